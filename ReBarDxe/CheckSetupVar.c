@@ -8,38 +8,56 @@
 #include "EfiVariable.h"
 #include "NvStrapsConfig.h"
 #include "StatusVar.h"
+#include "PhaseTimer.h"
+#include "SetupVarCRC.h"
 #include "CheckSetupVar.h"
 
 static CHAR16 const SETUP_VAR_NAME[] = L"Setup";
 static CHAR16 const CUSTOM_VAR_NAME[] = L"Custom";
 
-static uint_least64_t const ECMA_128_CRC_POLY = UINT64_C(0xC96C'5795'D787'0F42);
+static inline bool HasSetupVarAttributes(UINT32 attributes)
+{
+    return (attributes & (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS)) == (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS)
+	&& !(attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD);
+}
 
-static uint_least64_t ecma128_crc64(BYTE const *buffer, BYTE const *bufferEnd, uint_least64_t crcValue)
+// Read the variable into a new buffer of *varSize bytes, padded up to a multiple of QWORD_SIZE with the padding length
+static EFI_STATUS ReadSetupVariable(CHAR16 const *name, EFI_GUID *guid, UINT32 *attributes, UINTN *varSize, BYTE **data)
 {
-    crcValue = ~crcValue & (uint_least64_t)UINT64_C(0xFFFF'FFFF'FFFF'FFFF);
+    EFI_STATUS status = gBS->AllocatePool(EfiBootServicesData, *varSize + ((8u - *varSize) & 0b0000'0111u), (VOID **)data);
 
-    while (buffer != bufferEnd)
+    if (EFI_ERROR(status))
     {
-	crcValue ^= unpack_QWORD(buffer), buffer += QWORD_SIZE;
+	*data = NULL;
+	SetEFIError(EFIError_AllocateSetupVarData, status);
 
-	for (unsigned char bitIndex = 0u; bitIndex < QWORD_BITSIZE; bitIndex++)
-	    if (crcValue & UINT64_C(1) << (QWORD_BITSIZE - 1u))
-		crcValue <<= 1u, crcValue ^= ECMA_128_CRC_POLY;
-	    else
-		crcValue <<= 1u;
+	return status;
+    }
+
+    status = gRT->GetVariable((CHAR16 *)name, guid, attributes, varSize, *data);
+
+    if (EFI_ERROR(status))
+    {
+	gBS->FreePool(*data), *data = NULL;
+
+	return status;
     }
 
-    return ~crcValue & (uint_least64_t)UINT64_C(0xFFFF'FFFF'FFFF'FFFF);
+    uint_least8_t paddingLength = (8u - *varSize) & 0b0000'0111u;
+
+    for (unsigned i = 0u; i < paddingLength; i++)
+	(*data)[*varSize + i] = paddingLength;
+
+    return status;
 }
 
-static BYTE *LoadSetupVariable(CHAR16 const *name, EFI_GUID *guid, UINTN *dataLength)
+static BYTE *LoadSetupVariable(CHAR16 const *name, EFI_GUID *guid, UINTN *varSize, UINTN *dataLength)
 {
     UINT32 attributes = 0u;
-    *dataLength = 0u;
+    *varSize = 0u;
     BYTE *data = NULL;
 
-    EFI_STATUS status = gRT->GetVariable((CHAR16 *)name, guid, &attributes, dataLength, NULL);
+    EFI_STATUS status = gRT->GetVariable((CHAR16 *)name, guid, &attributes, varSize, NULL);
 
     if (status != EFI_BUFFER_TOO_SMALL)
     {
@@ -47,44 +65,81 @@ static BYTE *LoadSetupVariable(CHAR16 const *name, EFI_GUID *guid, UINTN *dataLe
 	return NULL;
     }
 
-    uint_least8_t paddingLength = 8u - *dataLength & 0b0000'0111u;
-
-    status = gBS->AllocatePool(EfiBootServicesData, *dataLength + paddingLength, (VOID **)&data);
+    status = ReadSetupVariable(name, guid, &attributes, varSize, &data);
 
     if (EFI_ERROR(status))
     {
-	SetEFIError(EFIError_AllocateSetupVarData, status);
+	SetEFIError(EFIError_ReadSetupVar, status);
 
 	return NULL;
     }
 
-    for (unsigned i = 0u; i < paddingLength; i++)
-	data[*dataLength + i] = paddingLength;
-
-    status = gRT->GetVariable((CHAR16 *)name, guid, &attributes, dataLength, data);
-
-    if (EFI_ERROR(status))
+    if (!HasSetupVarAttributes(attributes))
     {
 	gBS->FreePool(data), data = NULL;
-	SetEFIError(EFIError_ReadSetupVar, status);
+	SetStatusVar(StatusVar_BadSetupVarAttributes);
 
 	return NULL;
     }
 
-    if (   (attributes & (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS)) != (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS)
-	|| (attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD))
+    *dataLength = *varSize + ((8u - *varSize) & 0b0000'0111u);
+
+    return data;
+}
+
+// Read the variable found on a previous boot directly, with no enumeration and no separate size query. Any failure
+// is silent, the caller falls back to the full search that reports the error.
+static BYTE *LoadCachedSetupVariable(CHAR16 const *name, EFI_GUID *guid, UINTN *varSize, UINTN *dataLength)
+{
+    UINT32 attributes = 0u;
+    BYTE *data = NULL;
+
+    if (*varSize < 16u)
+	return NULL;
+
+    // "Setup" under any GUID has precedence over "Custom" during enumeration, and may have been created since. Only the
+    // full enumeration can rule it out, so a cached "Custom" variable is not used
+    if (name == CUSTOM_VAR_NAME)
+	return NULL;
+
+    EFI_STATUS status = ReadSetupVariable(name, guid, &attributes, varSize, &data);
+
+    if (status == EFI_BUFFER_TOO_SMALL)		    // variable grew, *varSize is updated
+	status = ReadSetupVariable(name, guid, &attributes, varSize, &data);
+
+    if (EFI_ERROR(status))
+	return NULL;
+
+    if (!HasSetupVarAttributes(attributes))
     {
-	gBS->FreePool(data), data = NULL;
-	SetStatusVar(StatusVar_BadSetupVarAttributes);
+	gBS->FreePool(data);
 
 	return NULL;
     }
 
-    *dataLength += paddingLength;
+    *dataLength = *varSize + ((8u - *varSize) & 0b0000'0111u);
 
     return data;
 }
 
+static inline void PackSetupVarGUID(uint_least8_t guidBytes[SETUP_VAR_GUID_SIZE], EFI_GUID const *guid)
+{
+    BYTE *buffer = pack_WORD(pack_WORD(pack_DWORD(guidBytes, guid->Data1), guid->Data2), guid->Data3);
+
+    for (unsigned i = 0u; i < ARRAY_SIZE(guid->Data4); i++)
+	buffer = pack_BYTE(buffer, guid->Data4[i]);
+}
+
+static inline void UnpackSetupVarGUID(EFI_GUID *guid, uint_least8_t const guidBytes[SETUP_VAR_GUID_SIZE])
+{
+    guid->Data1 = unpack_DWORD(guidBytes);
+    guid->Data2 = unpack_WORD(guidBytes + DWORD_SIZE);
+    guid->Data3 = unpack_WORD(guidBytes + DWORD_SIZE + WORD_SIZE);
+
+    for (unsigned i = 0u; i < ARRAY_SIZE(guid->Data4); i++)
+	guid->Data4[i] = unpack_BYTE(guidBytes + DWORD_SIZE + 2u * WORD_SIZE + i);
+}
+
 static bool FreeSetupVariable(BYTE *data)
 {
     if (data)
@@ -219,19 +274,26 @@ static bool NextUefiVariableName(UefiString *str, EFI_GUID *efiGUID)
     EFI_STATUS status = gRT->GetNextVariableName(&length, str->ptr, efiGUID);
 
     if (EFI_ERROR(status) && status == EFI_BUFFER_TOO_SMALL)
+    {
 	if (ReallocateUefiString(str, ++length))
 	    status = gRT->GetNextVariableName(&length, str->ptr, efiGUID);
 	else
 	    return false;
+    }
 
     if (EFI_ERROR(status))
+    {
 	if (status == EFI_NOT_FOUND)
-	    length = 0u;
+	{
+	    str->length = 0u;		// end of enumeration, the last name is left in the buffer
+	    return true;
+	}
 	else
 	{
 	    SetEFIError(EFIError_EnumVar, status);
 	    return false;
 	}
+    }
 
     str->length = LStringLength(str->ptr, str->capacity);
 
@@ -263,6 +325,7 @@ static CHAR16 const *FindSetupVariable(EFI_GUID *efiGUID)
 	if (varName.length)
 	{
 	    if (varName.length == ARRAY_SIZE(CUSTOM_VAR_NAME) - 1u && CompareUefiString(&varName, CUSTOM_VAR_NAME) == 0)
+	    {
 		if (setupVarName < SetupVar_Custom)
 		{
 		    setupVarName = SetupVar_Custom;
@@ -270,9 +333,8 @@ static CHAR16 const *FindSetupVariable(EFI_GUID *efiGUID)
 		}
 		else
 		    if (setupVarName == SetupVar_Custom)
-			multipleCustomVariables = true;		// "Custom" variable found twice
-		    else
-			;					// "Setup" variable has precedence over "Custom"
+			multipleCustomVariables = true;		// "Custom" variable found twice, "Setup" has precedence over "Custom"
+	    }
 	    else
 		if (varName.length == ARRAY_SIZE(SETUP_VAR_NAME) - 1u && CompareUefiString(&varName, SETUP_VAR_NAME) == 0)
 		{
@@ -287,6 +349,7 @@ static CHAR16 const *FindSetupVariable(EFI_GUID *efiGUID)
 		    }
 
 		    if (varSize >= 16u /* && !!(attributes & EFI_VARIABLE_NON_VOLATILE) && !!(attributes & EFI_VARIABLE_BOOTSERVICE_ACCESS) */)
+		    {
 			if (setupVarName < SetupVar_Setup)
 			{
 			    setupVarName = SetupVar_Setup;
@@ -300,6 +363,7 @@ static CHAR16 const *FindSetupVariable(EFI_GUID *efiGUID)
 			    enumerationCompleted = true;
 			    break;
 			}
+		    }
 		}
 	}
 	else
@@ -346,35 +410,73 @@ bool IsSetupVariableChanged()
 	return true;
 
     EFI_GUID setupVarGuid = { .Data1 = 0u, .Data2 = 0u, .Data3 = 0u, };
-    CHAR16 const *varName = FindSetupVariable(&setupVarGuid);
+    uint_least8_t guidBytes[SETUP_VAR_GUID_SIZE];
+    uint_least32_t cachedSize = 0u;
+    uint_least8_t cachedName = NvStrapsConfig_SetupVarName(config, guidBytes, &cachedSize);
+    CHAR16 const *varName = NULL;
+    UINTN varSize = cachedSize, length = 0u;
+    BYTE *data = NULL;
 
-    if (!varName)
-	return true;
+    uint_least64_t startTime = PhaseTimer_Start();
 
-    UINTN length;
-    BYTE *data = LoadSetupVariable(varName, &setupVarGuid, &length);
+    if (cachedName != SetupVarName_None)
+    {
+	varName = cachedName == SetupVarName_Setup ? SETUP_VAR_NAME : CUSTOM_VAR_NAME;
+	UnpackSetupVarGUID(&setupVarGuid, guidBytes);
+	data = LoadCachedSetupVariable(varName, &setupVarGuid, &varSize, &length);
+	PhaseTimer_Stop(PhaseTimer_SetupVarLoad, startTime);
+    }
 
     if (!data)
-	return true;
+    {
+	startTime = PhaseTimer_Start();
+	varName = FindSetupVariable(&setupVarGuid);
+	PhaseTimer_Stop(PhaseTimer_SetupVarEnum, startTime);
+
+	if (!varName)
+	{
+	    NvStrapsConfig_SetSetupVarName(config, SetupVarName_None, guidBytes, 0u);
+	    return true;
+	}
+
+	startTime = PhaseTimer_Start();
+	data = LoadSetupVariable(varName, &setupVarGuid, &varSize, &length);
+	PhaseTimer_Stop(PhaseTimer_SetupVarLoad, startTime);
+
+	if (!data)
+	    return true;
+    }
+
+    startTime = PhaseTimer_Start();
 
     uint_least64_t crc64 = ecma128_crc64(data, data + length, 0u);
 
+    PhaseTimer_Stop(PhaseTimer_SetupVarCRC, startTime);
+
     if (FreeSetupVariable(data))
     {
 	data = NULL;
 
-	if (NvStrapsConfig_HasSetupVarCRC(config))
-	    return NvStrapsConfig_SetupVarCRC(config) != crc64;
+	PackSetupVarGUID(guidBytes, &setupVarGuid);
+	NvStrapsConfig_SetSetupVarName(config, varName == SETUP_VAR_NAME ? SetupVarName_Setup : SetupVarName_Custom, guidBytes, (uint_least32_t)varSize);
+
+	bool isChanged = NvStrapsConfig_HasSetupVarCRC(config) && NvStrapsConfig_SetupVarCRC(config) != crc64;
 
-	NvStrapsConfig_SetSetupVarCRC(config, crc64);
-	NvStrapsConfig_SetHasSetupVarCRC(config, true);
+	if (!NvStrapsConfig_HasSetupVarCRC(config))
+	{
+	    NvStrapsConfig_SetSetupVarCRC(config, crc64);
+	    NvStrapsConfig_SetHasSetupVarCRC(config, true);
+	}
 
-	SaveNvStrapsConfig(&errorCode);
+	if (!isChanged)
+	{
+	    SaveNvStrapsConfig(&errorCode);
 
-	if (EFI_ERROR(errorCode))
-	    SetEFIError(EFIError_WriteConfigVar, errorCode);
+	    if (EFI_ERROR(errorCode))
+		SetEFIError(EFIError_WriteConfigVar, errorCode);
+	}
 
-	return false;
+	return isChanged;
     }
 
     return true;
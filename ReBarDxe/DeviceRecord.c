@@ -0,0 +1,110 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <Uefi.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "LocalAppConfig.h"
+#include "StatusVar.h"
+#include "PciConfig.h"
+#include "DeviceRecord.h"
+
+// Records are kept in an array that grows as needed, with hash chains linked by array index
+#define DEVICE_RECORD_BUCKETS	    64u
+#define DEVICE_RECORD_MIN_COUNT	    32u
+
+static uint_least16_t const NO_RECORD = WORD_BITMASK;
+
+static DeviceRecord *deviceRecords = NULL;
+static uint_least16_t deviceRecordCount = 0u, deviceRecordCapacity = 0u;
+static uint_least16_t deviceRecordBuckets[DEVICE_RECORD_BUCKETS];
+
+static unsigned deviceRecordHash(UINTN pciAddress)
+{
+    uint_least8_t bus, dev, fun;
+    pciUnpackAddress(pciAddress, &bus, &dev, &fun);
+
+    uint_least16_t pciLocation = pciPackLocation(bus, dev, fun);
+
+    return (pciLocation ^ pciLocation >> 6u) % DEVICE_RECORD_BUCKETS;
+}
+
+static bool growDeviceRecords()
+{
+    uint_least16_t newCapacity = deviceRecordCapacity ? deviceRecordCapacity * 2u : DEVICE_RECORD_MIN_COUNT;
+    DeviceRecord *newRecords = NULL;
+
+    if (newCapacity <= deviceRecordCapacity || newCapacity == NO_RECORD)
+	return false;
+
+    EFI_STATUS status = gBS->AllocatePool(EfiBootServicesData, newCapacity * sizeof *newRecords, (VOID **)&newRecords);
+
+    if (EFI_ERROR(status))
+    {
+	SetEFIError(EFIError_AllocateDeviceRecord, status);
+	return false;
+    }
+
+    if (deviceRecords)
+    {
+	CopyMem(newRecords, deviceRecords, deviceRecordCount * sizeof *deviceRecords);
+	gBS->FreePool(deviceRecords);
+    }
+    else
+	SetMem16(deviceRecordBuckets, sizeof deviceRecordBuckets, NO_RECORD);
+
+    deviceRecords = newRecords;
+    deviceRecordCapacity = newCapacity;
+
+    return true;
+}
+
+DeviceRecord *DeviceRecord_Find(UINTN pciAddress)
+{
+    if (!deviceRecords)
+	return NULL;
+
+    for (uint_least16_t index = deviceRecordBuckets[deviceRecordHash(pciAddress)]; index != NO_RECORD; index = deviceRecords[index].nextRecord)
+	if (deviceRecords[index].pciAddress == pciAddress)
+	    return deviceRecords + index;
+
+    return NULL;
+}
+
+DeviceRecord *DeviceRecord_Add(UINTN pciAddress)
+{
+    DeviceRecord *record = DeviceRecord_Find(pciAddress);
+
+    if (!record)
+    {
+	if (deviceRecordCount == deviceRecordCapacity && !growDeviceRecords())
+	    return NULL;
+
+	unsigned bucket = deviceRecordHash(pciAddress);
+
+	record = deviceRecords + deviceRecordCount;
+	record->nextRecord = deviceRecordBuckets[bucket];
+	deviceRecordBuckets[bucket] = deviceRecordCount++;
+    }
+
+    uint_least16_t nextRecord = record->nextRecord;
+
+    SetMem(record, sizeof *record, 0u);
+    record->pciAddress = pciAddress;
+    record->nextRecord = nextRecord;
+
+    return record;
+}
+
+uint_least16_t DeviceRecord_Count(void)
+{
+    return deviceRecordCount;
+}
+
+DeviceRecord *DeviceRecord_Get(uint_least16_t index)
+{
+    return index < deviceRecordCount ? deviceRecords + index : NULL;
+}
+
+// vim: ft=cpp
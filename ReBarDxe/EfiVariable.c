@@ -20,6 +20,16 @@
 #include "LocalAppConfig.h"
 #include "EfiVariable.h"
 
+// External definitions for the inline functions in EfiVariable.h
+extern inline uint_least8_t unpack_BYTE(BYTE const *buffer);
+extern inline uint_least16_t unpack_WORD(BYTE const *buffer);
+extern inline uint_least32_t unpack_DWORD(BYTE const *buffer);
+extern inline uint_least64_t unpack_QWORD(BYTE const *buffer);
+extern inline BYTE *pack_BYTE(BYTE *buffer, uint_least8_t value);
+extern inline BYTE *pack_WORD(BYTE *buffer, uint_least16_t value);
+extern inline BYTE *pack_DWORD(BYTE *buffer, uint_least32_t value);
+extern inline BYTE *pack_QWORD(BYTE *buffer, uint_least64_t value);
+
 // e3ee4a27-e2a2-4435-bba3-184ccad935a8                    // the PLATFROM_GUID from .dsc file
 
 #if defined(UEFI_SOURCE) || defined(EFIAPI)
@@ -156,7 +166,7 @@ ERROR_CODE ReadEfiVariable(char const *name, BYTE *buffer, uint_least32_t *size)
 #endif
 }
 
-ERROR_CODE WriteEfiVariable(char const name[MAX_VARIABLE_NAME_LENGTH], BYTE /* const */ *buffer, uint_least32_t size, uint_least32_t attributes)
+ERROR_CODE WriteEfiVariable(char const *name, BYTE /* const */ *buffer, uint_least32_t size, uint_least32_t attributes)
 {
 #if defined(UEFI_SOURCE) || defined(EFIAPI)
     CHAR16 varName[MAX_VARIABLE_NAME_LENGTH + 1u];
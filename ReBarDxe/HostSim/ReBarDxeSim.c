@@ -0,0 +1,578 @@
+// Runs the ReBarDxe driver as a Linux program, against a simulated platform with many PCI buses and GPUs, to
+// measure the driver work during boot and to check the resulting GPU STRAPS and status variable.
+//
+// Each boot runs in a new process, so the driver starts with no state from the previous boot, like on the real
+// firmware. Only the non-volatile variables are kept from one boot to the next.
+
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <Uefi.h>
+#include <Guid/EventGroup.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Protocol/S3SaveState.h>
+
+#include "LocalAppConfig.h"
+#include "DeviceRegistry.h"
+#include "NvStrapsConfig.h"
+#include "EfiVariable.h"
+#include "StatusVar.h"
+#include "PhaseTimer.h"
+#include "PciConfig.h"
+#include "TopologyCache.h"
+
+#include "SimPlatform.h"
+#include "SimPci.h"
+
+EFI_STATUS EFIAPI rebarInit(EFI_HANDLE imageHandle, EFI_SYSTEM_TABLE *systemTable);
+
+static EFI_GUID const driverVariableGuid = { 0xE3EE4A27u, 0xE2A2u, 0x4435u, { 0xBBu, 0xA3u, 0x18u, 0x4Cu, 0xCAu, 0xD9u, 0x35u, 0xA8u } };
+static EFI_GUID const amiSetupGuid = { 0xEC87D643u, 0xEBA4u, 0x4BB5u, { 0xA1u, 0xE5u, 0x3Fu, 0x3Eu, 0x36u, 0xB2u, 0x0Du, 0xA9u } };
+static EFI_GUID const dummyVariableGuid = { 0x5A3C7E21u, 0x94B1u, 0x4F0Eu, { 0x8Du, 0x62u, 0x1Bu, 0x07u, 0xC4u, 0x9Eu, 0x55u, 0x30u } };
+
+static char const *const phaseTimerNames[PhaseTimer_Count] =
+{
+    "DriverInit", "LoadConfig", "SetupVarEnum", "SetupVarLoad", "SetupVarCRC", "CMOSCheck", "HookInstall",
+    "PreprocessController", "StrapsRemap", "StrapsMMIO", "StrapsSettle", "ReBarWrite"
+};
+
+static struct
+{
+    unsigned setupVarSize, variableCount, warmBoots, expectedSetupCalls;
+    uint_least8_t reBarSelector, expectedReBarSize;
+    uint_least64_t apertureSize;
+    bool skipS3Resume, hasBar0Hint, hasGcdSpace;
+    SimPciOptions pci;
+}
+    options =
+{
+    .setupVarSize = 0x4000u,
+    .variableCount = 300u,
+    .warmBoots = 0u,
+    .expectedSetupCalls = 0u,
+    .reBarSelector = TARGET_PCI_BAR_SIZE_MAX,
+    .expectedReBarSize = 0u,
+    .apertureSize = UINT64_C(0x200'0000'0000),
+    .skipS3Resume = false,
+    .hasBar0Hint = true,
+    .hasGcdSpace = true,
+    .pci =
+    {
+	.busCount = 256u,
+	.gpuCount = 32u,
+	.useEcam = false,
+	.hasGpuReBar = true,
+	.acceptBlockReads = true,
+	.preassignBar0 = false,
+	.strapsBarSize = BarSizeSelector_256M,
+	.bar0Base = 0x8000'0000u,
+	.settleDelay = 5'000'000u
+    }
+};
+
+static void Usage(char const *programName)
+{
+    fprintf(stderr,
+	"Usage: %s [options]\n"
+	"  --buses N          PCI buses in segment 0, one root port for each bus after bus 0 (default 256)\n"
+	"  --gpus N           number of GPUs, the first %u are configured (default 32)\n"
+	"  --setup-size N     size of the Setup variable in bytes (default 16384)\n"
+	"  --vars N           other non-volatile variables in the store (default 300)\n"
+	"  --ecam             configure the driver to use ECAM from the ACPI MCFG table\n"
+	"  --rebar N          target PCI BAR size selector, 0 to only set the GPU STRAPS (default 32)\n"
+	"  --warm N           boots to run before the measured boot (default 0)\n"
+	"  --no-gpu-rebar     GPUs without a Resizable BAR capability\n"
+	"  --no-s3            configure the driver to skip the S3 resume boot script\n"
+	"  --no-block-reads   RootBridgeIo rejects config space reads with Count > 1\n"
+	"  --preassigned-bar0 the first GPU already decodes the configured BAR0 range before enumeration\n"
+	"  --bar0 ADDRESS     BAR0 address for the GPUs while the STRAPS are written (default 0x80000000)\n"
+	"  --no-bar0-hint     leave the BAR0 address out of the driver configuration, for the GCD to choose it\n"
+	"  --no-gcd-space     no free MMIO or I/O space in the GCD, the driver uses the configured BAR0 unallocated\n"
+	"  --aperture SIZE    64-bit MMIO aperture of the root bridge, free in the GCD (default 0x20000000000)\n"
+	"  --expect-rebar N   expected BAR1 size 2^N MiB for the configured GPUs after the boot\n"
+	"  --expect-setup N   expected STRAPS settle waits and ReBAR size writes in the boot\n",
+	programName, (unsigned)NvStraps_GPU_MAX_COUNT);
+}
+
+static bool ParseOptions(int argc, char *argv[])
+{
+    static struct option const longOptions[] =
+    {
+	{ "buses",	    required_argument, NULL, 'b' },
+	{ "gpus",	    required_argument, NULL, 'g' },
+	{ "setup-size",	    required_argument, NULL, 's' },
+	{ "vars",	    required_argument, NULL, 'v' },
+	{ "ecam",	    no_argument,       NULL, 'e' },
+	{ "rebar",	    required_argument, NULL, 'r' },
+	{ "warm",	    required_argument, NULL, 'w' },
+	{ "no-gpu-rebar",   no_argument,       NULL, 'G' },
+	{ "no-s3",	    no_argument,       NULL, 'S' },
+	{ "no-block-reads", no_argument,       NULL, 'B' },
+	{ "preassigned-bar0", no_argument,     NULL, 'P' },
+	{ "bar0",	    required_argument, NULL, '0' },
+	{ "no-bar0-hint",   no_argument,       NULL, 'H' },
+	{ "no-gcd-space",   no_argument,       NULL, 'N' },
+	{ "aperture",	    required_argument, NULL, 'A' },
+	{ "expect-rebar",   required_argument, NULL, 'X' },
+	{ "expect-setup",   required_argument, NULL, 'C' },
+	{ "help",	    no_argument,       NULL, 'h' },
+	{ NULL,		    0,		       NULL, 0 }
+    };
+
+    int option;
+
+    while ((option = getopt_long(argc, argv, "h", longOptions, NULL)) != -1)
+	switch (option)
+	{
+	case 'b':
+	    options.pci.busCount = (unsigned)strtoul(optarg, NULL, 0);
+	    break;
+	case 'g':
+	    options.pci.gpuCount = (unsigned)strtoul(optarg, NULL, 0);
+	    break;
+	case 's':
+	    options.setupVarSize = (unsigned)strtoul(optarg, NULL, 0);
+	    break;
+	case 'v':
+	    options.variableCount = (unsigned)strtoul(optarg, NULL, 0);
+	    break;
+	case 'e':
+	    options.pci.useEcam = true;
+	    break;
+	case 'r':
+	    options.reBarSelector = (uint_least8_t)strtoul(optarg, NULL, 0);
+	    break;
+	case 'w':
+	    options.warmBoots = (unsigned)strtoul(optarg, NULL, 0);
+	    break;
+	case 'G':
+	    options.pci.hasGpuReBar = false;
+	    break;
+	case 'S':
+	    options.skipS3Resume = true;
+	    break;
+	case 'B':
+	    options.pci.acceptBlockReads = false;
+	    break;
+	case 'P':
+	    options.pci.preassignBar0 = true;
+	    break;
+	case '0':
+	    options.pci.bar0Base = strtoull(optarg, NULL, 0);
+	    break;
+	case 'H':
+	    options.hasBar0Hint = false;
+	    break;
+	case 'N':
+	    options.hasGcdSpace = false;
+	    break;
+	case 'A':
+	    options.apertureSize = strtoull(optarg, NULL, 0);
+	    break;
+	case 'X':
+	    options.expectedReBarSize = (uint_least8_t)strtoul(optarg, NULL, 0);
+	    break;
+	case 'C':
+	    options.expectedSetupCalls = (unsigned)strtoul(optarg, NULL, 0);
+	    break;
+	default:
+	    Usage(argv[0u]);
+	    return false;
+	}
+
+    if (optind < argc || !options.setupVarSize)
+	return Usage(argv[0u]), false;
+
+    return true;
+}
+
+// Variables from other drivers, with the Setup variable in the middle of the enumeration order
+static void FillVariableStore(void)
+{
+    static UINT8 data[0x100u];
+    UINT8 *setupData = malloc(options.setupVarSize);
+    CHAR16 name[0x20u];
+    char asciiName[0x20u];
+
+    for (unsigned index = 0u; index < sizeof data; index++)
+	data[index] = (UINT8)(index * 37u + 11u);
+
+    for (unsigned index = 0u; index < options.setupVarSize; index++)
+	setupData[index] = (UINT8)(index * 131u >> 3u);
+
+    for (unsigned index = 0u; index <= options.variableCount; index++)
+	if (index == options.variableCount / 2u)
+	{
+	    SimPlatform_AsciiToUcs2(name, "Setup", ARRAY_SIZE(name));
+	    SimPlatform_SetVariable(name, &amiSetupGuid, EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS, options.setupVarSize, setupData);
+	}
+	else
+	{
+	    snprintf(asciiName, sizeof asciiName, "SimVariable%04u", index);
+	    SimPlatform_AsciiToUcs2(name, asciiName, ARRAY_SIZE(name));
+	    SimPlatform_SetVariable(name, &dummyVariableGuid, EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS, 16u + index % (sizeof data - 16u), data);
+	}
+
+    free(setupData);
+}
+
+static inline bool isConfiguredGpu(unsigned gpuIndex)
+{
+    return gpuIndex < NvStraps_GPU_MAX_COUNT;
+}
+
+// Configuration as saved by ReBarState, with the GPU and bridge locations for the first GPUs
+static void CreateConfig(void)
+{
+    NvStrapsConfig *config = GetNvStrapsConfig(false, NULL);
+
+    NvStrapsConfig_SetGlobalEnable(config, 1u);
+    NvStrapsConfig_SetTargetPciBarSizeSelector(config, options.reBarSelector);
+    NvStrapsConfig_SetUsePciECAM(config, options.pci.useEcam);
+    NvStrapsConfig_SetSkipS3Resume(config, options.skipS3Resume);
+
+    for (unsigned gpuIndex = 0u; gpuIndex < SimPci_GpuCount() && isConfiguredGpu(gpuIndex); gpuIndex++)
+    {
+	SimPciFunction const *gpu = SimPci_Gpu(gpuIndex), *bridge = gpu->bridge;
+
+	NvStraps_GPUConfig gpuConfig =
+	{
+	    .deviceID = gpu->config[0x02u] | gpu->config[0x03u] << 8u,
+	    .subsysVendorID = gpu->config[0x2Cu] | gpu->config[0x2Du] << 8u,
+	    .subsysDeviceID = gpu->config[0x2Eu] | gpu->config[0x2Fu] << 8u,
+	    .bus = gpu->bus, .device = gpu->dev, .function = gpu->fn,
+	    .bar0 = { .base = options.hasBar0Hint ? options.pci.bar0Base : 0u, .top = options.hasBar0Hint ? options.pci.bar0Base + 0x0100'0000u - 1u : 0u }
+	};
+
+	NvStraps_BridgeConfig bridgeConfig =
+	{
+	    .vendorID = bridge->config[0x00u] | bridge->config[0x01u] << 8u,
+	    .deviceID = bridge->config[0x02u] | bridge->config[0x03u] << 8u,
+	    .bridgeBus = bridge->bus, .bridgeDevice = bridge->dev, .bridgeFunction = bridge->fn,
+	    .bridgeSecondaryBus = bridge->config[0x19u]
+	};
+
+	NvStrapsConfig_SetGPUConfig(config, &gpuConfig);
+	NvStrapsConfig_SetBridgeConfig(config, &bridgeConfig);
+    }
+
+    NvStrapsConfig_SetIsDirty(config, true);
+    SaveNvStrapsConfig(NULL);
+}
+
+// PciBusDxe calls PreprocessController for every function found, then again for every function before the resources are collected
+static void RunBoot(void)
+{
+    EFI_PCI_CONTROLLER_RESOURCE_ALLOCATION_PHASE const phases[] = { EfiPciBeforeChildBusEnumeration, EfiPciBeforeResourceCollection };
+
+    rebarInit(gImageHandle, gST);
+
+    for (unsigned phaseIndex = 0u; phaseIndex < ARRAY_SIZE(phases); phaseIndex++)
+	for (unsigned index = 0u; index < SimPci_FunctionCount(); index++)
+	{
+	    SimPciFunction const *function = SimPci_Function(index);
+	    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_PCI_ADDRESS address = { .Register = 0u, .Function = function->fn, .Device = function->dev, .Bus = function->bus };
+
+	    simHostBridge.PreprocessController(&simHostBridge, simRootBridgeHandle, address, phases[phaseIndex]);
+	}
+
+    SimPlatform_SignalEventGroup(&gEfiEndOfDxeEventGroupGuid);
+    SimPlatform_SignalEventGroup(&gEfiEventReadyToBootGuid);
+}
+
+// Runs one boot in a child process, and keeps the non-volatile variables it leaves behind
+static bool RunInChild(void (*boot)(void))
+{
+    int pipeFd[2u];
+
+    if (pipe(pipeFd))
+	return perror("ReBarDxeSim: pipe"), false;
+
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+
+    if (pid < 0)
+	return perror("ReBarDxeSim: fork"), false;
+
+    if (!pid)
+    {
+	close(pipeFd[0u]);
+	boot();
+
+	bool isSaved = SimPlatform_SaveNonVolatileVariables(pipeFd[1u]);
+
+	close(pipeFd[1u]);
+	_exit(isSaved ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(pipeFd[1u]);
+
+    bool isLoaded = SimPlatform_LoadNonVolatileVariables(pipeFd[0u]);
+    int status = 0;
+
+    close(pipeFd[0u]);
+    waitpid(pid, &status, 0);
+
+    return isLoaded && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+static uint_least64_t WallClock(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint_least64_t)now.tv_sec * 1'000'000'000u + (uint_least64_t)now.tv_nsec;
+}
+
+static void PrintCounters(uint_least64_t wallTime)
+{
+    printf("Measured boot: %u buses, %u PCI functions, %u GPUs\n", options.pci.busCount, SimPci_FunctionCount(), SimPci_GpuCount());
+    printf("  wall time             %12.3f ms\n", wallTime / 1e6);
+    printf("  virtual time          %12.3f ms\n", SimPlatform_Now() / 1e6);
+    printf("  PreprocessController  %8llu\n", (unsigned long long)simCounters.preprocessCalls);
+    printf("  config reads          %8llu (%llu block reads)\n", (unsigned long long)simCounters.configReads, (unsigned long long)simCounters.configBlockReads);
+    printf("  config writes         %8llu\n", (unsigned long long)simCounters.configWrites);
+    printf("  ECAM reads / writes   %8llu / %llu\n", (unsigned long long)simCounters.ecamReads, (unsigned long long)simCounters.ecamWrites);
+    printf("  STRAPS updates        %8llu\n", (unsigned long long)simCounters.strapsUpdates);
+    printf("  ReBAR control writes  %8llu\n", (unsigned long long)simCounters.reBarWrites);
+    printf("  variable reads        %8llu\n", (unsigned long long)simCounters.variableReads);
+    printf("  variable writes       %8llu\n", (unsigned long long)simCounters.variableWrites);
+    printf("  variable enumerations %8llu\n", (unsigned long long)simCounters.variableEnumerations);
+    printf("  events created        %8llu\n", (unsigned long long)simCounters.eventsCreated);
+    printf("  timer waits           %8llu\n", (unsigned long long)simCounters.timerWaits);
+    printf("  Stall() calls         %8llu\n", (unsigned long long)simCounters.stallCalls);
+    printf("  pool allocations      %8llu\n", (unsigned long long)simCounters.poolAllocations);
+    printf("  GCD allocate / free   %8llu / %llu\n", (unsigned long long)simCounters.gcdAllocations, (unsigned long long)simCounters.gcdFrees);
+    printf("  boot script entries   %8llu\n", (unsigned long long)simCounters.bootScriptEntries);
+
+    for (unsigned opcode = 0u; opcode < ARRAY_SIZE(simCounters.bootScriptOpcodes); opcode++)
+	if (simCounters.bootScriptOpcodes[opcode])
+	    printf("    opcode 0x%02X        %8llu\n", opcode, (unsigned long long)simCounters.bootScriptOpcodes[opcode]);
+}
+
+// Returns the calls for each phase, 0 for the phases not in the variable
+static void PrintPhaseTimers(uint_least32_t calls[PhaseTimer_Count])
+{
+    for (unsigned phase = 0u; phase < PhaseTimer_Count; phase++)
+	calls[phase] = 0u;
+
+    UINTN size;
+    UINT8 const *buffer = SimPlatform_FindVariable(PhaseTimer_Name, &driverVariableGuid, &size);
+
+    if (!buffer || size < QWORD_SIZE + BYTE_SIZE || size != QWORD_SIZE + BYTE_SIZE + unpack_BYTE(buffer + QWORD_SIZE) * (UINTN)PHASE_TIMER_RECORD_SIZE)
+    {
+	printf("No valid %s variable\n", PhaseTimer_Name);
+	return;
+    }
+
+    uint_least64_t ticksPerSecond = unpack_QWORD(buffer);
+    unsigned count = unpack_BYTE(buffer + QWORD_SIZE);
+
+    printf("%s, %llu ticks per second:\n", PhaseTimer_Name, (unsigned long long)ticksPerSecond);
+
+    for (unsigned phase = 0u; phase < count && ticksPerSecond; phase++)
+    {
+	BYTE const *record = buffer + QWORD_SIZE + BYTE_SIZE + phase * PHASE_TIMER_RECORD_SIZE;
+
+	if (phase < PhaseTimer_Count)
+	    calls[phase] = unpack_DWORD(record + QWORD_SIZE);
+
+	printf("  %-22s %12.3f ms %8lu calls\n", phase < ARRAY_SIZE(phaseTimerNames) ? phaseTimerNames[phase] : "?",
+		unpack_QWORD(record) * 1e3 / ticksPerSecond, (unsigned long)unpack_DWORD(record + QWORD_SIZE));
+    }
+}
+
+// The driver should leave the topology for the next boot, when resizing BARs
+static bool PrintTopologyCache(void)
+{
+    UINTN size;
+    UINT8 const *buffer = SimPlatform_FindVariable(TopologyCache_Name, &driverVariableGuid, &size);
+
+    if (!buffer || size < 2u * BYTE_SIZE || unpack_BYTE(buffer) != TOPOLOGY_CACHE_VERSION)
+	return printf("No valid %s variable\n", TopologyCache_Name), options.reBarSelector < TARGET_PCI_BAR_SIZE_MIN || options.reBarSelector > TARGET_PCI_BAR_SIZE_MAX;
+
+    printf("%s: %u devices, %u bytes\n", TopologyCache_Name, (unsigned)unpack_BYTE(buffer + BYTE_SIZE), (unsigned)size);
+
+    return true;
+}
+
+// Returns the overall status, or StatusVar_ParseError
+static uint_least64_t PrintStatusVar(StatusVar_DeviceRecord records[STATUS_VAR_DEVICE_MAX_COUNT], unsigned *recordCount)
+{
+    UINTN size;
+    UINT8 const *buffer = SimPlatform_FindVariable(StatusVar_Name, &driverVariableGuid, &size);
+
+    *recordCount = 0u;
+
+    if (!buffer || size < QWORD_SIZE)
+	return printf("No valid %s variable\n", StatusVar_Name), StatusVar_ParseError;
+
+    uint_least64_t status = unpack_QWORD(buffer);
+
+    printf("%s: 0x%016llx (status %u)\n", StatusVar_Name, (unsigned long long)status, (unsigned)(status & BYTE_BITMASK));
+
+    if (size > QWORD_SIZE)
+    {
+	unsigned count = unpack_BYTE(buffer + QWORD_SIZE);
+
+	if (count > STATUS_VAR_DEVICE_MAX_COUNT || size != QWORD_SIZE + BYTE_SIZE + count * STATUS_VAR_DEVICE_RECORD_SIZE)
+	    return printf("  invalid device records\n"), StatusVar_ParseError;
+
+	for (unsigned index = 0u; index < count; index++)
+	{
+	    BYTE const *record = buffer + QWORD_SIZE + BYTE_SIZE + index * STATUS_VAR_DEVICE_RECORD_SIZE;
+
+	    records[index].segment = unpack_WORD(record);
+	    records[index].busLocation = unpack_WORD(record + 2u);
+	    records[index].flags = unpack_BYTE(record + 4u);
+	    records[index].status = unpack_BYTE(record + 5u);
+	    records[index].errorLocation = unpack_BYTE(record + 6u);
+	    records[index].errorStatus = unpack_BYTE(record + 7u);
+	    records[index].strapsStatus = unpack_BYTE(record + 8u);
+	    records[index].barSizeSelector = unpack_BYTE(record + 9u);
+	    records[index].reBarSizeMask = unpack_DWORD(record + 10u);
+	}
+
+	*recordCount = count;
+	printf("  %u device records\n", count);
+    }
+
+    return status;
+}
+
+static StatusVar_DeviceRecord const *FindDeviceRecord(StatusVar_DeviceRecord const *records, unsigned recordCount, SimPciFunction const *function)
+{
+    uint_least16_t busLocation = pciPackLocation(function->bus, function->dev, function->fn);
+
+    for (unsigned index = 0u; index < recordCount; index++)
+	if (records[index].segment == 0u && records[index].busLocation == busLocation)
+	    return records + index;
+
+    return NULL;
+}
+
+// The configured GPUs should end with the BAR size from the device registry in the STRAPS
+static bool CheckGpus(StatusVar_DeviceRecord const *records, unsigned recordCount)
+{
+    bool isValid = true;
+
+    for (unsigned gpuIndex = 0u; gpuIndex < SimPci_GpuCount(); gpuIndex++)
+    {
+	SimPciFunction *gpu = SimPci_Gpu(gpuIndex);
+	StatusVar_DeviceRecord const *record = FindDeviceRecord(records, recordCount, gpu);
+	BarSizeSelector expectedBarSize = lookupBarSizeInRegistry(gpu->config[0x02u] | gpu->config[0x03u] << 8u);
+	uint_least8_t strapsBarSize = SimPci_StrapsBarSize(gpu), reBarMaxSize = SimPci_ReBarMaxSize(gpu), reBarSize = SimPci_ReBarCurrentSize(gpu);
+	bool isGpuValid = !isConfiguredGpu(gpuIndex) || (strapsBarSize == expectedBarSize && (!options.pci.hasGpuReBar || reBarMaxSize == expectedBarSize + 6u));
+	bool isReBarSizeValid = !isConfiguredGpu(gpuIndex) || !options.expectedReBarSize || reBarSize == options.expectedReBarSize;
+
+	printf("  GPU %02x:%02x.%x  STRAPS BAR1 size %2u, ReBAR size 2^%-2u / max 2^%-2u MiB, status %3u, STRAPS status %3u%s%s\n",
+		gpu->bus, gpu->dev, gpu->fn, strapsBarSize, reBarSize, reBarMaxSize, record ? record->status : 0u, record ? record->strapsStatus : 0u,
+		isGpuValid ? isConfiguredGpu(gpuIndex) ? "" : "  (not configured)" : "  ** expected BAR1 size selector from the registry **",
+		isReBarSizeValid ? "" : "  ** unexpected BAR1 size **");
+
+	isValid = isValid && isGpuValid && isReBarSizeValid;
+    }
+
+    return isValid;
+}
+
+// After an S3 resume, the boot script alone should get the configured BAR size in the STRAPS of the configured GPUs
+static bool CheckS3Resume(void)
+{
+    unsigned lostWrites = SimPci_ReplayS3Resume();
+    bool isValid = !lostWrites;
+
+    printf("S3 resume: %u boot script entries replayed\n", SimPlatform_BootScriptEntryCount());
+
+    for (unsigned gpuIndex = 0u; gpuIndex < SimPci_GpuCount(); gpuIndex++)
+    {
+	SimPciFunction *gpu = SimPci_Gpu(gpuIndex);
+	BarSizeSelector expectedBarSize = lookupBarSizeInRegistry(gpu->config[0x02u] | gpu->config[0x03u] << 8u);
+	uint_least8_t strapsBarSize = SimPci_StrapsBarSize(gpu);
+
+	if (isConfiguredGpu(gpuIndex) && strapsBarSize != expectedBarSize)
+	{
+	    printf("  GPU %02x:%02x.%x  STRAPS BAR1 size %2u after resume  ** expected BAR1 size selector from the registry **\n", gpu->bus, gpu->dev, gpu->fn, strapsBarSize);
+	    isValid = false;
+	}
+    }
+
+    if (lostWrites)
+	printf("  %u STRAPS writes to an address not decoded on resume\n", lostWrites);
+
+    return isValid;
+}
+
+int main(int argc, char *argv[])
+{
+    if (!ParseOptions(argc, argv))
+	return EXIT_FAILURE;
+
+    SimPlatform_Init();
+
+    if (!SimPci_Init(&options.pci))
+	return EXIT_FAILURE;
+
+    SimPlatform_InstallProtocol(gImageHandle, &gEfiS3SaveStateProtocolGuid, &simS3SaveState);
+
+    // The GPUs only decode BAR0 at the configured address, so that is the only free MMIO space
+    if (options.hasGcdSpace)
+    {
+	SimPlatform_AddGcdSpace(false, options.pci.bar0Base, 0x0100'0000u);
+	SimPlatform_AddGcdSpace(true, 0xE000u, 0x2000u);
+
+	if (options.apertureSize)
+	    SimPlatform_AddGcdSpace(false, UINT64_C(0x100'0000'0000), options.apertureSize);
+    }
+
+    FillVariableStore();
+
+    if (!RunInChild(&CreateConfig))
+	return fprintf(stderr, "ReBarDxeSim: failed to create the driver configuration\n"), EXIT_FAILURE;
+
+    for (unsigned boot = 0u; boot < options.warmBoots; boot++)
+	if (!RunInChild(&RunBoot))
+	    return fprintf(stderr, "ReBarDxeSim: boot %u failed\n", boot + 1u), EXIT_FAILURE;
+
+    SimPlatform_Init();
+
+    uint_least64_t startTime = WallClock();
+
+    RunBoot();
+
+    uint_least64_t wallTime = WallClock() - startTime;
+    StatusVar_DeviceRecord records[STATUS_VAR_DEVICE_MAX_COUNT];
+    unsigned recordCount;
+    uint_least32_t phaseCalls[PhaseTimer_Count];
+
+    PrintCounters(wallTime);
+    PrintPhaseTimers(phaseCalls);
+
+    uint_least64_t status = PrintStatusVar(records, &recordCount);
+    bool isValid = CheckGpus(records, recordCount) && PrintTopologyCache();
+
+    if (!options.skipS3Resume)
+	isValid = CheckS3Resume() && isValid;
+
+    // The GPU setup is completed once for each root bridge, also when the BAR sizes are not planned
+    if (options.expectedSetupCalls && (phaseCalls[PhaseTimer_StrapsSettle] != options.expectedSetupCalls || phaseCalls[PhaseTimer_ReBarWrite] != options.expectedSetupCalls))
+	printf("%u STRAPS settle waits and %u ReBAR size writes, expected %u\n", (unsigned)phaseCalls[PhaseTimer_StrapsSettle], (unsigned)phaseCalls[PhaseTimer_ReBarWrite], options.expectedSetupCalls), isValid = false;
+
+    if (SimPlatform_GcdAllocationCount())
+	printf("%u GCD allocations not freed\n", SimPlatform_GcdAllocationCount()), isValid = false;
+
+    if ((status & BYTE_BITMASK) >= StatusVar_Internal_EFIError)
+	printf("Driver status %u is an error\n", (unsigned)(status & BYTE_BITMASK)), isValid = false;
+
+    return isValid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
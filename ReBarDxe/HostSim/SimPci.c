@@ -0,0 +1,770 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <Uefi.h>
+#include <Guid/Acpi.h>
+#include <IndustryStandard/Acpi.h>
+#include <Library/IoLib.h>
+#include <Protocol/PciRootBridgeIo.h>
+#include <Protocol/PciHostBridgeResourceAllocation.h>
+
+#include "SimPlatform.h"
+#include "SimPci.h"
+
+static uint_least32_t const
+    STRAPS_BASE_OFFSET = 0x0010'1000u,
+    STRAPS_PAGE_SIZE   = 0x0000'1000u,
+    GPU_BAR0_SIZE      = 0x0100'0000u,
+    ECAM_BASE_ADDRESS  = 0xE000'0000u,
+    ECAM_SIZE	       = 0x1000'0000u;
+
+static uint_least16_t const
+    VENDOR_INTEL = 0x8086u, DEVICE_HOST_BRIDGE = 0x4660u, DEVICE_ROOT_PORT = 0x7A38u, DEVICE_USB = 0x7A60u,
+    VENDOR_NVIDIA = 0x10DEu, DEVICE_TU102 = 0x1E07u, DEVICE_TU102_AUDIO = 0x10F7u,
+    VENDOR_ASUS = 0x1043u, DEVICE_ASUS_SUBSYS = 0x866Au,
+    VENDOR_SAMSUNG = 0x144Du, DEVICE_NVME = 0xA80Au;
+
+static SimPciOptions simOptions;
+static SimPciFunction *functions = NULL, *strapsOwner = NULL;
+static unsigned functionCount = 0u, gpuCount = 0u;
+static SimPciFunction **gpus = NULL;
+static SimPciFunction *functionMap[256u][32u][8u];
+static UINT8 *strapsPage = NULL;
+
+static inline void put16(UINT8 *config, unsigned offset, uint_least16_t value)
+{
+    config[offset] = value & 0xFFu, config[offset + 1u] = value >> 8u & 0xFFu;
+}
+
+static inline void put32(UINT8 *config, unsigned offset, uint_least32_t value)
+{
+    put16(config, offset, value & 0xFFFFu), put16(config, offset + 2u, value >> 16u & 0xFFFFu);
+}
+
+static inline uint_least32_t get32(UINT8 const *config, unsigned offset)
+{
+    return config[offset] | (uint_least32_t)config[offset + 1u] << 8u | (uint_least32_t)config[offset + 2u] << 16u | (uint_least32_t)config[offset + 3u] << 24u;
+}
+
+static inline bool isRangeOverlap(unsigned offset, unsigned size, unsigned regOffset, unsigned regSize)
+{
+    return offset < regOffset + regSize && regOffset < offset + size;
+}
+
+// PCI config space model
+
+static SimPciFunction *SimPci_AddFunction(uint_least8_t bus, uint_least8_t dev, uint_least8_t fn, SimPciKind kind, SimPciFunction *bridge)
+{
+    SimPciFunction *function = functions + functionCount++;
+
+    function->bus = bus, function->dev = dev, function->fn = fn;
+    function->kind = kind;
+    function->bridge = bridge;
+    functionMap[bus][dev][fn] = function;
+
+    return function;
+}
+
+static void SimPci_SetHeader(SimPciFunction *function, uint_least16_t vendorId, uint_least16_t deviceId, uint_least32_t classCode, uint_least8_t headerType)
+{
+    put16(function->config, 0x00u, vendorId);
+    put16(function->config, 0x02u, deviceId);
+    put32(function->config, 0x08u, classCode << 8u | 0x01u);
+    function->config[0x0Eu] = headerType;
+}
+
+// BAR1 sizes from 64 MiB up to the size selected by the STRAPS
+static void SimPci_UpdateGpuReBar(SimPciFunction *gpu)
+{
+    if (gpu->reBarOffset)
+	put32(gpu->config, gpu->reBarOffset + 4u, (uint_least32_t)((UINT32_C(1) << (gpu->strapsBarSize + 7u)) - (UINT32_C(1) << 6u)) << 4u);
+}
+
+// STRAPS as loaded by the GPU at power on
+static void SimPci_ResetStraps(SimPciFunction *gpu)
+{
+    gpu->strapsBarSize = simOptions.strapsBarSize;
+    gpu->straps0 = UINT32_C(0x0000'0101) | (uint_least32_t)(simOptions.strapsBarSize < 3u ? simOptions.strapsBarSize : simOptions.strapsBarSize < 10u ? 2u : 3u) << 14u;
+    gpu->straps1 = UINT32_C(0x0000'0010) | (uint_least32_t)(simOptions.strapsBarSize < 3u ? 0u : simOptions.strapsBarSize < 10u ? simOptions.strapsBarSize - 2u : 7u) << 20u;
+    gpu->isSettlePending = false;
+}
+
+static void SimPci_InitGpu(SimPciFunction *gpu)
+{
+    SimPci_SetHeader(gpu, VENDOR_NVIDIA, DEVICE_TU102, 0x03'0000u, 0x80u);
+    put32(gpu->config, 0x10u, 0x0000'0000u);	    // BAR0, 16 MiB, 32-bit
+    put32(gpu->config, 0x14u, 0x0000'000Cu);	    // BAR1, 64-bit prefetchable
+    put32(gpu->config, 0x1Cu, 0x0000'000Cu);	    // BAR3, 64-bit prefetchable
+    put32(gpu->config, 0x24u, 0x0000'0001u);	    // BAR5, I/O
+    put16(gpu->config, 0x2Cu, VENDOR_ASUS);
+    put16(gpu->config, 0x2Eu, DEVICE_ASUS_SUBSYS);
+
+    SimPci_ResetStraps(gpu);
+
+    // AER, then the Resizable BAR capability for BAR1, with the current size of 256 MiB
+    put32(gpu->config, 0x100u, UINT32_C(0x0001) | UINT32_C(1) << 16u | (simOptions.hasGpuReBar ? UINT32_C(0x140) << 20u : 0u));
+
+    if (simOptions.hasGpuReBar)
+    {
+	gpu->reBarOffset = 0x140u;
+	put32(gpu->config, 0x140u, UINT32_C(0x0015) | UINT32_C(1) << 16u);
+	put32(gpu->config, 0x148u, UINT32_C(1) | UINT32_C(1) << 5u | UINT32_C(8) << 8u);
+	SimPci_UpdateGpuReBar(gpu);
+    }
+}
+
+static void SimPci_InitNvme(SimPciFunction *function)
+{
+    SimPci_SetHeader(function, VENDOR_SAMSUNG, DEVICE_NVME, 0x01'0802u, 0x00u);
+    put32(function->config, 0x10u, 0x0000'0004u);	    // BAR0, 64-bit
+
+    // BAR0 sizes from 1 MiB to 8 MiB, current size 1 MiB
+    function->reBarOffset = 0x100u;
+    put32(function->config, 0x100u, UINT32_C(0x0015) | UINT32_C(1) << 16u);
+    put32(function->config, 0x104u, UINT32_C(0x0F) << 4u);
+    put32(function->config, 0x108u, UINT32_C(1) << 5u);
+}
+
+static void SimPci_AddSecondaryBus(SimPciFunction *rootPort, bool isGpuPort, unsigned *otherCount)
+{
+    uint_least8_t bus = rootPort->config[0x19u];
+
+    if (isGpuPort)
+    {
+	SimPciFunction *gpu = gpus[gpuCount++] = SimPci_AddFunction(bus, 0u, 0u, SimPciKind_Gpu, rootPort);
+	SimPciFunction *audio = SimPci_AddFunction(bus, 0u, 1u, SimPciKind_GpuAudio, rootPort);
+
+	rootPort->gpu = gpu;
+	SimPci_InitGpu(gpu);
+	SimPci_SetHeader(audio, VENDOR_NVIDIA, DEVICE_TU102_AUDIO, 0x04'0300u, 0x80u);
+	put16(audio->config, 0x2Cu, VENDOR_ASUS);
+	put16(audio->config, 0x2Eu, DEVICE_ASUS_SUBSYS);
+    }
+    else
+	switch ((*otherCount)++ % 3u)
+	{
+	case 0u:
+	    SimPci_InitNvme(SimPci_AddFunction(bus, 0u, 0u, SimPciKind_Nvme, rootPort));
+	    break;
+
+	case 1u:
+	    SimPci_SetHeader(SimPci_AddFunction(bus, 0u, 0u, SimPciKind_Usb, rootPort), VENDOR_INTEL, DEVICE_USB, 0x0C'0330u, 0x00u);
+	    break;
+
+	default:
+	    break;					    // empty slot
+	}
+}
+
+// Functions are added in the order PciBusDxe finds them, with the devices behind each root port right after the port
+static void SimPci_BuildTopology(unsigned requestedGpuCount)
+{
+    unsigned portCount = simOptions.busCount - 1u, otherCount = 0u;
+    SimPciFunction *hostBridge = SimPci_AddFunction(0u, 0u, 0u, SimPciKind_HostBridge, NULL);
+
+    SimPci_SetHeader(hostBridge, VENDOR_INTEL, DEVICE_HOST_BRIDGE, 0x06'0000u, portCount ? 0x80u : 0x00u);
+
+    // The GPUs at evenly spread root ports, and other devices cycled through the remaining ports
+    bool *isGpuPort = calloc(portCount ? portCount : 1u, sizeof *isGpuPort);
+
+    for (unsigned gpuIndex = 0u; gpuIndex < requestedGpuCount; gpuIndex++)
+	isGpuPort[gpuIndex * portCount / requestedGpuCount] = true;
+
+    for (unsigned port = 0u; port < portCount; port++)
+    {
+	uint_least8_t dev = port < 7u ? 0u : (port - 7u) / 8u + 1u, fn = port < 7u ? port + 1u : (port - 7u) % 8u;
+	bool isMultiFunction = dev == 0u || (dev - 1u) * 8u + 7u + 1u < portCount;
+	SimPciFunction *rootPort = SimPci_AddFunction(0u, dev, fn, SimPciKind_RootPort, NULL);
+
+	SimPci_SetHeader(rootPort, VENDOR_INTEL, DEVICE_ROOT_PORT, 0x06'0400u, isMultiFunction ? 0x81u : 0x01u);
+	rootPort->config[0x18u] = 0u;
+	rootPort->config[0x19u] = port + 1u;
+	rootPort->config[0x1Au] = port + 1u;
+	put16(rootPort->config, 0x1Cu, 0x00F0u);	    // I/O window closed
+	put32(rootPort->config, 0x20u, 0x0000'FFF0u);	    // memory window closed
+	put32(rootPort->config, 0x24u, 0x0000'FFF0u);
+
+	SimPci_AddSecondaryBus(rootPort, isGpuPort[port], &otherCount);
+    }
+
+    free(isGpuPort);
+}
+
+// Writable bits for each byte of the config space. Everything else is read-only.
+static UINT8 SimPci_WriteMask(SimPciFunction const *function, unsigned offset)
+{
+    if (offset == 0x04u)
+	return 0x07u;					    // I/O, memory, bus master
+    if (offset == 0x05u)
+	return 0x04u;					    // INTx disable
+    if (offset == 0x3Cu)
+	return 0xFFu;					    // interrupt line
+
+    if (function->kind == SimPciKind_RootPort)
+    {
+	if (offset >= 0x18u && offset < 0x1Bu)
+	    return 0xFFu;				    // bus numbers
+	if (offset == 0x1Cu || offset == 0x1Du)
+	    return 0xF0u;				    // I/O base and limit
+	if (offset >= 0x20u && offset < 0x28u)
+	    return offset & 1u ? 0xFFu : 0xF0u;		    // memory and prefetchable memory base and limit
+	if ((offset >= 0x28u && offset < 0x34u) || offset == 0x3Eu || offset == 0x3Fu)
+	    return 0xFFu;
+
+	return 0x00u;
+    }
+
+    if (function->kind == SimPciKind_Gpu && offset == 0x13u)
+	return 0xFFu;					    // BAR0, 16 MiB
+
+    if (function->reBarOffset && offset == function->reBarOffset + 9u)
+	return 0x3Fu;					    // BAR size in the first ReBAR control register
+
+    return 0x00u;
+}
+
+static inline uint_least8_t SimPci_DecodeStraps(uint_least32_t straps0, uint_least32_t straps1)
+{
+    uint_least8_t part1 = straps0 >> 14u & 0x03u, part2 = straps1 >> 20u & 0x07u;
+
+    return part1 < 2u ? part1 : part1 == 2u ? part2 + 2u : 10u;
+}
+
+static bool SimPci_IsBar0Decoded(SimPciFunction const *gpu)
+{
+    SimPciFunction const *bridge = gpu->bridge;
+    uint_least64_t bar0 = get32(gpu->config, 0x10u) & UINT32_C(0xFFFF'FFF0);
+    uint_least32_t memoryWindow = get32(bridge->config, 0x20u);
+    uint_least64_t windowBase = (uint_least64_t)(memoryWindow & 0xFFF0u) << 16u, windowLimit = (uint_least64_t)(memoryWindow >> 16u & 0xFFF0u) << 16u | 0xF'FFFFu;
+
+    return gpu->config[0x04u] & 0x02u && bridge->config[0x04u] & 0x02u && bar0 == simOptions.bar0Base && windowBase <= bar0 && bar0 + GPU_BAR0_SIZE - 1u <= windowLimit;
+}
+
+// Take the STRAPS written by the driver from the BAR0 MMIO page, the new BAR1 size shows in the ReBAR capability after
+// the settle delay
+static void SimPci_LatchStraps(SimPciFunction *gpu)
+{
+    UINT8 const *straps = strapsPage + (simOptions.bar0Base + STRAPS_BASE_OFFSET) % STRAPS_PAGE_SIZE;
+    UINT32 straps0, straps1;
+
+    memcpy(&straps0, straps + 0x0u, sizeof straps0);
+    memcpy(&straps1, straps + 0xCu, sizeof straps1);
+
+    if (straps0 != gpu->straps0 || straps1 != gpu->straps1)
+    {
+	uint_least8_t barSize = SimPci_DecodeStraps(straps0, straps1);
+
+	gpu->straps0 = straps0, gpu->straps1 = straps1;
+	simCounters.strapsUpdates++;
+
+	if (barSize != (gpu->isSettlePending ? gpu->pendingBarSize : gpu->strapsBarSize))
+	{
+	    gpu->pendingBarSize = barSize;
+	    gpu->isSettlePending = true;
+	    gpu->settleTime = SimPlatform_Now() + simOptions.settleDelay;
+	}
+    }
+}
+
+// The GPU reports the new BAR1 sizes some time after the STRAPS were written
+static void SimPci_ApplySettledStraps(SimPciFunction *gpu)
+{
+    if (gpu->isDecoding)
+	SimPci_LatchStraps(gpu);
+
+    if (gpu->isSettlePending && SimPlatform_Now() >= gpu->settleTime)
+    {
+	gpu->isSettlePending = false;
+	gpu->strapsBarSize = gpu->pendingBarSize;
+	SimPci_UpdateGpuReBar(gpu);
+    }
+}
+
+// Show the STRAPS registers in the BAR0 MMIO page while the GPU decodes BAR0, and latch them when it stops
+static void SimPci_UpdateDecode(SimPciFunction *gpu)
+{
+    bool isDecoding = SimPci_IsBar0Decoded(gpu);
+
+    if (isDecoding == gpu->isDecoding)
+	return;
+
+    UINT8 *straps = strapsPage + (simOptions.bar0Base + STRAPS_BASE_OFFSET) % STRAPS_PAGE_SIZE;
+
+    if (isDecoding)
+    {
+	if (strapsOwner)
+	{
+	    fprintf(stderr, "ReBarDxeSim: GPUs %02x:%02x.%x and %02x:%02x.%x both decode BAR0 at 0x%08llx\n",
+		    strapsOwner->bus, strapsOwner->dev, strapsOwner->fn, gpu->bus, gpu->dev, gpu->fn, (unsigned long long)simOptions.bar0Base);
+	    exit(EXIT_FAILURE);
+	}
+
+	memset(strapsPage, 0, STRAPS_PAGE_SIZE);
+	memcpy(straps + 0x0u, &gpu->straps0, sizeof(UINT32));
+	memcpy(straps + 0xCu, &gpu->straps1, sizeof(UINT32));
+	strapsOwner = gpu;
+    }
+    else
+    {
+	SimPci_LatchStraps(gpu);
+	memset(strapsPage, 0xFF, STRAPS_PAGE_SIZE);
+	strapsOwner = NULL;
+    }
+
+    gpu->isDecoding = isDecoding;
+}
+
+static uint_least32_t SimPci_ConfigRead(SimPciFunction *function, unsigned offset, unsigned size)
+{
+    if (!function)
+	return UINT32_MAX >> (32u - 8u * size);
+
+    if (function->kind == SimPciKind_Gpu)
+	SimPci_ApplySettledStraps(function);
+
+    uint_least32_t value = 0u;
+
+    for (unsigned index = 0u; index < size; index++)
+	value |= (uint_least32_t)function->config[(offset + index) & 0x0FFFu] << 8u * index;
+
+    return value;
+}
+
+static void SimPci_ConfigWrite(SimPciFunction *function, unsigned offset, unsigned size, uint_least32_t value)
+{
+    if (!function)
+	return;
+
+    for (unsigned index = 0u; index < size; index++)
+    {
+	unsigned byteOffset = (offset + index) & 0x0FFFu;
+	UINT8 mask = SimPci_WriteMask(function, byteOffset);
+
+	function->config[byteOffset] = (function->config[byteOffset] & ~mask) | (value >> 8u * index & mask);
+    }
+
+    if (function->reBarOffset && isRangeOverlap(offset, size, function->reBarOffset + 8u, 4u))
+	simCounters.reBarWrites++;
+
+    if (function->kind == SimPciKind_Gpu && (isRangeOverlap(offset, size, 0x04u, 2u) || isRangeOverlap(offset, size, 0x10u, 4u)))
+	SimPci_UpdateDecode(function);
+
+    if (function->kind == SimPciKind_RootPort && function->gpu && (isRangeOverlap(offset, size, 0x04u, 2u) || isRangeOverlap(offset, size, 0x20u, 4u)))
+	SimPci_UpdateDecode(function->gpu);
+}
+
+// RootBridgeIo protocol
+
+static SimPciFunction *SimPci_DecodeAddress(UINT64 address, unsigned *offset)
+{
+    *offset = address >> 32u ? (unsigned)(address >> 32u & 0x0FFFu) : (unsigned)(address & 0xFFu);
+
+    return functionMap[address >> 24u & 0xFFu][address >> 16u & 0x1Fu][address >> 8u & 0x07u];
+}
+
+static EFI_STATUS EFIAPI SimPci_RootBridgeIoPciRead(EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *This, EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_WIDTH width, UINT64 address, UINTN count, VOID *buffer)
+{
+    if (width > EfiPciWidthUint32 || !count || !buffer)
+	return EFI_INVALID_PARAMETER;
+
+    simCounters.configReads++;
+
+    if (count > 1u)
+    {
+	if (!simOptions.acceptBlockReads)
+	    return EFI_INVALID_PARAMETER;
+
+	simCounters.configBlockReads++;
+    }
+
+    unsigned offset, size = 1u << width;
+    SimPciFunction *function = SimPci_DecodeAddress(address, &offset);
+
+    for (UINTN index = 0u; index < count; index++)
+    {
+	uint_least32_t value = SimPci_ConfigRead(function, offset + index * size, size);
+
+	memcpy((UINT8 *)buffer + index * size, &value, size);
+    }
+
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI SimPci_RootBridgeIoPciWrite(EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *This, EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_WIDTH width, UINT64 address, UINTN count, VOID *buffer)
+{
+    if (width > EfiPciWidthUint32 || !count || !buffer)
+	return EFI_INVALID_PARAMETER;
+
+    simCounters.configWrites++;
+
+    unsigned offset, size = 1u << width;
+    SimPciFunction *function = SimPci_DecodeAddress(address, &offset);
+
+    for (UINTN index = 0u; index < count; index++)
+    {
+	uint_least32_t value = 0u;
+
+	memcpy(&value, (UINT8 const *)buffer + index * size, size);
+	SimPci_ConfigWrite(function, offset + index * size, size, value);
+    }
+
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI SimPci_RootBridgeIoPoll(EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *This, EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_WIDTH width, UINT64 address, UINT64 mask, UINT64 value, UINT64 delay, UINT64 *result)
+{
+    return EFI_UNSUPPORTED;
+}
+
+static EFI_STATUS EFIAPI SimPci_RootBridgeIoUnsupported(EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *This, EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_WIDTH width, UINT64 address, UINTN count, VOID *buffer)
+{
+    return EFI_UNSUPPORTED;
+}
+
+static UINT8 rootBridgeHandle, hostBridgeHandle;
+
+EFI_HANDLE simRootBridgeHandle = &rootBridgeHandle, simHostBridgeHandle = &hostBridgeHandle;
+
+EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL simRootBridgeIo =
+{
+    .ParentHandle = &hostBridgeHandle,
+    .PollMem = &SimPci_RootBridgeIoPoll,
+    .PollIo = &SimPci_RootBridgeIoPoll,
+    .Mem = { .Read = &SimPci_RootBridgeIoUnsupported, .Write = &SimPci_RootBridgeIoUnsupported },
+    .Io = { .Read = &SimPci_RootBridgeIoUnsupported, .Write = &SimPci_RootBridgeIoUnsupported },
+    .Pci = { .Read = &SimPci_RootBridgeIoPciRead, .Write = &SimPci_RootBridgeIoPciWrite },
+    .Configuration = NULL,
+    .SegmentNumber = 0u
+};
+
+// The original PreprocessController method from PciHostBridgeDxe, that the driver hooks
+static EFI_STATUS EFIAPI SimPci_PreprocessController(EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *This, EFI_HANDLE rootBridgeHandle, EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_PCI_ADDRESS pciAddress, EFI_PCI_CONTROLLER_RESOURCE_ALLOCATION_PHASE phase)
+{
+    simCounters.preprocessCalls++;
+
+    return rootBridgeHandle == simRootBridgeHandle ? EFI_SUCCESS : EFI_INVALID_PARAMETER;
+}
+
+// The root bridge decodes 64-bit MMIO, with the aperture added to the GCD by the simulation
+static EFI_STATUS EFIAPI SimPci_GetAllocAttributes(EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *This, EFI_HANDLE rootBridgeHandle, UINT64 *attributes)
+{
+    if (rootBridgeHandle != simRootBridgeHandle)
+	return EFI_INVALID_PARAMETER;
+
+    *attributes = EFI_PCI_HOST_BRIDGE_MEM64_DECODE;
+
+    return EFI_SUCCESS;
+}
+
+EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL simHostBridge =
+{
+    .GetAllocAttributes = &SimPci_GetAllocAttributes,
+    .PreprocessController = &SimPci_PreprocessController
+};
+
+// ECAM through the ACPI MCFG table, with the config space accessed by MmioRead/MmioWrite
+
+#pragma pack(push, 1)
+
+static struct
+{
+    EFI_ACPI_MEMORY_MAPPED_CONFIGURATION_BASE_ADDRESS_TABLE_HEADER header;
+    EFI_ACPI_MEMORY_MAPPED_ENHANCED_CONFIGURATION_SPACE_BASE_ADDRESS_ALLOCATION_STRUCTURE allocation;
+}
+    mcfg;
+
+static struct
+{
+    EFI_ACPI_DESCRIPTION_HEADER header;
+    UINT64 entries[1u];
+}
+    xsdt;
+
+#pragma pack(pop)
+
+static EFI_ACPI_2_0_ROOT_SYSTEM_DESCRIPTION_POINTER rsdp;
+
+static void SimPci_InstallAcpiTables(void)
+{
+    mcfg.header.Header.Signature = EFI_ACPI_2_0_MEMORY_MAPPED_CONFIGURATION_BASE_ADDRESS_TABLE_SIGNATURE;
+    mcfg.header.Header.Length = sizeof mcfg;
+    mcfg.header.Header.Revision = 1u;
+    mcfg.allocation.BaseAddress = ECAM_BASE_ADDRESS;
+    mcfg.allocation.PciSegmentGroupNumber = 0u;
+    mcfg.allocation.StartBusNumber = 0u;
+    mcfg.allocation.EndBusNumber = 0xFFu;
+
+    xsdt.header.Signature = EFI_ACPI_2_0_EXTENDED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE;
+    xsdt.header.Length = sizeof xsdt;
+    xsdt.header.Revision = 1u;
+    xsdt.entries[0u] = (UINT64)(UINTN)&mcfg;
+
+    rsdp.Signature = EFI_ACPI_2_0_ROOT_SYSTEM_DESCRIPTION_POINTER_SIGNATURE;
+    rsdp.Revision = 2u;
+    rsdp.Length = sizeof rsdp;
+    rsdp.XsdtAddress = (UINT64)(UINTN)&xsdt;
+
+    SimPlatform_InstallConfigurationTable(&gEfiAcpi20TableGuid, &rsdp);
+}
+
+static inline bool isEcamAddress(UINTN address)
+{
+    return simOptions.useEcam && address >= ECAM_BASE_ADDRESS && address - ECAM_BASE_ADDRESS < ECAM_SIZE;
+}
+
+static inline SimPciFunction *SimPci_DecodeEcamAddress(UINTN address, unsigned *offset)
+{
+    address -= ECAM_BASE_ADDRESS;
+    *offset = address & 0x0FFFu;
+
+    return functionMap[address >> 20u & 0xFFu][address >> 15u & 0x1Fu][address >> 12u & 0x07u];
+}
+
+static uint_least32_t SimPci_EcamRead(UINTN address, unsigned size)
+{
+    unsigned offset;
+    SimPciFunction *function = SimPci_DecodeEcamAddress(address, &offset);
+
+    simCounters.ecamReads++;
+
+    return SimPci_ConfigRead(function, offset, size);
+}
+
+static void SimPci_EcamWrite(UINTN address, unsigned size, uint_least32_t value)
+{
+    unsigned offset;
+    SimPciFunction *function = SimPci_DecodeEcamAddress(address, &offset);
+
+    simCounters.ecamWrites++;
+    SimPci_ConfigWrite(function, offset, size, value);
+}
+
+UINT8 EFIAPI MmioRead8(UINTN address)
+{
+    return isEcamAddress(address) ? (UINT8)SimPci_EcamRead(address, 1u) : *(UINT8 volatile *)address;
+}
+
+UINT8 EFIAPI MmioWrite8(UINTN address, UINT8 value)
+{
+    if (isEcamAddress(address))
+	SimPci_EcamWrite(address, 1u, value);
+    else
+	*(UINT8 volatile *)address = value;
+
+    return value;
+}
+
+UINT16 EFIAPI MmioRead16(UINTN address)
+{
+    return isEcamAddress(address) ? (UINT16)SimPci_EcamRead(address, 2u) : *(UINT16 volatile *)address;
+}
+
+UINT16 EFIAPI MmioWrite16(UINTN address, UINT16 value)
+{
+    if (isEcamAddress(address))
+	SimPci_EcamWrite(address, 2u, value);
+    else
+	*(UINT16 volatile *)address = value;
+
+    return value;
+}
+
+UINT32 EFIAPI MmioRead32(UINTN address)
+{
+    return isEcamAddress(address) ? (UINT32)SimPci_EcamRead(address, 4u) : *(UINT32 volatile *)address;
+}
+
+UINT32 EFIAPI MmioWrite32(UINTN address, UINT32 value)
+{
+    if (isEcamAddress(address))
+	SimPci_EcamWrite(address, 4u, value);
+    else
+	*(UINT32 volatile *)address = value;
+
+    return value;
+}
+
+bool SimPci_Init(SimPciOptions const *options)
+{
+    simOptions = *options;
+
+    if (simOptions.busCount < 1u || simOptions.busCount > 256u || simOptions.gpuCount > simOptions.busCount - 1u)
+	return fprintf(stderr, "ReBarDxeSim: %u GPUs do not fit on %u buses\n", simOptions.gpuCount, simOptions.busCount), false;
+
+    if (simOptions.bar0Base % GPU_BAR0_SIZE || simOptions.bar0Base >= UINT32_MAX)
+	return fprintf(stderr, "ReBarDxeSim: BAR0 address 0x%llx is not a 32-bit address aligned to 16 MiB\n", (unsigned long long)simOptions.bar0Base), false;
+
+    // The driver accesses the STRAPS registers at the BAR0 address, so the page is mapped at the same address in the process
+    uintptr_t pageAddress = (uintptr_t)(simOptions.bar0Base + STRAPS_BASE_OFFSET) & ~(uintptr_t)(STRAPS_PAGE_SIZE - 1u);
+
+    strapsPage = mmap((void *)pageAddress, STRAPS_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (strapsPage == MAP_FAILED || (uintptr_t)strapsPage != pageAddress)
+	return fprintf(stderr, "ReBarDxeSim: can not map the STRAPS page at 0x%llx, use --bar0 for another address\n", (unsigned long long)pageAddress), false;
+
+    memset(strapsPage, 0xFF, STRAPS_PAGE_SIZE);
+
+    functions = calloc(3u * simOptions.busCount, sizeof *functions);
+    gpus = calloc(simOptions.gpuCount ? simOptions.gpuCount : 1u, sizeof *gpus);
+
+    if (!functions || !gpus)
+	return fprintf(stderr, "ReBarDxeSim: out of memory\n"), false;
+
+    SimPci_BuildTopology(simOptions.gpuCount);
+
+    // Resources assigned by the firmware before PCI enumeration, with the configured BAR0 range for the first GPU
+    if (simOptions.preassignBar0 && gpuCount)
+    {
+	SimPciFunction *gpu = gpus[0u], *bridge = gpu->bridge;
+
+	put32(bridge->config, 0x20u, (uint_least32_t)(simOptions.bar0Base >> 16u & 0xFFF0u) | (uint_least32_t)((simOptions.bar0Base + GPU_BAR0_SIZE - 1u) & UINT32_C(0xFFF0'0000)));
+	bridge->config[0x04u] |= 0x02u;
+	put32(gpu->config, 0x10u, (uint_least32_t)simOptions.bar0Base);
+	gpu->config[0x04u] |= 0x02u;
+	SimPci_UpdateDecode(gpu);
+    }
+
+    if (simOptions.useEcam)
+	SimPci_InstallAcpiTables();
+
+    SimPlatform_InstallProtocol(simRootBridgeHandle, &gEfiPciRootBridgeIoProtocolGuid, &simRootBridgeIo);
+    SimPlatform_InstallProtocol(simHostBridgeHandle, &gEfiPciHostBridgeResourceAllocationProtocolGuid, &simHostBridge);
+
+    return true;
+}
+
+unsigned SimPci_FunctionCount(void)
+{
+    return functionCount;
+}
+
+SimPciFunction *SimPci_Function(unsigned index)
+{
+    return index < functionCount ? functions + index : NULL;
+}
+
+unsigned SimPci_GpuCount(void)
+{
+    return gpuCount;
+}
+
+SimPciFunction *SimPci_Gpu(unsigned index)
+{
+    return index < gpuCount ? gpus[index] : NULL;
+}
+
+uint_least8_t SimPci_StrapsBarSize(SimPciFunction *gpu)
+{
+    if (gpu->isDecoding)
+	SimPci_LatchStraps(gpu);
+
+    return SimPci_DecodeStraps(gpu->straps0, gpu->straps1);
+}
+
+uint_least8_t SimPci_ReBarCurrentSize(SimPciFunction const *function)
+{
+    return function->reBarOffset ? function->config[function->reBarOffset + 9u] & 0x3Fu : 0u;
+}
+
+uint_least8_t SimPci_ReBarMaxSize(SimPciFunction *gpu)
+{
+    SimPci_ApplySettledStraps(gpu);
+
+    uint_least32_t sizeMask = gpu->reBarOffset ? get32(gpu->config, gpu->reBarOffset + 4u) >> 4u : 0u;
+    uint_least8_t maxSize = 0u;
+
+    while (sizeMask >>= 1u)
+	maxSize++;
+
+    return maxSize;
+}
+
+// Power on after S3: the bridges and the GPUs lose the resources from the boot, and the GPUs reload the STRAPS
+static void SimPci_PowerOn(void)
+{
+    memset(strapsPage, 0xFF, STRAPS_PAGE_SIZE);
+    strapsOwner = NULL;
+
+    for (SimPciFunction *function = functions; function < functions + functionCount; function++)
+    {
+	function->config[0x04u] &= ~0x07u;
+
+	if (function->kind == SimPciKind_RootPort)
+	    put16(function->config, 0x1Cu, 0x0000u), put32(function->config, 0x20u, 0x0000'0000u);
+
+	if (function->kind == SimPciKind_Gpu)
+	{
+	    put32(function->config, 0x10u, 0x0000'0000u);
+	    function->isDecoding = false;
+	    SimPci_ResetStraps(function);
+
+	    if (function->reBarOffset)
+		SimPci_UpdateGpuReBar(function);
+	}
+    }
+}
+
+static bool SimPci_ReplayMmioWrite(UINT64 address, unsigned size, uint_least64_t data, uint_least64_t dataMask, bool isReadWrite)
+{
+    uintptr_t pageAddress = (uintptr_t)strapsPage;
+
+    // Only the STRAPS page is mapped, and only while a GPU decodes it
+    if (!strapsOwner || address < pageAddress || address + size > pageAddress + STRAPS_PAGE_SIZE)
+	return false;
+
+    uint_least64_t value = 0u;
+
+    if (isReadWrite)
+    {
+	memcpy(&value, strapsPage + (address - pageAddress), size);
+	data |= value & dataMask;
+    }
+
+    memcpy(strapsPage + (address - pageAddress), &data, size);
+
+    return true;
+}
+
+unsigned SimPci_ReplayS3Resume(void)
+{
+    unsigned lostWrites = 0u;
+
+    SimPci_PowerOn();
+
+    for (unsigned index = 0u; index < SimPlatform_BootScriptEntryCount(); index++)
+    {
+	SimBootScriptEntry const *entry = SimPlatform_BootScriptEntry(index);
+	unsigned size = 1u << entry->width, offset = 0u;
+	SimPciFunction *function;
+
+	switch (entry->opcode)
+	{
+	case EFI_BOOT_SCRIPT_MEM_WRITE_OPCODE:
+	case EFI_BOOT_SCRIPT_MEM_READ_WRITE_OPCODE:
+	    if (!SimPci_ReplayMmioWrite(entry->address, size, entry->data, entry->dataMask, entry->opcode == EFI_BOOT_SCRIPT_MEM_READ_WRITE_OPCODE))
+	    {
+		fprintf(stderr, "ReBarDxeSim: boot script entry %u writes to 0x%08llx, with no device decoding the address\n", index, (unsigned long long)entry->address);
+		lostWrites++;
+	    }
+	    break;
+
+	case EFI_BOOT_SCRIPT_PCI_CONFIG_WRITE_OPCODE:
+	case EFI_BOOT_SCRIPT_PCI_CONFIG2_WRITE_OPCODE:
+	    function = entry->segment ? NULL : SimPci_DecodeAddress(entry->address, &offset);
+	    SimPci_ConfigWrite(function, offset, size, (uint_least32_t)entry->data);
+	    break;
+
+	case EFI_BOOT_SCRIPT_PCI_CONFIG_READ_WRITE_OPCODE:
+	case EFI_BOOT_SCRIPT_PCI_CONFIG2_READ_WRITE_OPCODE:
+	    function = entry->segment ? NULL : SimPci_DecodeAddress(entry->address, &offset);
+	    SimPci_ConfigWrite(function, offset, size, (SimPci_ConfigRead(function, offset, size) & (uint_least32_t)entry->dataMask) | (uint_least32_t)entry->data);
+	    break;
+	}
+    }
+
+    return lostWrites;
+}
@@ -0,0 +1,74 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_PCI_H)
+#define NV_STRAPS_REBAR_HOST_SIM_PCI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <Uefi.h>
+#include <Protocol/PciRootBridgeIo.h>
+#include <Protocol/PciHostBridgeResourceAllocation.h>
+
+// Simulated PCI segment 0 behind one root bridge: a host bridge and one root port for each secondary bus on
+// bus 0, with the GPUs spread evenly across the root ports, and other devices behind the remaining ports.
+typedef struct SimPciOptions
+{
+    unsigned busCount, gpuCount;
+    bool useEcam, hasGpuReBar, acceptBlockReads;
+    bool preassignBar0;			    // the first GPU already decodes BAR0 before enumeration
+    uint_least8_t strapsBarSize;	    // initial BAR1 size selector in the GPU STRAPS
+    uint_least64_t bar0Base;		    // the only address where the GPU BAR0 can be decoded
+    uint_least64_t settleDelay;		    // ns until the ReBAR capability lists the new size from the STRAPS
+}
+    SimPciOptions;
+
+typedef enum SimPciKind
+{
+    SimPciKind_HostBridge,
+    SimPciKind_RootPort,
+    SimPciKind_Gpu,
+    SimPciKind_GpuAudio,
+    SimPciKind_Nvme,
+    SimPciKind_Usb
+}
+    SimPciKind;
+
+typedef struct SimPciFunction
+{
+    uint_least8_t bus, dev, fn;
+    SimPciKind kind;
+    struct SimPciFunction *bridge, *gpu;    // upstream root port, and the GPU behind a root port
+    uint_least16_t reBarOffset;
+
+    // GPU STRAPS, copied to the BAR0 MMIO page while the GPU decodes the BAR0 range
+    uint_least32_t straps0, straps1;
+    uint_least8_t strapsBarSize, pendingBarSize;
+    bool isDecoding, isSettlePending;
+    uint_least64_t settleTime;
+
+    UINT8 config[0x1000u];
+}
+    SimPciFunction;
+
+bool SimPci_Init(SimPciOptions const *options);
+
+// Functions in the order PciBusDxe finds them: each bridge is followed by the devices on its secondary bus
+unsigned SimPci_FunctionCount(void);
+SimPciFunction *SimPci_Function(unsigned index);
+
+unsigned SimPci_GpuCount(void);
+SimPciFunction *SimPci_Gpu(unsigned index);
+
+// BAR1 size selector from the STRAPS registers, and the current and the largest BAR1 size in the ReBAR capability
+uint_least8_t SimPci_StrapsBarSize(SimPciFunction *gpu);
+uint_least8_t SimPci_ReBarCurrentSize(SimPciFunction const *function);
+uint_least8_t SimPci_ReBarMaxSize(SimPciFunction *gpu);
+
+// S3 resume: power on the devices, and replay the boot script written by the driver. Returns the number of MMIO
+// writes that no device decoded.
+unsigned SimPci_ReplayS3Resume(void);
+
+extern EFI_HANDLE simRootBridgeHandle, simHostBridgeHandle;
+extern EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL simRootBridgeIo;
+extern EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL simHostBridge;
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_PCI_H)
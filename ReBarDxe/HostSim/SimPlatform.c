@@ -0,0 +1,1292 @@
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <cpuid.h>
+
+#include <Uefi.h>
+#include <Guid/Acpi.h>
+#include <Guid/EventGroup.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/DxeServicesTableLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+#include <Protocol/PciHostBridgeResourceAllocation.h>
+#include <Protocol/PciRootBridgeIo.h>
+#include <Protocol/S3SaveState.h>
+
+#include "SimPlatform.h"
+
+EFI_GUID gEfiEventReadyToBootGuid = { 0x7CE88FB3u, 0x4BD7u, 0x4679u, { 0x87u, 0xA8u, 0xA8u, 0xD8u, 0xDEu, 0xE5u, 0x0Du, 0x2Bu } };
+EFI_GUID gEfiEndOfDxeEventGroupGuid = { 0x02CE967Au, 0xDD7Eu, 0x4FFCu, { 0x9Eu, 0xE7u, 0x81u, 0x0Cu, 0xF0u, 0x47u, 0x08u, 0x80u } };
+EFI_GUID gEfiAcpi10TableGuid = { 0xEB9D2D30u, 0x2D88u, 0x11D3u, { 0x9Au, 0x16u, 0x00u, 0x90u, 0x27u, 0x3Fu, 0xC1u, 0x4Du } };
+EFI_GUID gEfiAcpi20TableGuid = { 0x8868E871u, 0xE4F1u, 0x11D3u, { 0xBCu, 0x22u, 0x00u, 0x80u, 0xC7u, 0x3Cu, 0x88u, 0x81u } };
+EFI_GUID gEfiPciRootBridgeIoProtocolGuid = { 0x2F707EBBu, 0x4A1Au, 0x11D4u, { 0x9Au, 0x38u, 0x00u, 0x90u, 0x27u, 0x3Fu, 0xC1u, 0x4Du } };
+EFI_GUID gEfiPciHostBridgeResourceAllocationProtocolGuid = { 0xCF8034BEu, 0x6768u, 0x4D8Bu, { 0xB7u, 0x39u, 0x7Cu, 0xCEu, 0x68u, 0x3Au, 0x9Fu, 0xBEu } };
+EFI_GUID gEfiS3SaveStateProtocolGuid = { 0xE857CAF6u, 0xC046u, 0x45DCu, { 0xBEu, 0x3Fu, 0xEEu, 0x07u, 0x65u, 0xFBu, 0xA8u, 0x87u } };
+
+SimCounters simCounters;
+
+// Virtual clock
+
+static uint_least64_t virtualTime = 0u;
+
+uint_least64_t SimPlatform_Now(void)
+{
+    return virtualTime;
+}
+
+// Events and timers. Timers are checked when the virtual clock advances, and when an event is waited for or checked.
+
+#define SIM_MAX_EVENTS 256u
+
+typedef struct SimEvent
+{
+    bool used, signaled, hasGroup, timerArmed;
+    UINT32 type;
+    EFI_TPL notifyTpl;
+    EFI_EVENT_NOTIFY notify;
+    VOID *context;
+    EFI_GUID group;
+    uint_least64_t triggerTime, period;
+}
+    SimEvent;
+
+static SimEvent simEvents[SIM_MAX_EVENTS];
+
+static SimEvent *SimEvent_Get(EFI_EVENT event)
+{
+    SimEvent *simEvent = event;
+
+    if (simEvent < simEvents || simEvent >= simEvents + SIM_MAX_EVENTS || !simEvent->used)
+	return NULL;
+
+    return simEvent;
+}
+
+static void SimEvent_Signal(SimEvent *event)
+{
+    if (event->type & EVT_NOTIFY_SIGNAL && event->notify)
+	event->notify(event, event->context);
+    else
+	event->signaled = true;
+}
+
+static void SimEvent_FireTimer(SimEvent *event)
+{
+    if (event->period)
+	while (event->triggerTime <= virtualTime)
+	    event->triggerTime += event->period;
+    else
+	event->timerArmed = false;
+
+    SimEvent_Signal(event);
+}
+
+static SimEvent *SimEvent_NextTimer(uint_least64_t limit)
+{
+    SimEvent *nextTimer = NULL;
+
+    for (SimEvent *event = simEvents; event < simEvents + SIM_MAX_EVENTS; event++)
+	if (event->used && event->timerArmed && event->triggerTime <= limit && (!nextTimer || event->triggerTime < nextTimer->triggerTime))
+	    nextTimer = event;
+
+    return nextTimer;
+}
+
+void SimPlatform_Advance(uint_least64_t nanoseconds)
+{
+    uint_least64_t targetTime = virtualTime + nanoseconds;
+    SimEvent *timer;
+
+    while ((timer = SimEvent_NextTimer(targetTime)))
+    {
+	if (timer->triggerTime > virtualTime)
+	    virtualTime = timer->triggerTime;
+
+	SimEvent_FireTimer(timer);
+    }
+
+    virtualTime = targetTime;
+}
+
+static EFI_STATUS EFIAPI Sim_CreateEventEx(UINT32 type, EFI_TPL notifyTpl, EFI_EVENT_NOTIFY notify, CONST VOID *context, CONST EFI_GUID *eventGroup, EFI_EVENT *event)
+{
+    if (!event || (type & EVT_NOTIFY_SIGNAL && !notify))
+	return EFI_INVALID_PARAMETER;
+
+    for (SimEvent *simEvent = simEvents; simEvent < simEvents + SIM_MAX_EVENTS; simEvent++)
+	if (!simEvent->used)
+	{
+	    memset(simEvent, 0, sizeof *simEvent);
+
+	    simEvent->used = true;
+	    simEvent->type = type;
+	    simEvent->notifyTpl = notifyTpl;
+	    simEvent->notify = notify;
+	    simEvent->context = (VOID *)context;
+
+	    if (eventGroup)
+		simEvent->hasGroup = true, simEvent->group = *eventGroup;
+
+	    simCounters.eventsCreated++;
+	    *event = simEvent;
+
+	    return EFI_SUCCESS;
+	}
+
+    return EFI_OUT_OF_RESOURCES;
+}
+
+static EFI_STATUS EFIAPI Sim_CreateEvent(UINT32 type, EFI_TPL notifyTpl, EFI_EVENT_NOTIFY notify, VOID *context, EFI_EVENT *event)
+{
+    return Sim_CreateEventEx(type, notifyTpl, notify, context, NULL, event);
+}
+
+// Trigger time is in 100 ns units
+static EFI_STATUS EFIAPI Sim_SetTimer(EFI_EVENT event, EFI_TIMER_DELAY type, UINT64 triggerTime)
+{
+    SimEvent *simEvent = SimEvent_Get(event);
+
+    if (!simEvent || !(simEvent->type & EVT_TIMER))
+	return EFI_INVALID_PARAMETER;
+
+    switch (type)
+    {
+    case TimerCancel:
+	simEvent->timerArmed = false;
+	return EFI_SUCCESS;
+
+    case TimerPeriodic:
+    case TimerRelative:
+	simEvent->timerArmed = true;
+	simEvent->triggerTime = virtualTime + (triggerTime ? triggerTime : 1u) * 100u;
+	simEvent->period = type == TimerPeriodic ? (triggerTime ? triggerTime : 1u) * 100u : 0u;
+	return EFI_SUCCESS;
+
+    default:
+	return EFI_INVALID_PARAMETER;
+    }
+}
+
+static EFI_STATUS EFIAPI Sim_WaitForEvent(UINTN eventCount, EFI_EVENT *events, UINTN *index)
+{
+    if (!eventCount || !events || !index)
+	return EFI_INVALID_PARAMETER;
+
+    simCounters.timerWaits++;
+
+    while (true)
+    {
+	uint_least64_t nextTime = UINT64_MAX;
+
+	for (UINTN eventIndex = 0u; eventIndex < eventCount; eventIndex++)
+	{
+	    SimEvent *simEvent = SimEvent_Get(events[eventIndex]);
+
+	    if (!simEvent || simEvent->type & EVT_NOTIFY_SIGNAL)
+		return *index = eventIndex, EFI_INVALID_PARAMETER;
+
+	    if (simEvent->timerArmed && simEvent->triggerTime <= virtualTime)
+		SimEvent_FireTimer(simEvent);
+
+	    if (simEvent->signaled)
+	    {
+		simEvent->signaled = false;
+		*index = eventIndex;
+
+		return EFI_SUCCESS;
+	    }
+
+	    if (simEvent->timerArmed && simEvent->triggerTime < nextTime)
+		nextTime = simEvent->triggerTime;
+	}
+
+	// Nothing would ever signal the events, the firmware would hang here
+	if (nextTime == UINT64_MAX)
+	{
+	    fprintf(stderr, "ReBarDxeSim: WaitForEvent() on events that are never signaled\n");
+	    return EFI_UNSUPPORTED;
+	}
+
+	SimPlatform_Advance(nextTime - virtualTime);
+    }
+}
+
+static EFI_STATUS EFIAPI Sim_SignalEvent(EFI_EVENT event)
+{
+    SimEvent *simEvent = SimEvent_Get(event);
+
+    if (!simEvent)
+	return EFI_INVALID_PARAMETER;
+
+    if (simEvent->hasGroup)
+	SimPlatform_SignalEventGroup(&simEvent->group);
+    else
+	SimEvent_Signal(simEvent);
+
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI Sim_CheckEvent(EFI_EVENT event)
+{
+    SimEvent *simEvent = SimEvent_Get(event);
+
+    if (!simEvent || simEvent->type & EVT_NOTIFY_SIGNAL)
+	return EFI_INVALID_PARAMETER;
+
+    if (simEvent->timerArmed && simEvent->triggerTime <= virtualTime)
+	SimEvent_FireTimer(simEvent);
+
+    if (simEvent->signaled)
+	return simEvent->signaled = false, EFI_SUCCESS;
+
+    return EFI_NOT_READY;
+}
+
+static EFI_STATUS EFIAPI Sim_CloseEvent(EFI_EVENT event)
+{
+    SimEvent *simEvent = SimEvent_Get(event);
+
+    if (!simEvent)
+	return EFI_INVALID_PARAMETER;
+
+    simEvent->used = false;
+
+    return EFI_SUCCESS;
+}
+
+void SimPlatform_SignalEventGroup(EFI_GUID const *eventGroup)
+{
+    for (SimEvent *event = simEvents; event < simEvents + SIM_MAX_EVENTS; event++)
+	if (event->used && event->hasGroup && CompareGuid(&event->group, eventGroup))
+	    SimEvent_Signal(event);
+}
+
+static EFI_STATUS EFIAPI Sim_Stall(UINTN microseconds)
+{
+    simCounters.stallCalls++;
+    SimPlatform_Advance((uint_least64_t)microseconds * 1'000u);
+
+    return EFI_SUCCESS;
+}
+
+// Protocol database
+
+#define SIM_MAX_PROTOCOLS 32u
+
+static struct
+{
+    EFI_HANDLE handle;
+    EFI_GUID guid;
+    VOID *interface;
+}
+    simProtocols[SIM_MAX_PROTOCOLS];
+
+static unsigned simProtocolCount = 0u;
+
+EFI_STATUS SimPlatform_InstallProtocol(EFI_HANDLE handle, EFI_GUID const *protocol, VOID *interface)
+{
+    if (simProtocolCount >= SIM_MAX_PROTOCOLS)
+	return EFI_OUT_OF_RESOURCES;
+
+    simProtocols[simProtocolCount].handle = handle;
+    simProtocols[simProtocolCount].guid = *protocol;
+    simProtocols[simProtocolCount].interface = interface;
+    simProtocolCount++;
+
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI Sim_HandleProtocol(EFI_HANDLE handle, EFI_GUID *protocol, VOID **interface)
+{
+    if (!protocol || !interface)
+	return EFI_INVALID_PARAMETER;
+
+    for (unsigned index = 0u; index < simProtocolCount; index++)
+	if (simProtocols[index].handle == handle && CompareGuid(&simProtocols[index].guid, protocol))
+	    return *interface = simProtocols[index].interface, EFI_SUCCESS;
+
+    return *interface = NULL, EFI_UNSUPPORTED;
+}
+
+static EFI_STATUS EFIAPI Sim_OpenProtocol(EFI_HANDLE handle, EFI_GUID *protocol, VOID **interface, EFI_HANDLE agentHandle, EFI_HANDLE controllerHandle, UINT32 attributes)
+{
+    return Sim_HandleProtocol(handle, protocol, interface);
+}
+
+static EFI_STATUS EFIAPI Sim_LocateProtocol(EFI_GUID *protocol, VOID *registration, VOID **interface)
+{
+    if (!protocol || !interface)
+	return EFI_INVALID_PARAMETER;
+
+    for (unsigned index = 0u; index < simProtocolCount; index++)
+	if (CompareGuid(&simProtocols[index].guid, protocol))
+	    return *interface = simProtocols[index].interface, EFI_SUCCESS;
+
+    return *interface = NULL, EFI_NOT_FOUND;
+}
+
+static EFI_STATUS EFIAPI Sim_AllocatePool(EFI_MEMORY_TYPE poolType, UINTN size, VOID **buffer)
+{
+    if (!buffer)
+	return EFI_INVALID_PARAMETER;
+
+    simCounters.poolAllocations++;
+
+    return (*buffer = malloc(size ? size : 1u)) ? EFI_SUCCESS : EFI_OUT_OF_RESOURCES;
+}
+
+static EFI_STATUS EFIAPI Sim_FreePool(VOID *buffer)
+{
+    free(buffer);
+
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI Sim_LocateHandleBuffer(EFI_LOCATE_SEARCH_TYPE searchType, EFI_GUID *protocol, VOID *searchKey, UINTN *handleCount, EFI_HANDLE **buffer)
+{
+    if (searchType != ByProtocol || !protocol || !handleCount || !buffer)
+	return EFI_INVALID_PARAMETER;
+
+    *handleCount = 0u;
+    *buffer = NULL;
+
+    for (unsigned index = 0u; index < simProtocolCount; index++)
+	if (CompareGuid(&simProtocols[index].guid, protocol))
+	    ++*handleCount;
+
+    if (!*handleCount)
+	return EFI_NOT_FOUND;
+
+    EFI_STATUS status = Sim_AllocatePool(EfiBootServicesData, *handleCount * sizeof **buffer, (VOID **)buffer);
+
+    if (EFI_ERROR(status))
+	return *handleCount = 0u, status;
+
+    for (unsigned index = 0u, handleIndex = 0u; index < simProtocolCount; index++)
+	if (CompareGuid(&simProtocols[index].guid, protocol))
+	    (*buffer)[handleIndex++] = simProtocols[index].handle;
+
+    return EFI_SUCCESS;
+}
+
+// Variable store
+
+#define SIM_MAX_VARIABLE_NAME 128u
+
+typedef struct SimVariable
+{
+    CHAR16 name[SIM_MAX_VARIABLE_NAME];
+    EFI_GUID guid;
+    UINT32 attributes;
+    UINTN size;
+    UINT8 *data;
+}
+    SimVariable;
+
+static SimVariable *simVariables = NULL;
+static unsigned simVariableCount = 0u, simVariableCapacity = 0u;
+
+static UINTN StrLen16(CHAR16 const *str)
+{
+    UINTN length = 0u;
+
+    while (str[length])
+	length++;
+
+    return length;
+}
+
+static bool StrEqual16(CHAR16 const *str1, CHAR16 const *str2)
+{
+    while (*str1 && *str1 == *str2)
+	str1++, str2++;
+
+    return *str1 == *str2;
+}
+
+void SimPlatform_AsciiToUcs2(CHAR16 *dest, char const *src, unsigned capacity)
+{
+    unsigned length = 0u;
+
+    while (length + 1u < capacity && src[length])
+	dest[length] = (CHAR16)(unsigned char)src[length], length++;
+
+    dest[length] = 0u;
+}
+
+static SimVariable *SimVariable_Find(CHAR16 const *name, EFI_GUID const *guid)
+{
+    for (SimVariable *variable = simVariables; variable < simVariables + simVariableCount; variable++)
+	if (CompareGuid(&variable->guid, guid) && StrEqual16(variable->name, name))
+	    return variable;
+
+    return NULL;
+}
+
+static void SimVariable_Delete(SimVariable *variable)
+{
+    free(variable->data);
+    memmove(variable, variable + 1, (size_t)(simVariables + simVariableCount - (variable + 1)) * sizeof *variable);
+    simVariableCount--;
+}
+
+EFI_STATUS SimPlatform_SetVariable(CHAR16 const *name, EFI_GUID const *guid, UINT32 attributes, UINTN size, VOID const *data)
+{
+    if (!name || !name[0u] || !guid || StrLen16(name) >= SIM_MAX_VARIABLE_NAME || (size && !data))
+	return EFI_INVALID_PARAMETER;
+
+    SimVariable *variable = SimVariable_Find(name, guid);
+
+    if (!size || !attributes)
+    {
+	if (!variable)
+	    return EFI_NOT_FOUND;
+
+	SimVariable_Delete(variable);
+
+	return EFI_SUCCESS;
+    }
+
+    UINT8 *newData = malloc(size);
+
+    if (!newData)
+	return EFI_OUT_OF_RESOURCES;
+
+    memcpy(newData, data, size);
+
+    if (!variable)
+    {
+	if (simVariableCount == simVariableCapacity)
+	{
+	    unsigned newCapacity = simVariableCapacity ? 2u * simVariableCapacity : 64u;
+	    SimVariable *newVariables = realloc(simVariables, newCapacity * sizeof *newVariables);
+
+	    if (!newVariables)
+		return free(newData), EFI_OUT_OF_RESOURCES;
+
+	    simVariables = newVariables;
+	    simVariableCapacity = newCapacity;
+	}
+
+	variable = simVariables + simVariableCount++;
+	memcpy(variable->name, name, (StrLen16(name) + 1u) * sizeof *name);
+	variable->guid = *guid;
+	variable->data = NULL;
+    }
+
+    free(variable->data);
+    variable->attributes = attributes;
+    variable->size = size;
+    variable->data = newData;
+
+    return EFI_SUCCESS;
+}
+
+VOID const *SimPlatform_FindVariable(char const *name, EFI_GUID const *guid, UINTN *size)
+{
+    CHAR16 varName[SIM_MAX_VARIABLE_NAME];
+
+    SimPlatform_AsciiToUcs2(varName, name, SIM_MAX_VARIABLE_NAME);
+
+    SimVariable const *variable = SimVariable_Find(varName, guid);
+
+    if (!variable)
+	return *size = 0u, NULL;
+
+    *size = variable->size;
+
+    return variable->data;
+}
+
+static EFI_STATUS EFIAPI Sim_GetVariable(CHAR16 *name, EFI_GUID *guid, UINT32 *attributes, UINTN *dataSize, VOID *data)
+{
+    simCounters.variableReads++;
+
+    if (!name || !guid || !dataSize)
+	return EFI_INVALID_PARAMETER;
+
+    SimVariable const *variable = SimVariable_Find(name, guid);
+
+    if (!variable)
+	return EFI_NOT_FOUND;
+
+    if (attributes)
+	*attributes = variable->attributes;
+
+    if (*dataSize < variable->size)
+	return *dataSize = variable->size, EFI_BUFFER_TOO_SMALL;
+
+    if (!data)
+	return EFI_INVALID_PARAMETER;
+
+    memcpy(data, variable->data, variable->size);
+    *dataSize = variable->size;
+
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI Sim_SetVariable(CHAR16 *name, EFI_GUID *guid, UINT32 attributes, UINTN dataSize, VOID *data)
+{
+    simCounters.variableWrites++;
+
+    return SimPlatform_SetVariable(name, guid, attributes, dataSize, data);
+}
+
+// The name size is in bytes, including the null character
+static EFI_STATUS EFIAPI Sim_GetNextVariableName(UINTN *nameSize, CHAR16 *name, EFI_GUID *guid)
+{
+    simCounters.variableEnumerations++;
+
+    if (!nameSize || !name || !guid)
+	return EFI_INVALID_PARAMETER;
+
+    unsigned nextIndex = 0u;
+
+    if (name[0u])
+    {
+	SimVariable const *variable = SimVariable_Find(name, guid);
+
+	if (!variable)
+	    return EFI_INVALID_PARAMETER;
+
+	nextIndex = (unsigned)(variable - simVariables) + 1u;
+    }
+
+    if (nextIndex >= simVariableCount)
+	return EFI_NOT_FOUND;
+
+    SimVariable const *variable = simVariables + nextIndex;
+    UINTN requiredSize = (StrLen16(variable->name) + 1u) * sizeof *name;
+
+    if (*nameSize < requiredSize)
+	return *nameSize = requiredSize, EFI_BUFFER_TOO_SMALL;
+
+    memcpy(name, variable->name, requiredSize);
+    *guid = variable->guid;
+    *nameSize = requiredSize;
+
+    return EFI_SUCCESS;
+}
+
+static bool WriteAll(int fd, void const *buffer, size_t size)
+{
+    unsigned char const *ptr = buffer;
+
+    while (size)
+    {
+	ssize_t written = write(fd, ptr, size);
+
+	if (written <= 0)
+	    return false;
+
+	ptr += written, size -= (size_t)written;
+    }
+
+    return true;
+}
+
+static bool ReadAll(int fd, void *buffer, size_t size)
+{
+    unsigned char *ptr = buffer;
+
+    while (size)
+    {
+	ssize_t bytesRead = read(fd, ptr, size);
+
+	if (bytesRead <= 0)
+	    return false;
+
+	ptr += bytesRead, size -= (size_t)bytesRead;
+    }
+
+    return true;
+}
+
+bool SimPlatform_SaveNonVolatileVariables(int fd)
+{
+    unsigned count = 0u;
+
+    for (SimVariable const *variable = simVariables; variable < simVariables + simVariableCount; variable++)
+	count += !!(variable->attributes & EFI_VARIABLE_NON_VOLATILE);
+
+    if (!WriteAll(fd, &count, sizeof count))
+	return false;
+
+    for (SimVariable const *variable = simVariables; variable < simVariables + simVariableCount; variable++)
+	if (variable->attributes & EFI_VARIABLE_NON_VOLATILE)
+	    if (!WriteAll(fd, variable->name, sizeof variable->name) || !WriteAll(fd, &variable->guid, sizeof variable->guid)
+		    || !WriteAll(fd, &variable->attributes, sizeof variable->attributes) || !WriteAll(fd, &variable->size, sizeof variable->size)
+		    || !WriteAll(fd, variable->data, variable->size))
+	    {
+		return false;
+	    }
+
+    return true;
+}
+
+// Replaces all the non-volatile variables, and keeps the order from the other process
+bool SimPlatform_LoadNonVolatileVariables(int fd)
+{
+    unsigned count;
+
+    if (!ReadAll(fd, &count, sizeof count))
+	return false;
+
+    for (unsigned index = simVariableCount; index--; )
+	if (simVariables[index].attributes & EFI_VARIABLE_NON_VOLATILE)
+	    SimVariable_Delete(simVariables + index);
+
+    for (unsigned index = 0u; index < count; index++)
+    {
+	SimVariable variable;
+
+	if (!ReadAll(fd, variable.name, sizeof variable.name) || !ReadAll(fd, &variable.guid, sizeof variable.guid)
+		|| !ReadAll(fd, &variable.attributes, sizeof variable.attributes) || !ReadAll(fd, &variable.size, sizeof variable.size))
+	{
+	    return false;
+	}
+
+	if (!(variable.data = malloc(variable.size ? variable.size : 1u)) || !ReadAll(fd, variable.data, variable.size))
+	    return free(variable.data), false;
+
+	variable.name[SIM_MAX_VARIABLE_NAME - 1u] = 0u;
+
+	bool isSet = !EFI_ERROR(SimPlatform_SetVariable(variable.name, &variable.guid, variable.attributes, variable.size, variable.data));
+
+	free(variable.data);
+
+	if (!isSet)
+	    return false;
+    }
+
+    return true;
+}
+
+// The year is after the driver build year, so the CMOS is not considered cleared
+static EFI_STATUS EFIAPI Sim_GetTime(EFI_TIME *time, VOID *capabilities)
+{
+    if (!time)
+	return EFI_INVALID_PARAMETER;
+
+    memset(time, 0, sizeof *time);
+    time->Year = 2025u;
+    time->Month = 6u;
+    time->Day = 1u;
+    time->Hour = 12u;
+
+    return EFI_SUCCESS;
+}
+
+// Boot script
+
+static SimBootScriptEntry *bootScript = NULL;
+static unsigned bootScriptCount = 0u, bootScriptCapacity = 0u;
+
+static uint_least64_t ReadScriptValue(VOID const *buffer, uint_least8_t width)
+{
+    switch (width)
+    {
+    case EfiBootScriptWidthUint8:
+	return *(UINT8 const *)buffer;
+    case EfiBootScriptWidthUint16:
+	return *(UINT16 const *)buffer;
+    case EfiBootScriptWidthUint32:
+	return *(UINT32 const *)buffer;
+    default:
+	return *(UINT64 const *)buffer;
+    }
+}
+
+static EFI_STATUS EFIAPI SimS3SaveState_Write(CONST EFI_S3_SAVE_STATE_PROTOCOL *This, UINTN opcode, ...)
+{
+    SimBootScriptEntry entry = { .opcode = (uint_least8_t)opcode, .segment = 0u, .dataMask = 0u };
+    VOID const *data = NULL, *dataMask = NULL;
+    va_list args;
+
+    va_start(args, opcode);
+    entry.width = (uint_least8_t)va_arg(args, int);
+
+    if (entry.width > EfiBootScriptWidthUint64)
+	return va_end(args), EFI_INVALID_PARAMETER;
+
+    switch (opcode)
+    {
+    case EFI_BOOT_SCRIPT_MEM_WRITE_OPCODE:
+    case EFI_BOOT_SCRIPT_PCI_CONFIG_WRITE_OPCODE:
+	entry.address = va_arg(args, UINT64);
+	va_arg(args, UINTN);
+	data = va_arg(args, VOID *);
+	break;
+
+    case EFI_BOOT_SCRIPT_MEM_READ_WRITE_OPCODE:
+    case EFI_BOOT_SCRIPT_PCI_CONFIG_READ_WRITE_OPCODE:
+	entry.address = va_arg(args, UINT64);
+	data = va_arg(args, VOID *);
+	dataMask = va_arg(args, VOID *);
+	break;
+
+    case EFI_BOOT_SCRIPT_PCI_CONFIG2_WRITE_OPCODE:
+	entry.segment = (uint_least16_t)va_arg(args, int);
+	entry.address = va_arg(args, UINT64);
+	va_arg(args, UINTN);
+	data = va_arg(args, VOID *);
+	break;
+
+    case EFI_BOOT_SCRIPT_PCI_CONFIG2_READ_WRITE_OPCODE:
+	entry.segment = (uint_least16_t)va_arg(args, int);
+	entry.address = va_arg(args, UINT64);
+	data = va_arg(args, VOID *);
+	dataMask = va_arg(args, VOID *);
+	break;
+
+    default:
+	va_end(args);
+	return EFI_UNSUPPORTED;
+    }
+
+    va_end(args);
+
+    if (!data)
+	return EFI_INVALID_PARAMETER;
+
+    entry.data = ReadScriptValue(data, entry.width);
+
+    if (dataMask)
+	entry.dataMask = ReadScriptValue(dataMask, entry.width);
+
+    if (bootScriptCount == bootScriptCapacity)
+    {
+	unsigned newCapacity = bootScriptCapacity ? 2u * bootScriptCapacity : 256u;
+	SimBootScriptEntry *newScript = realloc(bootScript, newCapacity * sizeof *newScript);
+
+	if (!newScript)
+	    return EFI_OUT_OF_RESOURCES;
+
+	bootScript = newScript;
+	bootScriptCapacity = newCapacity;
+    }
+
+    bootScript[bootScriptCount++] = entry;
+    simCounters.bootScriptEntries++;
+    simCounters.bootScriptOpcodes[opcode & 0x0Fu]++;
+
+    return EFI_SUCCESS;
+}
+
+EFI_S3_SAVE_STATE_PROTOCOL simS3SaveState = { .Write = &SimS3SaveState_Write };
+
+unsigned SimPlatform_BootScriptEntryCount(void)
+{
+    return bootScriptCount;
+}
+
+SimBootScriptEntry const *SimPlatform_BootScriptEntry(unsigned index)
+{
+    return index < bootScriptCount ? bootScript + index : NULL;
+}
+
+// GCD memory and I/O space: free ranges added by the simulation, and the ranges allocated by the driver
+
+#define SIM_MAX_GCD_SPACES	    8u
+#define SIM_MAX_GCD_ALLOCATIONS	    16u
+
+typedef struct SimGcdRange
+{
+    bool isIo;
+    EFI_PHYSICAL_ADDRESS baseAddress;
+    UINT64 length, capabilities, attributes;
+}
+    SimGcdRange;
+
+static SimGcdRange gcdSpaces[SIM_MAX_GCD_SPACES], gcdAllocations[SIM_MAX_GCD_ALLOCATIONS];
+static unsigned gcdSpaceCount = 0u, gcdAllocationCount = 0u;
+
+static inline bool isInRange(SimGcdRange const *range, EFI_PHYSICAL_ADDRESS baseAddress, UINT64 length)
+{
+    return baseAddress >= range->baseAddress && length <= range->length && baseAddress - range->baseAddress <= range->length - length;
+}
+
+static inline bool isRangeOverlap64(SimGcdRange const *range, EFI_PHYSICAL_ADDRESS baseAddress, UINT64 length)
+{
+    return baseAddress < range->baseAddress + range->length && range->baseAddress < baseAddress + length;
+}
+
+static SimGcdRange *Sim_GcdFindSpace(bool isIo, EFI_PHYSICAL_ADDRESS baseAddress, UINT64 length)
+{
+    for (unsigned index = 0u; index < gcdSpaceCount; index++)
+	if (gcdSpaces[index].isIo == isIo && isInRange(gcdSpaces + index, baseAddress, length))
+	    return gcdSpaces + index;
+
+    return NULL;
+}
+
+static SimGcdRange *Sim_GcdFindOverlap(bool isIo, EFI_PHYSICAL_ADDRESS baseAddress, UINT64 length)
+{
+    for (unsigned index = 0u; index < gcdAllocationCount; index++)
+	if (gcdAllocations[index].isIo == isIo && isRangeOverlap64(gcdAllocations + index, baseAddress, length))
+	    return gcdAllocations + index;
+
+    return NULL;
+}
+
+void SimPlatform_AddGcdSpace(bool isIo, EFI_PHYSICAL_ADDRESS baseAddress, UINT64 length)
+{
+    if (gcdSpaceCount < SIM_MAX_GCD_SPACES)
+	gcdSpaces[gcdSpaceCount++] = (SimGcdRange)
+	{
+	    .isIo = isIo, .baseAddress = baseAddress, .length = length,
+	    .capabilities = isIo ? 0u : EFI_MEMORY_UC | EFI_MEMORY_WC | EFI_MEMORY_WT | EFI_MEMORY_WB | EFI_MEMORY_UCE,
+	    .attributes = 0u
+	};
+}
+
+unsigned SimPlatform_GcdAllocationCount(void)
+{
+    return gcdAllocationCount;
+}
+
+static EFI_STATUS Sim_GcdAllocate(bool isIo, EFI_GCD_ALLOCATE_TYPE allocateType, UINTN alignment, UINT64 length, EFI_PHYSICAL_ADDRESS *baseAddress)
+{
+    UINT64 alignmentMask = (UINT64_C(1) << alignment) - 1u;
+
+    if (!length || alignment >= 64u || gcdAllocationCount >= SIM_MAX_GCD_ALLOCATIONS)
+	return EFI_INVALID_PARAMETER;
+
+    simCounters.gcdAllocations++;
+
+    if (allocateType == EfiGcdAllocateAddress)
+    {
+	if (*baseAddress & alignmentMask || !Sim_GcdFindSpace(isIo, *baseAddress, length))
+	    return EFI_NOT_FOUND;
+
+	if (Sim_GcdFindOverlap(isIo, *baseAddress, length))
+	    return EFI_ACCESS_DENIED;
+    }
+    else
+	if (allocateType == EfiGcdAllocateMaxAddressSearchTopDown)
+	{
+	    bool isFound = false;
+	    EFI_PHYSICAL_ADDRESS foundAddress = 0u;
+
+	    for (SimGcdRange const *space = gcdSpaces; space < gcdSpaces + gcdSpaceCount; space++)
+	    {
+		if (space->isIo != isIo || space->length < length)
+		    continue;
+
+		EFI_PHYSICAL_ADDRESS top = space->baseAddress + space->length - 1u;
+
+		if (top > *baseAddress)
+		    top = *baseAddress;
+
+		if (top < space->baseAddress || top - space->baseAddress + 1u < length)
+		    continue;
+
+		EFI_PHYSICAL_ADDRESS candidate = (top - length + 1u) & ~alignmentMask;
+
+		while (candidate >= space->baseAddress && isInRange(space, candidate, length))
+		{
+		    SimGcdRange const *overlap = Sim_GcdFindOverlap(isIo, candidate, length);
+
+		    if (!overlap)
+		    {
+			if (!isFound || candidate > foundAddress)
+			    isFound = true, foundAddress = candidate;
+
+			break;
+		    }
+
+		    if (overlap->baseAddress < length)
+			break;
+
+		    candidate = (overlap->baseAddress - length) & ~alignmentMask;
+		}
+	    }
+
+	    if (!isFound)
+		return EFI_NOT_FOUND;
+
+	    *baseAddress = foundAddress;
+	}
+	else
+	    return EFI_UNSUPPORTED;
+
+    gcdAllocations[gcdAllocationCount++] = (SimGcdRange)
+    {
+	.isIo = isIo, .baseAddress = *baseAddress, .length = length,
+	.capabilities = Sim_GcdFindSpace(isIo, *baseAddress, length)->capabilities,
+	.attributes = 0u
+    };
+
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS Sim_GcdFree(bool isIo, EFI_PHYSICAL_ADDRESS baseAddress, UINT64 length)
+{
+    for (unsigned index = 0u; index < gcdAllocationCount; index++)
+	if (gcdAllocations[index].isIo == isIo && gcdAllocations[index].baseAddress == baseAddress && gcdAllocations[index].length == length)
+	{
+	    gcdAllocations[index] = gcdAllocations[--gcdAllocationCount];
+	    simCounters.gcdFrees++;
+
+	    return EFI_SUCCESS;
+	}
+
+    return EFI_NOT_FOUND;
+}
+
+static EFI_STATUS EFIAPI Sim_AllocateMemorySpace(EFI_GCD_ALLOCATE_TYPE allocateType, EFI_GCD_MEMORY_TYPE memoryType, UINTN alignment, UINT64 length, EFI_PHYSICAL_ADDRESS *baseAddress, EFI_HANDLE imageHandle, EFI_HANDLE deviceHandle)
+{
+    return memoryType == EfiGcdMemoryTypeMemoryMappedIo ? Sim_GcdAllocate(false, allocateType, alignment, length, baseAddress) : EFI_NOT_FOUND;
+}
+
+static EFI_STATUS EFIAPI Sim_FreeMemorySpace(EFI_PHYSICAL_ADDRESS baseAddress, UINT64 length)
+{
+    return Sim_GcdFree(false, baseAddress, length);
+}
+
+static EFI_STATUS EFIAPI Sim_AllocateIoSpace(EFI_GCD_ALLOCATE_TYPE allocateType, EFI_GCD_IO_TYPE ioType, UINTN alignment, UINT64 length, EFI_PHYSICAL_ADDRESS *baseAddress, EFI_HANDLE imageHandle, EFI_HANDLE deviceHandle)
+{
+    return ioType == EfiGcdIoTypeIo ? Sim_GcdAllocate(true, allocateType, alignment, length, baseAddress) : EFI_NOT_FOUND;
+}
+
+static EFI_STATUS EFIAPI Sim_FreeIoSpace(EFI_PHYSICAL_ADDRESS baseAddress, UINT64 length)
+{
+    return Sim_GcdFree(true, baseAddress, length);
+}
+
+static EFI_STATUS EFIAPI Sim_GetMemorySpaceDescriptor(EFI_PHYSICAL_ADDRESS baseAddress, EFI_GCD_MEMORY_SPACE_DESCRIPTOR *descriptor)
+{
+    SimGcdRange const *range = Sim_GcdFindOverlap(false, baseAddress, 1u);
+
+    if (!range)
+	range = Sim_GcdFindSpace(false, baseAddress, 1u);
+
+    if (!range)
+	return EFI_NOT_FOUND;
+
+    *descriptor = (EFI_GCD_MEMORY_SPACE_DESCRIPTOR)
+    {
+	.BaseAddress = range->baseAddress, .Length = range->length,
+	.Capabilities = range->capabilities, .Attributes = range->attributes,
+	.GcdMemoryType = EfiGcdMemoryTypeMemoryMappedIo
+    };
+
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI Sim_SetMemorySpaceAttributes(EFI_PHYSICAL_ADDRESS baseAddress, UINT64 length, UINT64 attributes)
+{
+    for (SimGcdRange *range = gcdAllocations; range < gcdAllocations + gcdAllocationCount; range++)
+	if (!range->isIo && isInRange(range, baseAddress, length))
+	{
+	    if (attributes & ~range->capabilities)
+		return EFI_UNSUPPORTED;
+
+	    range->attributes = attributes;
+
+	    return EFI_SUCCESS;
+	}
+
+    return EFI_NOT_FOUND;
+}
+
+// Free and allocated ranges of each MMIO space, in address order
+static EFI_STATUS EFIAPI Sim_GetMemorySpaceMap(UINTN *descriptorCount, EFI_GCD_MEMORY_SPACE_DESCRIPTOR **memorySpaceMap)
+{
+    EFI_GCD_MEMORY_SPACE_DESCRIPTOR *descriptors = NULL;
+    EFI_STATUS status = gBS->AllocatePool(EfiBootServicesData, (SIM_MAX_GCD_SPACES * (2u * SIM_MAX_GCD_ALLOCATIONS + 1u)) * sizeof *descriptors, (VOID **)&descriptors);
+
+    if (EFI_ERROR(status))
+	return status;
+
+    *descriptorCount = 0u;
+
+    for (SimGcdRange const *space = gcdSpaces; space < gcdSpaces + gcdSpaceCount; space++)
+    {
+	if (space->isIo)
+	    continue;
+
+	EFI_PHYSICAL_ADDRESS address = space->baseAddress, spaceEnd = space->baseAddress + space->length;
+
+	while (address < spaceEnd)
+	{
+	    SimGcdRange const *nextAllocation = NULL;
+
+	    for (SimGcdRange const *range = gcdAllocations; range < gcdAllocations + gcdAllocationCount; range++)
+		if (!range->isIo && range->baseAddress >= address && range->baseAddress < spaceEnd && (!nextAllocation || range->baseAddress < nextAllocation->baseAddress))
+		    nextAllocation = range;
+
+	    EFI_PHYSICAL_ADDRESS freeEnd = nextAllocation ? nextAllocation->baseAddress : spaceEnd;
+
+	    if (freeEnd > address)
+		descriptors[(*descriptorCount)++] = (EFI_GCD_MEMORY_SPACE_DESCRIPTOR)
+		{
+		    .BaseAddress = address, .Length = freeEnd - address,
+		    .Capabilities = space->capabilities, .GcdMemoryType = EfiGcdMemoryTypeMemoryMappedIo
+		};
+
+	    if (!nextAllocation)
+		break;
+
+	    descriptors[(*descriptorCount)++] = (EFI_GCD_MEMORY_SPACE_DESCRIPTOR)
+	    {
+		.BaseAddress = nextAllocation->baseAddress, .Length = nextAllocation->length,
+		.Capabilities = nextAllocation->capabilities, .Attributes = nextAllocation->attributes,
+		.GcdMemoryType = EfiGcdMemoryTypeMemoryMappedIo, .ImageHandle = gImageHandle
+	    };
+
+	    address = nextAllocation->baseAddress + nextAllocation->length;
+	}
+    }
+
+    *memorySpaceMap = descriptors;
+
+    return EFI_SUCCESS;
+}
+
+static EFI_DXE_SERVICES simDxeServices =
+{
+    .AllocateMemorySpace = &Sim_AllocateMemorySpace,
+    .FreeMemorySpace = &Sim_FreeMemorySpace,
+    .GetMemorySpaceDescriptor = &Sim_GetMemorySpaceDescriptor,
+    .SetMemorySpaceAttributes = &Sim_SetMemorySpaceAttributes,
+    .AllocateIoSpace = &Sim_AllocateIoSpace,
+    .FreeIoSpace = &Sim_FreeIoSpace,
+    .GetMemorySpaceMap = &Sim_GetMemorySpaceMap
+};
+
+// System table
+
+static EFI_BOOT_SERVICES simBootServices =
+{
+    .CreateEvent = &Sim_CreateEvent,
+    .CreateEventEx = &Sim_CreateEventEx,
+    .SetTimer = &Sim_SetTimer,
+    .WaitForEvent = &Sim_WaitForEvent,
+    .SignalEvent = &Sim_SignalEvent,
+    .CheckEvent = &Sim_CheckEvent,
+    .CloseEvent = &Sim_CloseEvent,
+    .Stall = &Sim_Stall,
+    .HandleProtocol = &Sim_HandleProtocol,
+    .LocateProtocol = &Sim_LocateProtocol,
+    .LocateHandleBuffer = &Sim_LocateHandleBuffer,
+    .OpenProtocol = &Sim_OpenProtocol,
+    .AllocatePool = &Sim_AllocatePool,
+    .FreePool = &Sim_FreePool
+};
+
+static EFI_RUNTIME_SERVICES simRuntimeServices =
+{
+    .GetTime = &Sim_GetTime,
+    .GetVariable = &Sim_GetVariable,
+    .GetNextVariableName = &Sim_GetNextVariableName,
+    .SetVariable = &Sim_SetVariable
+};
+
+#define SIM_MAX_CONFIGURATION_TABLES 8u
+
+static EFI_CONFIGURATION_TABLE simConfigurationTables[SIM_MAX_CONFIGURATION_TABLES];
+
+static EFI_SYSTEM_TABLE simSystemTable =
+{
+    .BootServices = &simBootServices,
+    .RuntimeServices = &simRuntimeServices,
+    .NumberOfTableEntries = 0u,
+    .ConfigurationTable = simConfigurationTables
+};
+
+static UINT8 simImage;
+
+EFI_HANDLE gImageHandle = &simImage;
+EFI_SYSTEM_TABLE *gST = &simSystemTable;
+EFI_BOOT_SERVICES *gBS = &simBootServices;
+EFI_RUNTIME_SERVICES *gRT = &simRuntimeServices;
+EFI_DXE_SERVICES *gDS = &simDxeServices;
+
+EFI_STATUS SimPlatform_InstallConfigurationTable(EFI_GUID const *guid, VOID *table)
+{
+    if (simSystemTable.NumberOfTableEntries >= SIM_MAX_CONFIGURATION_TABLES)
+	return EFI_OUT_OF_RESOURCES;
+
+    simConfigurationTables[simSystemTable.NumberOfTableEntries].VendorGuid = *guid;
+    simConfigurationTables[simSystemTable.NumberOfTableEntries].VendorTable = table;
+    simSystemTable.NumberOfTableEntries++;
+
+    return EFI_SUCCESS;
+}
+
+void SimPlatform_Init(void)
+{
+    memset(&simCounters, 0, sizeof simCounters);
+}
+
+// UefiLib
+
+EFI_STATUS EFIAPI EfiGetSystemConfigurationTable(EFI_GUID *tableGuid, VOID **table)
+{
+    for (UINTN index = 0u; index < gST->NumberOfTableEntries; index++)
+	if (CompareGuid(&gST->ConfigurationTable[index].VendorGuid, tableGuid))
+	    return *table = gST->ConfigurationTable[index].VendorTable, EFI_SUCCESS;
+
+    return *table = NULL, EFI_NOT_FOUND;
+}
+
+EFI_STATUS EFIAPI EfiCreateEventReadyToBootEx(EFI_TPL notifyTpl, EFI_EVENT_NOTIFY notifyFunction, VOID *notifyContext, EFI_EVENT *readyToBootEvent)
+{
+    return gBS->CreateEventEx(EVT_NOTIFY_SIGNAL, notifyTpl, notifyFunction, notifyContext, &gEfiEventReadyToBootGuid, readyToBootEvent);
+}
+
+// BaseLib
+
+INTN EFIAPI HighBitSet64(UINT64 operand)
+{
+    return operand ? 63 - __builtin_clzll(operand) : -1;
+}
+
+UINT64 EFIAPI LShiftU64(UINT64 operand, UINTN count)
+{
+    return operand << count;
+}
+
+UINT64 EFIAPI RShiftU64(UINT64 operand, UINTN count)
+{
+    return operand >> count;
+}
+
+// Time stamp counter at 1 GHz, for the real time spent in the driver plus the virtual time from the simulated waits
+UINT64 EFIAPI AsmReadTsc(VOID)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (UINT64)now.tv_sec * 1'000'000'000u + (UINT64)now.tv_nsec + virtualTime;
+}
+
+VOID EFIAPI CpuPause(VOID)
+{
+}
+
+UINT32 EFIAPI AsmCpuid(UINT32 index, UINT32 *registerEax, UINT32 *registerEbx, UINT32 *registerEcx, UINT32 *registerEdx)
+{
+    unsigned eax = 0u, ebx = 0u, ecx = 0u, edx = 0u;
+
+    __cpuid_count(index, 0u, eax, ebx, ecx, edx);
+
+    if (registerEax)
+	*registerEax = eax;
+
+    if (registerEbx)
+	*registerEbx = ebx;
+
+    if (registerEcx)
+	*registerEcx = ecx;
+
+    if (registerEdx)
+	*registerEdx = edx;
+
+    return index;
+}
+
+// BaseMemoryLib
+
+VOID *EFIAPI CopyMem(VOID *destinationBuffer, CONST VOID *sourceBuffer, UINTN length)
+{
+    return memmove(destinationBuffer, sourceBuffer, length);
+}
+
+VOID *EFIAPI SetMem(VOID *buffer, UINTN length, UINT8 value)
+{
+    return memset(buffer, value, length);
+}
+
+VOID *EFIAPI SetMem16(VOID *buffer, UINTN length, UINT16 value)
+{
+    UINT16 *ptr = buffer;
+
+    for (UINTN index = 0u; index < length / sizeof value; index++)
+	ptr[index] = value;
+
+    return buffer;
+}
+
+VOID *EFIAPI ZeroMem(VOID *buffer, UINTN length)
+{
+    return memset(buffer, 0, length);
+}
+
+INTN EFIAPI CompareMem(CONST VOID *destinationBuffer, CONST VOID *sourceBuffer, UINTN length)
+{
+    return memcmp(destinationBuffer, sourceBuffer, length);
+}
+
+BOOLEAN EFIAPI CompareGuid(CONST EFI_GUID *guid1, CONST EFI_GUID *guid2)
+{
+    return !memcmp(guid1, guid2, sizeof *guid1);
+}
+
+// MemoryAllocationLib
+
+VOID *EFIAPI AllocatePool(UINTN allocationSize)
+{
+    simCounters.poolAllocations++;
+
+    return malloc(allocationSize ? allocationSize : 1u);
+}
+
+VOID *EFIAPI AllocateZeroPool(UINTN allocationSize)
+{
+    simCounters.poolAllocations++;
+
+    return calloc(1u, allocationSize ? allocationSize : 1u);
+}
+
+VOID *EFIAPI ReallocatePool(UINTN oldSize, UINTN newSize, VOID *oldBuffer)
+{
+    simCounters.poolAllocations++;
+
+    return realloc(oldBuffer, newSize ? newSize : 1u);
+}
+
+VOID EFIAPI FreePool(VOID *buffer)
+{
+    free(buffer);
+}
+
+#if defined(NVSTRAPS_HOST_SIM_DEBUG)
+
+// EDK2 format strings, with %a for ASCII strings and %r for EFI_STATUS values
+VOID EFIAPI DebugPrint(UINTN errorLevel, CONST CHAR8 *format, ...)
+{
+    char hostFormat[512u];
+    unsigned length = 0u;
+
+    for (CHAR8 const *ptr = format; *ptr && length + 3u < sizeof hostFormat; ptr++)
+	if (ptr[0u] == '%' && ptr[1u] == 'a')
+	    hostFormat[length++] = '%', hostFormat[length++] = 's', ptr++;
+	else
+	    if (ptr[0u] == '%' && ptr[1u] == 'r')
+		hostFormat[length++] = '%', hostFormat[length++] = 'l', hostFormat[length++] = 'x', ptr++;
+	    else
+		hostFormat[length++] = *ptr;
+
+    hostFormat[length] = '\0';
+
+    va_list args;
+
+    va_start(args, format);
+    vfprintf(stderr, hostFormat, args);
+    va_end(args);
+}
+
+#endif
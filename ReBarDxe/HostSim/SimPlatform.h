@@ -0,0 +1,62 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_PLATFORM_H)
+#define NV_STRAPS_REBAR_HOST_SIM_PLATFORM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <Uefi.h>
+#include <Protocol/S3SaveState.h>
+
+// Counters for the platform services called by the driver during one simulated boot
+typedef struct SimCounters
+{
+    uint_least64_t configReads, configWrites, configBlockReads, ecamReads, ecamWrites;
+    uint_least64_t strapsUpdates, reBarWrites, preprocessCalls;
+    uint_least64_t variableReads, variableWrites, variableEnumerations;
+    uint_least64_t bootScriptEntries, bootScriptOpcodes[0x10u];
+    uint_least64_t eventsCreated, timerWaits, stallCalls, poolAllocations;
+    uint_least64_t gcdAllocations, gcdFrees;
+}
+    SimCounters;
+
+extern SimCounters simCounters;
+
+// Virtual time in ns. Stall() and the timer events only advance the virtual clock, the simulation never sleeps.
+uint_least64_t SimPlatform_Now(void);
+void SimPlatform_Advance(uint_least64_t nanoseconds);
+
+void SimPlatform_Init(void);
+void SimPlatform_SignalEventGroup(EFI_GUID const *eventGroup);
+EFI_STATUS SimPlatform_InstallConfigurationTable(EFI_GUID const *guid, VOID *table);
+
+// Protocol interfaces found by LocateProtocol(), LocateHandleBuffer(), HandleProtocol() and OpenProtocol()
+EFI_STATUS SimPlatform_InstallProtocol(EFI_HANDLE handle, EFI_GUID const *protocol, VOID *interface);
+
+// Free MMIO or I/O ranges in the GCD, for the driver allocations
+void SimPlatform_AddGcdSpace(bool isIo, EFI_PHYSICAL_ADDRESS baseAddress, UINT64 length);
+unsigned SimPlatform_GcdAllocationCount(void);
+
+// In-memory variable store
+EFI_STATUS SimPlatform_SetVariable(CHAR16 const *name, EFI_GUID const *guid, UINT32 attributes, UINTN size, VOID const *data);
+VOID const *SimPlatform_FindVariable(char const *name, EFI_GUID const *guid, UINTN *size);
+void SimPlatform_AsciiToUcs2(CHAR16 *dest, char const *src, unsigned capacity);
+
+// Non-volatile variables are passed between processes, to run each simulated boot in a new process
+bool SimPlatform_SaveNonVolatileVariables(int fd);
+bool SimPlatform_LoadNonVolatileVariables(int fd);
+
+// Entries written to the boot script by the S3SaveState protocol
+typedef struct SimBootScriptEntry
+{
+    uint_least8_t opcode, width;
+    uint_least16_t segment;
+    uint_least64_t address, data, dataMask;
+}
+    SimBootScriptEntry;
+
+extern EFI_S3_SAVE_STATE_PROTOCOL simS3SaveState;
+
+unsigned SimPlatform_BootScriptEntryCount(void);
+SimBootScriptEntry const *SimPlatform_BootScriptEntry(unsigned index);
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_PLATFORM_H)
@@ -0,0 +1,9 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_GUID_ACPI_H)
+#define NV_STRAPS_REBAR_HOST_SIM_GUID_ACPI_H
+
+#include <Uefi.h>
+
+extern EFI_GUID gEfiAcpi10TableGuid;
+extern EFI_GUID gEfiAcpi20TableGuid;
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_GUID_ACPI_H)
@@ -0,0 +1,9 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_GUID_EVENT_GROUP_H)
+#define NV_STRAPS_REBAR_HOST_SIM_GUID_EVENT_GROUP_H
+
+#include <Uefi.h>
+
+extern EFI_GUID gEfiEventReadyToBootGuid;
+extern EFI_GUID gEfiEndOfDxeEventGroupGuid;
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_GUID_EVENT_GROUP_H)
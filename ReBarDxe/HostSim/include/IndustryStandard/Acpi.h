@@ -0,0 +1,43 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_ACPI_H)
+#define NV_STRAPS_REBAR_HOST_SIM_ACPI_H
+
+#include <Uefi.h>
+
+#pragma pack(push, 1)
+
+typedef struct
+{
+    UINT32 Signature;
+    UINT32 Length;
+    UINT8  Revision;
+    UINT8  Checksum;
+    UINT8  OemId[6];
+    UINT64 OemTableId;
+    UINT32 OemRevision;
+    UINT32 CreatorId;
+    UINT32 CreatorRevision;
+}
+    EFI_ACPI_DESCRIPTION_HEADER;
+
+typedef struct
+{
+    UINT64 Signature;
+    UINT8  Checksum;
+    UINT8  OemId[6];
+    UINT8  Revision;
+    UINT32 RsdtAddress;
+    UINT32 Length;
+    UINT64 XsdtAddress;
+    UINT8  ExtendedChecksum;
+    UINT8  Reserved[3];
+}
+    EFI_ACPI_2_0_ROOT_SYSTEM_DESCRIPTION_POINTER;
+
+#pragma pack(pop)
+
+#define EFI_ACPI_2_0_ROOT_SYSTEM_DESCRIPTION_POINTER_SIGNATURE		UINT64_C(0x2052'5450'2044'5352)	    // "RSD PTR "
+#define EFI_ACPI_2_0_EXTENDED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE	0x5444'5358u			    // "XSDT"
+
+#include <IndustryStandard/MemoryMappedConfigurationSpaceAccessTable.h>
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_ACPI_H)
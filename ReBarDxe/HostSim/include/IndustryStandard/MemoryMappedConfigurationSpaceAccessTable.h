@@ -0,0 +1,29 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_MCFG_H)
+#define NV_STRAPS_REBAR_HOST_SIM_MCFG_H
+
+#include <IndustryStandard/Acpi.h>
+
+#pragma pack(push, 1)
+
+typedef struct
+{
+    EFI_ACPI_DESCRIPTION_HEADER Header;
+    UINT64 Reserved;
+}
+    EFI_ACPI_MEMORY_MAPPED_CONFIGURATION_BASE_ADDRESS_TABLE_HEADER;
+
+typedef struct
+{
+    UINT64 BaseAddress;
+    UINT16 PciSegmentGroupNumber;
+    UINT8  StartBusNumber;
+    UINT8  EndBusNumber;
+    UINT32 Reserved;
+}
+    EFI_ACPI_MEMORY_MAPPED_ENHANCED_CONFIGURATION_SPACE_BASE_ADDRESS_ALLOCATION_STRUCTURE;
+
+#pragma pack(pop)
+
+#define EFI_ACPI_2_0_MEMORY_MAPPED_CONFIGURATION_BASE_ADDRESS_TABLE_SIGNATURE 0x4746'434Du	// "MCFG"
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_MCFG_H)
@@ -0,0 +1,8 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_PCI_EXPRESS21_H)
+#define NV_STRAPS_REBAR_HOST_SIM_PCI_EXPRESS21_H
+
+#define EFI_PCIE_CAPABILITY_BASE_OFFSET				0x100u
+#define PCI_EXPRESS_EXTENDED_CAPABILITY_ADVANCED_ERROR_REPORTING_ID	0x0001u
+#define PCI_EXPRESS_EXTENDED_CAPABILITY_RESIZABLE_BAR_ID	0x0015u
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_PCI_EXPRESS21_H)
@@ -0,0 +1,13 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_BASE_LIB_H)
+#define NV_STRAPS_REBAR_HOST_SIM_BASE_LIB_H
+
+#include <Uefi.h>
+
+INTN EFIAPI HighBitSet64(UINT64 Operand);
+UINT64 EFIAPI LShiftU64(UINT64 Operand, UINTN Count);
+UINT64 EFIAPI RShiftU64(UINT64 Operand, UINTN Count);
+UINT64 EFIAPI AsmReadTsc(VOID);
+VOID   EFIAPI CpuPause(VOID);
+UINT32 EFIAPI AsmCpuid(UINT32 Index, UINT32 *RegisterEax, UINT32 *RegisterEbx, UINT32 *RegisterEcx, UINT32 *RegisterEdx);
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_BASE_LIB_H)
@@ -0,0 +1,13 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_BASE_MEMORY_LIB_H)
+#define NV_STRAPS_REBAR_HOST_SIM_BASE_MEMORY_LIB_H
+
+#include <Uefi.h>
+
+VOID   *EFIAPI CopyMem(VOID *DestinationBuffer, CONST VOID *SourceBuffer, UINTN Length);
+VOID   *EFIAPI SetMem(VOID *Buffer, UINTN Length, UINT8 Value);
+VOID   *EFIAPI SetMem16(VOID *Buffer, UINTN Length, UINT16 Value);
+VOID   *EFIAPI ZeroMem(VOID *Buffer, UINTN Length);
+INTN    EFIAPI CompareMem(CONST VOID *DestinationBuffer, CONST VOID *SourceBuffer, UINTN Length);
+BOOLEAN EFIAPI CompareGuid(CONST EFI_GUID *Guid1, CONST EFI_GUID *Guid2);
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_BASE_MEMORY_LIB_H)
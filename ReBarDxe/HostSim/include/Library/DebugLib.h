@@ -0,0 +1,27 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_DEBUG_LIB_H)
+#define NV_STRAPS_REBAR_HOST_SIM_DEBUG_LIB_H
+
+#include <Uefi.h>
+
+#define DEBUG_INIT	0x0000'0001u
+#define DEBUG_WARN	0x0000'0002u
+#define DEBUG_INFO	0x0000'0040u
+#define DEBUG_VERBOSE	0x0040'0000u
+#define DEBUG_ERROR	0x8000'0000u
+
+// Debug messages are printed when the simulation is built with NVSTRAPS_HOST_SIM_DEBUG, as for a DEBUG firmware build
+#if defined(NVSTRAPS_HOST_SIM_DEBUG)
+VOID EFIAPI DebugPrint(UINTN ErrorLevel, CONST CHAR8 *Format, ...);
+# define DEBUG(Expression)	DebugPrint Expression
+# define DEBUG_CODE_BEGIN()	do {
+# define DEBUG_CODE_END()	} while (FALSE)
+#else
+# define MDEPKG_NDEBUG
+# define DEBUG(Expression)	do { } while (FALSE)
+# define DEBUG_CODE_BEGIN()	do { if (FALSE) {
+# define DEBUG_CODE_END()	} } while (FALSE)
+#endif
+
+#define ASSERT(Expression)	do { } while (FALSE)
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_DEBUG_LIB_H)
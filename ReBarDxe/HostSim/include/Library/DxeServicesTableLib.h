@@ -0,0 +1,59 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_DXE_SERVICES_TABLE_LIB_H)
+#define NV_STRAPS_REBAR_HOST_SIM_DXE_SERVICES_TABLE_LIB_H
+
+#include <Uefi.h>
+
+typedef enum
+{
+    EfiGcdAllocateAnySearchBottomUp,
+    EfiGcdAllocateMaxAddressSearchBottomUp,
+    EfiGcdAllocateAddress,
+    EfiGcdAllocateAnySearchTopDown,
+    EfiGcdAllocateMaxAddressSearchTopDown
+}
+    EFI_GCD_ALLOCATE_TYPE;
+
+typedef enum
+{
+    EfiGcdMemoryTypeNonExistent,
+    EfiGcdMemoryTypeReserved,
+    EfiGcdMemoryTypeSystemMemory,
+    EfiGcdMemoryTypeMemoryMappedIo
+}
+    EFI_GCD_MEMORY_TYPE;
+
+typedef enum
+{
+    EfiGcdIoTypeNonExistent,
+    EfiGcdIoTypeReserved,
+    EfiGcdIoTypeIo
+}
+    EFI_GCD_IO_TYPE;
+
+typedef struct
+{
+    EFI_PHYSICAL_ADDRESS BaseAddress;
+    UINT64 Length;
+    UINT64 Capabilities;
+    UINT64 Attributes;
+    EFI_GCD_MEMORY_TYPE GcdMemoryType;
+    EFI_HANDLE ImageHandle;
+    EFI_HANDLE DeviceHandle;
+}
+    EFI_GCD_MEMORY_SPACE_DESCRIPTOR;
+
+typedef struct
+{
+    EFI_STATUS (EFIAPI *AllocateMemorySpace)(EFI_GCD_ALLOCATE_TYPE GcdAllocateType, EFI_GCD_MEMORY_TYPE GcdMemoryType, UINTN Alignment, UINT64 Length, EFI_PHYSICAL_ADDRESS *BaseAddress, EFI_HANDLE ImageHandle, EFI_HANDLE DeviceHandle);
+    EFI_STATUS (EFIAPI *FreeMemorySpace)(EFI_PHYSICAL_ADDRESS BaseAddress, UINT64 Length);
+    EFI_STATUS (EFIAPI *GetMemorySpaceDescriptor)(EFI_PHYSICAL_ADDRESS BaseAddress, EFI_GCD_MEMORY_SPACE_DESCRIPTOR *Descriptor);
+    EFI_STATUS (EFIAPI *SetMemorySpaceAttributes)(EFI_PHYSICAL_ADDRESS BaseAddress, UINT64 Length, UINT64 Attributes);
+    EFI_STATUS (EFIAPI *AllocateIoSpace)(EFI_GCD_ALLOCATE_TYPE GcdAllocateType, EFI_GCD_IO_TYPE GcdIoType, UINTN Alignment, UINT64 Length, EFI_PHYSICAL_ADDRESS *BaseAddress, EFI_HANDLE ImageHandle, EFI_HANDLE DeviceHandle);
+    EFI_STATUS (EFIAPI *FreeIoSpace)(EFI_PHYSICAL_ADDRESS BaseAddress, UINT64 Length);
+    EFI_STATUS (EFIAPI *GetMemorySpaceMap)(UINTN *NumberOfDescriptors, EFI_GCD_MEMORY_SPACE_DESCRIPTOR **MemorySpaceMap);
+}
+    EFI_DXE_SERVICES;
+
+extern EFI_DXE_SERVICES *gDS;
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_DXE_SERVICES_TABLE_LIB_H)
@@ -0,0 +1,13 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_IO_LIB_H)
+#define NV_STRAPS_REBAR_HOST_SIM_IO_LIB_H
+
+#include <Uefi.h>
+
+UINT8  EFIAPI MmioRead8(UINTN Address);
+UINT8  EFIAPI MmioWrite8(UINTN Address, UINT8 Value);
+UINT16 EFIAPI MmioRead16(UINTN Address);
+UINT16 EFIAPI MmioWrite16(UINTN Address, UINT16 Value);
+UINT32 EFIAPI MmioRead32(UINTN Address);
+UINT32 EFIAPI MmioWrite32(UINTN Address, UINT32 Value);
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_IO_LIB_H)
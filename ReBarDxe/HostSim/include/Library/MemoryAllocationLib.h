@@ -0,0 +1,11 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_MEMORY_ALLOCATION_LIB_H)
+#define NV_STRAPS_REBAR_HOST_SIM_MEMORY_ALLOCATION_LIB_H
+
+#include <Uefi.h>
+
+VOID *EFIAPI AllocatePool(UINTN AllocationSize);
+VOID *EFIAPI AllocateZeroPool(UINTN AllocationSize);
+VOID *EFIAPI ReallocatePool(UINTN OldSize, UINTN NewSize, VOID *OldBuffer);
+VOID  EFIAPI FreePool(VOID *Buffer);
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_MEMORY_ALLOCATION_LIB_H)
@@ -0,0 +1,10 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_UEFI_BOOT_SERVICES_TABLE_LIB_H)
+#define NV_STRAPS_REBAR_HOST_SIM_UEFI_BOOT_SERVICES_TABLE_LIB_H
+
+#include <Uefi.h>
+
+extern EFI_HANDLE gImageHandle;
+extern EFI_SYSTEM_TABLE *gST;
+extern EFI_BOOT_SERVICES *gBS;
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_UEFI_BOOT_SERVICES_TABLE_LIB_H)
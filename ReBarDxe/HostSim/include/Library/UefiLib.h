@@ -0,0 +1,9 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_UEFI_LIB_H)
+#define NV_STRAPS_REBAR_HOST_SIM_UEFI_LIB_H
+
+#include <Uefi.h>
+
+EFI_STATUS EFIAPI EfiGetSystemConfigurationTable(EFI_GUID *TableGuid, VOID **Table);
+EFI_STATUS EFIAPI EfiCreateEventReadyToBootEx(EFI_TPL NotifyTpl, EFI_EVENT_NOTIFY NotifyFunction, VOID *NotifyContext, EFI_EVENT *ReadyToBootEvent);
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_UEFI_LIB_H)
@@ -0,0 +1,8 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_UEFI_RUNTIME_SERVICES_TABLE_LIB_H)
+#define NV_STRAPS_REBAR_HOST_SIM_UEFI_RUNTIME_SERVICES_TABLE_LIB_H
+
+#include <Uefi.h>
+
+extern EFI_RUNTIME_SERVICES *gRT;
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_UEFI_RUNTIME_SERVICES_TABLE_LIB_H)
@@ -0,0 +1,57 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_H)
+#define NV_STRAPS_REBAR_HOST_SIM_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_H
+
+#include <Uefi.h>
+#include <Protocol/PciRootBridgeIo.h>
+
+#define EFI_PCI_HOST_BRIDGE_COMBINE_MEM_PMEM	1u
+#define EFI_PCI_HOST_BRIDGE_MEM64_DECODE	2u
+
+typedef enum
+{
+    EfiPciHostBridgeBeginEnumeration,
+    EfiPciHostBridgeBeginBusAllocation,
+    EfiPciHostBridgeEndBusAllocation,
+    EfiPciHostBridgeBeginResourceAllocation,
+    EfiPciHostBridgeAllocateResources,
+    EfiPciHostBridgeSetResources,
+    EfiPciHostBridgeFreeResources,
+    EfiPciHostBridgeEndResourceAllocation,
+    EfiPciHostBridgeEndEnumeration,
+    EfiMaxPciHostBridgeEnumerationPhase
+}
+    EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PHASE;
+
+typedef enum
+{
+    EfiPciBeforeChildBusEnumeration,
+    EfiPciBeforeResourceCollection
+}
+    EFI_PCI_CONTROLLER_RESOURCE_ALLOCATION_PHASE;
+
+typedef struct _EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL;
+
+typedef EFI_STATUS (EFIAPI *EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_NOTIFY_PHASE)(EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *This, EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PHASE Phase);
+typedef EFI_STATUS (EFIAPI *EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_GET_NEXT_ROOT_BRIDGE)(EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *This, EFI_HANDLE *RootBridgeHandle);
+typedef EFI_STATUS (EFIAPI *EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_GET_ATTRIBUTES)(EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *This, EFI_HANDLE RootBridgeHandle, UINT64 *Attributes);
+typedef EFI_STATUS (EFIAPI *EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_START_BUS_ENUMERATION)(EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *This, EFI_HANDLE RootBridgeHandle, VOID **Configuration);
+typedef EFI_STATUS (EFIAPI *EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_SET_BUS_NUMBERS)(EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *This, EFI_HANDLE RootBridgeHandle, VOID *Configuration);
+typedef EFI_STATUS (EFIAPI *EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_SUBMIT_RESOURCES)(EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *This, EFI_HANDLE RootBridgeHandle, VOID *Configuration);
+typedef EFI_STATUS (EFIAPI *EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_GET_PROPOSED_RESOURCES)(EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *This, EFI_HANDLE RootBridgeHandle, VOID **Configuration);
+typedef EFI_STATUS (EFIAPI *EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_PREPROCESS_CONTROLLER)(EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *This, EFI_HANDLE RootBridgeHandle, EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_PCI_ADDRESS PciAddress, EFI_PCI_CONTROLLER_RESOURCE_ALLOCATION_PHASE Phase);
+
+struct _EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL
+{
+    EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_NOTIFY_PHASE NotifyPhase;
+    EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_GET_NEXT_ROOT_BRIDGE GetNextRootBridge;
+    EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_GET_ATTRIBUTES GetAllocAttributes;
+    EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_START_BUS_ENUMERATION StartBusEnumeration;
+    EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_SET_BUS_NUMBERS SetBusNumbers;
+    EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_SUBMIT_RESOURCES SubmitResources;
+    EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_GET_PROPOSED_RESOURCES GetProposedResources;
+    EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_PREPROCESS_CONTROLLER PreprocessController;
+};
+
+extern EFI_GUID gEfiPciHostBridgeResourceAllocationProtocolGuid;
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_H)
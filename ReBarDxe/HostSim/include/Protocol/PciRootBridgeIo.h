@@ -0,0 +1,64 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_PCI_ROOT_BRIDGE_IO_H)
+#define NV_STRAPS_REBAR_HOST_SIM_PCI_ROOT_BRIDGE_IO_H
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+
+typedef enum
+{
+    EfiPciWidthUint8,
+    EfiPciWidthUint16,
+    EfiPciWidthUint32,
+    EfiPciWidthUint64,
+    EfiPciWidthFifoUint8,
+    EfiPciWidthFifoUint16,
+    EfiPciWidthFifoUint32,
+    EfiPciWidthFifoUint64,
+    EfiPciWidthFillUint8,
+    EfiPciWidthFillUint16,
+    EfiPciWidthFillUint32,
+    EfiPciWidthFillUint64,
+    EfiPciWidthMaximum
+}
+    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_WIDTH;
+
+typedef struct _EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL;
+
+typedef EFI_STATUS (EFIAPI *EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_POLL_IO_MEM)(EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *This, EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_WIDTH Width, UINT64 Address, UINT64 Mask, UINT64 Value, UINT64 Delay, UINT64 *Result);
+typedef EFI_STATUS (EFIAPI *EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_IO_MEM)(EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *This, EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_WIDTH Width, UINT64 Address, UINTN Count, VOID *Buffer);
+
+typedef struct
+{
+    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_IO_MEM Read;
+    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_IO_MEM Write;
+}
+    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_ACCESS;
+
+struct _EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL
+{
+    EFI_HANDLE ParentHandle;
+    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_POLL_IO_MEM PollMem;
+    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_POLL_IO_MEM PollIo;
+    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_ACCESS Mem;
+    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_ACCESS Io;
+    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_ACCESS Pci;
+    EFI_STATUS (EFIAPI *Configuration)(EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *This, VOID **Resources);
+    UINT32 SegmentNumber;
+};
+
+typedef struct
+{
+    UINT8  Register;
+    UINT8  Function;
+    UINT8  Device;
+    UINT8  Bus;
+    UINT32 ExtendedRegister;
+}
+    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_PCI_ADDRESS;
+
+#define EFI_PCI_ADDRESS(bus, dev, func, reg) \
+    (UINT64)((((UINTN)(bus)) << 24) | (((UINTN)(dev)) << 16) | (((UINTN)(func)) << 8) | (((UINTN)(reg)) < 256 ? ((UINTN)(reg)) : (UINT64)(LShiftU64((UINT64)(reg), 32))))
+
+extern EFI_GUID gEfiPciRootBridgeIoProtocolGuid;
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_PCI_ROOT_BRIDGE_IO_H)
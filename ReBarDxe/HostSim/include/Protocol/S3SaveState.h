@@ -0,0 +1,48 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_S3_SAVE_STATE_H)
+#define NV_STRAPS_REBAR_HOST_SIM_S3_SAVE_STATE_H
+
+#include <Uefi.h>
+
+typedef enum
+{
+    EfiBootScriptWidthUint8,
+    EfiBootScriptWidthUint16,
+    EfiBootScriptWidthUint32,
+    EfiBootScriptWidthUint64,
+    EfiBootScriptWidthFifoUint8,
+    EfiBootScriptWidthFifoUint16,
+    EfiBootScriptWidthFifoUint32,
+    EfiBootScriptWidthFifoUint64,
+    EfiBootScriptWidthFillUint8,
+    EfiBootScriptWidthFillUint16,
+    EfiBootScriptWidthFillUint32,
+    EfiBootScriptWidthFillUint64,
+    EfiBootScriptWidthMaximum
+}
+    EFI_BOOT_SCRIPT_WIDTH;
+
+#define EFI_BOOT_SCRIPT_IO_WRITE_OPCODE			0x00u
+#define EFI_BOOT_SCRIPT_IO_READ_WRITE_OPCODE		0x01u
+#define EFI_BOOT_SCRIPT_MEM_WRITE_OPCODE		0x02u
+#define EFI_BOOT_SCRIPT_MEM_READ_WRITE_OPCODE		0x03u
+#define EFI_BOOT_SCRIPT_PCI_CONFIG_WRITE_OPCODE		0x04u
+#define EFI_BOOT_SCRIPT_PCI_CONFIG_READ_WRITE_OPCODE	0x05u
+#define EFI_BOOT_SCRIPT_STALL_OPCODE			0x07u
+#define EFI_BOOT_SCRIPT_PCI_CONFIG2_WRITE_OPCODE	0x0Du
+#define EFI_BOOT_SCRIPT_PCI_CONFIG2_READ_WRITE_OPCODE	0x0Eu
+
+typedef struct _EFI_S3_SAVE_STATE_PROTOCOL EFI_S3_SAVE_STATE_PROTOCOL;
+
+typedef EFI_STATUS (EFIAPI *EFI_S3_SAVE_STATE_WRITE)(CONST EFI_S3_SAVE_STATE_PROTOCOL *This, UINTN OpCode, ...);
+
+struct _EFI_S3_SAVE_STATE_PROTOCOL
+{
+    EFI_S3_SAVE_STATE_WRITE Write;
+    VOID *Insert;
+    VOID *Label;
+    VOID *Compare;
+};
+
+extern EFI_GUID gEfiS3SaveStateProtocolGuid;
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_S3_SAVE_STATE_H)
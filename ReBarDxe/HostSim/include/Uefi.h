@@ -0,0 +1,192 @@
+#if !defined(NV_STRAPS_REBAR_HOST_SIM_UEFI_H)
+#define NV_STRAPS_REBAR_HOST_SIM_UEFI_H
+
+// Subset of the EDK2 MdePkg definitions used by the driver, to build it as a regular Linux program for the host
+// simulation. Only the boot and runtime services the driver calls are listed, so the tables do not follow the
+// layout from the UEFI specification.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t   UINT8;
+typedef uint16_t  UINT16;
+typedef uint32_t  UINT32;
+typedef uint64_t  UINT64;
+typedef int8_t    INT8;
+typedef int16_t   INT16;
+typedef int32_t   INT32;
+typedef int64_t   INT64;
+typedef uintptr_t UINTN;
+typedef intptr_t  INTN;
+typedef uint16_t  CHAR16;
+typedef char	  CHAR8;
+typedef unsigned char BOOLEAN;
+typedef void	  VOID;
+
+typedef UINTN	  EFI_STATUS;
+typedef void	 *EFI_HANDLE;
+typedef void	 *EFI_EVENT;
+typedef UINTN	  EFI_TPL;
+typedef UINT64	  EFI_PHYSICAL_ADDRESS;
+
+typedef struct
+{
+    UINT32 Data1;
+    UINT16 Data2;
+    UINT16 Data3;
+    UINT8  Data4[8];
+}
+    EFI_GUID;
+
+typedef EFI_GUID GUID;
+
+#define IN
+#define OUT
+#define OPTIONAL
+#define CONST	    const
+#define EFIAPI
+
+#define TRUE	    ((BOOLEAN)1)
+#define FALSE	    ((BOOLEAN)0)
+
+#define MAX_UINT8   0xFFu
+#define MAX_UINT16  0xFFFFu
+#define MAX_UINT32  0xFFFF'FFFFu
+#define MAX_UINT64  0xFFFF'FFFF'FFFF'FFFFull
+
+#define ARRAY_SIZE(Array) (sizeof(Array) / sizeof((Array)[0u]))
+
+#define BASE_64KB   0x0001'0000u
+#define BASE_4GB    0x0001'0000'0000ull
+#define SIZE_1KB    0x0000'0400u
+#define SIZE_4KB    0x0000'1000u
+#define SIZE_1MB    0x0010'0000u
+#define SIZE_16MB   0x0100'0000u
+#define SIZE_32MB   0x0200'0000u
+
+#define ENCODE_ERROR(StatusCode) ((EFI_STATUS)(UINT64_C(0x8000'0000'0000'0000) | (StatusCode)))
+#define EFI_ERROR(StatusCode)	 (((INTN)(EFI_STATUS)(StatusCode)) < 0)
+
+#define EFI_SUCCESS		0u
+#define EFI_LOAD_ERROR		ENCODE_ERROR(1u)
+#define EFI_INVALID_PARAMETER	ENCODE_ERROR(2u)
+#define EFI_UNSUPPORTED		ENCODE_ERROR(3u)
+#define EFI_BUFFER_TOO_SMALL	ENCODE_ERROR(5u)
+#define EFI_NOT_READY		ENCODE_ERROR(6u)
+#define EFI_DEVICE_ERROR	ENCODE_ERROR(7u)
+#define EFI_OUT_OF_RESOURCES	ENCODE_ERROR(9u)
+#define EFI_NOT_FOUND		ENCODE_ERROR(14u)
+#define EFI_ACCESS_DENIED	ENCODE_ERROR(15u)
+#define EFI_TIMEOUT		ENCODE_ERROR(18u)
+
+#define EFI_VARIABLE_NON_VOLATILE		0x0000'0001u
+#define EFI_VARIABLE_BOOTSERVICE_ACCESS		0x0000'0002u
+#define EFI_VARIABLE_RUNTIME_ACCESS		0x0000'0004u
+#define EFI_VARIABLE_HARDWARE_ERROR_RECORD	0x0000'0008u
+
+#define EFI_MEMORY_UC		0x0000'0000'0000'0001ull
+#define EFI_MEMORY_WC		0x0000'0000'0000'0002ull
+#define EFI_MEMORY_WT		0x0000'0000'0000'0004ull
+#define EFI_MEMORY_WB		0x0000'0000'0000'0008ull
+#define EFI_MEMORY_UCE		0x0000'0000'0000'0010ull
+
+#define EVT_TIMER		0x8000'0000u
+#define EVT_NOTIFY_WAIT		0x0000'0100u
+#define EVT_NOTIFY_SIGNAL	0x0000'0200u
+
+#define TPL_APPLICATION		4u
+#define TPL_CALLBACK		8u
+#define TPL_NOTIFY		16u
+
+#define EFI_OPEN_PROTOCOL_GET_PROTOCOL 0x0000'0002u
+
+typedef enum
+{
+    TimerCancel,
+    TimerPeriodic,
+    TimerRelative
+}
+    EFI_TIMER_DELAY;
+
+typedef enum
+{
+    AllHandles,
+    ByRegisterNotify,
+    ByProtocol
+}
+    EFI_LOCATE_SEARCH_TYPE;
+
+typedef enum
+{
+    EfiReservedMemoryType,
+    EfiLoaderCode,
+    EfiLoaderData,
+    EfiBootServicesCode,
+    EfiBootServicesData
+}
+    EFI_MEMORY_TYPE;
+
+typedef struct
+{
+    UINT16 Year;
+    UINT8  Month;
+    UINT8  Day;
+    UINT8  Hour;
+    UINT8  Minute;
+    UINT8  Second;
+    UINT8  Pad1;
+    UINT32 Nanosecond;
+    INT16  TimeZone;
+    UINT8  Daylight;
+    UINT8  Pad2;
+}
+    EFI_TIME;
+
+typedef VOID (EFIAPI *EFI_EVENT_NOTIFY)(EFI_EVENT Event, VOID *Context);
+
+typedef struct
+{
+    EFI_STATUS (EFIAPI *CreateEvent)(UINT32 Type, EFI_TPL NotifyTpl, EFI_EVENT_NOTIFY NotifyFunction, VOID *NotifyContext, EFI_EVENT *Event);
+    EFI_STATUS (EFIAPI *CreateEventEx)(UINT32 Type, EFI_TPL NotifyTpl, EFI_EVENT_NOTIFY NotifyFunction, CONST VOID *NotifyContext, CONST EFI_GUID *EventGroup, EFI_EVENT *Event);
+    EFI_STATUS (EFIAPI *SetTimer)(EFI_EVENT Event, EFI_TIMER_DELAY Type, UINT64 TriggerTime);
+    EFI_STATUS (EFIAPI *WaitForEvent)(UINTN NumberOfEvents, EFI_EVENT *Event, UINTN *Index);
+    EFI_STATUS (EFIAPI *SignalEvent)(EFI_EVENT Event);
+    EFI_STATUS (EFIAPI *CheckEvent)(EFI_EVENT Event);
+    EFI_STATUS (EFIAPI *CloseEvent)(EFI_EVENT Event);
+    EFI_STATUS (EFIAPI *Stall)(UINTN Microseconds);
+    EFI_STATUS (EFIAPI *HandleProtocol)(EFI_HANDLE Handle, EFI_GUID *Protocol, VOID **Interface);
+    EFI_STATUS (EFIAPI *LocateProtocol)(EFI_GUID *Protocol, VOID *Registration, VOID **Interface);
+    EFI_STATUS (EFIAPI *LocateHandleBuffer)(EFI_LOCATE_SEARCH_TYPE SearchType, EFI_GUID *Protocol, VOID *SearchKey, UINTN *NoHandles, EFI_HANDLE **Buffer);
+    EFI_STATUS (EFIAPI *OpenProtocol)(EFI_HANDLE Handle, EFI_GUID *Protocol, VOID **Interface, EFI_HANDLE AgentHandle, EFI_HANDLE ControllerHandle, UINT32 Attributes);
+    EFI_STATUS (EFIAPI *AllocatePool)(EFI_MEMORY_TYPE PoolType, UINTN Size, VOID **Buffer);
+    EFI_STATUS (EFIAPI *FreePool)(VOID *Buffer);
+}
+    EFI_BOOT_SERVICES;
+
+typedef struct
+{
+    EFI_STATUS (EFIAPI *GetTime)(EFI_TIME *Time, VOID *Capabilities);
+    EFI_STATUS (EFIAPI *GetVariable)(CHAR16 *VariableName, EFI_GUID *VendorGuid, UINT32 *Attributes, UINTN *DataSize, VOID *Data);
+    EFI_STATUS (EFIAPI *GetNextVariableName)(UINTN *VariableNameSize, CHAR16 *VariableName, EFI_GUID *VendorGuid);
+    EFI_STATUS (EFIAPI *SetVariable)(CHAR16 *VariableName, EFI_GUID *VendorGuid, UINT32 Attributes, UINTN DataSize, VOID *Data);
+}
+    EFI_RUNTIME_SERVICES;
+
+typedef struct
+{
+    EFI_GUID VendorGuid;
+    VOID *VendorTable;
+}
+    EFI_CONFIGURATION_TABLE;
+
+typedef struct
+{
+    EFI_BOOT_SERVICES *BootServices;
+    EFI_RUNTIME_SERVICES *RuntimeServices;
+    UINTN NumberOfTableEntries;
+    EFI_CONFIGURATION_TABLE *ConfigurationTable;
+}
+    EFI_SYSTEM_TABLE;
+
+#endif		// !defined(NV_STRAPS_REBAR_HOST_SIM_UEFI_H)
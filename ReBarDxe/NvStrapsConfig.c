@@ -28,6 +28,37 @@
 
 #include "NvStrapsConfig.h"
 
+// External definitions for the inline functions in NvStrapsConfig.h
+extern inline uint_least8_t NvStrapsConfig_TargetPciBarSizeSelector(NvStrapsConfig const *config);
+extern inline uint_least8_t NvStrapsConfig_SetTargetPciBarSizeSelector(NvStrapsConfig *config, uint_least8_t barSizeSelector);
+extern inline uint_least64_t NvStrapsConfig_SetupVarCRC(NvStrapsConfig const *config);
+extern inline uint_least64_t NvStrapsConfig_SetSetupVarCRC(NvStrapsConfig *config, uint_least64_t varCRC);
+extern inline uint_least8_t NvStrapsConfig_IsGlobalEnable(NvStrapsConfig const *config);
+extern inline uint_least8_t NvStrapsConfig_SetGlobalEnable(NvStrapsConfig *config, uint_least8_t globalEnable);
+extern inline bool NvStrapsConfig_IsDirty(NvStrapsConfig const *config);
+extern inline bool NvStrapsConfig_SetIsDirty(NvStrapsConfig *config, bool dirtyFlag);
+extern inline bool NvStrapsConfig_SkipS3Resume(NvStrapsConfig const *config);
+extern inline bool NvStrapsConfig_SetSkipS3Resume(NvStrapsConfig *config, bool fSkipS3Resume);
+extern inline bool NvStrapsConfig_OverrideBarSizeMask(NvStrapsConfig const *config);
+extern inline bool NvStrapsConfig_SetOverrideBarSizeMask(NvStrapsConfig *config, bool fOverrideSizeMask);
+extern inline bool NvStrapsConfig_HasSetupVarCRC(NvStrapsConfig const *config);
+extern inline bool NvStrapsConfig_SetHasSetupVarCRC(NvStrapsConfig *config, bool hasCRC);
+extern inline bool NvStrapsConfig_EnableSetupVarCRC(NvStrapsConfig const *config);
+extern inline bool NvStrapsConfig_SetEnableSetupVarCRC(NvStrapsConfig *config, bool enableCRC);
+extern inline bool NvStrapsConfig_UsePciECAM(NvStrapsConfig const *config);
+extern inline bool NvStrapsConfig_SetUsePciECAM(NvStrapsConfig *config, bool useECAM);
+extern inline bool NvStrapsConfig_FlushStatusImmediately(NvStrapsConfig const *config);
+extern inline bool NvStrapsConfig_SetFlushStatusImmediately(NvStrapsConfig *config, bool flushImmediately);
+extern inline bool NvStrapsConfig_IsGpuConfigured(NvStrapsConfig const *config);
+extern inline bool NvStrapsConfig_IsDriverConfigured(NvStrapsConfig const *config);
+extern inline bool NvStrapsConfig_GPUSelector_DeviceMatch(NvStraps_GPUSelector const *selector, uint_least16_t devID);
+extern inline bool NvStrapsConfig_GPUSelector_SubsystemMatch(NvStraps_GPUSelector const *selector, uint_least16_t subsysVenID, uint_least16_t subsysDevID);
+extern inline bool NvStrapsConfig_GPUSelector_BusLocationMatch(NvStraps_GPUSelector const *selector, uint_least8_t busNr, uint_least8_t dev, uint_least8_t func);
+extern inline bool NvStrapsConfig_GPUConfig_DeviceMatch(NvStraps_GPUConfig const *config, uint_least16_t devID);
+extern inline bool NvStrapsConfig_GPUConfig_SubsystemMatch(NvStraps_GPUConfig const *config, uint_least16_t subsysVenID, uint_least16_t subsysDevID);
+extern inline bool NvStrapsConfig_BridgeConfig_DeviceMatch(NvStraps_BridgeConfig const *config, uint_least16_t venID, uint_least16_t devID);
+extern inline bool NvStrapsConfig_BridgeConfig_BusLocationMatch(NvStraps_BridgeConfig const *config, uint_least8_t bus, uint_least8_t dev, uint_least8_t func);
+
 char const NvStrapsConfig_VarName[] = "NvStrapsReBar";
 static NvStrapsConfig strapsConfig;
 
@@ -47,67 +78,238 @@ static void GPUSelector_unpack(BYTE const *buffer, NvStraps_GPUSelector *selecto
     selector->overrideBarSizeMask = unpack_BYTE(buffer), buffer += BYTE_SIZE;
 }
 
-static BYTE *GPUSelector_pack(BYTE *buffer, NvStraps_GPUSelector const *selector)
+static void GPUConfig_unpack(BYTE const *buffer, NvStraps_GPUConfig *config)
+{
+    config->deviceID            = unpack_WORD(buffer),  buffer += WORD_SIZE;
+    config->subsysVendorID      = unpack_WORD(buffer),  buffer += WORD_SIZE;
+    config->subsysDeviceID      = unpack_WORD(buffer),  buffer += WORD_SIZE;
+    config->bus                 = unpack_BYTE(buffer),  buffer += BYTE_SIZE;
+
+    uint_least8_t busPosition = unpack_BYTE(buffer); buffer += BYTE_SIZE;
+    config->device = busPosition >> 3u & 0b0001'1111u;
+    config->function = busPosition & 0b0111u;
+
+    config->bar0.base = unpack_QWORD(buffer), buffer += QWORD_SIZE;
+    config->bar0.top  = unpack_QWORD(buffer), buffer += QWORD_SIZE;
+}
+
+static void BridgeConfig_unpack(BYTE const *buffer, NvStraps_BridgeConfig *config)
+{
+    config->vendorID            = unpack_WORD(buffer), buffer += WORD_SIZE;
+    config->deviceID            = unpack_WORD(buffer), buffer += WORD_SIZE;
+    config->bridgeBus           = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+
+    uint_least8_t busPos = unpack_BYTE(buffer); buffer += BYTE_SIZE;
+
+    config->bridgeDevice        = config->bridgeBus == 0xFF && busPos == 0xFFu ? 0xFFu : busPos >> 3u & 0b0001'1111u;
+    config->bridgeFunction      = config->bridgeBus == 0xFF && busPos == 0xFFu ? 0xFFu : busPos & 0b0111u;
+
+    config->bridgeSecondaryBus  = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+}
+
+// Flags byte leading each record in the versioned format
+static uint_least8_t const
+    RECORD_HAS_SUBSYSTEM     = 0x01u,
+    RECORD_HAS_BUS_LOCATION  = 0x02u,
+    RECORD_HAS_32BIT_BAR0    = 0x04u,
+    RECORD_SAME_BRIDGE_ID    = 0x08u;		// same vendor and device ID as the previous bridge, as for ports of the same switch
+
+static inline bool hasSubsystem(uint_least16_t subsysVenID, uint_least16_t subsysDevID)
+{
+    return subsysVenID != WORD_BITMASK || subsysDevID != WORD_BITMASK;
+}
+
+static inline bool hasBusLocation(uint_least8_t bus, uint_least8_t dev, uint_least8_t fn)
+{
+    return bus != BYTE_BITMASK || dev != BYTE_BITMASK || fn != BYTE_BITMASK;
+}
+
+static inline unsigned GPUSelector_sizeV1(uint_least8_t flags)
+{
+    return BYTE_SIZE + WORD_SIZE + (flags & RECORD_HAS_SUBSYSTEM ? 2u * WORD_SIZE : 0u) + (flags & RECORD_HAS_BUS_LOCATION ? 2u * BYTE_SIZE : 0u) + 2u * BYTE_SIZE;
+}
+
+static inline unsigned GPUConfig_sizeV1(uint_least8_t flags)
+{
+    return BYTE_SIZE + WORD_SIZE + (flags & RECORD_HAS_SUBSYSTEM ? 2u * WORD_SIZE : 0u) + 2u * BYTE_SIZE + (flags & RECORD_HAS_32BIT_BAR0 ? 2u * DWORD_SIZE : 2u * QWORD_SIZE);
+}
+
+static inline unsigned BridgeConfig_sizeV1(uint_least8_t flags)
 {
+    return BYTE_SIZE + (flags & RECORD_SAME_BRIDGE_ID ? 0u : 2u * WORD_SIZE) + 3u * BYTE_SIZE;
+}
+
+static BYTE const *GPUSelector_unpackV1(BYTE const *buffer, BYTE const *bufferEnd, NvStraps_GPUSelector *selector)
+{
+    if (buffer >= bufferEnd || (unsigned)(bufferEnd - buffer) < GPUSelector_sizeV1(*buffer))
+	return NULL;
+
+    uint_least8_t flags = unpack_BYTE(buffer); buffer += BYTE_SIZE;
+
+    selector->deviceID = unpack_WORD(buffer), buffer += WORD_SIZE;
+    selector->subsysVendorID = selector->subsysDeviceID = WORD_BITMASK;
+    selector->bus = selector->device = selector->function = BYTE_BITMASK;
+
+    if (flags & RECORD_HAS_SUBSYSTEM)
+    {
+	selector->subsysVendorID = unpack_WORD(buffer), buffer += WORD_SIZE;
+	selector->subsysDeviceID = unpack_WORD(buffer), buffer += WORD_SIZE;
+    }
+
+    if (flags & RECORD_HAS_BUS_LOCATION)
+    {
+	selector->bus = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+
+	uint_least8_t busPos = unpack_BYTE(buffer); buffer += BYTE_SIZE;
+
+	selector->device = busPos >> 3u & 0b0001'1111u;
+	selector->function = busPos & 0b0111u;
+    }
+
+    selector->barSizeSelector = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+    selector->overrideBarSizeMask = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+
+    return buffer;
+}
+
+static BYTE *GPUSelector_packV1(BYTE *buffer, NvStraps_GPUSelector const *selector)
+{
+    uint_least8_t flags =
+	  (hasSubsystem(selector->subsysVendorID, selector->subsysDeviceID) ? RECORD_HAS_SUBSYSTEM : 0u)
+	| (hasBusLocation(selector->bus, selector->device, selector->function) ? RECORD_HAS_BUS_LOCATION : 0u);
+
+    buffer = pack_BYTE(buffer, flags);
     buffer = pack_WORD(buffer, selector->deviceID);
-    buffer = pack_WORD(buffer, selector->subsysVendorID);
-    buffer = pack_WORD(buffer, selector->subsysDeviceID);
-    buffer = pack_BYTE(buffer, selector->bus);
-    buffer = pack_BYTE(buffer, (uint_least8_t)((unsigned)selector->device << 3u & 0b1111'1000u | (unsigned)selector->function & 0b0111u));
+
+    if (flags & RECORD_HAS_SUBSYSTEM)
+    {
+	buffer = pack_WORD(buffer, selector->subsysVendorID);
+	buffer = pack_WORD(buffer, selector->subsysDeviceID);
+    }
+
+    if (flags & RECORD_HAS_BUS_LOCATION)
+    {
+	buffer = pack_BYTE(buffer, selector->bus);
+	buffer = pack_BYTE(buffer, (uint_least8_t)(((unsigned)selector->device << 3u & 0b1111'1000u) | ((unsigned)selector->function & 0b0111u)));
+    }
+
     buffer = pack_BYTE(buffer, selector->barSizeSelector);
     buffer = pack_BYTE(buffer, selector->overrideBarSizeMask);
 
     return buffer;
 }
 
-static void GPUConfig_unpack(BYTE const *buffer, NvStraps_GPUConfig *config)
+static BYTE const *GPUConfig_unpackV1(BYTE const *buffer, BYTE const *bufferEnd, NvStraps_GPUConfig *config)
 {
-    config->deviceID            = unpack_WORD(buffer),  buffer += WORD_SIZE;
-    config->subsysVendorID      = unpack_WORD(buffer),  buffer += WORD_SIZE;
-    config->subsysDeviceID      = unpack_WORD(buffer),  buffer += WORD_SIZE;
-    config->bus                 = unpack_BYTE(buffer),  buffer += BYTE_SIZE;
+    if (buffer >= bufferEnd || (unsigned)(bufferEnd - buffer) < GPUConfig_sizeV1(*buffer))
+	return NULL;
+
+    uint_least8_t flags = unpack_BYTE(buffer); buffer += BYTE_SIZE;
+
+    config->deviceID = unpack_WORD(buffer), buffer += WORD_SIZE;
+    config->subsysVendorID = config->subsysDeviceID = WORD_BITMASK;
+
+    if (flags & RECORD_HAS_SUBSYSTEM)
+    {
+	config->subsysVendorID = unpack_WORD(buffer), buffer += WORD_SIZE;
+	config->subsysDeviceID = unpack_WORD(buffer), buffer += WORD_SIZE;
+    }
+
+    config->bus = unpack_BYTE(buffer), buffer += BYTE_SIZE;
 
     uint_least8_t busPosition = unpack_BYTE(buffer); buffer += BYTE_SIZE;
     config->device = busPosition >> 3u & 0b0001'1111u;
     config->function = busPosition & 0b0111u;
 
-    config->bar0.base = unpack_QWORD(buffer), buffer += QWORD_SIZE;
-    config->bar0.top  = unpack_QWORD(buffer), buffer += QWORD_SIZE;
+    if (flags & RECORD_HAS_32BIT_BAR0)
+    {
+	config->bar0.base = unpack_DWORD(buffer), buffer += DWORD_SIZE;
+	config->bar0.top  = unpack_DWORD(buffer), buffer += DWORD_SIZE;
+    }
+    else
+    {
+	config->bar0.base = unpack_QWORD(buffer), buffer += QWORD_SIZE;
+	config->bar0.top  = unpack_QWORD(buffer), buffer += QWORD_SIZE;
+    }
+
+    return buffer;
 }
 
-static BYTE *GPUConfig_pack(BYTE *buffer, NvStraps_GPUConfig const *config)
+static BYTE *GPUConfig_packV1(BYTE *buffer, NvStraps_GPUConfig const *config)
 {
+    uint_least8_t flags =
+	  (hasSubsystem(config->subsysVendorID, config->subsysDeviceID) ? RECORD_HAS_SUBSYSTEM : 0u)
+	| (config->bar0.base <= UINT32_MAX && config->bar0.top <= UINT32_MAX ? RECORD_HAS_32BIT_BAR0 : 0u);
+
+    buffer = pack_BYTE(buffer, flags);
     buffer = pack_WORD(buffer, config->deviceID);
-    buffer = pack_WORD(buffer, config->subsysVendorID);
-    buffer = pack_WORD(buffer, config->subsysDeviceID);
+
+    if (flags & RECORD_HAS_SUBSYSTEM)
+    {
+	buffer = pack_WORD(buffer, config->subsysVendorID);
+	buffer = pack_WORD(buffer, config->subsysDeviceID);
+    }
+
     buffer = pack_BYTE(buffer, config->bus);
-    buffer = pack_BYTE(buffer, (unsigned)config->device << 3u & 0b1111'1000u | (unsigned)config->function & 0b0111u);
-    buffer = pack_QWORD(buffer, config->bar0.base);
-    buffer = pack_QWORD(buffer, config->bar0.top);
+    buffer = pack_BYTE(buffer, ((unsigned)config->device << 3u & 0b1111'1000u) | ((unsigned)config->function & 0b0111u));
+
+    if (flags & RECORD_HAS_32BIT_BAR0)
+    {
+	buffer = pack_DWORD(buffer, (uint_least32_t)config->bar0.base);
+	buffer = pack_DWORD(buffer, (uint_least32_t)config->bar0.top);
+    }
+    else
+    {
+	buffer = pack_QWORD(buffer, config->bar0.base);
+	buffer = pack_QWORD(buffer, config->bar0.top);
+    }
 
     return buffer;
 }
 
-static void BridgeConfig_unpack(BYTE const *buffer, NvStraps_BridgeConfig *config)
+static BYTE const *BridgeConfig_unpackV1(BYTE const *buffer, BYTE const *bufferEnd, NvStraps_BridgeConfig const *previous, NvStraps_BridgeConfig *config)
 {
-    config->vendorID            = unpack_WORD(buffer), buffer += WORD_SIZE;
-    config->deviceID            = unpack_WORD(buffer), buffer += WORD_SIZE;
-    config->bridgeBus           = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+    if (buffer >= bufferEnd || (unsigned)(bufferEnd - buffer) < BridgeConfig_sizeV1(*buffer) || (*buffer & RECORD_SAME_BRIDGE_ID && !previous))
+	return NULL;
+
+    uint_least8_t flags = unpack_BYTE(buffer); buffer += BYTE_SIZE;
+
+    if (flags & RECORD_SAME_BRIDGE_ID)
+    {
+	config->vendorID = previous->vendorID;
+	config->deviceID = previous->deviceID;
+    }
+    else
+    {
+	config->vendorID = unpack_WORD(buffer), buffer += WORD_SIZE;
+	config->deviceID = unpack_WORD(buffer), buffer += WORD_SIZE;
+    }
+
+    config->bridgeBus = unpack_BYTE(buffer), buffer += BYTE_SIZE;
 
     uint_least8_t busPos = unpack_BYTE(buffer); buffer += BYTE_SIZE;
 
     config->bridgeDevice        = config->bridgeBus == 0xFF && busPos == 0xFFu ? 0xFFu : busPos >> 3u & 0b0001'1111u;
     config->bridgeFunction      = config->bridgeBus == 0xFF && busPos == 0xFFu ? 0xFFu : busPos & 0b0111u;
-
     config->bridgeSecondaryBus  = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+
+    return buffer;
 }
 
-static UINT8 *BridgeConfig_pack(BYTE *buffer, NvStraps_BridgeConfig  const *config)
+static BYTE *BridgeConfig_packV1(BYTE *buffer, NvStraps_BridgeConfig const *previous, NvStraps_BridgeConfig const *config)
 {
-    buffer = pack_WORD(buffer, config->vendorID);
-    buffer = pack_WORD(buffer, config->deviceID);
+    uint_least8_t flags = previous && previous->vendorID == config->vendorID && previous->deviceID == config->deviceID ? RECORD_SAME_BRIDGE_ID : 0u;
+
+    buffer = pack_BYTE(buffer, flags);
+
+    if (!(flags & RECORD_SAME_BRIDGE_ID))
+    {
+	buffer = pack_WORD(buffer, config->vendorID);
+	buffer = pack_WORD(buffer, config->deviceID);
+    }
+
     buffer = pack_BYTE(buffer, config->bridgeBus);
-    buffer = pack_BYTE(buffer, (unsigned)config->bridgeDevice << 3u & 0b1111'1000u | (unsigned)config->bridgeFunction & 0b0111u);
+    buffer = pack_BYTE(buffer, ((unsigned)config->bridgeDevice << 3u & 0b1111'1000u) | ((unsigned)config->bridgeFunction & 0b0111u));
     buffer = pack_BYTE(buffer, config->bridgeSecondaryBus);
 
     return buffer;
@@ -132,12 +334,14 @@ void NvStrapsConfig_Clear(NvStrapsConfig *config)
     config->nPciBarSize = 0u;
     config->nOptionFlags = 0u;
     config->nSetupVarCRC = 0u;
+    config->setupVarName = SetupVarName_None;
+    config->setupVarSize = 0u;
     config->nGPUSelector = 0u;
     config->nGPUConfig = 0u;
     config->nBridgeConfig = 0u;
 }
 
-static unsigned NvStrapsConfig_BufferSize(NvStrapsConfig const *config)
+static unsigned NvStrapsConfig_BufferSizeV0(NvStrapsConfig const *config)
 {
     return NV_STRAPS_HEADER_SIZE
         + BYTE_SIZE + config->nGPUSelector * GPU_SELECTOR_SIZE
@@ -145,7 +349,7 @@ static unsigned NvStrapsConfig_BufferSize(NvStrapsConfig const *config)
         + BYTE_SIZE + config->nBridgeConfig * BRIDGE_CONFIG_SIZE;
 }
 
-static void NvStrapsConfig_Load(BYTE const *buffer, unsigned size, NvStrapsConfig *config)
+static bool NvStrapsConfig_LoadV0(BYTE const *buffer, unsigned size, NvStrapsConfig *config)
 {
     do
     {
@@ -155,6 +359,8 @@ static void NvStrapsConfig_Load(BYTE const *buffer, unsigned size, NvStrapsConfi
         config->nPciBarSize = unpack_BYTE(buffer), buffer += BYTE_SIZE;
         config->nOptionFlags = unpack_WORD(buffer), buffer += WORD_SIZE;
 	config->nSetupVarCRC = unpack_QWORD(buffer), buffer += QWORD_SIZE;
+        config->setupVarName = SetupVarName_None;	    // the Setup variable identity is not saved in version 0
+        config->setupVarSize = 0u;
         config->nGPUSelector = unpack_BYTE(buffer), buffer += BYTE_SIZE;
 
         if (config->nGPUSelector > ARRAY_SIZE(config->GPUs) || size < (unsigned)NV_STRAPS_HEADER_SIZE + BYTE_SIZE + config->nGPUSelector * GPU_SELECTOR_SIZE + BYTE_SIZE)
@@ -177,7 +383,7 @@ static void NvStrapsConfig_Load(BYTE const *buffer, unsigned size, NvStrapsConfi
         config->nBridgeConfig = unpack_BYTE(buffer), buffer += BYTE_SIZE;
 
         if (config->nBridgeConfig > ARRAY_SIZE(config->bridge)
-                 || size < NvStrapsConfig_BufferSize(config))
+                 || size < NvStrapsConfig_BufferSizeV0(config))
         {
             break;
         }
@@ -185,44 +391,114 @@ static void NvStrapsConfig_Load(BYTE const *buffer, unsigned size, NvStrapsConfi
         for (unsigned i = 0u; i < config->nBridgeConfig; i++)
             BridgeConfig_unpack(buffer, config->bridge + i), buffer += BRIDGE_CONFIG_SIZE;
 
-        config->dirty = false;
-
-        return;
+        return true;
     }
     while (false);
 
-    NvStrapsConfig_Clear(config);
+    return false;
 }
 
-static unsigned NvStrapsConfig_Save(BYTE *buffer, unsigned size, NvStrapsConfig const *config)
+static bool NvStrapsConfig_LoadV1(BYTE const *buffer, unsigned size, NvStrapsConfig *config)
 {
-    unsigned const BUFFER_SIZE = NvStrapsConfig_BufferSize(config);
+    BYTE const *bufferEnd = buffer + size;
+
+    if (size < NV_STRAPS_V1_HEADER_SIZE || unpack_BYTE(buffer) != NV_STRAPS_FORMAT_MARKER || unpack_BYTE(buffer + BYTE_SIZE) != NV_STRAPS_FORMAT_VERSION)
+	return false;
+
+    buffer += 2u * BYTE_SIZE;
+
+    config->nPciBarSize = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+    config->nOptionFlags = unpack_WORD(buffer), buffer += WORD_SIZE;
+    config->nSetupVarCRC = unpack_QWORD(buffer), buffer += QWORD_SIZE;
+    config->nGPUSelector = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+    config->nGPUConfig = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+    config->nBridgeConfig = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+
+    if (config->nGPUSelector > ARRAY_SIZE(config->GPUs) || config->nGPUConfig > ARRAY_SIZE(config->gpuConfig) || config->nBridgeConfig > ARRAY_SIZE(config->bridge))
+	return false;
+
+    for (unsigned i = 0u; i < config->nGPUSelector; i++)
+	if (!(buffer = GPUSelector_unpackV1(buffer, bufferEnd, config->GPUs + i)))
+	    return false;
+
+    for (unsigned i = 0u; i < config->nGPUConfig; i++)
+	if (!(buffer = GPUConfig_unpackV1(buffer, bufferEnd, config->gpuConfig + i)))
+	    return false;
+
+    for (unsigned i = 0u; i < config->nBridgeConfig; i++)
+	if (!(buffer = BridgeConfig_unpackV1(buffer, bufferEnd, i ? config->bridge + i - 1u : NULL, config->bridge + i)))
+	    return false;
+
+    config->setupVarName = SetupVarName_None;
+    config->setupVarSize = 0u;
 
+    // Optional Setup variable identity, absent if the Setup variable was never found
+    if (bufferEnd - buffer >= NV_STRAPS_SETUP_VAR_ID_SIZE && unpack_BYTE(buffer) && unpack_BYTE(buffer) <= SetupVarName_Setup)
+    {
+	config->setupVarName = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+
+	for (unsigned i = 0u; i < SETUP_VAR_GUID_SIZE; i++)
+	    config->setupVarGUID[i] = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+
+	config->setupVarSize = unpack_DWORD(buffer), buffer += DWORD_SIZE;
+    }
+
+    return true;
+}
+
+// Read both the versioned format and the original fixed layout (version 0), saving always uses the latest version
+void NvStrapsConfig_Load(BYTE const *buffer, unsigned size, NvStrapsConfig *config)
+{
+    bool isLoaded = size && unpack_BYTE(buffer) == NV_STRAPS_FORMAT_MARKER ? NvStrapsConfig_LoadV1(buffer, size, config) : NvStrapsConfig_LoadV0(buffer, size, config);
+
+    if (isLoaded)
+    {
+	NvStrapsConfig_IndexGPUSelectors(config);
+	config->dirty = false;
+    }
+    else
+	NvStrapsConfig_Clear(config);
+}
+
+unsigned NvStrapsConfig_Save(BYTE *buffer, unsigned size, NvStrapsConfig const *config)
+{
     if (NvStrapsConfig_IsDriverConfigured(config)
          && config->nGPUSelector <= ARRAY_SIZE(config->GPUs)
          && config->nGPUConfig <= ARRAY_SIZE(config->gpuConfig)
          && config->nBridgeConfig <= ARRAY_SIZE(config->bridge)
-         && size >= BUFFER_SIZE)
+         && size >= NV_STRAPS_CONFIG_SIZE)
     {
+        BYTE *bufferStart = buffer;
+
+        buffer = pack_BYTE(buffer, NV_STRAPS_FORMAT_MARKER);
+        buffer = pack_BYTE(buffer, NV_STRAPS_FORMAT_VERSION);
         buffer = pack_BYTE(buffer, config->nPciBarSize);
         buffer = pack_WORD(buffer, config->nOptionFlags);
 	buffer = pack_QWORD(buffer, config->nSetupVarCRC);
         buffer = pack_BYTE(buffer, config->nGPUSelector);
+        buffer = pack_BYTE(buffer, config->nGPUConfig);
+        buffer = pack_BYTE(buffer, config->nBridgeConfig);
 
         for (unsigned i = 0u; i < config->nGPUSelector; i++)
-            buffer = GPUSelector_pack(buffer, config->GPUs + i);
-
-        buffer = pack_BYTE(buffer, config->nGPUConfig);
+            buffer = GPUSelector_packV1(buffer, config->GPUs + i);
 
         for (unsigned i = 0u; i < config->nGPUConfig; i++)
-            buffer = GPUConfig_pack(buffer, config->gpuConfig + i);
-
-        buffer = pack_BYTE(buffer, config->nBridgeConfig);
+            buffer = GPUConfig_packV1(buffer, config->gpuConfig + i);
 
         for (unsigned i = 0u; i < config->nBridgeConfig; i++)
-            buffer = BridgeConfig_pack(buffer, config->bridge + i);
+            buffer = BridgeConfig_packV1(buffer, i ? config->bridge + i - 1u : NULL, config->bridge + i);
+
+	if (config->setupVarName != SetupVarName_None)
+	{
+	    buffer = pack_BYTE(buffer, config->setupVarName);
+
+	    for (unsigned i = 0u; i < SETUP_VAR_GUID_SIZE; i++)
+		buffer = pack_BYTE(buffer, config->setupVarGUID[i]);
+
+	    buffer = pack_DWORD(buffer, config->setupVarSize);
+	}
 
-        return BUFFER_SIZE;
+        return (unsigned)(buffer - bufferStart);
     }
 
     return 0u;
@@ -238,42 +514,129 @@ static inline bool NvStrapsConfig_GPUSelector_HasBusLocation(NvStraps_GPUSelecto
     return selector->bus != BYTE_BITMASK || selector->device != BYTE_BITMASK || selector->function != BYTE_BITMASK;
 }
 
+// Selectors with a subsystem and a bus location come first, then selectors with a subsystem, then selectors by PCI ID only
+static inline unsigned NvStrapsConfig_GPUSelector_Tier(NvStraps_GPUSelector const *selector)
+{
+    if (NvStrapsConfig_GPUSelector_HasSubsystem(selector))
+	return NvStrapsConfig_GPUSelector_HasBusLocation(selector) ? 0u : 1u;
+
+    return 2u;
+}
+
+static inline uint_least32_t NvStrapsConfig_GPUSelector_IndexKey(NvStraps_GPUSelector const *selector)
+{
+    return (uint_least32_t)selector->deviceID << 2u | NvStrapsConfig_GPUSelector_Tier(selector);
+}
+
+// Stable insertion sort, selectors with the same key keep the order from the configuration
+void NvStrapsConfig_IndexGPUSelectors(NvStrapsConfig *config)
+{
+    for (unsigned i = 0u; i < config->nGPUSelector && i < ARRAY_SIZE(config->GPUs); i++)
+    {
+	uint_least32_t key = NvStrapsConfig_GPUSelector_IndexKey(config->GPUs + i);
+	unsigned pos = i;
+
+	while (pos && NvStrapsConfig_GPUSelector_IndexKey(config->GPUs + config->gpuSelectorIndex[pos - 1u]) > key)
+	    config->gpuSelectorIndex[pos] = config->gpuSelectorIndex[pos - 1u], pos--;
+
+	config->gpuSelectorIndex[pos] = (uint_least8_t)i;
+    }
+}
+
+// Position in the index of the first selector with a key not less than the given key
+static unsigned NvStrapsConfig_GPUSelector_LowerBound(NvStrapsConfig const *config, uint_least32_t key)
+{
+    unsigned first = 0u, count = config->nGPUSelector;
+
+    while (count)
+    {
+	unsigned step = count / 2u;
+
+	if (NvStrapsConfig_GPUSelector_IndexKey(config->GPUs + config->gpuSelectorIndex[first + step]) < key)
+	    first += step + 1u, count -= step + 1u;
+	else
+	    count = step;
+    }
+
+    return first;
+}
+
+unsigned NvStrapsConfig_FindGPUSelector(NvStrapsConfig const *config, uint_least16_t deviceID, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t bus, uint_least8_t dev, uint_least8_t fn)
+{
+    NvStraps_GPUSelector selector = { .deviceID = deviceID, .subsysVendorID = subsysVenID, .subsysDeviceID = subsysDevID, .bus = bus, .device = dev, .function = fn };
+    uint_least32_t key = NvStrapsConfig_GPUSelector_IndexKey(&selector);
+
+    for (unsigned pos = NvStrapsConfig_GPUSelector_LowerBound(config, key); pos < config->nGPUSelector; pos++)
+    {
+	NvStraps_GPUSelector const *gpuSelector = config->GPUs + config->gpuSelectorIndex[pos];
+
+	if (NvStrapsConfig_GPUSelector_IndexKey(gpuSelector) != key)
+	    break;
+
+	if (NvStrapsConfig_GPUSelector_SubsystemMatch(gpuSelector, subsysVenID, subsysDevID) && NvStrapsConfig_GPUSelector_BusLocationMatch(gpuSelector, bus, dev, fn))
+	    return config->gpuSelectorIndex[pos];
+    }
+
+    return WORD_BITMASK;
+}
+
+static bool NvStrapsConfig_GPUSelector_HasBarSize(NvStraps_GPUSelector const *selector)
+{
+    return selector->barSizeSelector != BarSizeSelector_None;
+}
+
+static bool NvStrapsConfig_GPUSelector_HasMaskOverride(NvStraps_GPUSelector const *selector)
+{
+    return !!selector->overrideBarSizeMask;
+}
+
+// The first matching selector by bus location wins, otherwise the last matching selector by subsystem, otherwise the last by PCI ID
+static NvStraps_GPUSelector const *NvStrapsConfig_LookupGPUSelector
+    (
+	NvStrapsConfig const *config,
+	uint_least16_t deviceID, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t bus, uint_least8_t dev, uint_least8_t fn,
+	bool (*isConfigured)(NvStraps_GPUSelector const *selector),
+	ConfigPriority *configPriority
+    )
+{
+    unsigned
+	locationTier  = NvStrapsConfig_GPUSelector_LowerBound(config, (uint_least32_t)deviceID << 2u | 0u),
+	subsystemTier = NvStrapsConfig_GPUSelector_LowerBound(config, (uint_least32_t)deviceID << 2u | 1u),
+	pciIdTier     = NvStrapsConfig_GPUSelector_LowerBound(config, (uint_least32_t)deviceID << 2u | 2u),
+	tierEnd       = NvStrapsConfig_GPUSelector_LowerBound(config, (uint_least32_t)deviceID << 2u | 3u);
+
+    for (unsigned pos = locationTier; pos < subsystemTier; pos++)
+    {
+	NvStraps_GPUSelector const *selector = config->GPUs + config->gpuSelectorIndex[pos];
+
+	if (NvStrapsConfig_GPUSelector_SubsystemMatch(selector, subsysVenID, subsysDevID) && NvStrapsConfig_GPUSelector_BusLocationMatch(selector, bus, dev, fn) && isConfigured(selector))
+	    return *configPriority = EXPLICIT_PCI_LOCATION, selector;
+    }
+
+    for (unsigned pos = pciIdTier; pos > subsystemTier; pos--)
+    {
+	NvStraps_GPUSelector const *selector = config->GPUs + config->gpuSelectorIndex[pos - 1u];
+
+	if (NvStrapsConfig_GPUSelector_SubsystemMatch(selector, subsysVenID, subsysDevID) && isConfigured(selector))
+	    return *configPriority = EXPLICIT_SUBSYSTEM_ID, selector;
+    }
+
+    for (unsigned pos = tierEnd; pos > pciIdTier; pos--)
+    {
+	NvStraps_GPUSelector const *selector = config->GPUs + config->gpuSelectorIndex[pos - 1u];
+
+	if (isConfigured(selector))
+	    return *configPriority = EXPLICIT_PCI_ID, selector;
+    }
+
+    return *configPriority = UNCONFIGURED, NULL;
+}
+
 NvStraps_BarSize NvStrapsConfig_LookupBarSize(NvStrapsConfig const *config, uint_least16_t deviceID, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t bus, uint_least8_t dev, uint_least8_t fn)
 {
-    ConfigPriority configPriority = UNCONFIGURED;
-    BarSizeSelector barSizeSelector = BarSizeSelector_None;
-
-    for (unsigned iGPU = 0u; iGPU < config->nGPUSelector; iGPU++)
-        if (NvStrapsConfig_GPUSelector_DeviceMatch(config->GPUs + iGPU, deviceID))
-            if (NvStrapsConfig_GPUSelector_HasSubsystem(config->GPUs + iGPU))
-                if (NvStrapsConfig_GPUSelector_SubsystemMatch(config->GPUs + iGPU, subsysVenID, subsysDevID))
-                    if (NvStrapsConfig_GPUSelector_HasBusLocation(config->GPUs + iGPU))
-                        if (NvStrapsConfig_GPUSelector_BusLocationMatch(config->GPUs + iGPU, bus, dev, fn))
-			    if (config->GPUs[iGPU].barSizeSelector != BarSizeSelector_None)
-			    {
-				NvStraps_BarSize sizeSelector = { .priority = EXPLICIT_PCI_LOCATION, .barSizeSelector = (BarSizeSelector)config->GPUs[iGPU].barSizeSelector };
-
-				return sizeSelector;
-			    }
-			    else
-				;
-                        else
-                            ;
-                    else
-			if (config->GPUs[iGPU].barSizeSelector != BarSizeSelector_None)
-			    configPriority = EXPLICIT_SUBSYSTEM_ID, barSizeSelector = (BarSizeSelector)config->GPUs[iGPU].barSizeSelector;
-			else
-			    ;
-                else
-                    ;
-            else
-		if (config->GPUs[iGPU].barSizeSelector != BarSizeSelector_None)
-		{
-		    if (configPriority < EXPLICIT_SUBSYSTEM_ID)
-			configPriority = EXPLICIT_PCI_ID, barSizeSelector = (BarSizeSelector)config->GPUs[iGPU].barSizeSelector;
-		}
-		else
-		    ;
+    ConfigPriority configPriority;
+    NvStraps_GPUSelector const *selector = NvStrapsConfig_LookupGPUSelector(config, deviceID, subsysVenID, subsysDevID, bus, dev, fn, NvStrapsConfig_GPUSelector_HasBarSize, &configPriority);
+    BarSizeSelector barSizeSelector = selector ? (BarSizeSelector)selector->barSizeSelector : BarSizeSelector_None;
 
     if (configPriority == UNCONFIGURED && NvStrapsConfig_IsGlobalEnable(config))
     {
@@ -299,40 +662,9 @@ NvStraps_BarSize NvStrapsConfig_LookupBarSize(NvStrapsConfig const *config, uint
 
 NvStraps_BarSizeMaskOverride NvStrapsConfig_LookupBarSizeMaskOverride(NvStrapsConfig const *config, uint_least16_t deviceID, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t bus, uint_least8_t dev, uint_least8_t fn)
 {
-    ConfigPriority configPriority = UNCONFIGURED;
-    bool barSizeMaskOverride = false;
-
-    for (unsigned iGPU = 0u; iGPU < config->nGPUSelector; iGPU++)
-        if (NvStrapsConfig_GPUSelector_DeviceMatch(config->GPUs + iGPU, deviceID))
-            if (NvStrapsConfig_GPUSelector_HasSubsystem(config->GPUs + iGPU))
-                if (NvStrapsConfig_GPUSelector_SubsystemMatch(config->GPUs + iGPU, subsysVenID, subsysDevID))
-                    if (NvStrapsConfig_GPUSelector_HasBusLocation(config->GPUs + iGPU))
-                        if (NvStrapsConfig_GPUSelector_BusLocationMatch(config->GPUs + iGPU, bus, dev, fn))
-			    if (config->GPUs[iGPU].overrideBarSizeMask)
-			    {
-				NvStraps_BarSizeMaskOverride maskOverride = { .priority = EXPLICIT_PCI_LOCATION, .sizeMaskOverride = config->GPUs[iGPU].overrideBarSizeMask != 0xFFu };
-
-				return maskOverride;
-			    }
-			    else
-				;
-                        else
-                            ;
-                    else
-			if (config->GPUs[iGPU].overrideBarSizeMask)
-			    configPriority = EXPLICIT_SUBSYSTEM_ID, barSizeMaskOverride = config->GPUs[iGPU].overrideBarSizeMask != 0xFFu;
-			else
-			    ;
-                else
-                    ;
-            else
-		if (config->GPUs[iGPU].overrideBarSizeMask)
-		{
-		    if (configPriority < EXPLICIT_SUBSYSTEM_ID)
-			configPriority = EXPLICIT_PCI_ID, barSizeMaskOverride = config->GPUs[iGPU].overrideBarSizeMask != 0xFFu;
-		}
-		else
-		    ;
+    ConfigPriority configPriority;
+    NvStraps_GPUSelector const *selector = NvStrapsConfig_LookupGPUSelector(config, deviceID, subsysVenID, subsysDevID, bus, dev, fn, NvStrapsConfig_GPUSelector_HasMaskOverride, &configPriority);
+    bool barSizeMaskOverride = selector && selector->overrideBarSizeMask != 0xFFu;
 
     if (configPriority == UNCONFIGURED)
     {
@@ -379,6 +711,19 @@ NvStraps_BridgeConfig const *NvStrapsConfig_LookupBridgeConfig(NvStrapsConfig co
     return NULL;
 }
 
+NvStraps_GPUPolicy NvStrapsConfig_ResolveGPUPolicy(NvStrapsConfig const *config, uint_least16_t deviceID, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t bus, uint_least8_t dev, uint_least8_t fn)
+{
+    NvStraps_GPUPolicy policy =
+    {
+	.barSize = NvStrapsConfig_LookupBarSize(config, deviceID, subsysVenID, subsysDevID, bus, dev, fn),
+	.sizeMaskOverride = NvStrapsConfig_LookupBarSizeMaskOverride(config, deviceID, subsysVenID, subsysDevID, bus, dev, fn),
+	.gpuConfig = NvStrapsConfig_LookupGPUConfig(config, bus, dev, fn),
+	.bridgeConfig = NvStrapsConfig_LookupBridgeConfig(config, bus)
+    };
+
+    return policy;
+}
+
 uint_least32_t NvStrapsConfig_HasBridgeDevice(NvStrapsConfig const *config, uint_least8_t bus, uint_least8_t dev, uint_least8_t fn)
 {
     unsigned index = NvStrapsConfig_FindBridgeConfig(config, bus, dev, fn);
@@ -386,7 +731,7 @@ uint_least32_t NvStrapsConfig_HasBridgeDevice(NvStrapsConfig const *config, uint
     if (index == WORD_BITMASK)
 	return (uint_least32_t)WORD_BITMASK << WORD_BITSIZE | WORD_BITMASK;
 
-    return (uint_least32_t)config->bridge[index].deviceID << WORD_BITSIZE | config->bridge[index].vendorID & WORD_BITMASK;
+    return (uint_least32_t)config->bridge[index].deviceID << WORD_BITSIZE | (config->bridge[index].vendorID & WORD_BITMASK);
 }
 
 static void NvStraps_UpdateGPUConfig(NvStrapsConfig *config, unsigned gpuIndex, NvStraps_GPUConfig const *gpuConfig)
@@ -412,6 +757,7 @@ bool NvStrapsConfig_SetGPUConfig(NvStrapsConfig *config, NvStraps_GPUConfig cons
     unsigned gpuIndex = NvStrapsConfig_FindGPUConfig(config, gpuConfig->bus, gpuConfig->device, gpuConfig->function);
 
     if (gpuIndex == WORD_BITMASK)
+    {
 	if (config->nGPUConfig < ARRAY_SIZE(config->gpuConfig))
 	{
 	    config->gpuConfig[config->nGPUConfig++] = *gpuConfig;
@@ -419,8 +765,7 @@ bool NvStrapsConfig_SetGPUConfig(NvStrapsConfig *config, NvStraps_GPUConfig cons
 
 	    return true;
 	}
-	else
-	    ;
+    }
     else
     {
 	NvStraps_UpdateGPUConfig(config, gpuIndex, gpuConfig);
@@ -448,6 +793,7 @@ bool NvStrapsConfig_SetBridgeConfig(NvStrapsConfig *config, NvStraps_BridgeConfi
     unsigned bridgeIndex = NvStrapsConfig_FindBridgeConfig(config, bridgeConfig->bridgeBus, bridgeConfig->bridgeDevice, bridgeConfig->bridgeFunction);
 
     if (bridgeIndex == WORD_BITMASK)
+    {
 	if (config->nBridgeConfig < ARRAY_SIZE(config->bridge))
 	{
 	    config->bridge[config->nBridgeConfig++] = *bridgeConfig;
@@ -455,8 +801,7 @@ bool NvStrapsConfig_SetBridgeConfig(NvStrapsConfig *config, NvStraps_BridgeConfi
 
 	    return true;
 	}
-	else
-	    ;
+    }
     else
     {
 	NvStrapsConfig_UpdateBridgeConfig(config, bridgeIndex, bridgeConfig);
@@ -467,6 +812,41 @@ bool NvStrapsConfig_SetBridgeConfig(NvStrapsConfig *config, NvStraps_BridgeConfi
     return false;
 }
 
+uint_least8_t NvStrapsConfig_SetupVarName(NvStrapsConfig const *config, uint_least8_t guid[SETUP_VAR_GUID_SIZE], uint_least32_t *size)
+{
+    if (config->setupVarName != SetupVarName_None)
+    {
+	for (unsigned i = 0u; i < SETUP_VAR_GUID_SIZE; i++)
+	    guid[i] = config->setupVarGUID[i];
+
+	*size = config->setupVarSize;
+    }
+
+    return config->setupVarName;
+}
+
+bool NvStrapsConfig_SetSetupVarName(NvStrapsConfig *config, uint_least8_t name, uint_least8_t const guid[SETUP_VAR_GUID_SIZE], uint_least32_t size)
+{
+    bool isChanged = config->setupVarName != name;
+
+    if (name == SetupVarName_None)
+	size = 0u;
+    else
+	for (unsigned i = 0u; i < SETUP_VAR_GUID_SIZE; i++)
+	    if (config->setupVarGUID[i] != guid[i])
+		config->setupVarGUID[i] = guid[i], isChanged = true;
+
+    isChanged = isChanged || config->setupVarSize != size;
+
+    config->setupVarName = name;
+    config->setupVarSize = size;
+
+    if (isChanged)
+	config->dirty = true;
+
+    return isChanged;
+}
+
 NvStrapsConfig *GetNvStrapsConfig(bool reload, ERROR_CODE *errorCode)
 {
     static bool isLoaded = false;
@@ -3,29 +3,216 @@
 
 #include <Uefi.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/IoLib.h>
+#include <Library/MemoryAllocationLib.h>
 #include <Protocol/PciRootBridgeIo.h>
 #include <IndustryStandard/Pci.h>
 #include <IndustryStandard/Pci22.h>
 #include <IndustryStandard/PciExpress21.h>
 
+#if defined(_ASSERT)
+# undef _ASSERT
+#endif
+
+#include <Library/DebugLib.h>
+
 #include "pciRegs.h"
 #include "S3ResumeScript.h"
 #include "LocalAppConfig.h"
 #include "StatusVar.h"
+#include "PhaseTimer.h"
 #include "SetupNvStraps.h"
 #include "ReBar.h"
+#include "PciEcam.h"
 #include "PciConfig.h"
+#include "PciTrace.h"
+
+// External definitions for the inline functions in PciConfig.h
+extern inline UINTN pciMakeAddress(uint_least16_t segment, uint_least8_t rootBridgeIndex, uint_least8_t bus, uint_least8_t dev, uint_least8_t fun);
+extern inline UINTN pciSiblingAddress(UINTN pciAddress, uint_least8_t bus, uint_least8_t dev, uint_least8_t fun);
+extern inline uint_least16_t pciAddressSegment(UINTN pciAddress);
+extern inline uint_least8_t pciAddressRootBridge(UINTN pciAddress);
+extern inline void pciUnpackAddress(UINTN pciAddress, uint_least8_t *bus, uint_least8_t *dev, uint_least8_t *fun);
+extern inline uint_least16_t pciPackLocation(uint_least8_t bus, uint_least8_t dev, uint_least8_t fun);
 
-inline bool PCI_POSSIBLE_ERROR(UINT32 val)
+static inline bool PCI_POSSIBLE_ERROR(UINT32 val)
 {
     return val == MAX_UINT32;
-};
+}
+
+// RootBridgeIo protocol for each root bridge handle seen so far. The index in this table is kept in the PCI address
+// When enabled, the ECAM range for the root bridge segment is used for config space access instead of RootBridgeIo
+#define PCI_MAX_ROOT_BRIDGES		16u
+
+static struct
+{
+    EFI_HANDLE handle;
+    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *rootBridgeIo;
+    PciEcamRange ecamRange;
+}
+    rootBridges[PCI_MAX_ROOT_BRIDGES];
+
+static uint_least8_t rootBridgeCount = 0u;
+static bool isEcamEnabled = false;
+
+static inline EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *pciRootBridgeIo(UINTN pciAddress)
+{
+    return rootBridges[pciAddress >> PCI_ADDRESS_ROOT_BRIDGE_SHIFT & (PCI_MAX_ROOT_BRIDGES - 1u)].rootBridgeIo;
+}
+
+// Memory address for the config register in the ECAM range, or 0 to use RootBridgeIo
+static inline UINTN pciEcamAddress(UINTN pciAddress, INTN pos)
+{
+    PciEcamRange const *ecamRange = &rootBridges[pciAddress >> PCI_ADDRESS_ROOT_BRIDGE_SHIFT & (PCI_MAX_ROOT_BRIDGES - 1u)].ecamRange;
+    uint_least8_t bus = pciAddress >> 24u & BYTE_BITMASK;
+
+    if (!ecamRange->baseAddress || bus < ecamRange->startBus || bus > ecamRange->endBus)
+	return 0u;
+
+    UINTN reg = (UINTN)((pciAddress & PCI_ADDRESS_REGISTER_MASK) >> 32u) + pos;
+
+    return (UINTN)ecamRange->baseAddress
+	+ ((UINTN)bus << 20u | (pciAddress >> 16u & 0x1Fu) << 15u | (pciAddress >> 8u & 0x07u) << 12u | (reg & 0x0FFFu));
+}
+
+void pciConfigUseEcam(bool useEcam)
+{
+    isEcamEnabled = useEcam && PciEcam_Init();
+
+    if (useEcam && !isEcamEnabled)
+	DEBUG((DEBUG_INFO, "ReBarDXE: No ECAM ranges in ACPI MCFG table, using RootBridgeIo for PCI config space\n"));
+}
+
+static EFI_STATUS pciLocateRootBridge(EFI_HANDLE rootBridgeHandle, uint_least8_t *rootBridgeIndex)
+{
+    for (uint_least8_t index = 0u; index < rootBridgeCount; index++)
+	if (rootBridges[index].handle == rootBridgeHandle)
+	    return *rootBridgeIndex = index, EFI_SUCCESS;
+
+    if (rootBridgeCount >= ARRAY_SIZE(rootBridges))
+	return EFI_OUT_OF_RESOURCES;
+
+    EFI_STATUS status = gBS->HandleProtocol(rootBridgeHandle, &gEfiPciRootBridgeIoProtocolGuid, (void **)&rootBridges[rootBridgeCount].rootBridgeIo);
+
+    if (EFI_ERROR(status))
+	return status;
+
+    rootBridges[rootBridgeCount].handle = rootBridgeHandle;
+
+    if (!isEcamEnabled || !PciEcam_LookupRange(rootBridges[rootBridgeCount].rootBridgeIo->SegmentNumber, &rootBridges[rootBridgeCount].ecamRange))
+	rootBridges[rootBridgeCount].ecamRange.baseAddress = 0u;
+
+    *rootBridgeIndex = rootBridgeCount++;
+
+    return EFI_SUCCESS;
+}
+
+// Number of PCI root bridges in the system, 0 if unknown. The free MMIO ranges in the GCD can only be attributed to
+// a root bridge aperture when there is a single root bridge.
+uint_least8_t pciSystemRootBridgeCount()
+{
+    static UINTN systemRootBridgeCount = 0u;
+
+    if (!systemRootBridgeCount)
+    {
+	EFI_HANDLE *handleBuffer = NULL;
+
+	if (!EFI_ERROR(gBS->LocateHandleBuffer(ByProtocol, &gEfiPciRootBridgeIoProtocolGuid, NULL, &systemRootBridgeCount, &handleBuffer)))
+	    FreePool(handleBuffer);
+	else
+	    systemRootBridgeCount = 0u;
+    }
+
+    return systemRootBridgeCount > BYTE_BITMASK ? BYTE_BITMASK : (uint_least8_t)systemRootBridgeCount;
+}
+
+// Snapshot of the configuration space for the few devices accessed during one PreprocessController call.
+// Standard header dwords are loaded on first use, and the extended capability list is walked only once.
+// Writes to the header drop the written dword, and the whole cache is dropped when the next call starts,
+// as PciBusDxe changes bus numbers and resources between the calls.
+#define PCI_CONFIG_CACHE_SIZE		4u
+#define PCI_CONFIG_CACHE_EXT_CAPS	16u
+#define PCI_CONFIG_HEADER_DWORDS	(PCI_STD_HEADER_SIZEOF / sizeof(UINT32))
+
+typedef struct PciConfigCacheEntry
+{
+    UINTN pciAddress;
+    bool headerLoaded;
+    uint_least16_t headerValidMask;
+    UINT32 header[PCI_CONFIG_HEADER_DWORDS];
+
+    bool extCapsLoaded;
+    uint_least8_t extCapCount;
+
+    struct
+    {
+	uint_least16_t capId, capOffset;
+    }
+	extCaps[PCI_CONFIG_CACHE_EXT_CAPS];
+}
+    PciConfigCacheEntry;
+
+static PciConfigCacheEntry pciConfigCache[PCI_CONFIG_CACHE_SIZE];
+static uint_least8_t pciConfigCacheCount = 0u, pciConfigCacheNext = 0u;
+
+static inline UINTN pciConfigCacheKey(UINTN pciAddress)
+{
+    return pciAddress & ~(UINTN)(PCI_ADDRESS_REGISTER_MASK | BYTE_BITMASK);
+}
+
+static void pciConfigCacheInvalidate()
+{
+    pciConfigCacheCount = 0u;
+    pciConfigCacheNext = 0u;
+}
+
+static PciConfigCacheEntry *pciConfigCacheLookup(UINTN pciAddress)
+{
+    pciAddress = pciConfigCacheKey(pciAddress);
+
+    for (PciConfigCacheEntry *entry = pciConfigCache; entry < pciConfigCache + pciConfigCacheCount; entry++)
+	if (entry->pciAddress == pciAddress)
+	    return entry;
+
+    return NULL;
+}
+
+static PciConfigCacheEntry *pciConfigCacheEntry(UINTN pciAddress)
+{
+    PciConfigCacheEntry *entry = pciConfigCacheLookup(pciAddress);
+
+    if (!entry)
+    {
+	if (pciConfigCacheCount < ARRAY_SIZE(pciConfigCache))
+	    entry = pciConfigCache + pciConfigCacheCount++;
+	else
+	{
+	    entry = pciConfigCache + pciConfigCacheNext;
+	    pciConfigCacheNext = (pciConfigCacheNext + 1u) % ARRAY_SIZE(pciConfigCache);
+	}
 
-static EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *pciRootBridgeIo;
+	entry->pciAddress = pciConfigCacheKey(pciAddress);
+	entry->headerLoaded = false;
+	entry->headerValidMask = 0u;
+	entry->extCapsLoaded = false;
+	entry->extCapCount = 0u;
+    }
+
+    return entry;
+}
+
+static void pciConfigCacheDropHeader(UINTN pciAddress, INTN pos)
+{
+    PciConfigCacheEntry *entry = pciConfigCacheLookup(pciAddress);
+
+    if (entry && pos >= 0 && pos < PCI_STD_HEADER_SIZEOF)
+	entry->headerValidMask &= ~(uint_least16_t)(1u << pos / sizeof(UINT32));
+}
 
 UINT64 pciAddrOffset(UINTN pciAddress, INTN offset)
 {
-    UINTN reg = (pciAddress & 0xffffffff00000000) >> 32;
+    UINTN reg = (pciAddress & PCI_ADDRESS_REGISTER_MASK) >> 32;
     UINTN bus = (pciAddress & 0xff000000) >> 24;
     UINTN dev = (pciAddress & 0xff0000) >> 16;
     UINTN func = (pciAddress & 0xff00) >> 8;
@@ -36,44 +223,197 @@ UINT64 pciAddrOffset(UINTN pciAddress, INTN offset)
 // created these functions to make it easy to read as we are adapting alot of code from Linux
 static inline EFI_STATUS pciReadConfigDword(UINTN pciAddress, INTN pos, UINT32 *buf)
 {
-    return pciRootBridgeIo->Pci.Read(pciRootBridgeIo, EfiPciWidthUint32, pciAddrOffset(pciAddress, pos), 1u, buf);
+    UINTN ecamAddress = pciEcamAddress(pciAddress, pos);
+    EFI_STATUS status = EFI_SUCCESS;
+
+    if (ecamAddress)
+	*buf = MmioRead32(ecamAddress);
+    else
+    {
+	EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *rootBridgeIo = pciRootBridgeIo(pciAddress);
+
+	status = rootBridgeIo->Pci.Read(rootBridgeIo, EfiPciWidthUint32, pciAddrOffset(pciAddress, pos), 1u, buf);
+    }
+
+    PCI_TRACE_ACCESS(pciAddress, pos, sizeof *buf, false, *buf);
+
+    return status;
+}
+
+// Root bridges that rejected a multi-dword read, to use single dword reads from then on
+static EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *blockReadRejected[PCI_MAX_ROOT_BRIDGES];
+static uint_least8_t blockReadRejectedCount = 0u;
+
+static bool isBlockReadRejected(EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *rootBridgeIo)
+{
+    for (unsigned index = 0u; index < blockReadRejectedCount; index++)
+	if (blockReadRejected[index] == rootBridgeIo)
+	    return true;
+
+    return false;
+}
+
+// Read consecutive dwords with a single RootBridgeIo call (Count > 1), or one dword at a time if the root bridge can not
+static EFI_STATUS pciReadConfigBlock(UINTN pciAddress, INTN pos, UINTN count, UINT32 *buf)
+{
+    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *rootBridgeIo = pciRootBridgeIo(pciAddress);
+    EFI_STATUS status;
+
+    if (count > 1u && !isBlockReadRejected(rootBridgeIo) && !pciEcamAddress(pciAddress, pos))
+    {
+	status = rootBridgeIo->Pci.Read(rootBridgeIo, EfiPciWidthUint32, pciAddrOffset(pciAddress, pos), count, buf);
+
+	if (status != EFI_INVALID_PARAMETER && status != EFI_UNSUPPORTED)
+	{
+	    for (UINTN index = 0u; index < count; index++)
+		PCI_TRACE_ACCESS(pciAddress, pos + (INTN)(index * sizeof *buf), sizeof *buf, false, buf[index]);
+
+	    return status;
+	}
+
+	if (blockReadRejectedCount < ARRAY_SIZE(blockReadRejected))
+	    blockReadRejected[blockReadRejectedCount++] = rootBridgeIo;
+    }
+
+    for (UINTN index = 0u; index < count; index++)
+	if (EFI_ERROR((status = pciReadConfigDword(pciAddress, pos + (INTN)(index * sizeof *buf), buf + index))))
+	    return status;
+
+    return EFI_SUCCESS;
 }
 
 // Using the PollMem function silently breaks UEFI boot (the board needs flash recovery...)
 static inline EFI_STATUS pciPollConfigDword(UINTN pciAddress, INTN pos, UINT64 mask, UINT64 value, UINT64 delay, UINT64 *result)
 {
-    return pciRootBridgeIo->PollMem(pciRootBridgeIo, EfiPciWidthUint32, pciAddrOffset(pciAddress, pos), mask, value, delay, result);
+    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *rootBridgeIo = pciRootBridgeIo(pciAddress);
+
+    return rootBridgeIo->PollMem(rootBridgeIo, EfiPciWidthUint32, pciAddrOffset(pciAddress, pos), mask, value, delay, result);
 }
 
 static inline EFI_STATUS pciWriteConfigDword(UINTN pciAddress, INTN pos, UINT32 *buf)
 {
-    return pciRootBridgeIo->Pci.Write(pciRootBridgeIo, EfiPciWidthUint32, pciAddrOffset(pciAddress, pos), 1u, buf);
+    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *rootBridgeIo = pciRootBridgeIo(pciAddress);
+
+    pciConfigCacheDropHeader(pciAddress, pos);
+    PCI_TRACE_ACCESS(pciAddress, pos, sizeof *buf, true, *buf);
+
+    UINTN ecamAddress = pciEcamAddress(pciAddress, pos);
+
+    if (ecamAddress)
+	return MmioWrite32(ecamAddress, *buf), EFI_SUCCESS;
+
+    return rootBridgeIo->Pci.Write(rootBridgeIo, EfiPciWidthUint32, pciAddrOffset(pciAddress, pos), 1u, buf);
 }
 
 static inline EFI_STATUS pciReadConfigWord(UINTN pciAddress, INTN pos, UINT16 *buf)
 {
-    return pciRootBridgeIo->Pci.Read(pciRootBridgeIo, EfiPciWidthUint16, pciAddrOffset(pciAddress, pos), 1u, buf);
+    UINTN ecamAddress = pciEcamAddress(pciAddress, pos);
+    EFI_STATUS status = EFI_SUCCESS;
+
+    if (ecamAddress)
+	*buf = MmioRead16(ecamAddress);
+    else
+    {
+	EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *rootBridgeIo = pciRootBridgeIo(pciAddress);
+
+	status = rootBridgeIo->Pci.Read(rootBridgeIo, EfiPciWidthUint16, pciAddrOffset(pciAddress, pos), 1u, buf);
+    }
+
+    PCI_TRACE_ACCESS(pciAddress, pos, sizeof *buf, false, *buf);
+
+    return status;
 }
 
 static inline EFI_STATUS pciWriteConfigWord(UINTN pciAddress, INTN pos, UINT16 *buf)
 {
-    return pciRootBridgeIo->Pci.Write(pciRootBridgeIo, EfiPciWidthUint16, pciAddrOffset(pciAddress, pos), 1u, buf);
+    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *rootBridgeIo = pciRootBridgeIo(pciAddress);
+
+    pciConfigCacheDropHeader(pciAddress, pos);
+    PCI_TRACE_ACCESS(pciAddress, pos, sizeof *buf, true, *buf);
+
+    UINTN ecamAddress = pciEcamAddress(pciAddress, pos);
+
+    if (ecamAddress)
+	return MmioWrite16(ecamAddress, *buf), EFI_SUCCESS;
+
+    return rootBridgeIo->Pci.Write(rootBridgeIo, EfiPciWidthUint16, pciAddrOffset(pciAddress, pos), 1u, buf);
 }
 
 static inline EFI_STATUS pciReadConfigByte(UINTN pciAddress, INTN pos, UINT8 *buf)
 {
-    return pciRootBridgeIo->Pci.Read(pciRootBridgeIo, EfiPciWidthUint8, pciAddrOffset(pciAddress, pos), 1u, buf);
+    UINTN ecamAddress = pciEcamAddress(pciAddress, pos);
+    EFI_STATUS status = EFI_SUCCESS;
+
+    if (ecamAddress)
+	*buf = MmioRead8(ecamAddress);
+    else
+    {
+	EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *rootBridgeIo = pciRootBridgeIo(pciAddress);
+
+	status = rootBridgeIo->Pci.Read(rootBridgeIo, EfiPciWidthUint8, pciAddrOffset(pciAddress, pos), 1u, buf);
+    }
+
+    PCI_TRACE_ACCESS(pciAddress, pos, sizeof *buf, false, *buf);
+
+    return status;
 }
 
 static inline EFI_STATUS pciWriteConfigByte(UINTN pciAddress, INTN pos, UINT8 *buf)
 {
-    return pciRootBridgeIo->Pci.Write(pciRootBridgeIo, EfiPciWidthUint8, pciAddrOffset(pciAddress, pos), 1u, buf);
+    EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *rootBridgeIo = pciRootBridgeIo(pciAddress);
+
+    pciConfigCacheDropHeader(pciAddress, pos);
+    PCI_TRACE_ACCESS(pciAddress, pos, sizeof *buf, true, *buf);
+
+    UINTN ecamAddress = pciEcamAddress(pciAddress, pos);
+
+    if (ecamAddress)
+	return MmioWrite8(ecamAddress, *buf), EFI_SUCCESS;
+
+    return rootBridgeIo->Pci.Write(rootBridgeIo, EfiPciWidthUint8, pciAddrOffset(pciAddress, pos), 1u, buf);
+}
+
+// Read a dword from the standard header through the cache. Other registers are always read from the device
+static EFI_STATUS pciReadCachedConfigDword(UINTN pciAddress, INTN pos, UINT32 *buf)
+{
+    if (pos < 0 || pos >= PCI_STD_HEADER_SIZEOF || pos % sizeof(UINT32))
+	return pciReadConfigDword(pciAddress, pos, buf);
+
+    PciConfigCacheEntry *entry = pciConfigCacheEntry(pciAddress);
+    uint_least16_t dwordBit = 1u << pos / sizeof(UINT32);
+
+    // Load the full header with the first read from a device
+    if (!entry->headerLoaded)
+    {
+	entry->headerLoaded = true;
+
+	if (!EFI_ERROR(pciReadConfigBlock(pciAddress, 0, ARRAY_SIZE(entry->header), entry->header)))
+	    entry->headerValidMask = (uint_least16_t)((1u << ARRAY_SIZE(entry->header)) - 1u);
+    }
+
+    if (entry->headerValidMask & dwordBit)
+    {
+	*buf = entry->header[pos / sizeof(UINT32)];
+	return EFI_SUCCESS;
+    }
+
+    EFI_STATUS status = pciReadConfigDword(pciAddress, pos, buf);
+
+    if (!EFI_ERROR(status))
+    {
+	entry->header[pos / sizeof(UINT32)] = *buf;
+	entry->headerValidMask |= dwordBit;
+    }
+
+    return status;
 }
 
 EFI_STATUS pciReadDeviceSubsystem(UINTN pciAddress, uint_least16_t *subsysVenID, uint_least16_t *subsysDevID)
 {
+    PCI_TRACE_SITE(PciTrace_DeviceHeader);
+
     UINT32 subsys = MAX_UINT32;
-    EFI_STATUS status = pciReadConfigDword(pciAddress, PCI_SUBSYSTEM_VENDOR_ID_OFFSET, &subsys);
+    EFI_STATUS status = pciReadCachedConfigDword(pciAddress, PCI_SUBSYSTEM_VENDOR_ID_OFFSET, &subsys);
 
     if (EFI_ERROR(status))
         *subsysVenID = WORD_BITMASK, *subsysDevID = WORD_BITMASK;
@@ -85,9 +425,11 @@ EFI_STATUS pciReadDeviceSubsystem(UINTN pciAddress, uint_least16_t *subsysVenID,
 
 uint_least32_t pciDeviceClass(UINTN pciAddress)
 {
+    PCI_TRACE_SITE(PciTrace_DeviceHeader);
+
     UINT32 configReg;
 
-    if (EFI_ERROR(pciReadConfigDword(pciAddress, PCI_REVISION_ID_OFFSET, &configReg)))
+    if (EFI_ERROR(pciReadCachedConfigDword(pciAddress, PCI_REVISION_ID_OFFSET, &configReg)))
 	return UINT32_C(0xFFFF'FFFF);
 
     return configReg & UINT32_C(0xFFFF'FF00);
@@ -95,9 +437,11 @@ uint_least32_t pciDeviceClass(UINTN pciAddress)
 
 uint_least32_t pciDeviceBAR0(UINTN pciAddress, EFI_STATUS *status)
 {
+    PCI_TRACE_SITE(PciTrace_DeviceHeader);
+
     UINT32 baseAddress;
 
-    *status = pciReadConfigDword(pciAddress, PCI_BASE_ADDRESS_0, &baseAddress);
+    *status = pciReadCachedConfigDword(pciAddress, PCI_BASE_ADDRESS_0, &baseAddress);
 
     if (EFI_ERROR(*status))
 	return UINT32_C(0xFFFF'FFFF);
@@ -105,11 +449,40 @@ uint_least32_t pciDeviceBAR0(UINTN pciAddress, EFI_STATUS *status)
     return baseAddress;
 }
 
+// Mask of the 64-bit prefetchable memory BARs (by the index of the low dword), that PciBusDxe places in the
+// prefetchable memory window of the bridge
+uint_least8_t pciDevicePrefetchableBARs(UINTN pciAddress)
+{
+    PCI_TRACE_SITE(PciTrace_DeviceHeader);
+
+    uint_least8_t barMask = 0u;
+
+    for (uint_least8_t barIndex = 0u; barIndex < PCI_MAX_BAR; barIndex++)
+    {
+	UINT32 baseAddress;
+
+	if (EFI_ERROR(pciReadCachedConfigDword(pciAddress, PCI_BASE_ADDRESS_0 + barIndex * sizeof baseAddress, &baseAddress)) || PCI_POSSIBLE_ERROR(baseAddress))
+	    break;
+
+	if ((baseAddress & PCI_BASE_ADDRESS_SPACE) == PCI_BASE_ADDRESS_SPACE_MEMORY && (baseAddress & PCI_BASE_ADDRESS_MEM_TYPE_MASK) == PCI_BASE_ADDRESS_MEM_TYPE_64)
+	{
+	    if (baseAddress & PCI_BASE_ADDRESS_MEM_PREFETCH)
+		barMask |= 1u << barIndex;
+
+	    barIndex++;		// high dword of the address
+	}
+    }
+
+    return barMask;
+}
+
 EFI_STATUS pciBridgeSecondaryBus(UINTN pciAddress, uint_least8_t *secondaryBus)
 {
+    PCI_TRACE_SITE(PciTrace_DeviceHeader);
+
     UINT32 configReg;
 
-    EFI_STATUS status = pciReadConfigDword(pciAddress, PCI_BRIDGE_PRIMARY_BUS_REGISTER_OFFSET, &configReg);
+    EFI_STATUS status = pciReadCachedConfigDword(pciAddress, PCI_BRIDGE_PRIMARY_BUS_REGISTER_OFFSET, &configReg);
 
     if (EFI_ERROR(status))
 	*secondaryBus = BYTE_BITMASK;
@@ -134,18 +507,31 @@ bool pciIsVgaController(uint_least32_t pciClassReg)
 
 UINTN pciLocateDevice(EFI_HANDLE RootBridgeHandle, EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_PCI_ADDRESS addressInfo, uint_least16_t *venID, uint_least16_t *devID, uint_least8_t *headerType)
 {
-    gBS->HandleProtocol(RootBridgeHandle, &gEfiPciRootBridgeIoProtocolGuid, (void **)&pciRootBridgeIo);
+    PCI_TRACE_SITE(PciTrace_LocateDevice);
+
+    uint_least8_t rootBridgeIndex;
+    EFI_STATUS status = pciLocateRootBridge(RootBridgeHandle, &rootBridgeIndex);
+
+    pciConfigCacheInvalidate();
+
+    if (EFI_ERROR(status))
+    {
+	SetEFIError(EFIError_LoadRootBridgeIoProtocol, status);
+	*venID = WORD_BITMASK, *devID = WORD_BITMASK, *headerType = BYTE_BITMASK;
 
-    UINTN pciAddress = EFI_PCI_ADDRESS(addressInfo.Bus, addressInfo.Device, addressInfo.Function, 0x00u);
+	return 0u;
+    }
+
+    UINTN pciAddress = pciMakeAddress(rootBridges[rootBridgeIndex].rootBridgeIo->SegmentNumber, rootBridgeIndex, addressInfo.Bus, addressInfo.Device, addressInfo.Function);
     UINT32 pciID;
 
-    pciReadConfigDword(pciAddress, PCI_VENDOR_ID_OFFSET, &pciID);
+    pciReadCachedConfigDword(pciAddress, PCI_VENDOR_ID_OFFSET, &pciID);
 
     if (pciID != ((uint_least32_t) WORD_BITMASK << WORD_BITSIZE | WORD_BITMASK))
     {
 	UINT32 configReg;
 
-	if (EFI_ERROR(pciReadConfigDword(pciAddress, PCI_CACHELINE_SIZE_OFFSET, &configReg)))
+	if (EFI_ERROR(pciReadCachedConfigDword(pciAddress, PCI_CACHELINE_SIZE_OFFSET, &configReg)))
 	    *headerType = BYTE_BITMASK;
 	else
 	    *headerType = (configReg >> WORD_BITSIZE) & BYTE_BITMASK;
@@ -160,9 +546,9 @@ UINTN pciLocateDevice(EFI_HANDLE RootBridgeHandle, EFI_PCI_ROOT_BRIDGE_IO_PROTOC
 }
 
 // adapted from Linux pci_find_ext_capability
-uint_least16_t pciFindExtCapability(UINTN pciAddress, uint_least32_t cap)
+static uint_least16_t pciWalkExtCapabilities(UINTN pciAddress, uint_least32_t cap, PciConfigCacheEntry *entry)
 {
-    uint_least16_t capabilityOffset = EFI_PCIE_CAPABILITY_BASE_OFFSET;
+    uint_least16_t capabilityOffset = EFI_PCIE_CAPABILITY_BASE_OFFSET, foundOffset = 0u;
     UINT32 capabilityHeader;
     EFI_STATUS status;
 
@@ -174,15 +560,32 @@ uint_least16_t pciFindExtCapability(UINTN pciAddress, uint_least32_t cap)
      * cap version and next pointer all being 0. Or it could also be all FF
      */
     if (capabilityHeader == 0u || PCI_POSSIBLE_ERROR(capabilityHeader))
-        return 0u;
+        return entry->extCapsLoaded = true, 0u;
 
     /* minimum 8 bytes per capability */
     int_fast16_t  ttl = (PCI_CFG_SPACE_EXP_SIZE - EFI_PCIE_CAPABILITY_BASE_OFFSET) / 8u;
 
+    bool listTruncated = false;
+
+    // Walk the entire list once to fill the cache, the first match is returned
     while (ttl-- > 0)
     {
-        if (PCI_EXT_CAP_ID(capabilityHeader) == cap && capabilityOffset)
-            return capabilityOffset;
+        if (PCI_EXT_CAP_ID(capabilityHeader) == cap && !foundOffset)
+            foundOffset = capabilityOffset;
+
+        if (entry->extCapCount < ARRAY_SIZE(entry->extCaps))
+        {
+            entry->extCaps[entry->extCapCount].capId = PCI_EXT_CAP_ID(capabilityHeader);
+            entry->extCaps[entry->extCapCount].capOffset = capabilityOffset;
+            entry->extCapCount++;
+        }
+        else
+        {
+            listTruncated = true;
+
+            if (foundOffset)
+                return foundOffset;
+        }
 
         capabilityOffset = PCI_EXT_CAP_NEXT(capabilityHeader);
 
@@ -192,45 +595,100 @@ uint_least16_t pciFindExtCapability(UINTN pciAddress, uint_least32_t cap)
         if (EFI_ERROR((status = pciReadConfigDword(pciAddress, capabilityOffset, &capabilityHeader))))
         {
             SetEFIError(EFIError_PCI_FindCap, status);
-            break;
+            return foundOffset;
         }
     }
 
-    return 0u;
+    entry->extCapsLoaded = !listTruncated;
+
+    return foundOffset;
 }
 
-static uint_least16_t pciBARConfigOffset(UINTN pciAddress, uint_least16_t capOffset, uint_least8_t barIndex)
+uint_least16_t pciFindExtCapability(UINTN pciAddress, uint_least32_t cap)
 {
-    UINT32 configValue;
-    pciReadConfigDword(pciAddress, capOffset + PCI_REBAR_CTRL, &configValue);
+    PCI_TRACE_SITE(PciTrace_ExtCapability);
 
-    unsigned nBars = (configValue & PCI_REBAR_CTRL_NBAR_MASK) >> PCI_REBAR_CTRL_NBAR_SHIFT;
+    PciConfigCacheEntry *entry = pciConfigCacheEntry(pciAddress);
 
-    for (unsigned i = 0u; i < nBars; i++, capOffset += 8u)
+    if (!entry->extCapsLoaded)
     {
-        pciReadConfigDword(pciAddress, capOffset + PCI_REBAR_CTRL, &configValue);
-
-        if ((configValue & PCI_REBAR_CTRL_BAR_IDX) == barIndex)
-            return capOffset;
+        entry->extCapCount = 0u;
+        return pciWalkExtCapabilities(pciAddress, cap, entry);
     }
 
+    for (unsigned index = 0u; index < entry->extCapCount; index++)
+        if (entry->extCaps[index].capId == cap)
+            return entry->extCaps[index].capOffset;
+
     return 0u;
 }
 
-uint_least32_t pciRebarGetPossibleSizes(UINTN pciAddress, uint_least16_t capabilityOffset, UINT16 vid, UINT16 did, uint_least8_t barIndex)
+// Read all the BAR entries of the Resizable BAR capability in one pass
+bool pciRebarParseCapability(UINTN pciAddress, uint_least16_t capabilityOffset, PciReBarCapability *reBar)
 {
-    uint_least16_t barConfigOffset = pciBARConfigOffset(pciAddress, capabilityOffset, barIndex);
+    PCI_TRACE_SITE(PciTrace_ReBarCapability);
 
-    if (barConfigOffset)
+    SetMem(reBar, sizeof *reBar, 0u);
+    reBar->capabilityOffset = capabilityOffset;
+
+    if (!capabilityOffset)
+        return false;
+
+    UINT32 barControl, barEntries[2u * (PCI_REBAR_CTRL_NBAR_MASK >> PCI_REBAR_CTRL_NBAR_SHIFT)];
+    EFI_STATUS status;
+
+    if (EFI_ERROR((status = pciReadConfigDword(pciAddress, capabilityOffset + PCI_REBAR_CTRL, &barControl))))
+        return SetEFIError(EFIError_PCI_FindCap, status), false;
+
+    unsigned nBars = (barControl & PCI_REBAR_CTRL_NBAR_MASK) >> PCI_REBAR_CTRL_NBAR_SHIFT;
+
+    // capability and control registers for all entries
+    if (EFI_ERROR((status = pciReadConfigBlock(pciAddress, capabilityOffset + PCI_REBAR_CAP, 2u * nBars, barEntries))))
+        return SetEFIError(EFIError_PCI_FindCap, status), false;
+
+    for (unsigned entryIndex = 0u; entryIndex < nBars; entryIndex++)
     {
-        UINT32 barSizeMask;
-        pciReadConfigDword(pciAddress, barConfigOffset + PCI_REBAR_CAP, &barSizeMask);
-        barSizeMask &= PCI_REBAR_CAP_SIZES;
+        uint_least16_t entryOffset = capabilityOffset + entryIndex * 8u;
+        UINT32 barCapability = barEntries[2u * entryIndex];
+
+        barControl = barEntries[2u * entryIndex + 1u];
 
-        return barSizeMask >> 4u;
+        uint_least8_t barIndex = barControl & PCI_REBAR_CTRL_BAR_IDX;
+
+        if (barIndex >= ARRAY_SIZE(reBar->bar) || reBar->bar[barIndex].entryOffset)
+            continue;
+
+        reBar->bar[barIndex].entryOffset = entryOffset;
+        reBar->bar[barIndex].barControl = barControl;
+        reBar->bar[barIndex].sizeMask = (barCapability & PCI_REBAR_CAP_SIZES) >> 4u;
+        reBar->bar[barIndex].currentSize = (barControl & PCI_REBAR_CTRL_BAR_SIZE) >> PCI_REBAR_CTRL_BAR_SHIFT;
+        reBar->barCount++;
+
+        DEBUG((DEBUG_INFO, "ReBarDXE: BAR%u resizable, sizes 0x%x, current size 2^%u MiB\n", barIndex, reBar->bar[barIndex].sizeMask, reBar->bar[barIndex].currentSize));
     }
 
-    return 0u;
+    return !!reBar->barCount;
+}
+
+uint_least32_t pciRebarGetPossibleSizes(PciReBarCapability const *reBar, uint_least8_t barIndex)
+{
+    return barIndex < ARRAY_SIZE(reBar->bar) ? reBar->bar[barIndex].sizeMask : 0u;
+}
+
+// Re-read the size list for one BAR, for devices that update the list (like GPUs with new STRAPS)
+uint_least32_t pciRebarReadPossibleSizes(UINTN pciAddress, PciReBarCapability *reBar, uint_least8_t barIndex)
+{
+    PCI_TRACE_SITE(PciTrace_ReBarCapability);
+
+    if (barIndex >= ARRAY_SIZE(reBar->bar) || !reBar->bar[barIndex].entryOffset)
+        return 0u;
+
+    UINT32 barCapability;
+
+    if (EFI_ERROR(pciReadConfigDword(pciAddress, reBar->bar[barIndex].entryOffset + PCI_REBAR_CAP, &barCapability)))
+        return reBar->bar[barIndex].sizeMask;
+
+    return reBar->bar[barIndex].sizeMask = (barCapability & PCI_REBAR_CAP_SIZES) >> 4u;
 }
 
 /*
@@ -252,19 +710,25 @@ uint_least32_t pciRebarPollPossibleSizes(UINTN pciAddress, uint_least16_t capabi
 }
  */
 
-bool pciRebarSetSize(UINTN pciAddress, uint_least16_t capabilityOffset, uint_least8_t barIndex, uint_least8_t barSizeBitIndex)
+bool pciRebarSetSize(UINTN pciAddress, PciReBarCapability *reBar, uint_least8_t barIndex, uint_least8_t barSizeBitIndex)
 {
-    uint_least16_t barConfigOffset = pciBARConfigOffset(pciAddress, capabilityOffset, barIndex);
+    PCI_TRACE_SITE(PciTrace_ReBarSize);
 
-    if (barConfigOffset)
+    if (barIndex < ARRAY_SIZE(reBar->bar) && reBar->bar[barIndex].entryOffset)
     {
-        UINT32 barSizeControl;
-        pciReadConfigDword(pciAddress, barConfigOffset + PCI_REBAR_CTRL, &barSizeControl);
+        PciReBarEntry *barEntry = reBar->bar + barIndex;
+        UINT32 barSizeControl = barEntry->barControl;
 
         barSizeControl &= ~ (uint_least32_t)PCI_REBAR_CTRL_BAR_SIZE;
         barSizeControl |= (uint_least32_t)barSizeBitIndex << PCI_REBAR_CTRL_BAR_SHIFT;
 
-        pciWriteConfigDword(pciAddress, barConfigOffset + PCI_REBAR_CTRL, &barSizeControl);
+        uint_least64_t startTime = PhaseTimer_Start();
+
+        pciWriteConfigDword(pciAddress, barEntry->entryOffset + PCI_REBAR_CTRL, &barSizeControl);
+        PhaseTimer_Stop(PhaseTimer_ReBarWrite, startTime);
+
+        barEntry->barControl = barSizeControl;
+        barEntry->currentSize = barSizeBitIndex;
 
         return true;
     }
@@ -272,17 +736,56 @@ bool pciRebarSetSize(UINTN pciAddress, uint_least16_t capabilityOffset, uint_lea
     return false;
 }
 
-void pciSaveAndRemapBridgeConfig(UINTN bridgePciAddress, UINT32 bridgeSaveArea[3u], EFI_PHYSICAL_ADDRESS baseAddress0, EFI_PHYSICAL_ADDRESS topAddress0, EFI_PHYSICAL_ADDRESS ioBaseLimit)
+// Check if the bridge memory window and the device BAR0 already decode the given range, so the device
+// registers can be accessed in place
+bool pciIsDeviceBAR0Decoded(UINTN bridgePciAddress, UINTN pciAddress, EFI_PHYSICAL_ADDRESS baseAddress0, EFI_PHYSICAL_ADDRESS topAddress0)
+{
+    PCI_TRACE_SITE(PciTrace_DeviceHeader);
+
+    UINT32 bridgeCommand, bridgeMemoryBaseLimit, deviceCommand, deviceBaseAddress, deviceBaseAddressHigh = 0u;
+
+    if (EFI_ERROR(pciReadCachedConfigDword(bridgePciAddress, PCI_COMMAND_OFFSET, &bridgeCommand))
+	    || EFI_ERROR(pciReadCachedConfigDword(bridgePciAddress, PCI_MEMORY_BASE, &bridgeMemoryBaseLimit))
+	    || EFI_ERROR(pciReadCachedConfigDword(pciAddress, PCI_COMMAND_OFFSET, &deviceCommand))
+	    || EFI_ERROR(pciReadCachedConfigDword(pciAddress, PCI_BASE_ADDRESS_0, &deviceBaseAddress)))
+	return false;
+
+    if (PCI_POSSIBLE_ERROR(bridgeCommand) || PCI_POSSIBLE_ERROR(deviceCommand) || PCI_POSSIBLE_ERROR(deviceBaseAddress))
+	return false;
+
+    if (!(bridgeCommand & EFI_PCI_COMMAND_MEMORY_SPACE) || !(deviceCommand & EFI_PCI_COMMAND_MEMORY_SPACE))
+	return false;
+
+    if (deviceBaseAddress & PCI_BASE_ADDRESS_SPACE)
+	return false;
+
+    if ((deviceBaseAddress & PCI_BASE_ADDRESS_MEM_TYPE_MASK) == PCI_BASE_ADDRESS_MEM_TYPE_64
+	    && EFI_ERROR(pciReadCachedConfigDword(pciAddress, PCI_BASE_ADDRESS_0 + sizeof(UINT32), &deviceBaseAddressHigh)))
+	return false;
+
+    EFI_PHYSICAL_ADDRESS
+	windowBase = (EFI_PHYSICAL_ADDRESS)(bridgeMemoryBaseLimit << 16u & UINT32_C(0xFFF0'0000)),
+	windowTop = (EFI_PHYSICAL_ADDRESS)((bridgeMemoryBaseLimit & UINT32_C(0xFFF0'0000)) | UINT32_C(0x000F'FFFF));
+
+    return !deviceBaseAddressHigh && (deviceBaseAddress & UINT32_C(0xFFFF'FFF0)) == (baseAddress0 & UINT32_C(0xFFFF'FFF0))
+	&& windowBase <= windowTop && windowBase <= baseAddress0 && topAddress0 <= windowTop;
+}
+
+void pciSaveAndRemapBridgeConfig(UINTN bridgePciAddress, UINT32 bridgeSaveArea[3u], EFI_PHYSICAL_ADDRESS baseAddress0, EFI_PHYSICAL_ADDRESS topAddress0, EFI_PHYSICAL_ADDRESS ioBaseLimit, bool writeConfig)
 {
+    PCI_TRACE_SITE(PciTrace_BridgeRemap);
+
     bool efiError = false, s3SaveStateError = false;
     EFI_STATUS status;
 
+    UINT32 configReg, bridgeConfig[3u];      // bus numbers, I/O base and limit, memory base and limit
+
     efiError = efiError || EFI_ERROR((status = pciReadConfigDword(bridgePciAddress, PCI_COMMAND_OFFSET, bridgeSaveArea + 0u)));
-    efiError = efiError || EFI_ERROR((status = pciReadConfigDword(bridgePciAddress, PCI_IO_BASE,        bridgeSaveArea + 1u)));
-    efiError = efiError || EFI_ERROR((status = pciReadConfigDword(bridgePciAddress, PCI_MEMORY_BASE,    bridgeSaveArea + 2u)));
+    efiError = efiError || EFI_ERROR((status = pciReadConfigBlock(bridgePciAddress, PCI_BRIDGE_PRIMARY_BUS_REGISTER_OFFSET, ARRAY_SIZE(bridgeConfig), bridgeConfig)));
 
-    UINT32 configReg;
-    efiError = efiError || EFI_ERROR((status = pciReadConfigDword(bridgePciAddress, PCI_BRIDGE_PRIMARY_BUS_REGISTER_OFFSET, &configReg)));
+    configReg = bridgeConfig[0u];
+    bridgeSaveArea[1u] = bridgeConfig[1u];
+    bridgeSaveArea[2u] = bridgeConfig[2u];
 
     if (!efiError)
     {
@@ -300,15 +803,18 @@ void pciSaveAndRemapBridgeConfig(UINTN bridgePciAddress, UINT32 bridgeSaveArea[3
 	    return;
 	}
 
-        UINT32 bridgeIoRange = ioBaseLimit & 0xFF00u | ioBaseLimit >> BYTE_BITSIZE & 0x00FFu;
+        UINT32 bridgeIoRange = (ioBaseLimit & 0xFF00u) | (ioBaseLimit >> BYTE_BITSIZE & 0x00FFu);
         UINT32
                 bridgeCommand = bridgeSaveArea[0u] | EFI_PCI_COMMAND_IO_SPACE | EFI_PCI_COMMAND_MEMORY_SPACE | EFI_PCI_COMMAND_BUS_MASTER,
-                bridgeIoBaseLimit = bridgeSaveArea[1u] & UINT32_C(0xFFFF'0000) | bridgeIoRange & UINT32_C(0x0000'FFFF),
-                bridgeMemoryBaseLimit = (baseAddress0 >> 16u & UINT32_C(0x0000'FFF0) | topAddress0 & UINT32_C(0xFFF0'0000));
+                bridgeIoBaseLimit = (bridgeSaveArea[1u] & UINT32_C(0xFFFF'0000)) | (bridgeIoRange & UINT32_C(0x0000'FFFF)),
+                bridgeMemoryBaseLimit = ((baseAddress0 >> 16u & UINT32_C(0x0000'FFF0)) | (topAddress0 & UINT32_C(0xFFF0'0000)));
 
-        efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(bridgePciAddress, PCI_MEMORY_BASE,    &bridgeMemoryBaseLimit)));
-        efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(bridgePciAddress, PCI_IO_BASE,        &bridgeIoBaseLimit)));
-        efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(bridgePciAddress, PCI_COMMAND_OFFSET, &bridgeCommand)));
+	if (writeConfig)
+	{
+	    efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(bridgePciAddress, PCI_MEMORY_BASE,    &bridgeMemoryBaseLimit)));
+	    efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(bridgePciAddress, PCI_IO_BASE,        &bridgeIoBaseLimit)));
+	    efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(bridgePciAddress, PCI_COMMAND_OFFSET, &bridgeCommand)));
+	}
 
 	if (!efiError)
 	{
@@ -370,26 +876,68 @@ void pciSaveAndRemapBridgeConfig(UINTN bridgePciAddress, UINT32 bridgeSaveArea[3
         SetEFIError(s3SaveStateError ? EFIError_WriteS3SaveStateProtocol : EFIError_PCI_BridgeConfig, status);
 }
 
-void pciRestoreBridgeConfig(UINTN bridgePciAddress, UINT32 bridgeSaveArea[3u])
+void pciRestoreBridgeConfig(UINTN bridgePciAddress, UINT32 bridgeSaveArea[3u], bool writeConfig)
 {
-    bool efiError = false;
+    PCI_TRACE_SITE(PciTrace_BridgeRestore);
+
+    bool efiError = false, s3SaveStateError = false;
     EFI_STATUS status;
 
-    efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(bridgePciAddress, PCI_COMMAND_OFFSET, bridgeSaveArea + 0u)));
-    efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(bridgePciAddress, PCI_IO_BASE,        bridgeSaveArea + 1u)));
-    efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(bridgePciAddress, PCI_MEMORY_BASE,    bridgeSaveArea + 2u)));
+    if (writeConfig)
+    {
+	efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(bridgePciAddress, PCI_COMMAND_OFFSET, bridgeSaveArea + 0u)));
+	efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(bridgePciAddress, PCI_IO_BASE,        bridgeSaveArea + 1u)));
+	efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(bridgePciAddress, PCI_MEMORY_BASE,    bridgeSaveArea + 2u)));
+    }
+
+    // On resume the bridge also stops decoding the range again, before the next GPU is mapped there
+    if (!efiError)
+    {
+	status = S3ResumeScript_PciConfigReadWrite_DWORD
+	    (
+		bridgePciAddress,
+		PCI_COMMAND_OFFSET,
+		bridgeSaveArea[0u] & (EFI_PCI_COMMAND_IO_SPACE | EFI_PCI_COMMAND_MEMORY_SPACE | EFI_PCI_COMMAND_BUS_MASTER),
+		(UINT32) ~(UINT32)(EFI_PCI_COMMAND_IO_SPACE | EFI_PCI_COMMAND_MEMORY_SPACE | EFI_PCI_COMMAND_BUS_MASTER)
+	    );
+
+	efiError = efiError || EFI_ERROR(status);
+	s3SaveStateError = s3SaveStateError || EFI_ERROR(status);
+    }
+
+    if (!efiError)
+    {
+	status = S3ResumeScript_PciConfigReadWrite_DWORD(bridgePciAddress, PCI_IO_BASE, bridgeSaveArea[1u] & UINT32_C(0x0000'FFFF), UINT32_C(0xFFFF'0000));
+
+	efiError = efiError || EFI_ERROR(status);
+	s3SaveStateError = s3SaveStateError || EFI_ERROR(status);
+    }
+
+    if (!efiError)
+    {
+	status = S3ResumeScript_PciConfigWrite_DWORD(bridgePciAddress, PCI_MEMORY_BASE, bridgeSaveArea[2u]);
+
+	efiError = efiError || EFI_ERROR(status);
+	s3SaveStateError = s3SaveStateError || EFI_ERROR(status);
+    }
 
     if (efiError)
-        SetEFIError(EFIError_PCI_BridgeRestore, status);
+        SetEFIError(s3SaveStateError ? EFIError_WriteS3SaveStateProtocol : EFIError_PCI_BridgeRestore, status);
 }
 
-void pciSaveAndRemapDeviceBAR0(UINTN pciAddress, UINT32 gpuSaveArea[2u], EFI_PHYSICAL_ADDRESS baseAddress0)
+void pciSaveAndRemapDeviceBAR0(UINTN pciAddress, UINT32 gpuSaveArea[2u], EFI_PHYSICAL_ADDRESS baseAddress0, bool writeConfig)
 {
+    PCI_TRACE_SITE(PciTrace_DeviceRemap);
+
     bool efiError = false, s3SaveStateError = false;
     EFI_STATUS status;
 
-    efiError = efiError || EFI_ERROR((status = pciReadConfigDword(pciAddress, PCI_COMMAND_OFFSET, gpuSaveArea + 0u)));
-    efiError = efiError || EFI_ERROR((status = pciReadConfigDword(pciAddress, PCI_BASE_ADDRESS_0, gpuSaveArea + 1u)));
+    UINT32 deviceConfig[(PCI_BASE_ADDRESS_0 - PCI_COMMAND_OFFSET) / sizeof(UINT32) + 1u];	    // command register up to BAR0
+
+    efiError = efiError || EFI_ERROR((status = pciReadConfigBlock(pciAddress, PCI_COMMAND_OFFSET, ARRAY_SIZE(deviceConfig), deviceConfig)));
+
+    gpuSaveArea[0u] = deviceConfig[0u];
+    gpuSaveArea[1u] = deviceConfig[ARRAY_SIZE(deviceConfig) - 1u];
 
     if (!efiError)
     {
@@ -403,8 +951,11 @@ void pciSaveAndRemapDeviceBAR0(UINTN pciAddress, UINT32 gpuSaveArea[2u], EFI_PHY
            gpuBaseAddress = baseAddress0 & UINT32_C(0xFFFFFFF0),
            gpuCommand = gpuSaveArea[0u] | PCI_COMMAND_IO | PCI_COMMAND_MEMORY | PCI_COMMAND_MASTER;
 
-        efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(pciAddress, PCI_BASE_ADDRESS_0, &gpuBaseAddress)));
-        efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(pciAddress, PCI_COMMAND_OFFSET, &gpuCommand)));
+	if (writeConfig)
+	{
+	    efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(pciAddress, PCI_BASE_ADDRESS_0, &gpuBaseAddress)));
+	    efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(pciAddress, PCI_COMMAND_OFFSET, &gpuCommand)));
+	}
 
 	if (!efiError)
 	{
@@ -438,16 +989,43 @@ void pciSaveAndRemapDeviceBAR0(UINTN pciAddress, UINT32 gpuSaveArea[2u], EFI_PHY
         SetEFIError(s3SaveStateError ? EFIError_WriteS3SaveStateProtocol : EFIError_PCI_DeviceBARConfig, status);
 }
 
-void pciRestoreDeviceConfig(UINTN pciAddress, UINT32 saveArea[2u])
+void pciRestoreDeviceConfig(UINTN pciAddress, UINT32 saveArea[2u], bool writeConfig)
 {
-    bool efiError = false;
+    PCI_TRACE_SITE(PciTrace_DeviceRestore);
+
+    bool efiError = false, s3SaveStateError = false;
     EFI_STATUS status;
 
-    efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(pciAddress, PCI_COMMAND_OFFSET, saveArea + 0u)));
-    efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(pciAddress, PCI_BASE_ADDRESS_0, saveArea + 1u)));
+    if (writeConfig)
+    {
+	efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(pciAddress, PCI_COMMAND_OFFSET, saveArea + 0u)));
+	efiError = efiError || EFI_ERROR((status = pciWriteConfigDword(pciAddress, PCI_BASE_ADDRESS_0, saveArea + 1u)));
+    }
+
+    if (!efiError)
+    {
+	status = S3ResumeScript_PciConfigReadWrite_DWORD
+	    (
+		pciAddress,
+		PCI_COMMAND_OFFSET,
+		saveArea[0u] & (EFI_PCI_COMMAND_IO_SPACE | EFI_PCI_COMMAND_MEMORY_SPACE | EFI_PCI_COMMAND_BUS_MASTER),
+		(uint_least32_t) ~(uint_least32_t)(EFI_PCI_COMMAND_IO_SPACE | EFI_PCI_COMMAND_MEMORY_SPACE | EFI_PCI_COMMAND_BUS_MASTER)
+	    );
+
+	efiError = efiError || EFI_ERROR(status);
+	s3SaveStateError = s3SaveStateError || EFI_ERROR(status);
+    }
+
+    if (!efiError)
+    {
+	status = S3ResumeScript_PciConfigWrite_DWORD(pciAddress, PCI_BASE_ADDRESS_0, saveArea[1u]);
+
+	efiError = efiError || EFI_ERROR(status);
+	s3SaveStateError = s3SaveStateError || EFI_ERROR(status);
+    }
 
     if (efiError)
-        SetEFIError(EFIError_PCI_DeviceBARRestore, status);
+        SetEFIError(s3SaveStateError ? EFIError_WriteS3SaveStateProtocol : EFIError_PCI_DeviceBARRestore, status);
 }
 
 // vim: ft=cpp
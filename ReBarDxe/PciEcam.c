@@ -0,0 +1,99 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <Uefi.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Guid/Acpi.h>
+#include <IndustryStandard/Acpi.h>
+#include <IndustryStandard/MemoryMappedConfigurationSpaceAccessTable.h>
+
+#if defined(_ASSERT)
+# undef _ASSERT
+#endif
+
+#include <Library/DebugLib.h>
+
+#include "LocalAppConfig.h"
+#include "PciEcam.h"
+
+#define PCI_ECAM_MAX_RANGES 8u
+
+static PciEcamRange ecamRanges[PCI_ECAM_MAX_RANGES];
+static uint_least8_t ecamRangeCount = 0u;
+
+static EFI_ACPI_DESCRIPTION_HEADER const *findAcpiTable(EFI_ACPI_2_0_ROOT_SYSTEM_DESCRIPTION_POINTER const *rsdp, UINT32 signature)
+{
+    // Entries in XSDT are 64-bit, entries in RSDT are 32-bit, and both can be unaligned
+    bool useXsdt = rsdp->Revision >= 2u && rsdp->XsdtAddress;
+    EFI_ACPI_DESCRIPTION_HEADER const *rootTable = (EFI_ACPI_DESCRIPTION_HEADER const *)(UINTN)(useXsdt ? rsdp->XsdtAddress : rsdp->RsdtAddress);
+
+    if (!rootTable)
+	return NULL;
+
+    UINTN entrySize = useXsdt ? sizeof(UINT64) : sizeof(UINT32);
+    UINTN entryCount = (rootTable->Length - sizeof *rootTable) / entrySize;
+    UINT8 const *entries = (UINT8 const *)(rootTable + 1u);
+
+    for (UINTN index = 0u; index < entryCount; index++)
+    {
+	UINT64 tableAddress = 0u;
+
+	CopyMem(&tableAddress, entries + index * entrySize, entrySize);
+
+	EFI_ACPI_DESCRIPTION_HEADER const *table = (EFI_ACPI_DESCRIPTION_HEADER const *)(UINTN)tableAddress;
+
+	if (table && table->Signature == signature)
+	    return table;
+    }
+
+    return NULL;
+}
+
+// Load the ECAM ranges from the MCFG table, returns false if there are none
+bool PciEcam_Init()
+{
+    EFI_ACPI_2_0_ROOT_SYSTEM_DESCRIPTION_POINTER const *rsdp = NULL;
+
+    ecamRangeCount = 0u;
+
+    if (EFI_ERROR(EfiGetSystemConfigurationTable(&gEfiAcpi20TableGuid, (VOID **)&rsdp)) || !rsdp)
+	if (EFI_ERROR(EfiGetSystemConfigurationTable(&gEfiAcpi10TableGuid, (VOID **)&rsdp)) || !rsdp)
+	    return false;
+
+    EFI_ACPI_DESCRIPTION_HEADER const *mcfg = findAcpiTable(rsdp, EFI_ACPI_2_0_MEMORY_MAPPED_CONFIGURATION_BASE_ADDRESS_TABLE_SIGNATURE);
+
+    if (!mcfg)
+	return false;
+
+    EFI_ACPI_MEMORY_MAPPED_ENHANCED_CONFIGURATION_SPACE_BASE_ADDRESS_ALLOCATION_STRUCTURE const *allocation =
+	(EFI_ACPI_MEMORY_MAPPED_ENHANCED_CONFIGURATION_SPACE_BASE_ADDRESS_ALLOCATION_STRUCTURE const *)
+	    ((UINT8 const *)mcfg + sizeof(EFI_ACPI_MEMORY_MAPPED_CONFIGURATION_BASE_ADDRESS_TABLE_HEADER));
+    UINTN allocationCount = (mcfg->Length - sizeof(EFI_ACPI_MEMORY_MAPPED_CONFIGURATION_BASE_ADDRESS_TABLE_HEADER)) / sizeof *allocation;
+
+    for (UINTN index = 0u; index < allocationCount && ecamRangeCount < ARRAY_SIZE(ecamRanges); index++, allocation++)
+	if (allocation->BaseAddress && allocation->StartBusNumber <= allocation->EndBusNumber)
+	{
+	    ecamRanges[ecamRangeCount].baseAddress = allocation->BaseAddress;
+	    ecamRanges[ecamRangeCount].segment = allocation->PciSegmentGroupNumber;
+	    ecamRanges[ecamRangeCount].startBus = allocation->StartBusNumber;
+	    ecamRanges[ecamRangeCount].endBus = allocation->EndBusNumber;
+
+	    DEBUG((DEBUG_INFO, "ReBarDXE: ECAM segment %u buses %02x-%02x at 0x%lx\n", allocation->PciSegmentGroupNumber, allocation->StartBusNumber, allocation->EndBusNumber, allocation->BaseAddress));
+
+	    ecamRangeCount++;
+	}
+
+    return !!ecamRangeCount;
+}
+
+bool PciEcam_LookupRange(uint_least16_t segment, PciEcamRange *range)
+{
+    for (unsigned index = 0u; index < ecamRangeCount; index++)
+	if (ecamRanges[index].segment == segment)
+	    return *range = ecamRanges[index], true;
+
+    return false;
+}
+
+// vim: ft=cpp
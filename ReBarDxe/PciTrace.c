@@ -0,0 +1,234 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <Uefi.h>
+#include <Guid/EventGroup.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "LocalAppConfig.h"
+#include "EfiVariable.h"
+#include "StatusVar.h"
+#include "PciConfig.h"
+#include "PciTrace.h"
+
+char const PciTrace_Name[] = "NvStrapsReBarPciTrace";
+
+#if NVSTRAPS_PCI_TRACE
+
+#define PCI_TRACE_REGISTER_COUNT    (0x1000u / sizeof(UINT32))	    // dwords in the extended config space
+
+typedef struct PciTrace_Counter
+{
+    uint_least32_t reads, writes;
+}
+    PciTrace_Counter;
+
+typedef struct PciTrace_Entry
+{
+    uint_least8_t site, width;
+    uint_least16_t segment, location, offset;
+    uint_least32_t value;
+}
+    PciTrace_Entry;
+
+enum
+{
+    PCI_TRACE_COUNTER_SIZE = DWORD_SIZE + DWORD_SIZE,
+    PCI_TRACE_ENTRY_SIZE = BYTE_SIZE + WORD_SIZE + WORD_SIZE + WORD_SIZE + BYTE_SIZE + DWORD_SIZE,
+    PCI_TRACE_VAR_MAX_SIZE = BYTE_SIZE + PciTrace_SiteCount * PCI_TRACE_COUNTER_SIZE
+	+ BYTE_SIZE + PCI_TRACE_MAX_DEVICES * (WORD_SIZE + WORD_SIZE + PCI_TRACE_COUNTER_SIZE)
+	+ WORD_SIZE + PCI_TRACE_REGISTER_COUNT * (WORD_SIZE + PCI_TRACE_COUNTER_SIZE)
+	+ DWORD_SIZE + WORD_SIZE + PCI_TRACE_MAX_ENTRIES * PCI_TRACE_ENTRY_SIZE
+};
+
+static PciTrace_Site currentSite = PciTrace_Other;
+static PciTrace_Counter siteCounters[PciTrace_SiteCount], registerCounters[PCI_TRACE_REGISTER_COUNT];
+
+static struct
+{
+    UINTN pciAddress;
+    PciTrace_Counter counter;
+}
+    deviceCounters[PCI_TRACE_MAX_DEVICES];
+
+static uint_least8_t deviceCount = 0u;
+
+static PciTrace_Entry traceEntries[PCI_TRACE_MAX_ENTRIES];
+static uint_least32_t accessCount = 0u;
+
+static EFI_EVENT readyToBootEvent = NULL;
+
+void PciTrace_SetSite(PciTrace_Site site)
+{
+    currentSite = site;
+}
+
+static PciTrace_Counter *PciTrace_DeviceCounter(UINTN pciAddress)
+{
+    pciAddress &= ~(UINTN)(PCI_ADDRESS_REGISTER_MASK | BYTE_BITMASK);
+
+    for (unsigned index = 0u; index < deviceCount; index++)
+	if (deviceCounters[index].pciAddress == pciAddress)
+	    return &deviceCounters[index].counter;
+
+    if (deviceCount >= ARRAY_SIZE(deviceCounters))
+	return NULL;
+
+    deviceCounters[deviceCount].pciAddress = pciAddress;
+
+    return &deviceCounters[deviceCount++].counter;
+}
+
+static inline void PciTrace_Count(PciTrace_Counter *counter, bool isWrite)
+{
+    if (counter)
+    {
+	if (isWrite)
+	    counter->writes++;
+	else
+	    counter->reads++;
+    }
+}
+
+void PciTrace_Access(UINTN pciAddress, INTN pos, uint_least8_t width, bool isWrite, UINT32 value)
+{
+    uint_least16_t offset = (uint_least16_t)((((pciAddress & PCI_ADDRESS_REGISTER_MASK) >> 32u) + pos) & 0x0FFFu);
+
+    PciTrace_Count(siteCounters + currentSite, isWrite);
+    PciTrace_Count(PciTrace_DeviceCounter(pciAddress), isWrite);
+    PciTrace_Count(registerCounters + offset / sizeof(UINT32), isWrite);
+
+    if (accessCount < ARRAY_SIZE(traceEntries))
+    {
+	uint_least8_t bus, dev, fun;
+
+	pciUnpackAddress(pciAddress, &bus, &dev, &fun);
+
+	traceEntries[accessCount] = (PciTrace_Entry)
+	{
+	    .site = currentSite,
+	    .width = width | (isWrite ? PCI_TRACE_WRITE_FLAG : 0u),
+	    .segment = pciAddressSegment(pciAddress),
+	    .location = pciPackLocation(bus, dev, fun),
+	    .offset = offset,
+	    .value = value
+	};
+    }
+
+    accessCount++;
+}
+
+static BYTE *PciTrace_PackCounter(BYTE *buffer, PciTrace_Counter const *counter)
+{
+    buffer = pack_DWORD(buffer, counter->reads);
+
+    return pack_DWORD(buffer, counter->writes);
+}
+
+static void PciTrace_LogSummary(void)
+{
+    static char const *const siteNames[PciTrace_SiteCount] =
+    {
+	"Other", "LocateDevice", "DeviceHeader", "ExtCapability", "ReBarCapability", "ReBarSize",
+	"BridgeRemap", "BridgeRestore", "DeviceRemap", "DeviceRestore"
+    };
+
+    DEBUG((DEBUG_INFO, "ReBarDXE: %u PCI config space accesses\n", accessCount));
+
+    for (unsigned site = 0u; site < PciTrace_SiteCount; site++)
+	if (siteCounters[site].reads || siteCounters[site].writes)
+	    DEBUG((DEBUG_INFO, "ReBarDXE:   %a: %u reads, %u writes\n", siteNames[site], siteCounters[site].reads, siteCounters[site].writes));
+
+    for (unsigned index = 0u; index < deviceCount; index++)
+    {
+	uint_least8_t bus, dev, fun;
+
+	pciUnpackAddress(deviceCounters[index].pciAddress, &bus, &dev, &fun);
+	DEBUG((DEBUG_INFO, "ReBarDXE:   %04x:%02x:%02x.%x: %u reads, %u writes\n", pciAddressSegment(deviceCounters[index].pciAddress), bus, dev, fun,
+	    deviceCounters[index].counter.reads, deviceCounters[index].counter.writes));
+    }
+
+    for (unsigned index = 0u; index < ARRAY_SIZE(registerCounters); index++)
+	if (registerCounters[index].reads || registerCounters[index].writes)
+	    DEBUG((DEBUG_INFO, "ReBarDXE:   register 0x%03x: %u reads, %u writes\n", index * (unsigned)sizeof(UINT32), registerCounters[index].reads, registerCounters[index].writes));
+}
+
+EFI_STATUS PciTrace_Flush(void)
+{
+    static BYTE buffer[PCI_TRACE_VAR_MAX_SIZE];
+    BYTE *bufferEnd = buffer;
+
+    PciTrace_LogSummary();
+
+    bufferEnd = pack_BYTE(bufferEnd, PciTrace_SiteCount);
+
+    for (unsigned site = 0u; site < PciTrace_SiteCount; site++)
+	bufferEnd = PciTrace_PackCounter(bufferEnd, siteCounters + site);
+
+    bufferEnd = pack_BYTE(bufferEnd, deviceCount);
+
+    for (unsigned index = 0u; index < deviceCount; index++)
+    {
+	uint_least8_t bus, dev, fun;
+
+	pciUnpackAddress(deviceCounters[index].pciAddress, &bus, &dev, &fun);
+	bufferEnd = pack_WORD(bufferEnd, pciAddressSegment(deviceCounters[index].pciAddress));
+	bufferEnd = pack_WORD(bufferEnd, pciPackLocation(bus, dev, fun));
+	bufferEnd = PciTrace_PackCounter(bufferEnd, &deviceCounters[index].counter);
+    }
+
+    BYTE *registerCount = bufferEnd;
+    uint_least16_t count = 0u;
+
+    bufferEnd += WORD_SIZE;
+
+    for (unsigned index = 0u; index < ARRAY_SIZE(registerCounters); index++)
+	if (registerCounters[index].reads || registerCounters[index].writes)
+	{
+	    bufferEnd = pack_WORD(bufferEnd, index * sizeof(UINT32));
+	    bufferEnd = PciTrace_PackCounter(bufferEnd, registerCounters + index);
+	    count++;
+	}
+
+    pack_WORD(registerCount, count);
+
+    count = accessCount < ARRAY_SIZE(traceEntries) ? accessCount : ARRAY_SIZE(traceEntries);
+    bufferEnd = pack_DWORD(bufferEnd, accessCount);
+    bufferEnd = pack_WORD(bufferEnd, count);
+
+    for (unsigned index = 0u; index < count; index++)
+    {
+	bufferEnd = pack_BYTE(bufferEnd, traceEntries[index].site);
+	bufferEnd = pack_WORD(bufferEnd, traceEntries[index].segment);
+	bufferEnd = pack_WORD(bufferEnd, traceEntries[index].location);
+	bufferEnd = pack_WORD(bufferEnd, traceEntries[index].offset);
+	bufferEnd = pack_BYTE(bufferEnd, traceEntries[index].width);
+	bufferEnd = pack_DWORD(bufferEnd, traceEntries[index].value);
+    }
+
+    return WriteEfiVariable(PciTrace_Name, buffer, (uint_least32_t)(bufferEnd - buffer), EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS);
+}
+
+static VOID EFIAPI PciTrace_ReadyToBoot(EFI_EVENT event, VOID *context)
+{
+    PciTrace_Flush();
+
+    gBS->CloseEvent(event);
+    readyToBootEvent = NULL;
+}
+
+void PciTrace_Init(void)
+{
+    if (!readyToBootEvent)
+    {
+	EFI_STATUS status = gBS->CreateEventEx(EVT_NOTIFY_SIGNAL, TPL_CALLBACK, &PciTrace_ReadyToBoot, NULL, &gEfiEventReadyToBootGuid, &readyToBootEvent);
+
+	if (EFI_ERROR(status))
+	{
+	    readyToBootEvent = NULL;
+	    SetEFIError(EFIError_CreateEvent, status);
+	}
+    }
+}
+
+#endif	    // NVSTRAPS_PCI_TRACE
@@ -0,0 +1,127 @@
+#if defined(UEFI_SOURCE) || defined(EFIAPI)
+# include <Uefi.h>
+# include <Guid/EventGroup.h>
+# include <Library/BaseLib.h>
+# include <Library/UefiBootServicesTableLib.h>
+#else
+# if defined(WINDOWS) || defined(_WINDOWS) || defined(_WIN32) || defined(_WIN64)
+#  if defined(_M_AMD64) && !defined(_AMD64_)
+#   define _AMD64_
+#  endif
+#  include <windef.h>
+# endif
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "LocalAppConfig.h"
+#include "EfiVariable.h"
+#include "StatusVar.h"
+#include "PhaseTimer.h"
+
+char const PhaseTimer_Name[] = "NvStrapsReBarTimers";
+
+#if defined(UEFI_SOURCE) || defined(EFIAPI)
+
+// The time stamp counter is calibrated once, against the boot services Stall(), when the timers are written.
+// The value is in microseconds, and can be overridden from the build options.
+#if !defined(NVSTRAPS_TIMER_CALIBRATION_TIME)
+# define NVSTRAPS_TIMER_CALIBRATION_TIME 1'000u		// 1 ms
+#endif
+
+static PhaseTimer_Record phaseTimers[PhaseTimer_Count];
+static EFI_EVENT readyToBootEvent = NULL;
+
+uint_least64_t PhaseTimer_Start(void)
+{
+    return AsmReadTsc();
+}
+
+void PhaseTimer_Stop(PhaseTimer_Phase phase, uint_least64_t startTime)
+{
+    uint_least64_t endTime = AsmReadTsc();
+
+    phaseTimers[phase].ticks += endTime - startTime;
+    phaseTimers[phase].calls++;
+}
+
+static uint_least64_t PhaseTimer_TicksPerSecond(void)
+{
+    uint_least64_t startTime = AsmReadTsc();
+
+    gBS->Stall(NVSTRAPS_TIMER_CALIBRATION_TIME);
+
+    return (AsmReadTsc() - startTime) * (UINT64_C(1'000'000) / NVSTRAPS_TIMER_CALIBRATION_TIME);
+}
+
+EFI_STATUS PhaseTimer_Flush(void)
+{
+    BYTE buffer[PHASE_TIMER_VAR_MAX_SIZE], *bufferEnd = buffer;
+
+    bufferEnd = pack_QWORD(bufferEnd, PhaseTimer_TicksPerSecond());
+    bufferEnd = pack_BYTE(bufferEnd, PhaseTimer_Count);
+
+    for (unsigned phase = 0u; phase < PhaseTimer_Count; phase++)
+    {
+	bufferEnd = pack_QWORD(bufferEnd, phaseTimers[phase].ticks);
+	bufferEnd = pack_DWORD(bufferEnd, phaseTimers[phase].calls);
+    }
+
+    return WriteEfiVariable(PhaseTimer_Name, buffer, (uint_least32_t)(bufferEnd - buffer), EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS);
+}
+
+static VOID EFIAPI PhaseTimer_ReadyToBoot(EFI_EVENT event, VOID *context)
+{
+    PhaseTimer_Flush();
+
+    gBS->CloseEvent(event);
+    readyToBootEvent = NULL;
+}
+
+void PhaseTimer_Init(void)
+{
+    if (!readyToBootEvent)
+    {
+	EFI_STATUS status = gBS->CreateEventEx(EVT_NOTIFY_SIGNAL, TPL_CALLBACK, &PhaseTimer_ReadyToBoot, NULL, &gEfiEventReadyToBootGuid, &readyToBootEvent);
+
+	if (EFI_ERROR(status))
+	{
+	    readyToBootEvent = NULL;
+	    SetEFIError(EFIError_CreateEvent, status);
+	}
+    }
+}
+
+#else
+
+unsigned ReadPhaseTimers(ERROR_CODE *errorCode, PhaseTimer_Record records[PhaseTimer_Count], uint_least64_t *ticksPerSecond)
+{
+    BYTE buffer[PHASE_TIMER_VAR_MAX_SIZE];
+    uint_least32_t size = sizeof buffer;
+
+    *ticksPerSecond = 0u;
+    *errorCode = ReadEfiVariable(PhaseTimer_Name, buffer, &size);
+
+    if (*errorCode || size < QWORD_SIZE + BYTE_SIZE)
+	return 0u;
+
+    unsigned count = unpack_BYTE(buffer + QWORD_SIZE);
+
+    if (count > PhaseTimer_Count || size != QWORD_SIZE + BYTE_SIZE + count * PHASE_TIMER_RECORD_SIZE)
+	return 0u;
+
+    BYTE const *recordBuffer = buffer + QWORD_SIZE + BYTE_SIZE;
+
+    for (unsigned phase = 0u; phase < count; phase++)
+    {
+	records[phase].ticks = unpack_QWORD(recordBuffer), recordBuffer += QWORD_SIZE;
+	records[phase].calls = unpack_DWORD(recordBuffer), recordBuffer += DWORD_SIZE;
+    }
+
+    *ticksPerSecond = unpack_QWORD(buffer);
+
+    return count;
+}
+
+#endif
@@ -13,6 +13,7 @@ SPDX-License-Identifier: MIT
 #include <IndustryStandard/PciExpress21.h>
 #include <Protocol/PciHostBridgeResourceAllocation.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/BaseMemoryLib.h>
 
 #if defined(_ASSERT)
 # undef _ASSERT
@@ -22,11 +23,16 @@ SPDX-License-Identifier: MIT
 
 #include "LocalAppConfig.h"
 #include "StatusVar.h"
+#include "PhaseTimer.h"
 #include "PciConfig.h"
+#include "PciTrace.h"
 #include "S3ResumeScript.h"
 #include "NvStrapsConfig.h"
 #include "SetupNvStraps.h"
 #include "CheckSetupVar.h"
+#include "DeviceRecord.h"
+#include "ReBarPlanner.h"
+#include "TopologyCache.h"
 
 #include "ReBar.h"
 
@@ -42,13 +48,51 @@ static uint_least16_t const
 // >0: maximum BAR size (2^x) set to value. 32 for unlimited, 64 for selected GPU only
 static uint_least8_t nPciBarSizeSelector = TARGET_PCI_BAR_SIZE_DISABLED;
 
-static EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *pciResAlloc;
+// Original PreprocessController method for each hooked host bridge
+#define MAX_HOST_BRIDGE_COUNT 16u
 
-static EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_PREPROCESS_CONTROLLER o_PreprocessController;
+static struct
+{
+    EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *pciResAlloc;
+    EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_PREPROCESS_CONTROLLER o_PreprocessController;
+}
+    hostBridges[MAX_HOST_BRIDGE_COUNT];
+
+static uint_least8_t hostBridgeCount = 0u;
 
 EFI_HANDLE reBarImageHandle = NULL;
 NvStrapsConfig *config = NULL;
 
+// Chipset function classes known to have no Resizable BAR (class register mask and value). Other classes are still
+// checked for the capability with a 1..32 selector
+static uint_least32_t const reBarClassDenyList[][2u] =
+{
+    { UINT32_C(0xFFFF'0000), UINT32_C(0x0600'0000) },	    // host bridges
+    { UINT32_C(0xFFFF'0000), UINT32_C(0x0601'0000) },	    // ISA / LPC bridges
+    { UINT32_C(0xFFFF'0000), UINT32_C(0x0106'0000) },	    // SATA controllers
+    { UINT32_C(0xFFFF'0000), UINT32_C(0x0403'0000) },	    // HD Audio controllers
+    { UINT32_C(0xFFFF'0000), UINT32_C(0x0C03'0000) },	    // USB controllers
+    { UINT32_C(0xFFFF'0000), UINT32_C(0x0C05'0000) }	    // SMBus controllers
+};
+
+// Turing companion functions (HD Audio, USB and USB Type-C UCSI) on the GPU bus
+static uint_least16_t const nvCompanionDeviceDenyList[] =
+{
+    0x10F7u, 0x10F8u, 0x10F9u, 0x10FAu, 0x1AEBu,
+    0x1AD6u, 0x1AD7u, 0x1AD8u, 0x1AD9u, 0x1ADAu, 0x1ADBu, 0x1AECu, 0x1AEDu
+};
+
+// Built once from the configuration, to reject most functions after the first header read
+static struct
+{
+    bool isReBarEnabled, isGpuConfigured;
+    uint_least8_t bridgeCount;
+    uint_least16_t bridgeLocation[ARRAY_SIZE(config->bridge)];
+    uint_least8_t bridgeSecondaryBus[ARRAY_SIZE(config->bridge)];
+    uint_least8_t bridgeRootBridge[ARRAY_SIZE(config->bridge)];	    // root bridge index once enumerated
+}
+    devicePrefilter;
+
 // find highest-order bit set and return the bit index
 static inline uint_least8_t highestBitIndex(uint_least32_t val)
 {
@@ -66,9 +110,9 @@ static inline uint_least8_t min(uint_least8_t val1, uint_least8_t val2)
     return val1 < val2 ? val1 : val2;
 }
 
-uint_least32_t getReBarSizeMask(UINTN pciAddress, uint_least16_t capabilityOffset, uint_least16_t vid, uint_least16_t did, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t barIndex)
+uint_least32_t getReBarSizeMask(UINTN pciAddress, PciReBarCapability const *reBar, uint_least16_t vid, uint_least16_t did, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t barIndex)
 {
-    uint_least32_t barSizeMask = pciRebarGetPossibleSizes(pciAddress, capabilityOffset, vid, did, barIndex);
+    uint_least32_t barSizeMask = pciRebarGetPossibleSizes(reBar, barIndex);
 
     /* Sapphire RX 5600 XT Pulse has an invalid cap dword for BAR 0 */
     if (vid == PCI_VENDOR_ID_AMD && did == PCI_DEVICE_Sapphire_RX_5600_XT_Pulse && barIndex == PCI_BAR_IDX0 && barSizeMask == 0x7000u)
@@ -80,7 +124,136 @@ uint_least32_t getReBarSizeMask(UINTN pciAddress, uint_least16_t capabilityOffse
     return barSizeMask;
 }
 
-static void reBarSetupDevice(EFI_HANDLE handle, EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_PCI_ADDRESS addrInfo)
+static uint_least8_t reBarSelectBarSize(DeviceRecord const *record, uint_least8_t barIndex)
+{
+    uint_least32_t nBarSizeMask = getReBarSizeMask(record->pciAddress, &record->reBar, record->vendorId, record->deviceId, record->subsysVenID, record->subsysDevID, barIndex);
+
+    if (nBarSizeMask)
+        for (uint_least8_t barSizeBitIndex = min(highestBitIndex(nBarSizeMask), nPciBarSizeSelector); barSizeBitIndex > 0u; barSizeBitIndex--)
+            if (nBarSizeMask & 1u << barSizeBitIndex)
+                return barSizeBitIndex;
+
+    return 0u;
+}
+
+static void reBarResizeBARs(DeviceRecord *record)
+{
+    for (uint_least8_t barIndex = 0u; barIndex < PCI_MAX_BAR; barIndex++)
+        if (record->barSizeBitIndex[barIndex])
+        {
+            bool resized = pciRebarSetSize(record->pciAddress, &record->reBar, barIndex, record->barSizeBitIndex[barIndex]);
+
+            if (record->isSelectedGpu && resized)
+                SetDeviceStatusVar(record->pciAddress, StatusVar_GpuReBarConfigured);
+        }
+}
+
+static void reBarBuildPrefilter(void)
+{
+    devicePrefilter.isReBarEnabled = TARGET_PCI_BAR_SIZE_MIN <= nPciBarSizeSelector && nPciBarSizeSelector <= TARGET_PCI_BAR_SIZE_MAX;
+    devicePrefilter.isGpuConfigured = NvStrapsConfig_IsGpuConfigured(config);
+    devicePrefilter.bridgeCount = 0u;
+
+    for (unsigned index = 0u; index < config->nBridgeConfig && index < ARRAY_SIZE(config->bridge); index++)
+    {
+	NvStraps_BridgeConfig const *bridge = config->bridge + index;
+
+	devicePrefilter.bridgeLocation[devicePrefilter.bridgeCount] = pciPackLocation(bridge->bridgeBus, bridge->bridgeDevice, bridge->bridgeFunction);
+	devicePrefilter.bridgeRootBridge[devicePrefilter.bridgeCount] = BYTE_BITMASK;
+	devicePrefilter.bridgeSecondaryBus[devicePrefilter.bridgeCount++] = bridge->bridgeSecondaryBus;
+    }
+}
+
+static bool reBarPrefilterDevice(UINTN pciAddress, uint_least16_t vid, uint_least16_t did, uint_least8_t headerType)
+{
+    if (vid == TARGET_GPU_VENDOR_ID)
+	for (unsigned index = 0u; index < ARRAY_SIZE(nvCompanionDeviceDenyList); index++)
+	    if (nvCompanionDeviceDenyList[index] == did)
+		return false;
+
+    uint_least8_t bus, dev, fun, rootBridgeIndex = pciAddressRootBridge(pciAddress);
+
+    pciUnpackAddress(pciAddress, &bus, &dev, &fun);
+
+    // Bus numbers in the configuration are for segment 0. A configured bridge is bound to the root bridge it is
+    // enumerated on, before the devices on its secondary bus
+    bool isConfigSegment = !pciAddressSegment(pciAddress);
+
+    if (pciIsPciBridge(headerType))
+    {
+	uint_least16_t pciLocation = pciPackLocation(bus, dev, fun);
+
+	for (unsigned index = 0u; isConfigSegment && index < devicePrefilter.bridgeCount; index++)
+	    if (devicePrefilter.bridgeLocation[index] == pciLocation
+		    && (devicePrefilter.bridgeRootBridge[index] == BYTE_BITMASK || devicePrefilter.bridgeRootBridge[index] == rootBridgeIndex))
+	    {
+		devicePrefilter.bridgeRootBridge[index] = rootBridgeIndex;
+		return true;
+	    }
+
+	return false;
+    }
+
+    for (unsigned index = 0u; isConfigSegment && index < devicePrefilter.bridgeCount; index++)
+	if (devicePrefilter.bridgeSecondaryBus[index] == bus && devicePrefilter.bridgeRootBridge[index] == rootBridgeIndex)
+	    return true;
+
+    uint_least32_t pciClass = pciDeviceClass(pciAddress);
+
+    if (vid == TARGET_GPU_VENDOR_ID && devicePrefilter.isGpuConfigured && (pciClass & UINT32_C(0xFF00'0000)) == (uint_least32_t)PCI_CLASS_DISPLAY << 3u * BYTE_BITSIZE)
+	return true;
+
+    if (!devicePrefilter.isReBarEnabled)
+	return false;
+
+    for (unsigned index = 0u; index < ARRAY_SIZE(reBarClassDenyList); index++)
+	if ((pciClass & reBarClassDenyList[index][0u]) == reBarClassDenyList[index][1u])
+	    return false;
+
+    return true;
+}
+
+// Root bridges with the GPU setup completed and the BAR sizes planned, on the second PreprocessController call
+static uint_least16_t plannedRootBridges = 0u;
+
+// Before the first device on a root bridge is resized again, wait for the GPUs with new STRAPS and plan the BAR sizes
+// for all the devices on the root bridge together. The sizes are selected again from the start, as the sizes restored
+// from the topology cache were already planned for the previous boot. The sizes are selected once for each root
+// bridge, also when they are not planned
+static void reBarPlanRootBridge(EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *pciResAlloc, EFI_HANDLE rootBridgeHandle, UINTN pciAddress)
+{
+    uint_least16_t rootBridgeBit = (uint_least16_t)(1u << pciAddressRootBridge(pciAddress));
+
+    if (plannedRootBridges & rootBridgeBit)
+        return;
+
+    plannedRootBridges |= rootBridgeBit;
+
+    for (uint_least16_t index = 0u; index < DeviceRecord_Count(); index++)
+    {
+        DeviceRecord *record = DeviceRecord_Get(index);
+
+        if (pciAddressRootBridge(record->pciAddress) != pciAddressRootBridge(pciAddress))
+            continue;
+
+        if (record->isSelectedGpu)
+        {
+            NvStraps_CompleteSetup(record->pciAddress, record->vendorId, record->deviceId, nPciBarSizeSelector);
+
+            if (devicePrefilter.isReBarEnabled && record->reBar.bar[PCI_BAR_IDX1].entryOffset)
+                pciRebarReadPossibleSizes(record->pciAddress, &record->reBar, PCI_BAR_IDX1);
+        }
+
+        if (devicePrefilter.isReBarEnabled && record->reBar.barCount)
+            for (uint_least8_t barIndex = 0u; barIndex < PCI_MAX_BAR; barIndex++)
+                record->barSizeBitIndex[barIndex] = reBarSelectBarSize(record, barIndex);
+    }
+
+    if (devicePrefilter.isReBarEnabled)
+        ReBarPlanner_Plan(pciResAlloc, rootBridgeHandle, pciAddress);
+}
+
+static void reBarSetupDevice(EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *pciResAlloc, EFI_HANDLE handle, EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_PCI_ADDRESS addrInfo, EFI_PCI_CONTROLLER_RESOURCE_ALLOCATION_PHASE phase)
 {
     uint_least16_t vid, did;
     uint_least8_t headerType;
@@ -89,37 +262,76 @@ static void reBarSetupDevice(EFI_HANDLE handle, EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_
     if (vid == WORD_BITMASK)
         return;
 
+    if (!reBarPrefilterDevice(pciAddress, vid, did, headerType))
+    {
+        // The prefetchable BARs of the function still take space in the bridge window planned for the bus
+        if (devicePrefilter.isReBarEnabled && phase == EfiPciBeforeChildBusEnumeration && !pciIsPciBridge(headerType))
+            ReBarPlanner_AddOtherBars(pciAddress);
+
+        return;
+    }
+
+    bool isReBarEnabled = devicePrefilter.isReBarEnabled;
+    DeviceRecord *record = DeviceRecord_Find(pciAddress);
+
+    // On the second call only re-apply the BAR sizes planned after the first call. Only GPUs with new STRAPS can report new sizes
+    if (phase != EfiPciBeforeChildBusEnumeration && record && record->vendorId == vid && record->deviceId == did)
+    {
+        reBarPlanRootBridge(pciResAlloc, handle, pciAddress);
+
+        reBarResizeBARs(record);
+
+        return;
+    }
+
     DEBUG((DEBUG_INFO, "ReBarDXE: Device vid:%x did:%x\n", vid, did));
 
     NvStraps_EnumDevice(pciAddress, vid, did, headerType);
 
-    uint_least16_t subsysVenID = WORD_BITMASK, subsysDevID = WORD_BITMASK;
-    bool isSelectedGpu = NvStraps_CheckDevice(pciAddress, vid, did, &subsysVenID, &subsysDevID);
+    DeviceRecord localRecord;
 
-    if (isSelectedGpu)
-        NvStraps_Setup(pciAddress, vid, did, subsysVenID, subsysDevID, nPciBarSizeSelector);
-
-    if (TARGET_PCI_BAR_SIZE_MIN <= nPciBarSizeSelector && nPciBarSizeSelector <= TARGET_PCI_BAR_SIZE_MAX)
+    if (!(record = DeviceRecord_Add(pciAddress)))
     {
-        uint_least16_t const capOffset = pciFindExtCapability(pciAddress, PCI_EXPRESS_EXTENDED_CAPABILITY_RESIZABLE_BAR_ID);
+        SetMem(&localRecord, sizeof localRecord, 0u);
+        record = &localRecord;
+        record->pciAddress = pciAddress;
+    }
 
-        if (capOffset)
-            for (uint_least8_t barIndex = 0u; barIndex < PCI_MAX_BAR; barIndex++)
-            {
-                uint_least32_t nBarSizeMask = getReBarSizeMask(pciAddress, capOffset, vid, did, subsysVenID, subsysDevID, barIndex);
+    record->vendorId = vid;
+    record->deviceId = did;
+    record->subsysVenID = WORD_BITMASK;
+    record->subsysDevID = WORD_BITMASK;
+    record->isSelectedGpu = NvStraps_CheckDevice(pciAddress, vid, did, &record->subsysVenID, &record->subsysDevID);
+    record->isBridge = pciIsPciBridge(headerType);
 
-                if (nBarSizeMask)
-                    for (uint_least8_t barSizeBitIndex = min(highestBitIndex(nBarSizeMask), nPciBarSizeSelector); barSizeBitIndex > 0u; barSizeBitIndex--)
-                        if (nBarSizeMask & 1u << barSizeBitIndex)
-                        {
-                            bool resized = pciRebarSetSize(pciAddress, capOffset, barIndex, barSizeBitIndex);
+    // Program the STRAPS for all GPUs in the first phase, and wait for them once, in the second phase
+    if (record->isSelectedGpu)
+    {
+        if (phase == EfiPciBeforeChildBusEnumeration)
+            NvStraps_Setup(pciAddress, vid, did, record->subsysVenID, record->subsysDevID);
+        else
+            NvStraps_CompleteSetup(pciAddress, vid, did, nPciBarSizeSelector);
+    }
 
-                            if (isSelectedGpu && resized)
-                                SetDeviceStatusVar(pciAddress, StatusVar_GpuReBarConfigured);
+    if (isReBarEnabled)
+    {
+        // Devices unchanged since the last boot get the sizes applied then, without the capability search
+        if (!TopologyCache_Restore(record) && pciRebarParseCapability(pciAddress, pciFindExtCapability(pciAddress, PCI_EXPRESS_EXTENDED_CAPABILITY_RESIZABLE_BAR_ID), &record->reBar))
+        {
+            for (uint_least8_t barIndex = 0u; barIndex < PCI_MAX_BAR; barIndex++)
+                record->barSizeBitIndex[barIndex] = reBarSelectBarSize(record, barIndex);
 
-                            break;
-                        }
+            if (!record->isBridge)
+            {
+                record->isDisplay = (pciDeviceClass(pciAddress) & UINT32_C(0xFF00'0000)) == (uint_least32_t)PCI_CLASS_DISPLAY << 3u * BYTE_BITSIZE;
+                record->prefetchableBarMask = pciDevicePrefetchableBARs(pciAddress);
             }
+        }
+        else
+            if (!record->reBar.barCount && !record->isBridge)
+                ReBarPlanner_AddOtherBars(pciAddress);
+
+        reBarResizeBARs(record);
     }
 }
 
@@ -131,6 +343,15 @@ static EFI_STATUS EFIAPI PreprocessControllerOverride
         IN  EFI_PCI_CONTROLLER_RESOURCE_ALLOCATION_PHASE      Phase
     )
 {
+    EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL_PREPROCESS_CONTROLLER o_PreprocessController = NULL;
+
+    for (unsigned index = 0u; index < hostBridgeCount && !o_PreprocessController; index++)
+        if (hostBridges[index].pciResAlloc == This)
+            o_PreprocessController = hostBridges[index].o_PreprocessController;
+
+    if (!o_PreprocessController)
+        return EFI_INVALID_PARAMETER;
+
     // call the original method
     EFI_STATUS status = o_PreprocessController(This, RootBridgeHandle, PciAddress, Phase);
 
@@ -138,7 +359,12 @@ static EFI_STATUS EFIAPI PreprocessControllerOverride
 
     // EDK2 PciBusDxe setups Resizable BAR twice so we will do same
     if (Phase <= EfiPciBeforeResourceCollection)
-        reBarSetupDevice(RootBridgeHandle, PciAddress);
+    {
+        uint_least64_t startTime = PhaseTimer_Start();
+
+        reBarSetupDevice(This, RootBridgeHandle, PciAddress, Phase);
+        PhaseTimer_Stop(PhaseTimer_PreprocessController, startTime);
+    }
 
     return status;
 }
@@ -162,27 +388,38 @@ static void pciHostBridgeResourceAllocationProtocolHook()
         goto free;
     }
 
-    status = gBS->OpenProtocol
-	(
-	    handleBuffer[0],
-	    &gEfiPciHostBridgeResourceAllocationProtocolGuid,
-	    (VOID **)&pciResAlloc,
-	    gImageHandle,
-	    NULL,
-	    EFI_OPEN_PROTOCOL_GET_PROTOCOL
-	);
-
-    if (EFI_ERROR(status))
+    for (UINTN handleIndex = 0u; handleIndex < handleCount && hostBridgeCount < ARRAY_SIZE(hostBridges); handleIndex++)
     {
-        SetEFIError(EFIError_LoadBridgeProtocol, status);
-        goto free;
-    }
+        EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *pciResAlloc = NULL;
+
+        status = gBS->OpenProtocol
+            (
+                handleBuffer[handleIndex],
+                &gEfiPciHostBridgeResourceAllocationProtocolGuid,
+                (VOID **)&pciResAlloc,
+                gImageHandle,
+                NULL,
+                EFI_OPEN_PROTOCOL_GET_PROTOCOL
+            );
+
+        if (EFI_ERROR(status))
+        {
+            SetEFIError(EFIError_LoadBridgeProtocol, status);
+            continue;
+        }
+
+        if (pciResAlloc->PreprocessController == &PreprocessControllerOverride)
+            continue;
 
-    DEBUG((DEBUG_INFO, "ReBarDXE: Hooking EfiPciHostBridgeResourceAllocationProtocol->PreprocessController\n"));
+        DEBUG((DEBUG_INFO, "ReBarDXE: Hooking EfiPciHostBridgeResourceAllocationProtocol->PreprocessController for host bridge %u\n", (unsigned)handleIndex));
 
-    // Hook PreprocessController
-    o_PreprocessController = pciResAlloc->PreprocessController;
-    pciResAlloc->PreprocessController = &PreprocessControllerOverride;
+        // Hook PreprocessController
+        hostBridges[hostBridgeCount].pciResAlloc = pciResAlloc;
+        hostBridges[hostBridgeCount].o_PreprocessController = pciResAlloc->PreprocessController;
+        hostBridgeCount++;
+
+        pciResAlloc->PreprocessController = &PreprocessControllerOverride;
+    }
 
 free:
     if (handleBuffer)
@@ -194,19 +431,28 @@ static bool IsCMOSClear()
     // Detect CMOS reset by checking if year before BUILD_YEAR
     EFI_STATUS status;
     EFI_TIME time = { .Year = 0u };
+    uint_least64_t startTime = PhaseTimer_Start();
 
     if (EFI_ERROR((status = gRT->GetTime(&time, NULL))))
         SetEFIError(EFIError_CMOSTime, status);
 
+    PhaseTimer_Stop(PhaseTimer_CMOSCheck, startTime);
+
     return time.Year < BUILD_YEAR;
 }
 
 EFI_STATUS EFIAPI rebarInit(IN EFI_HANDLE imageHandle, IN EFI_SYSTEM_TABLE *systemTable)
 {
+    uint_least64_t initTime = PhaseTimer_Start();
+
     DEBUG((DEBUG_INFO, "ReBarDXE: Loaded\n"));
 
     reBarImageHandle = imageHandle;
     config = GetNvStrapsConfig(false, NULL);    // attempts to overflow EFI variable data should result in EFI_BUFFER_TOO_SMALL
+    PhaseTimer_Stop(PhaseTimer_LoadConfig, initTime);
+    StatusVar_Init(NvStrapsConfig_FlushStatusImmediately(config));
+    PhaseTimer_Init();
+    PCI_TRACE_INIT();
     nPciBarSizeSelector = NvStrapsConfig_TargetPciBarSizeSelector(config);
 
     if (nPciBarSizeSelector == TARGET_PCI_BAR_SIZE_DISABLED && NvStrapsConfig_IsGpuConfigured(config))
@@ -230,6 +476,7 @@ EFI_STATUS EFIAPI rebarInit(IN EFI_HANDLE imageHandle, IN EFI_SYSTEM_TABLE *syst
 		SaveNvStrapsConfig(NULL);
 
             SetStatusVar(StatusVar_Cleared);
+            PhaseTimer_Stop(PhaseTimer_DriverInit, initTime);
 
             return EFI_SUCCESS;
         }
@@ -237,11 +484,20 @@ EFI_STATUS EFIAPI rebarInit(IN EFI_HANDLE imageHandle, IN EFI_SYSTEM_TABLE *syst
         SetStatusVar(StatusVar_Configured);
 
 	S3ResumeScript_Init(NvStrapsConfig_IsGpuConfigured(config));
+	pciConfigUseEcam(NvStrapsConfig_UsePciECAM(config));
+	reBarBuildPrefilter();
+	TopologyCache_Init(devicePrefilter.isReBarEnabled);
+
+	uint_least64_t startTime = PhaseTimer_Start();
+
         pciHostBridgeResourceAllocationProtocolHook();          // For overriding PciHostBridgeResourceAllocationProtocol
+	PhaseTimer_Stop(PhaseTimer_HookInstall, startTime);
     }
     else
         SetStatusVar(StatusVar_Unconfigured);
 
+    PhaseTimer_Stop(PhaseTimer_DriverInit, initTime);
+
     return EFI_SUCCESS;
 }
 
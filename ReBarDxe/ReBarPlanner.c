@@ -0,0 +1,299 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/DxeServicesTableLib.h>
+#include <IndustryStandard/Pci22.h>
+#include <Protocol/PciHostBridgeResourceAllocation.h>
+
+#if defined(_ASSERT)
+# undef _ASSERT
+#endif
+
+#include <Library/DebugLib.h>
+
+#include "LocalAppConfig.h"
+#include "StatusVar.h"
+#include "PciConfig.h"
+#include "DeviceRecord.h"
+#include "ReBar.h"
+#include "ReBarPlanner.h"
+
+// The host bridge protocol only reports the root bridge resources after they are allocated, so the aperture is taken
+// from the free MMIO space that the host bridge driver adds to the GCD for its root bridges: the largest free range
+// above 4 GiB if the root bridge decodes 64-bit MMIO, or else the largest free range below 4 GiB. The free ranges can
+// only be attributed to a root bridge when there is a single one, so with more root bridges the sizes are not planned.
+//
+// Only the 64-bit prefetchable BARs are planned. Each bus gets one bridge window, that is aligned to the largest BAR
+// on the bus and also holds the prefetchable BARs that are not resized. The windows are placed in the aperture from
+// the largest alignment down, and while they do not fit the largest BAR is reduced to the next supported size. The
+// functions without a device record are noted by bus, with their prefetchable BARs.
+#define REBAR_PLAN_MAX_BARS	    64u
+#define REBAR_PLAN_MAX_WINDOWS	    32u
+#define REBAR_PLAN_MAX_ROOT_BRIDGES 16u
+
+// Other BARs are reduced first, down to 1/16 of the largest GPU BAR
+static unsigned const GPU_SIZE_WEIGHT = 4u;
+
+typedef struct ReBarPlanner_Bar
+{
+    uint_least16_t recordIndex;
+    uint_least8_t barIndex, windowIndex;
+    uint_least32_t sizeMask;		    // supported sizes up to the size selected for the device
+}
+    ReBarPlanner_Bar;
+
+typedef struct ReBarPlanner_Window
+{
+    uint_least8_t bus;
+    bool hasOtherBars;
+    uint_least64_t size, alignment;
+}
+    ReBarPlanner_Window;
+
+static ReBarPlanner_Bar planBars[REBAR_PLAN_MAX_BARS];
+static ReBarPlanner_Window planWindows[REBAR_PLAN_MAX_WINDOWS];
+static uint_least8_t planBarCount = 0u, planWindowCount = 0u;
+static uint_least32_t otherBarBuses[REBAR_PLAN_MAX_ROOT_BRIDGES][(BYTE_BITMASK + 1u) / (sizeof(uint_least32_t) * BYTE_BITSIZE)];
+
+static bool ReBarPlanner_FindAperture(EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *pciResAlloc, EFI_HANDLE rootBridgeHandle, EFI_PHYSICAL_ADDRESS *apertureBase, uint_least64_t *apertureLength)
+{
+    UINT64 attributes = 0u;
+    EFI_STATUS status = pciResAlloc->GetAllocAttributes(pciResAlloc, rootBridgeHandle, &attributes);
+
+    if (EFI_ERROR(status))
+	return SetEFIError(EFIError_HostBridgeAttributes, status), false;
+
+    bool isMem64Decode = !!(attributes & EFI_PCI_HOST_BRIDGE_MEM64_DECODE);
+    EFI_PHYSICAL_ADDRESS rangeMin = isMem64Decode ? BASE_4GB : 0u, rangeMax = isMem64Decode ? MAX_UINT64 : BASE_4GB - 1u;
+    UINTN descriptorCount = 0u;
+    EFI_GCD_MEMORY_SPACE_DESCRIPTOR *memorySpaceMap = NULL;
+
+    if (EFI_ERROR((status = gDS->GetMemorySpaceMap(&descriptorCount, &memorySpaceMap))))
+	return SetEFIError(EFIError_GetMemorySpaceMap, status), false;
+
+    EFI_PHYSICAL_ADDRESS rangeBase = 0u;
+    uint_least64_t rangeLength = 0u;
+
+    *apertureLength = 0u;
+
+    // The map is sorted by address, adjacent free ranges are merged
+    for (UINTN index = 0u; index < descriptorCount; index++)
+    {
+	EFI_GCD_MEMORY_SPACE_DESCRIPTOR const *descriptor = memorySpaceMap + index;
+	EFI_PHYSICAL_ADDRESS base = descriptor->BaseAddress, top = descriptor->BaseAddress + descriptor->Length - 1u;
+
+	if (descriptor->GcdMemoryType != EfiGcdMemoryTypeMemoryMappedIo || descriptor->ImageHandle || !descriptor->Length || top < rangeMin || base > rangeMax)
+	{
+	    rangeLength = 0u;
+	    continue;
+	}
+
+	base = base < rangeMin ? rangeMin : base;
+	top = top > rangeMax ? rangeMax : top;
+
+	if (!rangeLength || rangeBase + rangeLength != base)
+	    rangeBase = base, rangeLength = 0u;
+
+	rangeLength += top - base + 1u;
+
+	if (rangeLength > *apertureLength)
+	    *apertureBase = rangeBase, *apertureLength = rangeLength;
+    }
+
+    FreePool(memorySpaceMap);
+
+    return !!*apertureLength;
+}
+
+static ReBarPlanner_Window *ReBarPlanner_Window_Find(uint_least8_t bus)
+{
+    for (ReBarPlanner_Window *window = planWindows; window < planWindows + planWindowCount; window++)
+	if (window->bus == bus)
+	    return window;
+
+    if (planWindowCount >= ARRAY_SIZE(planWindows))
+	return NULL;
+
+    planWindows[planWindowCount] = (ReBarPlanner_Window){ .bus = bus, .hasOtherBars = false, .size = 0u, .alignment = 0u };
+
+    return planWindows + planWindowCount++;
+}
+
+static bool ReBarPlanner_IsOtherBarBus(uint_least8_t rootBridgeIndex, uint_least8_t bus)
+{
+    return !!(otherBarBuses[rootBridgeIndex][bus / 32u] & UINT32_C(1) << bus % 32u);
+}
+
+// Returns false if the devices on the root bridge have more BARs or buses than the plan can hold
+static bool ReBarPlanner_Collect(uint_least8_t rootBridgeIndex)
+{
+    planBarCount = 0u;
+    planWindowCount = 0u;
+
+    for (uint_least16_t recordIndex = 0u; recordIndex < DeviceRecord_Count(); recordIndex++)
+    {
+	DeviceRecord const *record = DeviceRecord_Get(recordIndex);
+
+	if (pciAddressRootBridge(record->pciAddress) != rootBridgeIndex || !record->prefetchableBarMask)
+	    continue;
+
+	uint_least8_t bus, dev, fun;
+
+	pciUnpackAddress(record->pciAddress, &bus, &dev, &fun);
+
+	ReBarPlanner_Window *window = ReBarPlanner_Window_Find(bus);
+
+	if (!window)
+	    return false;
+
+	window->hasOtherBars = window->hasOtherBars || ReBarPlanner_IsOtherBarBus(rootBridgeIndex, bus);
+
+	for (uint_least8_t barIndex = 0u; barIndex < PCI_MAX_BAR; barIndex++)
+	    if (record->prefetchableBarMask & 1u << barIndex)
+	    {
+		uint_least8_t barSizeBitIndex = record->barSizeBitIndex[barIndex];
+
+		if (barSizeBitIndex && planBarCount >= ARRAY_SIZE(planBars))
+		    return false;
+
+		if (barSizeBitIndex)
+		    planBars[planBarCount++] = (ReBarPlanner_Bar)
+		    {
+			.recordIndex = recordIndex,
+			.barIndex = barIndex,
+			.windowIndex = (uint_least8_t)(window - planWindows),
+			.sizeMask = getReBarSizeMask(record->pciAddress, &record->reBar, record->vendorId, record->deviceId, record->subsysVenID, record->subsysDevID, barIndex)
+			    & ((UINT32_C(2) << barSizeBitIndex) - 1u) & ~UINT32_C(1)
+		    };
+		else
+		    window->hasOtherBars = true;
+	    }
+    }
+
+    return true;
+}
+
+static bool ReBarPlanner_Fits(EFI_PHYSICAL_ADDRESS apertureBase, uint_least64_t apertureLength)
+{
+    for (ReBarPlanner_Window *window = planWindows; window < planWindows + planWindowCount; window++)
+	window->size = 0u, window->alignment = 0u;
+
+    for (ReBarPlanner_Bar const *bar = planBars; bar < planBars + planBarCount; bar++)
+    {
+	ReBarPlanner_Window *window = planWindows + bar->windowIndex;
+	uint_least64_t barSize = LShiftU64(SIZE_1MB, DeviceRecord_Get(bar->recordIndex)->barSizeBitIndex[bar->barIndex]);
+
+	window->size += barSize;
+
+	if (barSize > window->alignment)
+	    window->alignment = barSize;
+    }
+
+    // The other prefetchable BARs have unknown sizes, that still take the window to the next alignment boundary
+    for (ReBarPlanner_Window *window = planWindows; window < planWindows + planWindowCount; window++)
+	if (window->alignment)
+	    window->size = (window->size + (window->hasOtherBars ? 1u : 0u) + window->alignment - 1u) & ~(window->alignment - 1u);
+
+    EFI_PHYSICAL_ADDRESS address = apertureBase, apertureEnd = apertureBase + apertureLength;
+    uint_least32_t placedWindows = 0u;
+
+    for (unsigned count = 0u; count < planWindowCount; count++)
+    {
+	ReBarPlanner_Window const *nextWindow = NULL;
+
+	for (unsigned index = 0u; index < planWindowCount; index++)
+	    if (!(placedWindows & UINT32_C(1) << index) && (!nextWindow || planWindows[index].alignment > nextWindow->alignment))
+		nextWindow = planWindows + index;
+
+	placedWindows |= UINT32_C(1) << (nextWindow - planWindows);
+
+	if (!nextWindow->alignment)
+	    continue;
+
+	address = ((address + nextWindow->alignment - 1u) & ~(nextWindow->alignment - 1u)) + nextWindow->size;
+
+	if (address > apertureEnd)
+	    return false;
+    }
+
+    return true;
+}
+
+// Reduce the BAR with the largest weighted size, that has a smaller size supported
+static bool ReBarPlanner_ReduceBar(void)
+{
+    DeviceRecord *selectedRecord = NULL;
+    uint_least8_t selectedBarIndex = 0u;
+    uint_least32_t selectedSizes = 0u;
+    unsigned selectedWeight = 0u;
+
+    for (ReBarPlanner_Bar const *bar = planBars; bar < planBars + planBarCount; bar++)
+    {
+	DeviceRecord *record = DeviceRecord_Get(bar->recordIndex);
+	uint_least8_t barSizeBitIndex = record->barSizeBitIndex[bar->barIndex];
+	uint_least32_t smallerSizes = bar->sizeMask & ((UINT32_C(1) << barSizeBitIndex) - 1u);
+
+	// Other BARs go first for the same weight
+	unsigned weight = (barSizeBitIndex + (record->isDisplay ? 0u : GPU_SIZE_WEIGHT)) * 2u + (record->isDisplay ? 0u : 1u);
+
+	if (smallerSizes && (!selectedRecord || weight > selectedWeight))
+	{
+	    selectedRecord = record;
+	    selectedBarIndex = bar->barIndex;
+	    selectedSizes = smallerSizes;
+	    selectedWeight = weight;
+	}
+    }
+
+    if (!selectedRecord)
+	return false;
+
+    selectedRecord->barSizeBitIndex[selectedBarIndex] = (uint_least8_t)HighBitSet64(selectedSizes);
+
+    return true;
+}
+
+void ReBarPlanner_AddOtherBars(UINTN pciAddress)
+{
+    uint_least8_t bus, dev, fun;
+
+    pciUnpackAddress(pciAddress, &bus, &dev, &fun);
+
+    if (pciDevicePrefetchableBARs(pciAddress))
+	otherBarBuses[pciAddressRootBridge(pciAddress)][bus / 32u] |= UINT32_C(1) << bus % 32u;
+}
+
+void ReBarPlanner_Plan(EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *pciResAlloc, EFI_HANDLE rootBridgeHandle, UINTN pciAddress)
+{
+    uint_least8_t rootBridgeIndex = pciAddressRootBridge(pciAddress);
+    EFI_PHYSICAL_ADDRESS apertureBase = 0u;
+    uint_least64_t apertureLength = 0u;
+
+    if (pciSystemRootBridgeCount() != 1u)
+    {
+	DEBUG((DEBUG_INFO, "ReBarDXE: %u root bridges, BAR sizes are not planned for the MMIO apertures\n", (unsigned)pciSystemRootBridgeCount()));
+	return;
+    }
+
+    if (!ReBarPlanner_Collect(rootBridgeIndex))
+    {
+	DEBUG((DEBUG_INFO, "ReBarDXE: More than %u resizable BARs or %u buses with prefetchable BARs, BAR sizes are not planned\n", REBAR_PLAN_MAX_BARS, REBAR_PLAN_MAX_WINDOWS));
+	SetEFIError(EFIError_ReBarPlanLimit, EFI_OUT_OF_RESOURCES);
+	return;
+    }
+
+    if (!planBarCount || !ReBarPlanner_FindAperture(pciResAlloc, rootBridgeHandle, &apertureBase, &apertureLength))
+	return;
+
+    unsigned reduceCount = 0u;
+    bool isFit;
+
+    while (!(isFit = ReBarPlanner_Fits(apertureBase, apertureLength)) && ReBarPlanner_ReduceBar())
+	reduceCount++;
+
+    DEBUG((DEBUG_INFO, "ReBarDXE: %u resizable BARs on %u buses for the MMIO aperture at 0x%lx, size 0x%lx, %u size reductions%a\n",
+	planBarCount, planWindowCount, apertureBase, apertureLength, reduceCount, isFit ? "" : ", smallest sizes do not fit"));
+}
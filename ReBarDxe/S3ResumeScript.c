@@ -14,6 +14,189 @@
 
 EFI_S3_SAVE_STATE_PROTOCOL *S3SaveState = NULL;
 
+// Resume actions are collected during DXE and written to the boot script once, at EndOfDxe, with the read-modify-write
+// actions on the same register merged and the repeated actions dropped. Actions recorded after EndOfDxe, or when the
+// table is full, are written right away.
+#define S3_RESUME_SCRIPT_MAX_ENTRIES	128u
+
+typedef struct S3ResumeScript_Entry
+{
+    bool isPciConfig;
+    uint_least16_t segment;
+    UINT64 address;				// memory address, or the EFI_PCI_ADDRESS for config space
+    uint_least32_t data, dataMask;		// a plain write has no mask bits
+}
+    S3ResumeScript_Entry;
+
+static S3ResumeScript_Entry scriptEntries[S3_RESUME_SCRIPT_MAX_ENTRIES];
+static uint_least8_t scriptEntryCount = 0u;
+static bool writeImmediately = false;
+static EFI_EVENT endOfDxeEvent = NULL, readyToBootEvent = NULL;
+
+static EFI_STATUS S3ResumeScript_Write(S3ResumeScript_Entry const *entry)
+{
+    UINT32 data = entry->data, dataMask = entry->dataMask;
+
+    if (!entry->isPciConfig)
+	return dataMask ?
+	    S3SaveState->Write
+		(
+		    S3SaveState,
+		    (UINT16)EFI_BOOT_SCRIPT_MEM_READ_WRITE_OPCODE,
+		    (EFI_BOOT_SCRIPT_WIDTH)EfiBootScriptWidthUint32,
+		    entry->address,
+		    (void *)&data,
+		    (void *)&dataMask
+		)
+	  : S3SaveState->Write
+		(
+		    S3SaveState,
+		    (UINT16)EFI_BOOT_SCRIPT_MEM_WRITE_OPCODE,
+		    (EFI_BOOT_SCRIPT_WIDTH)EfiBootScriptWidthUint32,
+		    entry->address,
+		    (UINTN)1u,
+		    (void *)&data
+		);
+
+    // Devices in PCI segments other than 0 need the PCI_CONFIG2 opcodes, that include the segment number
+    if (entry->segment)
+	return dataMask ?
+	    S3SaveState->Write
+		(
+		    S3SaveState,
+		    (UINT16)EFI_BOOT_SCRIPT_PCI_CONFIG2_READ_WRITE_OPCODE,
+		    (EFI_BOOT_SCRIPT_WIDTH)EfiBootScriptWidthUint32,
+		    (UINT16)entry->segment,
+		    entry->address,
+		    (void *)&data,
+		    (void *)&dataMask
+		)
+	  : S3SaveState->Write
+		(
+		    S3SaveState,
+		    (UINT16)EFI_BOOT_SCRIPT_PCI_CONFIG2_WRITE_OPCODE,
+		    (EFI_BOOT_SCRIPT_WIDTH)EfiBootScriptWidthUint32,
+		    (UINT16)entry->segment,
+		    entry->address,
+		    (UINTN)1u,
+		    (void *)&data
+		);
+
+    return dataMask ?
+	S3SaveState->Write
+	    (
+		S3SaveState,
+		(UINT16)EFI_BOOT_SCRIPT_PCI_CONFIG_READ_WRITE_OPCODE,
+		(EFI_BOOT_SCRIPT_WIDTH)EfiBootScriptWidthUint32,
+		entry->address,
+		(void *)&data,
+		(void *)&dataMask
+	    )
+      : S3SaveState->Write
+	    (
+		S3SaveState,
+		(UINT16)EFI_BOOT_SCRIPT_PCI_CONFIG_WRITE_OPCODE,
+		(EFI_BOOT_SCRIPT_WIDTH)EfiBootScriptWidthUint32,
+		entry->address,
+		(UINTN)1u,
+		(void *)&data
+	    );
+}
+
+static inline bool S3ResumeScript_IsSameTarget(S3ResumeScript_Entry const *entry, S3ResumeScript_Entry const *newEntry)
+{
+    return entry->isPciConfig == newEntry->isPciConfig && entry->segment == newEntry->segment && entry->address == newEntry->address;
+}
+
+// Applying (data1, mask1) and then (data2, mask2) to a register gives: value & mask1 & mask2 | data1 & mask2 | data2
+//
+// Config space entries can move ahead of other config space entries, but not ahead of MMIO entries, that expect the
+// bridge windows and BARs as programmed before them. MMIO entries can not move ahead of config space entries, that
+// can change the device decoding the address.
+static EFI_STATUS S3ResumeScript_Record(S3ResumeScript_Entry const *newEntry)
+{
+    if (!S3SaveState)
+	return EFI_SUCCESS;
+
+    if (writeImmediately)
+	return S3ResumeScript_Write(newEntry);
+
+    bool isMemoryAccessAfter = false, isConfigAccessAfter = false;
+
+    for (S3ResumeScript_Entry *entry = scriptEntries + scriptEntryCount; entry-- > scriptEntries; )
+    {
+	if (S3ResumeScript_IsSameTarget(entry, newEntry))
+	{
+	    uint_least32_t
+		dataMask = entry->dataMask & newEntry->dataMask,
+		data = (entry->data & newEntry->dataMask) | newEntry->data;
+
+	    // The config register already gets the same value
+	    if (newEntry->isPciConfig && dataMask == entry->dataMask && data == entry->data)
+		return EFI_SUCCESS;
+
+	    if (newEntry->isPciConfig ? isMemoryAccessAfter : isConfigAccessAfter)
+		break;
+
+	    entry->dataMask = dataMask;
+	    entry->data = data;
+
+	    return EFI_SUCCESS;
+	}
+
+	if (entry->isPciConfig)
+	    isConfigAccessAfter = true;
+	else
+	    isMemoryAccessAfter = true;
+    }
+
+    if (scriptEntryCount < ARRAY_SIZE(scriptEntries))
+    {
+	scriptEntries[scriptEntryCount++] = *newEntry;
+	return EFI_SUCCESS;
+    }
+
+    // Keep the script order when the buffer is full: write out the buffered entries first, then all later ones
+    S3ResumeScript_Flush();
+    writeImmediately = true;
+
+    return S3ResumeScript_Write(newEntry);
+}
+
+EFI_STATUS S3ResumeScript_Flush(void)
+{
+    EFI_STATUS status = EFI_SUCCESS;
+
+    if (S3SaveState)
+	for (unsigned index = 0u; index < scriptEntryCount; index++)
+	{
+	    EFI_STATUS entryStatus = S3ResumeScript_Write(scriptEntries + index);
+
+	    if (EFI_ERROR(entryStatus))
+		status = entryStatus;
+	}
+
+    scriptEntryCount = 0u;
+
+    if (EFI_ERROR(status))
+	SetEFIError(EFIError_WriteS3SaveStateProtocol, status);
+
+    return status;
+}
+
+static VOID EFIAPI S3ResumeScript_EndOfDxe(EFI_EVENT event, VOID *context)
+{
+    S3ResumeScript_Flush();
+    writeImmediately = true;
+
+    gBS->CloseEvent(event);
+
+    if (event == endOfDxeEvent)
+	endOfDxeEvent = NULL;
+    else
+	readyToBootEvent = NULL;
+}
+
 static void LoadS3SaveStateProtocol()
 {
     EFI_STATUS status = gBS->LocateProtocol(&gEfiS3SaveStateProtocolGuid, NULL, (void **)&S3SaveState);
@@ -26,54 +209,58 @@ void S3ResumeScript_Init(bool enabled)
 {
     if (enabled && !NvStrapsConfig_SkipS3Resume(config))
 	LoadS3SaveStateProtocol();
+
+    if (S3SaveState && !endOfDxeEvent)
+    {
+	// ReadyToBoot is the fallback for platforms that enumerate PCI devices after EndOfDxe
+	EFI_STATUS status = gBS->CreateEventEx(EVT_NOTIFY_SIGNAL, TPL_CALLBACK, &S3ResumeScript_EndOfDxe, NULL, &gEfiEndOfDxeEventGroupGuid, &endOfDxeEvent);
+
+	if (!EFI_ERROR(status))
+	    status = gBS->CreateEventEx(EVT_NOTIFY_SIGNAL, TPL_CALLBACK, &S3ResumeScript_EndOfDxe, NULL, &gEfiEventReadyToBootGuid, &readyToBootEvent);
+
+	if (EFI_ERROR(status))
+	{
+	    endOfDxeEvent = NULL;
+	    readyToBootEvent = NULL;
+	    writeImmediately = true;
+	    SetEFIError(EFIError_CreateEvent, status);
+	}
+    }
 }
 
 // EFI_STATUS S3ResumeScript_MemWrite_DWORD(uintptr_t address, uint_least32_t data);
 
 EFI_STATUS S3ResumeScript_MemReadWrite_DWORD(uintptr_t address, uint_least32_t data, uint_least32_t dataMask)
 {
-    if (S3SaveState)
-	return S3SaveState->Write
-	    (
-		S3SaveState,
-		(UINT16)EFI_BOOT_SCRIPT_MEM_READ_WRITE_OPCODE,
-		(EFI_BOOT_SCRIPT_WIDTH)EfiBootScriptWidthUint32,
-		(UINT64)address,
-		(void *)&data,
-		(void *)&dataMask
-	    );
+    S3ResumeScript_Entry entry = { .isPciConfig = false, .segment = 0u, .address = (UINT64)address, .data = data, .dataMask = dataMask };
 
-    return EFI_SUCCESS;
+    return S3ResumeScript_Record(&entry);
 }
 
 EFI_STATUS S3ResumeScript_PciConfigWrite_DWORD(UINTN pciAddress, uint_least16_t offset, uint_least32_t data)
 {
-    if (S3SaveState)
-	return S3SaveState->Write
-	    (
-		S3SaveState,
-		(UINT16)EFI_BOOT_SCRIPT_PCI_CONFIG_WRITE_OPCODE,
-		(EFI_BOOT_SCRIPT_WIDTH)EfiBootScriptWidthUint32,
-		(UINT64)pciAddrOffset(pciAddress, offset),
-		(UINTN)1u,
-		(void *)&data
-	    );
+    S3ResumeScript_Entry entry =
+    {
+	.isPciConfig = true,
+	.segment = pciAddressSegment(pciAddress),
+	.address = (UINT64)pciAddrOffset(pciAddress, offset),
+	.data = data,
+	.dataMask = 0u
+    };
 
-    return EFI_SUCCESS;
+    return S3ResumeScript_Record(&entry);
 }
 
 EFI_STATUS S3ResumeScript_PciConfigReadWrite_DWORD(UINTN pciAddress, uint_least16_t offset, uint_least32_t data, uint_least32_t dataMask)
 {
-    if (S3SaveState)
-	return S3SaveState->Write
-	    (
-		S3SaveState,
-		(UINT16)EFI_BOOT_SCRIPT_PCI_CONFIG_READ_WRITE_OPCODE,
-		(EFI_BOOT_SCRIPT_WIDTH)EfiBootScriptWidthUint32,
-		(UINT64)pciAddrOffset(pciAddress, offset),
-		(void *)&data,
-		(void *)&dataMask
-	    );
+    S3ResumeScript_Entry entry =
+    {
+	.isPciConfig = true,
+	.segment = pciAddressSegment(pciAddress),
+	.address = (UINT64)pciAddrOffset(pciAddress, offset),
+	.data = data,
+	.dataMask = dataMask
+    };
 
-    return EFI_SUCCESS;
+    return S3ResumeScript_Record(&entry);
 }
@@ -10,7 +10,14 @@
 #include <Library/DxeServicesTableLib.h>
 #include <IndustryStandard/Pci.h>
 
+#if defined(_ASSERT)
+# undef _ASSERT
+#endif
+
+#include <Library/DebugLib.h>
+
 #include "StatusVar.h"
+#include "PhaseTimer.h"
 #include "PciConfig.h"
 #include "S3ResumeScript.h"
 #include "DeviceRegistry.h"
@@ -33,6 +40,18 @@ static uint_least32_t const
     BAR1_SIZE_PART2_SHIFT = 20u,
     BAR1_SIZE_PART2_BITSIZE = 3u;
 
+// After the STRAPS bits are changed, the GPU takes some time to report the new BAR size in the ReBAR
+// capability. Poll the capability at a short interval and stop as soon as the new size is listed, or
+// when the upper bound is reached. Both values are in 100ns units (EFI timer), and can be overridden
+// from the build options.
+#if !defined(NVSTRAPS_SETTLE_POLL_INTERVAL)
+# define NVSTRAPS_SETTLE_POLL_INTERVAL 10'000u           // 1 ms
+#endif
+
+#if !defined(NVSTRAPS_SETTLE_TIMEOUT)
+# define NVSTRAPS_SETTLE_TIMEOUT       1'000'000u        // 100 ms, the previous fixed delay
+#endif
+
 static uint_least16_t enumeratedBridges[ARRAY_SIZE(config->bridge)] = { 0, };
 static uint_least8_t enumeratedBridgeCount = 0u;
 
@@ -45,6 +64,54 @@ static bool isBridgeEnumerated(uint_least16_t pciLocation)
     return false;
 }
 
+// GPU policies resolved from the configuration, kept for the rest of the boot
+typedef struct NvStraps_ResolvedGPU
+{
+    UINTN pciAddress;
+    uint_least16_t deviceId, subsysVenID, subsysDevID;
+    NvStraps_GPUPolicy policy;
+}
+    NvStraps_ResolvedGPU;
+
+static NvStraps_ResolvedGPU resolvedGPUs[2u * ARRAY_SIZE(config->GPUs)];
+static uint_least8_t resolvedGPUCount = 0u;
+
+static NvStraps_GPUPolicy const *NvStraps_ResolveGPUPolicy(UINTN pciAddress, uint_least16_t deviceId, uint_least16_t subsysVenID, uint_least16_t subsysDevID, NvStraps_GPUPolicy *localPolicy)
+{
+    for (unsigned index = 0u; index < resolvedGPUCount; index++)
+	if (resolvedGPUs[index].pciAddress == pciAddress && resolvedGPUs[index].deviceId == deviceId
+		&& resolvedGPUs[index].subsysVenID == subsysVenID && resolvedGPUs[index].subsysDevID == subsysDevID)
+	{
+	    return &resolvedGPUs[index].policy;
+	}
+
+    uint_least8_t bus, device, func;
+
+    pciUnpackAddress(pciAddress, &bus, &device, &func);
+
+    NvStraps_GPUPolicy *policy = localPolicy;
+
+    if (resolvedGPUCount < ARRAY_SIZE(resolvedGPUs))
+    {
+	NvStraps_ResolvedGPU *resolvedGPU = resolvedGPUs + resolvedGPUCount++;
+
+	resolvedGPU->pciAddress = pciAddress;
+	resolvedGPU->deviceId = deviceId;
+	resolvedGPU->subsysVenID = subsysVenID;
+	resolvedGPU->subsysDevID = subsysDevID;
+	policy = &resolvedGPU->policy;
+    }
+
+    *policy = NvStrapsConfig_ResolveGPUPolicy(config, deviceId, subsysVenID, subsysDevID, bus, device, func);
+
+    return policy;
+}
+
+static inline bool isBarSizeSelected(NvStraps_BarSize barSizeSelector)
+{
+    return barSizeSelector.priority != UNCONFIGURED && barSizeSelector.barSizeSelector != BarSizeSelector_None && barSizeSelector.barSizeSelector != BarSizeSelector_Excluded;
+}
+
 void NvStraps_EnumDevice(UINTN pciAddress, uint_least16_t vendorId, uint_least16_t deviceId, uint_least8_t headerType)
 {
     if (pciIsPciBridge(headerType) && (enumeratedBridgeCount < ARRAY_SIZE(enumeratedBridges)))
@@ -52,10 +119,13 @@ void NvStraps_EnumDevice(UINTN pciAddress, uint_least16_t vendorId, uint_least16
 	uint_least8_t bus, dev, fun;
 	pciUnpackAddress(pciAddress, &bus, &dev, &fun);
 
+	if (isBridgeEnumerated(pciPackLocation(bus, dev, fun)))
+	    return;
+
 	if (NvStrapsConfig_HasBridgeDevice(config, bus, dev, fun) != ((uint_least32_t)WORD_BITMASK << WORD_BITSIZE | WORD_BITMASK))
 	{
 	    enumeratedBridges[enumeratedBridgeCount++] = pciPackLocation(bus, dev, fun);
-	    SetStatusVar(StatusVar_BridgeFound);
+	    SetDeviceStatusVar(pciAddress, StatusVar_BridgeFound);
 	}
     }
 }
@@ -69,14 +139,10 @@ bool NvStraps_CheckDevice(UINTN pciAddress, uint_least16_t vendorId, uint_least1
 	if (EFI_ERROR(status))
 	    return SetEFIError(EFIError_PCI_DeviceSubsystem, status), false;
 
-        uint_least8_t bus, device, fun;
-
-	pciUnpackAddress(pciAddress, &bus, &device, &fun);
-
-        NvStraps_BarSize barSizeSelector =
-            NvStrapsConfig_LookupBarSize(config, deviceId, *subsysVenID, *subsysDevID, bus, device, fun);
+        NvStraps_GPUPolicy localPolicy;
+        NvStraps_BarSize barSizeSelector = NvStraps_ResolveGPUPolicy(pciAddress, deviceId, *subsysVenID, *subsysDevID, &localPolicy)->barSize;
 
-        if (barSizeSelector.priority == UNCONFIGURED || barSizeSelector.barSizeSelector == BarSizeSelector_None || barSizeSelector.barSizeSelector == BarSizeSelector_Excluded)
+        if (!isBarSizeSelected(barSizeSelector))
         {
             SetDeviceStatusVar(pciAddress, barSizeSelector.barSizeSelector == BarSizeSelector_Excluded ? StatusVar_GpuExcluded : StatusVar_GPU_Unconfigured);
             return false;
@@ -101,8 +167,8 @@ static bool ConfigureNvStrapsBAR1Size(EFI_PHYSICAL_ADDRESS baseAddress0, UINT8 b
     CopyMem(&STRAPS1, pSTRAPS1, sizeof STRAPS1);
 
     UINT8
-        barSize_Part1 = STRAPS0 >> BAR1_SIZE_PART1_SHIFT & (UINT32_C(1) << BAR1_SIZE_PART1_BITSIZE) - 1u,
-        barSize_Part2 = STRAPS1 >> BAR1_SIZE_PART2_SHIFT & (UINT32_C(1) << BAR1_SIZE_PART2_BITSIZE) - 1u;
+        barSize_Part1 = STRAPS0 >> BAR1_SIZE_PART1_SHIFT & ((UINT32_C(1) << BAR1_SIZE_PART1_BITSIZE) - 1u),
+        barSize_Part2 = STRAPS1 >> BAR1_SIZE_PART2_SHIFT & ((UINT32_C(1) << BAR1_SIZE_PART2_BITSIZE) - 1u);
 
     UINT8
         targetBarSize_Part1 = barSize < 3u ? barSize : barSize < 10u ? 2u           : 3u,
@@ -149,21 +215,253 @@ static bool ConfigureNvStrapsBAR1Size(EFI_PHYSICAL_ADDRESS baseAddress0, UINT8 b
     return barSize_Part1 + barSize_Part2 != targetBarSize_Part1 + targetBarSize_Part2;
 }
 
-void NvStraps_Setup(UINTN pciAddress, uint_least16_t vendorId, uint_least16_t deviceId, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_fast8_t nPciBarSizeSelector)
+// Temporary MMIO range for the GPU BAR0 and I/O range for the bridge, allocated from the GCD while the STRAPS are
+// programmed. The BAR0 address recorded by the configuration tool is tried first, then, with a single root bridge, any
+// free MMIO range below 4 GiB, that can only be part of its aperture. With more root bridges the free ranges can not be
+// attributed to the GPU root bridge, so there is no fallback. If the GCD has no free range, the recorded address is used
+// without allocation, as it is usually part of a root bridge aperture already allocated by the host bridge driver.
+// The cache attributes changed for the range are restored before it is freed.
+static uint_least64_t const
+    TARGET_GPU_BAR0_SIZE = SIZE_16MB,
+    TARGET_BRIDGE_IO_WINDOW_SIZE = SIZE_4KB;
+
+typedef struct NvStraps_TempWindow
+{
+    EFI_PHYSICAL_ADDRESS baseAddress0, topAddress0, ioBase;
+    uint_least64_t memoryAttributes;
+    uint_least16_t ioBaseLimit;
+    bool isMemoryAllocated, isIoAllocated, isAttributesChanged;
+}
+    NvStraps_TempWindow;
+
+// A range without the UC capability is left as it is, the MMIO accesses to the STRAPS do not depend on it
+static void NvStraps_SetUncacheable(UINTN pciAddress, NvStraps_TempWindow *window)
+{
+    EFI_GCD_MEMORY_SPACE_DESCRIPTOR memoryDescriptor;
+    EFI_STATUS status = gDS->GetMemorySpaceDescriptor(window->baseAddress0, &memoryDescriptor);
+
+    if (EFI_ERROR(status) || !(memoryDescriptor.Capabilities & EFI_MEMORY_UC) || memoryDescriptor.Attributes & EFI_MEMORY_UC)
+    {
+	if (!EFI_ERROR(status) && !(memoryDescriptor.Capabilities & EFI_MEMORY_UC))
+	    DEBUG((DEBUG_INFO, "ReBarDXE: No UC capability for the temporary BAR0 range at 0x%lx\n", window->baseAddress0));
+
+	return;
+    }
+
+    uint_least64_t cacheAttributes = EFI_MEMORY_UC | EFI_MEMORY_WC | EFI_MEMORY_WT | EFI_MEMORY_WB | EFI_MEMORY_UCE;
+
+    status = gDS->SetMemorySpaceAttributes(window->baseAddress0, window->topAddress0 - window->baseAddress0 + 1u, (memoryDescriptor.Attributes & ~cacheAttributes) | EFI_MEMORY_UC);
+
+    if (EFI_ERROR(status))
+	SetDeviceEFIError(pciAddress, EFIError_SetMemorySpaceAttributes, status);
+    else
+    {
+	window->memoryAttributes = memoryDescriptor.Attributes;
+	window->isAttributesChanged = true;
+    }
+}
+
+static bool NvStraps_AllocateTempWindow(UINTN pciAddress, bool hasBar0Hint, NvStraps_TempWindow *window)
+{
+    uint_least64_t length = hasBar0Hint ? window->topAddress0 - window->baseAddress0 + 1u : TARGET_GPU_BAR0_SIZE;
+    EFI_PHYSICAL_ADDRESS baseAddress = window->baseAddress0;
+    EFI_STATUS status = EFI_NOT_FOUND;
+
+    if (hasBar0Hint)
+	status = gDS->AllocateMemorySpace(EfiGcdAllocateAddress, EfiGcdMemoryTypeMemoryMappedIo, 0u, length, &baseAddress, reBarImageHandle, NULL);
+
+    if (EFI_ERROR(status) && pciSystemRootBridgeCount() == 1u)
+    {
+	baseAddress = BASE_4GB - 1u;
+	status = gDS->AllocateMemorySpace(EfiGcdAllocateMaxAddressSearchTopDown, EfiGcdMemoryTypeMemoryMappedIo, (UINTN)HighBitSet64(length), length, &baseAddress, reBarImageHandle, NULL);
+    }
+
+    if (EFI_ERROR(status))
+    {
+	if (!hasBar0Hint)
+	    return SetDeviceEFIError(pciAddress, EFIError_AllocateMemorySpace, status), false;
+    }
+    else
+    {
+	window->isMemoryAllocated = true;
+	window->baseAddress0 = baseAddress;
+	window->topAddress0 = baseAddress + length - 1u;
+
+	NvStraps_SetUncacheable(pciAddress, window);
+    }
+
+    // Bridge I/O windows use 4 KiB granularity, with the 32-bit I/O addressing flag in the low nibble
+    window->ioBase = BASE_64KB - 1u;
+
+    if (!EFI_ERROR(gDS->AllocateIoSpace(EfiGcdAllocateMaxAddressSearchTopDown, EfiGcdIoTypeIo, 12u, TARGET_BRIDGE_IO_WINDOW_SIZE, &window->ioBase, reBarImageHandle, NULL)))
+    {
+	uint_least16_t ioRange = (uint_least16_t)((window->ioBase >> BYTE_BITSIZE & 0xF0u) | (TARGET_BRIDGE_IO_BASE_LIMIT >> BYTE_BITSIZE & 0x0Fu));
+
+	window->isIoAllocated = true;
+	window->ioBaseLimit = (uint_least16_t)(ioRange << BYTE_BITSIZE | ioRange);
+    }
+
+    return true;
+}
+
+static void NvStraps_FreeTempWindow(UINTN pciAddress, NvStraps_TempWindow *window)
+{
+    EFI_STATUS status;
+
+    if (window->isIoAllocated && EFI_ERROR((status = gDS->FreeIoSpace(window->ioBase, TARGET_BRIDGE_IO_WINDOW_SIZE))))
+	SetDeviceEFIError(pciAddress, EFIError_FreeIoSpace, status);
+
+    if (window->isAttributesChanged && EFI_ERROR((status = gDS->SetMemorySpaceAttributes(window->baseAddress0, window->topAddress0 - window->baseAddress0 + 1u, window->memoryAttributes))))
+	SetDeviceEFIError(pciAddress, EFIError_SetMemorySpaceAttributes, status);
+
+    if (window->isMemoryAllocated && EFI_ERROR((status = gDS->FreeMemorySpace(window->baseAddress0, window->topAddress0 - window->baseAddress0 + 1u))))
+	SetDeviceEFIError(pciAddress, EFIError_FreeMemorySpace, status);
+
+    window->isIoAllocated = false;
+    window->isMemoryAllocated = false;
+    window->isAttributesChanged = false;
+}
+
+static inline bool isBarSizeListed(uint_least32_t barSizeMask, uint_least8_t barSizeBitIndex)
+{
+    return !!(barSizeMask & UINT32_C(1) << barSizeBitIndex);
+}
+
+// GPUs with the STRAPS programmed in the first PreprocessController phase, waiting for the BAR sizing pass.
+// The STRAPS for all GPUs are programmed first, then a single settle window is used for all of them.
+typedef struct NvStraps_PendingGPU
+{
+    UINTN pciAddress;
+    uint_least16_t vendorId, deviceId;
+    PciReBarCapability reBar;
+    uint_least8_t barSizeBitIndex;
+    bool sizeMaskOverride;
+    bool settled;
+    uint_least32_t barSizeMask;
+}
+    NvStraps_PendingGPU;
+
+static NvStraps_PendingGPU pendingGPUs[ARRAY_SIZE(config->gpuConfig)];
+static uint_least8_t pendingGPUCount = 0u;
+static EFI_EVENT settleDeadline = NULL;
+static bool isSettleWindowOpen = false;
+
+static NvStraps_PendingGPU *findPendingGPU(UINTN pciAddress)
+{
+    for (unsigned index = 0u; index < pendingGPUCount; index++)
+	if (pendingGPUs[index].pciAddress == pciAddress)
+	    return pendingGPUs + index;
+
+    return NULL;
+}
+
+// (Re-)start the settle window, so it ends NVSTRAPS_SETTLE_TIMEOUT after the last GPU was programmed
+static void NvStraps_OpenSettleWindow(UINTN pciAddress)
+{
+    EFI_STATUS status;
+
+    if (!settleDeadline && EFI_ERROR((status = gBS->CreateEvent(EVT_TIMER, TPL_APPLICATION, NULL, NULL, &settleDeadline))))
+    {
+	settleDeadline = NULL;
+        SetDeviceEFIError(pciAddress, EFIError_CreateTimer, status);
+	return;
+    }
+
+    if (EFI_ERROR((status = gBS->SetTimer(settleDeadline, TimerRelative, NVSTRAPS_SETTLE_TIMEOUT))))
+    {
+        SetDeviceEFIError(pciAddress, EFIError_SetupTimer, status);
+	return;
+    }
+
+    isSettleWindowOpen = true;
+}
+
+static bool NvStraps_PollPendingGPUs()
+{
+    bool allSettled = true;
+
+    for (NvStraps_PendingGPU *gpu = pendingGPUs; gpu < pendingGPUs + pendingGPUCount; gpu++)
+	if (!gpu->settled)
+	{
+	    if (gpu->reBar.bar[PCI_BAR_IDX1].entryOffset)
+	    {
+		gpu->barSizeMask = pciRebarReadPossibleSizes(gpu->pciAddress, &gpu->reBar, PCI_BAR_IDX1);
+		gpu->settled = isBarSizeListed(gpu->barSizeMask, gpu->barSizeBitIndex);
+	    }
+
+	    allSettled = allSettled && gpu->settled;
+	}
+
+    return allSettled;
+}
+
+// Wait once for all pending GPUs to report the new BAR size, or until the settle window ends.
+// GPUs without a ReBAR entry for BAR1 can not be polled, and keep the window open until the end.
+static void NvStraps_SettlePendingGPUs()
+{
+    if (!isSettleWindowOpen)
+	return;
+
+    isSettleWindowOpen = false;
+
+    if (NvStraps_PollPendingGPUs())
+    {
+	gBS->SetTimer(settleDeadline, TimerCancel, 0u);
+	return;
+    }
+
+    EFI_EVENT pollTimer = NULL;
+    EFI_STATUS status;
+
+    if (EFI_ERROR((status = gBS->CreateEvent(EVT_TIMER, TPL_APPLICATION, NULL, NULL, &pollTimer))))
+    {
+        SetEFIError(EFIError_CreateTimer, status);
+        return;
+    }
+
+    if (EFI_ERROR((status = gBS->SetTimer(pollTimer, TimerPeriodic, NVSTRAPS_SETTLE_POLL_INTERVAL))))
+        SetEFIError(EFIError_SetupTimer, status);
+    else
+    {
+	EFI_EVENT waitEvents[2u] = { pollTimer, settleDeadline };
+
+	while (true)
+        {
+            UINTN eventIndex = 0u;
+
+            if (EFI_ERROR((status = gBS->WaitForEvent(ARRAY_SIZE(waitEvents), waitEvents, &eventIndex))))
+            {
+                SetEFIError(EFIError_WaitTimer, status);
+                break;
+            }
+
+            if (eventIndex == 1u || NvStraps_PollPendingGPUs())
+                break;
+        }
+
+        gBS->SetTimer(pollTimer, TimerCancel, 0u);
+	gBS->SetTimer(settleDeadline, TimerCancel, 0u);
+    }
+
+    if (EFI_ERROR((status = gBS->CloseEvent(pollTimer))))
+        SetEFIError(EFIError_CloseTimer, status);
+}
+
+void NvStraps_Setup(UINTN pciAddress, uint_least16_t vendorId, uint_least16_t deviceId, uint_least16_t subsysVenID, uint_least16_t subsysDevID)
 {
     uint_least8_t bus, device, func;
 
     pciUnpackAddress(pciAddress, &bus, &device, &func);
 
-    NvStraps_BarSize barSizeSelector =
-        NvStrapsConfig_LookupBarSize(config, deviceId, subsysVenID, subsysDevID, bus, device, func);
+    NvStraps_GPUPolicy localPolicy;
+    NvStraps_GPUPolicy const *policy = NvStraps_ResolveGPUPolicy(pciAddress, deviceId, subsysVenID, subsysDevID, &localPolicy);
+    NvStraps_BarSize barSizeSelector = policy->barSize;
 
-    if (barSizeSelector.priority == UNCONFIGURED || barSizeSelector.barSizeSelector == BarSizeSelector_None || barSizeSelector.barSizeSelector == BarSizeSelector_Excluded)
+    if (!isBarSizeSelected(barSizeSelector))
         return;
 
-    NvStraps_BarSizeMaskOverride sizeMaskOverride = NvStrapsConfig_LookupBarSizeMaskOverride(config, deviceId, subsysVenID, subsysDevID, bus, device, func);
-
-    NvStraps_GPUConfig const *gpuConfig = NvStrapsConfig_LookupGPUConfig(config, bus, device, func);
+    NvStraps_BarSizeMaskOverride sizeMaskOverride = policy->sizeMaskOverride;
+    NvStraps_GPUConfig const *gpuConfig = policy->gpuConfig;
 
     if (!gpuConfig)
     {
@@ -171,14 +469,16 @@ void NvStraps_Setup(UINTN pciAddress, uint_least16_t vendorId, uint_least16_t de
 	return;
     }
 
-    if (gpuConfig->bar0.base >= UINT32_MAX || gpuConfig->bar0.top >= UINT32_MAX || gpuConfig->bar0.base & UINT32_C(0x0000'000F)
-	    || gpuConfig->bar0.base % (gpuConfig->bar0.top - gpuConfig->bar0.base + 1u))
+    // BAR0 range from the configuration is optional, and only used as a hint for the temporary MMIO window
+    if ((gpuConfig->bar0.base || gpuConfig->bar0.top)
+	    && (gpuConfig->bar0.base >= UINT32_MAX || gpuConfig->bar0.top >= UINT32_MAX || gpuConfig->bar0.top <= gpuConfig->bar0.base
+		|| gpuConfig->bar0.base & UINT32_C(0x0000'000F) || gpuConfig->bar0.base % (gpuConfig->bar0.top - gpuConfig->bar0.base + 1u)))
     {
 	SetDeviceStatusVar(pciAddress, StatusVar_BadGpuConfig);
 	return;
     }
 
-    NvStraps_BridgeConfig const *bridgeConfig = NvStrapsConfig_LookupBridgeConfig(config, bus);
+    NvStraps_BridgeConfig const *bridgeConfig = policy->bridgeConfig;
 
     if (!bridgeConfig)
     {
@@ -192,7 +492,7 @@ void NvStraps_Setup(UINTN pciAddress, uint_least16_t vendorId, uint_least16_t de
 	    return;
 	}
 
-    UINTN bridgePciAddress = EFI_PCI_ADDRESS(bridgeConfig->bridgeBus, bridgeConfig->bridgeDevice, bridgeConfig->bridgeFunction, 0u);
+    UINTN bridgePciAddress = pciSiblingAddress(pciAddress, bridgeConfig->bridgeBus, bridgeConfig->bridgeDevice, bridgeConfig->bridgeFunction);
     uint_least8_t bridgeSecondaryBus;
     EFI_STATUS status = pciBridgeSecondaryBus(bridgePciAddress, &bridgeSecondaryBus);
 
@@ -208,111 +508,120 @@ void NvStraps_Setup(UINTN pciAddress, uint_least16_t vendorId, uint_least16_t de
 	return;
     }
 
+    uint_least64_t startTime = PhaseTimer_Start();
+    bool hasBar0Hint = gpuConfig->bar0.top > gpuConfig->bar0.base;
+
+    // The STRAPS are accessed in place if the firmware already assigned the configured BAR0 range
+    bool isBar0Decoded = hasBar0Hint && pciIsDeviceBAR0Decoded(bridgePciAddress, pciAddress, gpuConfig->bar0.base, gpuConfig->bar0.top);
+    NvStraps_TempWindow window = { .baseAddress0 = gpuConfig->bar0.base, .topAddress0 = gpuConfig->bar0.top, .ioBaseLimit = TARGET_BRIDGE_IO_BASE_LIMIT };
     UINT32 bridgeSaveArea[3u], gpuSaveArea[2u];
 
-//    EFI_PHYSICAL_ADDRESS baseAddress0 = BASE_4GB - 1u, bridgeIoPortRangeBegin = BASE_64KB - 1u;
-
-//    if (EFI_SUCCESS == gDS->AllocateMemorySpace(EfiGcdAllocateMaxAddressSearchTopDown, EfiGcdMemoryTypeMemoryMappedIo, 25u, SIZE_32MB, &baseAddress0, reBarImageHandle, NULL))
-//    {
-//        if (EFI_SUCCESS == gDS->AllocateIoSpace(EfiGcdAllocateMaxAddressSearchTopDown, EfiGcdIoTypeIo, 12u, SIZE_1KB / 2, &bridgeIoPortRangeBegin, reBarImageHandle, NULL))
-//        {
-//                EFI_GCD_MEMORY_SPACE_DESCRIPTOR memoryDescriptor;
-//
-//                if (EFI_ERROR(gDS->GetMemorySpaceDescriptor(baseAddress0, &memoryDescriptor)))
-//                    SetStatusVar(StatusVar_EFIError);
-//                else
-//                    if (EFI_ERROR(gDS->SetMemorySpaceAttributes(baseAddress0, SIZE_16MB, memoryDescriptor.Attributes | EFI_MEMORY_UC)))
-//                        SetStatusVar(StatusVar_EFIError);
-
-                pciSaveAndRemapBridgeConfig(bridgePciAddress, bridgeSaveArea, gpuConfig->bar0.base, gpuConfig->bar0.top, TARGET_BRIDGE_IO_BASE_LIMIT);
-                pciSaveAndRemapDeviceBAR0(pciAddress, gpuSaveArea, gpuConfig->bar0.base);
-
-                bool configUpdated = ConfigureNvStrapsBAR1Size(gpuConfig->bar0.base & UINT32_C(0xFFFF'FFF0), barSizeSelector.barSizeSelector);     // mask the flag bits from the address
-
-		// RecordUpdateGPU(bus, device, func, barSizeSelector.barSizeSelector);
-
-                pciRestoreDeviceConfig(pciAddress, gpuSaveArea);
-                pciRestoreBridgeConfig(bridgePciAddress, bridgeSaveArea);
-
-                SetDeviceStatusVar(pciAddress, configUpdated ? StatusVar_GpuStrapsConfigured : StatusVar_GpuStrapsPreConfigured);
-
-                uint_least16_t capabilityOffset = pciFindExtCapability(pciAddress, PCI_EXPRESS_EXTENDED_CAPABILITY_RESIZABLE_BAR_ID);
-                uint_least32_t barSizeMask = capabilityOffset ? pciRebarGetPossibleSizes(pciAddress, capabilityOffset, vendorId, deviceId, PCI_BAR_IDX1) : 0u;
-
-                if (barSizeMask)
-                {
-                    if (barSizeMask & UINT32_C(1) << (barSizeSelector.barSizeSelector + 6u))
-                        SetDeviceStatusVar(pciAddress, StatusVar_GpuStrapsConfirm);
-                    else
-                        SetDeviceStatusVar(pciAddress, StatusVar_GpuStrapsNoConfirm);
-                }
-                else
-		    if (isTuringGPU(deviceId))
-			SetDeviceStatusVar(pciAddress, StatusVar_GpuNoReBarCapability);
-
-                if (nPciBarSizeSelector == TARGET_PCI_BAR_SIZE_GPU_ONLY)
-                {
-		    if (capabilityOffset && (barSizeMask & UINT32_C(0x0000'0001) << (barSizeSelector.barSizeSelector + 6u) || sizeMaskOverride.sizeMaskOverride))
-		    {
-			if ((barSizeMask & UINT32_C(0x0000'0001) << (barSizeSelector.barSizeSelector + 6u)) == 0)
-			    SetDeviceStatusVar(pciAddress, StatusVar_GpuReBarSizeOverride);
-
-			if (pciRebarSetSize(pciAddress, capabilityOffset, PCI_BAR_IDX1, (uint_least8_t)(barSizeSelector.barSizeSelector + 6u)))
-			    SetDeviceStatusVar(pciAddress, StatusVar_GpuReBarConfigured);
-		    }
-                }
-                else
-                    if (nPciBarSizeSelector == TARGET_PCI_BAR_SIZE_GPU_STRAPS_ONLY)
-                    {
-                        EFI_EVENT eventTimer = NULL;
-
-                        if (EFI_ERROR((status = gBS->CreateEvent(EVT_TIMER, TPL_APPLICATION, NULL, NULL, &eventTimer))))
-                            SetDeviceEFIError(pciAddress, EFIError_CreateTimer, status);
-                        else
-                        {
-                            if (EFI_ERROR((status = gBS->SetTimer(eventTimer, TimerRelative, 1'000'000u))))
-                                SetDeviceEFIError(pciAddress, EFIError_SetupTimer, status);
-                            else
-                            {
-                                UINTN eventIndex = 0u;
-
-                                if (EFI_ERROR((status = gBS->WaitForEvent(1, &eventTimer, &eventIndex))))
-                                    SetDeviceEFIError(pciAddress, EFIError_WaitTimer, status);
-                            }
-
-                            if (EFI_ERROR((status = gBS->CloseEvent(eventTimer))))
-                                SetDeviceEFIError(pciAddress, EFIError_CloseTimer, status);
-                        }
-                    }
-
-//            gDS->FreeIoSpace(bridgeIoPortRangeBegin, SIZE_1KB / 2u);
-//        }
-//        else
-//            SetStatusVar(StatusVar_EFIAllocationError);
-//
-//        gDS->FreeMemorySpace(baseAddress0, SIZE_32MB);
-//    }
-//    else
-//        SetStatusVar(StatusVar_EFIAllocationError);
+    if (!isBar0Decoded && !NvStraps_AllocateTempWindow(pciAddress, hasBar0Hint, &window))
+    {
+	PhaseTimer_Stop(PhaseTimer_StrapsRemap, startTime);
+	return;
+    }
+
+    // A decoded BAR0 is left as it is, but the S3 resume script still maps it for the STRAPS, and unmaps it after
+    pciSaveAndRemapBridgeConfig(bridgePciAddress, bridgeSaveArea, window.baseAddress0, window.topAddress0, window.ioBaseLimit, !isBar0Decoded);
+    pciSaveAndRemapDeviceBAR0(pciAddress, gpuSaveArea, window.baseAddress0, !isBar0Decoded);
+
+    uint_least64_t mmioTime = PhaseTimer_Start();
+    bool configUpdated = ConfigureNvStrapsBAR1Size(window.baseAddress0 & UINT32_C(0xFFFF'FFF0), barSizeSelector.barSizeSelector);     // mask the flag bits from the address
+
+    PhaseTimer_Stop(PhaseTimer_StrapsMMIO, mmioTime);
+
+    // RecordUpdateGPU(bus, device, func, barSizeSelector.barSizeSelector);
+
+    pciRestoreDeviceConfig(pciAddress, gpuSaveArea, !isBar0Decoded);
+    pciRestoreBridgeConfig(bridgePciAddress, bridgeSaveArea, !isBar0Decoded);
+
+    if (!isBar0Decoded)
+	NvStraps_FreeTempWindow(pciAddress, &window);
+
+    PhaseTimer_Stop(PhaseTimer_StrapsRemap, startTime);
+
+    SetDeviceStatusVar(pciAddress, configUpdated ? StatusVar_GpuStrapsConfigured : StatusVar_GpuStrapsPreConfigured);
+
+    NvStraps_PendingGPU *pendingGPU = findPendingGPU(pciAddress);
+
+    if (!pendingGPU && pendingGPUCount < ARRAY_SIZE(pendingGPUs))
+        pendingGPU = pendingGPUs + pendingGPUCount++;
+
+    if (pendingGPU)
+    {
+        pendingGPU->pciAddress = pciAddress;
+        pendingGPU->vendorId = vendorId;
+        pendingGPU->deviceId = deviceId;
+        pciRebarParseCapability(pciAddress, pciFindExtCapability(pciAddress, PCI_EXPRESS_EXTENDED_CAPABILITY_RESIZABLE_BAR_ID), &pendingGPU->reBar);
+        pendingGPU->barSizeBitIndex = (uint_least8_t)(barSizeSelector.barSizeSelector + 6u);
+        pendingGPU->sizeMaskOverride = sizeMaskOverride.sizeMaskOverride;
+        pendingGPU->barSizeMask = pciRebarGetPossibleSizes(&pendingGPU->reBar, PCI_BAR_IDX1);
+
+        // Only wait for the new BAR size if the STRAPS were actually changed during this boot
+        pendingGPU->settled = !configUpdated || isBarSizeListed(pendingGPU->barSizeMask, pendingGPU->barSizeBitIndex);
+
+        if (!pendingGPU->settled)
+            NvStraps_OpenSettleWindow(pciAddress);
+    }
+}
+
+// Runs in the second PreprocessController phase, after the STRAPS were programmed for all selected GPUs
+void NvStraps_CompleteSetup(UINTN pciAddress, uint_least16_t vendorId, uint_least16_t deviceId, uint_fast8_t nPciBarSizeSelector)
+{
+    NvStraps_PendingGPU *pendingGPU = findPendingGPU(pciAddress);
+
+    if (!pendingGPU)
+	return;
+
+    uint_least64_t startTime = PhaseTimer_Start();
+
+    NvStraps_SettlePendingGPUs();
+    PhaseTimer_Stop(PhaseTimer_StrapsSettle, startTime);
+
+    PciReBarCapability *reBar = &pendingGPU->reBar;
+    uint_least8_t barSizeBitIndex = pendingGPU->barSizeBitIndex;
+    uint_least32_t barSizeMask = pendingGPU->barSizeMask;
+
+    SetDeviceBarSize(pciAddress, (uint_least8_t)(barSizeBitIndex - 6u), barSizeMask);
+
+    if (barSizeMask)
+    {
+        if (isBarSizeListed(barSizeMask, barSizeBitIndex))
+            SetDeviceStatusVar(pciAddress, StatusVar_GpuStrapsConfirm);
+        else
+            SetDeviceStatusVar(pciAddress, StatusVar_GpuStrapsNoConfirm);
+    }
+    else
+	if (isTuringGPU(deviceId))
+	    SetDeviceStatusVar(pciAddress, StatusVar_GpuNoReBarCapability);
+
+    if (nPciBarSizeSelector == TARGET_PCI_BAR_SIZE_GPU_ONLY)
+    {
+	if (reBar->bar[PCI_BAR_IDX1].entryOffset && (isBarSizeListed(barSizeMask, barSizeBitIndex) || pendingGPU->sizeMaskOverride))
+	{
+	    if (!isBarSizeListed(barSizeMask, barSizeBitIndex))
+		SetDeviceStatusVar(pciAddress, StatusVar_GpuReBarSizeOverride);
+
+	    if (pciRebarSetSize(pciAddress, reBar, PCI_BAR_IDX1, barSizeBitIndex))
+		SetDeviceStatusVar(pciAddress, StatusVar_GpuReBarConfigured);
+	}
+    }
 }
 
 bool NvStraps_CheckBARSizeListAdjust(UINTN pciAddress, uint_least16_t vid, uint_least16_t did, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t barIndex)
 {
     if (vid == TARGET_GPU_VENDOR_ID && subsysVenID != WORD_BITMASK && subsysDevID != WORD_BITMASK && barIndex == PCI_BAR_IDX1)
     {
-	uint_least8_t bus, device, func;
-	pciUnpackAddress(pciAddress, &bus, &device, &func);
-
-	NvStraps_BarSize barSizeSelector = NvStrapsConfig_LookupBarSize(config, did, subsysVenID, subsysDevID, bus, device, func);
+	NvStraps_GPUPolicy localPolicy;
+	NvStraps_GPUPolicy const *policy = NvStraps_ResolveGPUPolicy(pciAddress, did, subsysVenID, subsysDevID, &localPolicy);
 
-	if (barSizeSelector.priority == UNCONFIGURED || barSizeSelector.barSizeSelector == BarSizeSelector_None || barSizeSelector.barSizeSelector == BarSizeSelector_Excluded)
+	if (!isBarSizeSelected(policy->barSize))
 	    return false;
 
-	NvStraps_BarSizeMaskOverride sizeMaskOverride = NvStrapsConfig_LookupBarSizeMaskOverride(config, did, subsysVenID, subsysDevID, bus, device, func);
-
-	if (sizeMaskOverride.sizeMaskOverride)
+	if (policy->sizeMaskOverride.sizeMaskOverride && policy->bridgeConfig)
 	{
-	    NvStraps_BridgeConfig const *bridgeConfig = NvStrapsConfig_LookupBridgeConfig(config, bus);
+	    NvStraps_BridgeConfig const *bridgeConfig = policy->bridgeConfig;
 
 	    return isBridgeEnumerated(pciPackLocation(bridgeConfig->bridgeBus, bridgeConfig->bridgeDevice, bridgeConfig->bridgeFunction));
 	}
@@ -325,13 +634,10 @@ bool NvStraps_CheckBARSizeListAdjust(UINTN pciAddress, uint_least16_t vid, uint_
 
 uint_least32_t NvStraps_AdjustBARSizeList(UINTN pciAddress, uint_least16_t vid, uint_least16_t did, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t barIndex, uint_least32_t barSizeMask)
 {
-    uint_least8_t bus, device, func;
-
-    pciUnpackAddress(pciAddress, &bus, &device, &func);
-
-    NvStraps_BarSize barSizeSelector = NvStrapsConfig_LookupBarSize(config, did, subsysVenID, subsysDevID, bus, device, func);
+    NvStraps_GPUPolicy localPolicy;
+    NvStraps_BarSize barSizeSelector = NvStraps_ResolveGPUPolicy(pciAddress, did, subsysVenID, subsysDevID, &localPolicy)->barSize;
 
-    if (barSizeSelector.priority == UNCONFIGURED || barSizeSelector.barSizeSelector == BarSizeSelector_None || barSizeSelector.barSizeSelector == BarSizeSelector_Excluded)
+    if (!isBarSizeSelected(barSizeSelector))
         return barSizeMask;
 
     if ((barSizeMask & UINT32_C(0x00000001) << (6u + (unsigned)barSizeSelector.barSizeSelector)) == 0u)
@@ -0,0 +1,227 @@
+#if defined(UEFI_SOURCE) || defined(EFIAPI)
+# include <Uefi.h>
+# include <Library/BaseLib.h>
+#else
+# if defined(WINDOWS) || defined(_WINDOWS) || defined(_WIN32) || defined(_WIN64)
+#  if defined(_M_AMD64) && !defined(_AMD64_)
+#   define _AMD64_
+#  endif
+#  include <windef.h>
+# endif
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(_M_AMD64) || defined(_M_X64) || defined(__x86_64__) || defined(MDE_CPU_X64)
+# define SETUP_VAR_CRC_PCLMUL
+# include <emmintrin.h>
+# include <wmmintrin.h>
+# if defined(_MSC_VER)
+#  include <intrin.h>
+# elif !defined(UEFI_SOURCE) && !defined(EFIAPI)
+#  include <cpuid.h>
+# endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+# define TARGET_PCLMUL __attribute__((target("sse2,pclmul")))
+#else
+# define TARGET_PCLMUL
+#endif
+
+#include "LocalAppConfig.h"
+#include "EfiVariable.h"
+#include "SetupVarCRC.h"
+
+static uint_least64_t const ECMA_128_CRC_POLY = UINT64_C(0xC96C'5795'D787'0F42);
+
+// crcTable[j][b] is the CRC register after shifting (b << 8j) through all 64 bits
+static uint_least64_t crcTable[QWORD_SIZE][1u << BYTE_BITSIZE];
+static bool isCrcTableReady = false;
+
+uint_least64_t ecma128_crc64_bitwise(BYTE const *buffer, BYTE const *bufferEnd, uint_least64_t crcValue)
+{
+    crcValue = ~crcValue & (uint_least64_t)UINT64_C(0xFFFF'FFFF'FFFF'FFFF);
+
+    while (buffer != bufferEnd)
+    {
+	crcValue ^= unpack_QWORD(buffer), buffer += QWORD_SIZE;
+
+	for (unsigned char bitIndex = 0u; bitIndex < QWORD_BITSIZE; bitIndex++)
+	    if (crcValue & UINT64_C(1) << (QWORD_BITSIZE - 1u))
+		crcValue <<= 1u, crcValue ^= ECMA_128_CRC_POLY;
+	    else
+		crcValue <<= 1u;
+    }
+
+    return ~crcValue & (uint_least64_t)UINT64_C(0xFFFF'FFFF'FFFF'FFFF);
+}
+
+static void buildCrcTable(void)
+{
+    for (unsigned byteValue = 0u; byteValue < ARRAY_SIZE(crcTable[0u]); byteValue++)
+    {
+	uint_least64_t crcValue = (uint_least64_t)byteValue << (QWORD_BITSIZE - BYTE_BITSIZE);
+
+	for (unsigned bitIndex = 0u; bitIndex < BYTE_BITSIZE; bitIndex++)
+	    crcValue = crcValue & UINT64_C(1) << (QWORD_BITSIZE - 1u) ? crcValue << 1u ^ ECMA_128_CRC_POLY : crcValue << 1u;
+
+	crcTable[0u][byteValue] = crcValue;
+    }
+
+    for (unsigned slice = 1u; slice < ARRAY_SIZE(crcTable); slice++)
+	for (unsigned byteValue = 0u; byteValue < ARRAY_SIZE(crcTable[0u]); byteValue++)
+	{
+	    uint_least64_t crcValue = crcTable[slice - 1u][byteValue];
+
+	    crcTable[slice][byteValue] = crcValue << BYTE_BITSIZE ^ crcTable[0u][crcValue >> (QWORD_BITSIZE - BYTE_BITSIZE)];
+	}
+
+    isCrcTableReady = true;
+}
+
+// Shift one QWORD through the CRC register
+static inline uint_least64_t crcShiftQWORD(uint_least64_t crcValue)
+{
+    return crcTable[7u][crcValue >> 7u * BYTE_BITSIZE & BYTE_BITMASK] ^ crcTable[6u][crcValue >> 6u * BYTE_BITSIZE & BYTE_BITMASK]
+	 ^ crcTable[5u][crcValue >> 5u * BYTE_BITSIZE & BYTE_BITMASK] ^ crcTable[4u][crcValue >> 4u * BYTE_BITSIZE & BYTE_BITMASK]
+	 ^ crcTable[3u][crcValue >> 3u * BYTE_BITSIZE & BYTE_BITMASK] ^ crcTable[2u][crcValue >> 2u * BYTE_BITSIZE & BYTE_BITMASK]
+	 ^ crcTable[1u][crcValue >>      BYTE_BITSIZE & BYTE_BITMASK] ^ crcTable[0u][crcValue		  & BYTE_BITMASK];
+}
+
+static uint_least64_t crc64_table(BYTE const *buffer, BYTE const *bufferEnd, uint_least64_t crcRegister)
+{
+    while (buffer != bufferEnd)
+	crcRegister = crcShiftQWORD(crcRegister ^ unpack_QWORD(buffer)), buffer += QWORD_SIZE;
+
+    return crcRegister;
+}
+
+uint_least64_t ecma128_crc64_table(BYTE const *buffer, BYTE const *bufferEnd, uint_least64_t crcValue)
+{
+    if (!isCrcTableReady)
+	buildCrcTable();
+
+    return ~crc64_table(buffer, bufferEnd, ~crcValue & (uint_least64_t)UINT64_C(0xFFFF'FFFF'FFFF'FFFF)) & (uint_least64_t)UINT64_C(0xFFFF'FFFF'FFFF'FFFF);
+}
+
+#if defined(SETUP_VAR_CRC_PCLMUL)
+
+enum
+{
+    PCLMUL_BLOCK_SIZE = 2u * QWORD_SIZE,
+    PCLMUL_LANE_COUNT = 4u,
+    PCLMUL_MIN_SIZE = 2u * PCLMUL_LANE_COUNT * PCLMUL_BLOCK_SIZE
+};
+
+// x^n mod P, for the folding constants
+static uint_least64_t crcPowerOfX(unsigned n)
+{
+    uint_least64_t remainder = 1u;
+
+    while (n--)
+	remainder = remainder & UINT64_C(1) << (QWORD_BITSIZE - 1u) ? remainder << 1u ^ ECMA_128_CRC_POLY : remainder << 1u;
+
+    return remainder;
+}
+
+static bool hasPCLMUL(void)
+{
+#if defined(UEFI_SOURCE) || defined(EFIAPI)
+    UINT32 eax = 0u, ebx = 0u, ecx = 0u, edx = 0u;
+
+    AsmCpuid(1u, &eax, &ebx, &ecx, &edx);
+#elif defined(_MSC_VER)
+    int cpuInfo[4u];
+
+    __cpuid(cpuInfo, 1);
+    unsigned ecx = (unsigned)cpuInfo[2u];
+#else
+    unsigned eax = 0u, ebx = 0u, ecx = 0u, edx = 0u;
+
+    __get_cpuid(1u, &eax, &ebx, &ecx, &edx);
+#endif
+
+    return !!(ecx & UINT32_C(1) << 1u);		// CPUID.01H:ECX.PCLMULQDQ[bit 1]
+}
+
+// Folding keeps 128-bit blocks with the first QWORD (the higher polynomial part) in the low half, as loaded from memory.
+// A block X = H * x^64 + L, that is followed by more data at a distance of n bits, is folded as
+// H * (x^(n+64) mod P) + L * (x^n mod P), a 128-bit value added to the data at that distance.
+static inline TARGET_PCLMUL __m128i crcFold(__m128i block, __m128i foldConstants)
+{
+    __m128i folded = _mm_xor_si128(_mm_clmulepi64_si128(block, foldConstants, 0x00), _mm_clmulepi64_si128(block, foldConstants, 0x11));
+
+    return _mm_shuffle_epi32(folded, 0x4E);	// swap halves, back to memory order
+}
+
+static inline TARGET_PCLMUL __m128i crcFoldConstants(unsigned distance)
+{
+    return _mm_set_epi64x((long long)crcPowerOfX(distance), (long long)crcPowerOfX(distance + QWORD_BITSIZE));
+}
+
+static TARGET_PCLMUL uint_least64_t crc64_pclmul(BYTE const *buffer, BYTE const *bufferEnd, uint_least64_t crcRegister)
+{
+    static __m128i fold512, fold128;
+    static bool isFoldReady = false;
+
+    if (!isFoldReady)
+    {
+	fold512 = crcFoldConstants(PCLMUL_LANE_COUNT * PCLMUL_BLOCK_SIZE * BYTE_BITSIZE);
+	fold128 = crcFoldConstants(PCLMUL_BLOCK_SIZE * BYTE_BITSIZE);
+	isFoldReady = true;
+    }
+
+    __m128i lane[PCLMUL_LANE_COUNT];
+
+    for (unsigned index = 0u; index < PCLMUL_LANE_COUNT; index++)
+	lane[index] = _mm_loadu_si128((__m128i const *)(buffer + index * PCLMUL_BLOCK_SIZE));
+
+    lane[0u] = _mm_xor_si128(lane[0u], _mm_set_epi64x(0, (long long)crcRegister));
+    buffer += PCLMUL_LANE_COUNT * PCLMUL_BLOCK_SIZE;
+
+    while ((UINTN)(bufferEnd - buffer) >= PCLMUL_LANE_COUNT * PCLMUL_BLOCK_SIZE)
+    {
+	for (unsigned index = 0u; index < PCLMUL_LANE_COUNT; index++)
+	    lane[index] = _mm_xor_si128(crcFold(lane[index], fold512), _mm_loadu_si128((__m128i const *)(buffer + index * PCLMUL_BLOCK_SIZE)));
+
+	buffer += PCLMUL_LANE_COUNT * PCLMUL_BLOCK_SIZE;
+    }
+
+    __m128i block = lane[0u];
+
+    for (unsigned index = 1u; index < PCLMUL_LANE_COUNT; index++)
+	block = _mm_xor_si128(crcFold(block, fold128), lane[index]);
+
+    while ((UINTN)(bufferEnd - buffer) >= PCLMUL_BLOCK_SIZE)
+	block = _mm_xor_si128(crcFold(block, fold128), _mm_loadu_si128((__m128i const *)buffer)), buffer += PCLMUL_BLOCK_SIZE;
+
+    // Shift the last block through the CRC register, then any QWORD left
+    crcRegister = crcShiftQWORD((uint_least64_t)_mm_cvtsi128_si64(block));
+    crcRegister = crcShiftQWORD(crcRegister ^ (uint_least64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(block, block)));
+
+    return crc64_table(buffer, bufferEnd, crcRegister);
+}
+
+#endif		// defined(SETUP_VAR_CRC_PCLMUL)
+
+uint_least64_t ecma128_crc64(BYTE const *buffer, BYTE const *bufferEnd, uint_least64_t crcValue)
+{
+    uint_least64_t crcRegister = ~crcValue & (uint_least64_t)UINT64_C(0xFFFF'FFFF'FFFF'FFFF);
+
+    if (!isCrcTableReady)
+	buildCrcTable();
+
+#if defined(SETUP_VAR_CRC_PCLMUL)
+    static signed char usePCLMUL = -1;
+
+    if (usePCLMUL < 0)
+	usePCLMUL = hasPCLMUL();
+
+    if (usePCLMUL && (UINTN)(bufferEnd - buffer) >= PCLMUL_MIN_SIZE)
+	return ~crc64_pclmul(buffer, bufferEnd, crcRegister) & (uint_least64_t)UINT64_C(0xFFFF'FFFF'FFFF'FFFF);
+#endif
+
+    return ~crc64_table(buffer, bufferEnd, crcRegister) & (uint_least64_t)UINT64_C(0xFFFF'FFFF'FFFF'FFFF);
+}
@@ -1,6 +1,8 @@
 
 #if defined(UEFI_SOURCE) || defined(EFIAPI)
 # include <Uefi.h>
+# include <Guid/EventGroup.h>
+# include <Library/UefiBootServicesTableLib.h>
 # include <Library/UefiRuntimeServicesTableLib.h>
 #else
 # if defined(WINDOWS) || defined(_WINDOWS) || defined(_WIN32) || defined(_WIN64)
@@ -11,6 +13,8 @@
 # endif
 #endif
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "LocalAppConfig.h"
@@ -22,94 +26,290 @@
 char const StatusVar_Name[] = "NvStrapsReBarStatus";
 
 #if defined(UEFI_SOURCE) || defined(EFIAPI)
-static uint_least8_t nVarCount = 2u;
-static uint_least64_t statusVar[NvStraps_GPU_MAX_COUNT + 1u] = { StatusVar_NotLoaded, StatusVar_NotLoaded };
+static uint_least64_t statusVar = StatusVar_NotLoaded;
+static uint_least8_t deviceRecordCount = 0u;
+static StatusVar_DeviceRecord deviceRecords[STATUS_VAR_DEVICE_MAX_COUNT];
 
-static inline uint_least16_t MakeBusLocation(uint_least8_t bus, uint_least8_t device, uint_least8_t function)
+static BYTE *StatusVar_DeviceRecord_pack(BYTE *buffer, StatusVar_DeviceRecord const *record)
 {
-    return (uint_least16_t)bus << 8u | ((uint_least16_t)device & 0b0001'1111u) << 3u | function & 0b0111u;
+    buffer = pack_WORD(buffer, record->segment);
+    buffer = pack_WORD(buffer, record->busLocation);
+    buffer = pack_BYTE(buffer, record->flags);
+    buffer = pack_BYTE(buffer, record->status);
+    buffer = pack_BYTE(buffer, record->errorLocation);
+    buffer = pack_BYTE(buffer, record->errorStatus);
+    buffer = pack_BYTE(buffer, record->strapsStatus);
+    buffer = pack_BYTE(buffer, record->barSizeSelector);
+    buffer = pack_DWORD(buffer, record->reBarSizeMask);
+
+    return buffer;
 }
 
-static inline UINT16 PciAddressToBusLocation(UINTN pciAddress)
+// Status is kept in memory and written once at ReadyToBoot, unless the immediate mode is set
+static bool isStatusVarDirty = false, flushStatusImmediately = false;
+static uint_least16_t statusVarLocation = 0u;
+static EFI_EVENT readyToBootEvent = NULL;
+
+static EFI_STATUS WriteStatusVar(void)
 {
-    return MakeBusLocation(pciAddress >> 24u & 0xFFu, pciAddress >> 16u & 0xFFu, pciAddress >> 8u & 0xFFu);
+    isStatusVarDirty = true;
+
+    return flushStatusImmediately ? StatusVar_Flush() : EFI_SUCCESS;
 }
 
-static EFI_STATUS WriteStatusVar(uint_least16_t pciLocation)
+EFI_STATUS StatusVar_Flush(void)
 {
+    if (!isStatusVarDirty)
+	return EFI_SUCCESS;
+
     uint_least64_t var =
-           (uint_least64_t)pciLocation << (WORD_BITSIZE + DWORD_BITSIZE)
-         | (uint_least64_t)statusVar[0u] & UINT64_C(0x0000FFFF'FFFFFFFF);
+           (uint_least64_t)statusVarLocation << (WORD_BITSIZE + DWORD_BITSIZE)
+         | ((uint_least64_t)statusVar & UINT64_C(0x0000FFFF'FFFFFFFF));
+
+    BYTE buffer[STATUS_VAR_MAX_SIZE], *bufferEnd = pack_QWORD(buffer, var);
+
+    // Without device records the variable keeps the original 8-byte layout
+    if (deviceRecordCount)
+    {
+	bufferEnd = pack_BYTE(bufferEnd, deviceRecordCount);
+
+	for (unsigned i = 0u; i < deviceRecordCount; i++)
+	    bufferEnd = StatusVar_DeviceRecord_pack(bufferEnd, deviceRecords + i);
+    }
+
+    EFI_STATUS status = WriteEfiVariable(StatusVar_Name, buffer, (uint_least32_t)(bufferEnd - buffer), EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS);
+
+    if (!EFI_ERROR(status))
+	isStatusVarDirty = false;
+
+    return status;
+}
+
+static VOID EFIAPI StatusVar_ReadyToBoot(EFI_EVENT event, VOID *context)
+{
+    StatusVar_Flush();
+
+    gBS->CloseEvent(event);
+    readyToBootEvent = NULL;
+}
+
+void StatusVar_Init(bool flushImmediately)
+{
+    flushStatusImmediately = flushImmediately;
+
+    if (flushImmediately)
+	StatusVar_Flush();
+    else
+	if (!readyToBootEvent)
+	{
+	    EFI_STATUS status = gBS->CreateEventEx(EVT_NOTIFY_SIGNAL, TPL_CALLBACK, &StatusVar_ReadyToBoot, NULL, &gEfiEventReadyToBootGuid, &readyToBootEvent);
+
+	    if (EFI_ERROR(status))
+	    {
+		// No callback, so write every status update as it happens
+		readyToBootEvent = NULL;
+		flushStatusImmediately = true;
+		SetEFIError(EFIError_CreateEvent, status);
+		StatusVar_Flush();
+	    }
+	}
+}
+
+static inline uint_least16_t PciAddressToBusLocation(UINTN pciAddress)
+{
+    uint_least8_t bus, dev, fun;
 
-    BYTE buffer[QWORD_SIZE];
+    pciUnpackAddress(pciAddress, &bus, &dev, &fun);
 
-    return WriteEfiVariable(StatusVar_Name, buffer, (uint_least32_t)(pack_QWORD(buffer, var) - buffer), EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS);
-};
+    return pciPackLocation(bus, dev, fun);
+}
 
-static void SetStatusVarInternal(StatusVar val, uint_least16_t pciLocation)
+static StatusVar_DeviceRecord *FindDeviceRecord(UINTN pciAddress)
 {
-    if (val > statusVar[0u])
+    uint_least16_t segment = pciAddressSegment(pciAddress), busLocation = PciAddressToBusLocation(pciAddress);
+
+    for (unsigned i = 0u; i < deviceRecordCount; i++)
+	if (deviceRecords[i].segment == segment && deviceRecords[i].busLocation == busLocation)
+	    return deviceRecords + i;
+
+    if (deviceRecordCount < ARRAY_SIZE(deviceRecords))
     {
-        statusVar[0u] = val;
-        WriteStatusVar(pciLocation);
+	StatusVar_DeviceRecord *record = deviceRecords + deviceRecordCount++;
+
+	record->segment = segment;
+	record->busLocation = busLocation;
+	record->flags = 0u;
+	record->status = 0u;
+	record->errorLocation = EFIError_None;
+	record->errorStatus = 0u;
+	record->strapsStatus = 0u;
+	record->barSizeSelector = BarSizeSelector_None;
+	record->reBarSizeMask = 0u;
+
+	return record;
     }
+
+    return NULL;
 }
 
-void SetStatusVar(StatusVar val)
+static inline bool IsStrapsStatus(StatusVar val)
 {
-    SetStatusVarInternal(val, 0u);
+    return val == StatusVar_GpuStrapsConfigured || val == StatusVar_GpuStrapsPreConfigured || val == StatusVar_GpuStrapsConfirm || val == StatusVar_GpuStrapsNoConfirm;
+}
+
+static bool SetStatusVarInternal(StatusVar val, uint_least16_t pciLocation)
+{
+    if (val > statusVar)
+    {
+        statusVar = val;
+	statusVarLocation = pciLocation;
+
+	return true;
+    }
+
+    return false;
 }
 
-void SetEFIErrorInternal(EFIErrorLocation errLocation, EFI_STATUS status, uint_least16_t pciLocation)
+static bool SetEFIErrorInternal(EFIErrorLocation errLocation, EFI_STATUS status, uint_least16_t pciLocation)
 {
-    if (statusVar[0u] < UINT64_C(1) << DWORD_BITSIZE)
+    if (statusVar < UINT64_C(1) << DWORD_BITSIZE)
     {
         uint_least64_t value =
                    (uint_least64_t)(+errLocation & +BYTE_BITMASK) << (DWORD_BITSIZE + BYTE_BITSIZE)
                  | (uint_least64_t)(status & BYTE_BITMASK) << DWORD_BITSIZE
                  | StatusVar_Internal_EFIError;
 
-        statusVar[0u] = value;
-        WriteStatusVar(pciLocation);
+        statusVar = value;
+	statusVarLocation = pciLocation;
+
+	return true;
     }
+
+    return false;
+}
+
+void SetStatusVar(StatusVar val)
+{
+    if (SetStatusVarInternal(val, 0u))
+	WriteStatusVar();
 }
 
 void SetEFIError(EFIErrorLocation errLocation, EFI_STATUS status)
 {
-    SetEFIErrorInternal(errLocation, status, 0u);
+    if (SetEFIErrorInternal(errLocation, status, 0u))
+	WriteStatusVar();
 }
 
 void SetDeviceEFIError(UINTN pciAddress, EFIErrorLocation errLocation, EFI_STATUS status)
 {
-    uint_least8_t bus, dev, fun;
+    StatusVar_DeviceRecord *record = FindDeviceRecord(pciAddress);
+    bool isChanged = false;
 
-    pciUnpackAddress(pciAddress, &bus, &dev, &fun);
-    SetEFIErrorInternal(errLocation, status, pciPackLocation(bus, dev, fun));
+    if (record && record->errorLocation == EFIError_None)
+    {
+	record->errorLocation = errLocation & BYTE_BITMASK;
+	record->errorStatus = status & BYTE_BITMASK;
+
+	if (record->status < StatusVar_Internal_EFIError)
+	    record->status = StatusVar_Internal_EFIError;
+
+	isChanged = true;
+    }
+
+    if (SetEFIErrorInternal(errLocation, status, PciAddressToBusLocation(pciAddress)) || isChanged)
+	WriteStatusVar();
 }
 
 void SetDeviceStatusVar(UINTN pciAddress, StatusVar val)
 {
-    uint_least8_t bus, dev, fun;
+    StatusVar_DeviceRecord *record = FindDeviceRecord(pciAddress);
+    bool isChanged = false;
 
-    pciUnpackAddress(pciAddress, &bus, &dev, &fun);
-    SetStatusVarInternal(val, pciPackLocation(bus, dev, fun));
+    if (record)
+    {
+	if (val == StatusVar_BridgeFound && !(record->flags & StatusVar_DeviceRecord_Bridge))
+	    record->flags |= StatusVar_DeviceRecord_Bridge, isChanged = true;
+
+	if (val > record->status)
+	    record->status = val, isChanged = true;
+
+	if (IsStrapsStatus(val) && record->strapsStatus != val)
+	    record->strapsStatus = val, isChanged = true;
+    }
+
+    if (SetStatusVarInternal(val, PciAddressToBusLocation(pciAddress)) || isChanged)
+	WriteStatusVar();
+}
+
+void SetDeviceBarSize(UINTN pciAddress, uint_least8_t barSizeSelector, uint_least32_t reBarSizeMask)
+{
+    StatusVar_DeviceRecord *record = FindDeviceRecord(pciAddress);
+
+    if (record && (record->barSizeSelector != barSizeSelector || record->reBarSizeMask != reBarSizeMask))
+    {
+	record->barSizeSelector = barSizeSelector;
+	record->reBarSizeMask = reBarSizeMask;
+
+	WriteStatusVar();
+    }
 }
 #else
-uint_least64_t ReadStatusVar(ERROR_CODE *errorCode)
+static BYTE const *StatusVar_DeviceRecord_unpack(BYTE const *buffer, StatusVar_DeviceRecord *record)
 {
-    BYTE buffer[QWORD_SIZE];
+    record->segment = unpack_WORD(buffer), buffer += WORD_SIZE;
+    record->busLocation = unpack_WORD(buffer), buffer += WORD_SIZE;
+    record->flags = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+    record->status = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+    record->errorLocation = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+    record->errorStatus = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+    record->strapsStatus = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+    record->barSizeSelector = unpack_BYTE(buffer), buffer += BYTE_SIZE;
+    record->reBarSizeMask = unpack_DWORD(buffer), buffer += DWORD_SIZE;
+
+    return buffer;
+}
+
+uint_least64_t ReadStatusVarRecords(ERROR_CODE *errorCode, StatusVar_DeviceRecord records[STATUS_VAR_DEVICE_MAX_COUNT], unsigned *recordCount)
+{
+    BYTE buffer[STATUS_VAR_MAX_SIZE];
     uint_least32_t size = sizeof buffer;
     *errorCode = ReadEfiVariable(StatusVar_Name, buffer, &size);
 
+    if (recordCount)
+	*recordCount = 0u;
+
     if (*errorCode)
         return StatusVar_NVAR_API_Error;
 
     if (size == 0u)
         return StatusVar_NotLoaded;
 
-    if (size != sizeof buffer)
+    if (size < QWORD_SIZE)
         return StatusVar_ParseError;
 
+    if (size > QWORD_SIZE)
+    {
+	unsigned count = unpack_BYTE(buffer + QWORD_SIZE);
+
+	if (count > STATUS_VAR_DEVICE_MAX_COUNT || size != QWORD_SIZE + BYTE_SIZE + count * STATUS_VAR_DEVICE_RECORD_SIZE)
+	    return StatusVar_ParseError;
+
+	if (records && recordCount)
+	{
+	    BYTE const *recordBuffer = buffer + QWORD_SIZE + BYTE_SIZE;
+
+	    for (unsigned i = 0u; i < count; i++)
+		recordBuffer = StatusVar_DeviceRecord_unpack(recordBuffer, records + i);
+
+	    *recordCount = count;
+	}
+    }
+
     return unpack_QWORD(buffer);
 }
+
+uint_least64_t ReadStatusVar(ERROR_CODE *errorCode)
+{
+    return ReadStatusVarRecords(errorCode, NULL, NULL);
+}
 #endif
@@ -0,0 +1,246 @@
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <Uefi.h>
+#include <Guid/EventGroup.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <IndustryStandard/Pci22.h>
+
+#if defined(_ASSERT)
+# undef _ASSERT
+#endif
+
+#include <Library/DebugLib.h>
+
+#include "LocalAppConfig.h"
+#include "EfiVariable.h"
+#include "StatusVar.h"
+#include "PciConfig.h"
+#include "pciRegs.h"
+#include "DeviceRecord.h"
+#include "TopologyCache.h"
+
+char const TopologyCache_Name[] = "NvStrapsReBarTopology";
+
+enum
+{
+    TOPOLOGY_CACHE_FLAG_DISPLAY = 0x01u,
+
+    TOPOLOGY_CACHE_BAR_SIZE = BYTE_SIZE + WORD_SIZE + DWORD_SIZE + DWORD_SIZE + BYTE_SIZE,
+    TOPOLOGY_CACHE_ENTRY_MAX_SIZE = 6u * WORD_SIZE + 2u * BYTE_SIZE + WORD_SIZE + BYTE_SIZE + PCI_MAX_BAR * TOPOLOGY_CACHE_BAR_SIZE,
+    TOPOLOGY_CACHE_VAR_MAX_SIZE = BYTE_SIZE + BYTE_SIZE + TOPOLOGY_CACHE_MAX_ENTRIES * TOPOLOGY_CACHE_ENTRY_MAX_SIZE
+};
+
+typedef struct TopologyCache_Entry
+{
+    uint_least16_t segment, location, vendorId, deviceId, subsysVenID, subsysDevID;
+    uint_least8_t flags, prefetchableBarMask;
+    PciReBarCapability reBar;
+    uint_least8_t barSizeBitIndex[PCI_MAX_BAR];
+}
+    TopologyCache_Entry;
+
+static TopologyCache_Entry cacheEntries[TOPOLOGY_CACHE_MAX_ENTRIES];
+static uint_least8_t cacheEntryCount = 0u, restoredCount = 0u;
+
+// Variable content loaded at boot, to only write the variable when it changes
+static BYTE cacheBuffer[TOPOLOGY_CACHE_VAR_MAX_SIZE];
+static uint_least32_t cacheSize = 0u;
+
+static EFI_EVENT readyToBootEvent = NULL;
+
+static BYTE const *TopologyCache_UnpackEntry(BYTE const *buffer, BYTE const *bufferEnd, TopologyCache_Entry *entry)
+{
+    if (bufferEnd - buffer < (ptrdiff_t)(6u * WORD_SIZE + 2u * BYTE_SIZE + WORD_SIZE + BYTE_SIZE))
+	return NULL;
+
+    SetMem(entry, sizeof *entry, 0u);
+
+    entry->segment = unpack_WORD(buffer), buffer += WORD_SIZE;
+    entry->location = unpack_WORD(buffer), buffer += WORD_SIZE;
+    entry->vendorId = unpack_WORD(buffer), buffer += WORD_SIZE;
+    entry->deviceId = unpack_WORD(buffer), buffer += WORD_SIZE;
+    entry->subsysVenID = unpack_WORD(buffer), buffer += WORD_SIZE;
+    entry->subsysDevID = unpack_WORD(buffer), buffer += WORD_SIZE;
+    entry->flags = unpack_BYTE(buffer++);
+    entry->prefetchableBarMask = unpack_BYTE(buffer++);
+    entry->reBar.capabilityOffset = unpack_WORD(buffer), buffer += WORD_SIZE;
+
+    uint_least8_t barCount = unpack_BYTE(buffer++);
+
+    if (barCount > PCI_MAX_BAR || bufferEnd - buffer < (ptrdiff_t)(barCount * TOPOLOGY_CACHE_BAR_SIZE))
+	return NULL;
+
+    for (uint_least8_t index = 0u; index < barCount; index++)
+    {
+	uint_least8_t barIndex = unpack_BYTE(buffer++);
+
+	if (barIndex >= PCI_MAX_BAR || entry->reBar.bar[barIndex].entryOffset)
+	    return NULL;
+
+	PciReBarEntry *barEntry = entry->reBar.bar + barIndex;
+
+	barEntry->entryOffset = unpack_WORD(buffer), buffer += WORD_SIZE;
+	barEntry->barControl = unpack_DWORD(buffer), buffer += DWORD_SIZE;
+	barEntry->sizeMask = unpack_DWORD(buffer), buffer += DWORD_SIZE;
+	barEntry->currentSize = (barEntry->barControl & PCI_REBAR_CTRL_BAR_SIZE) >> PCI_REBAR_CTRL_BAR_SHIFT;
+	entry->barSizeBitIndex[barIndex] = unpack_BYTE(buffer++);
+	entry->reBar.barCount++;
+    }
+
+    return buffer;
+}
+
+static BYTE *TopologyCache_PackRecord(BYTE *buffer, DeviceRecord const *record, uint_least16_t subsysVenID, uint_least16_t subsysDevID)
+{
+    uint_least8_t bus, dev, fun;
+
+    pciUnpackAddress(record->pciAddress, &bus, &dev, &fun);
+
+    buffer = pack_WORD(buffer, pciAddressSegment(record->pciAddress));
+    buffer = pack_WORD(buffer, pciPackLocation(bus, dev, fun));
+    buffer = pack_WORD(buffer, record->vendorId);
+    buffer = pack_WORD(buffer, record->deviceId);
+    buffer = pack_WORD(buffer, subsysVenID);
+    buffer = pack_WORD(buffer, subsysDevID);
+    buffer = pack_BYTE(buffer, record->isDisplay ? TOPOLOGY_CACHE_FLAG_DISPLAY : 0u);
+    buffer = pack_BYTE(buffer, record->prefetchableBarMask);
+    buffer = pack_WORD(buffer, record->reBar.capabilityOffset);
+    buffer = pack_BYTE(buffer, record->reBar.barCount);
+
+    for (uint_least8_t barIndex = 0u; barIndex < PCI_MAX_BAR; barIndex++)
+	if (record->reBar.bar[barIndex].entryOffset)
+	{
+	    buffer = pack_BYTE(buffer, barIndex);
+	    buffer = pack_WORD(buffer, record->reBar.bar[barIndex].entryOffset);
+	    buffer = pack_DWORD(buffer, record->reBar.bar[barIndex].barControl);
+	    buffer = pack_DWORD(buffer, record->reBar.bar[barIndex].sizeMask);
+	    buffer = pack_BYTE(buffer, record->barSizeBitIndex[barIndex]);
+	}
+
+    return buffer;
+}
+
+static void TopologyCache_Load(void)
+{
+    cacheSize = sizeof cacheBuffer;
+
+    EFI_STATUS status = ReadEfiVariable(TopologyCache_Name, cacheBuffer, &cacheSize);
+
+    // A missing or oversized variable is rebuilt at the end of the boot
+    if (EFI_ERROR(status) || cacheSize < 2u * BYTE_SIZE || unpack_BYTE(cacheBuffer) != TOPOLOGY_CACHE_VERSION)
+    {
+	cacheSize = 0u;
+	return;
+    }
+
+    BYTE const *buffer = cacheBuffer + 2u * BYTE_SIZE, *bufferEnd = cacheBuffer + cacheSize;
+    uint_least8_t entryCount = unpack_BYTE(cacheBuffer + BYTE_SIZE);
+
+    for (cacheEntryCount = 0u; cacheEntryCount < entryCount && cacheEntryCount < ARRAY_SIZE(cacheEntries); cacheEntryCount++)
+	if (!(buffer = TopologyCache_UnpackEntry(buffer, bufferEnd, cacheEntries + cacheEntryCount)))
+	{
+	    cacheEntryCount = 0u;
+	    break;
+	}
+}
+
+// Subsystem IDs come from the config header already loaded for the device, bridges have other registers there
+static bool TopologyCache_ReadSubsystem(DeviceRecord const *record, uint_least16_t *subsysVenID, uint_least16_t *subsysDevID)
+{
+    *subsysVenID = WORD_BITMASK, *subsysDevID = WORD_BITMASK;
+
+    return record->isBridge || !EFI_ERROR(pciReadDeviceSubsystem(record->pciAddress, subsysVenID, subsysDevID));
+}
+
+bool TopologyCache_Restore(DeviceRecord *record)
+{
+    if (!cacheEntryCount)
+	return false;
+
+    uint_least8_t bus, dev, fun;
+    uint_least16_t subsysVenID, subsysDevID;
+
+    pciUnpackAddress(record->pciAddress, &bus, &dev, &fun);
+
+    if (!TopologyCache_ReadSubsystem(record, &subsysVenID, &subsysDevID))
+	return false;
+
+    uint_least16_t segment = pciAddressSegment(record->pciAddress), location = pciPackLocation(bus, dev, fun);
+
+    for (TopologyCache_Entry const *entry = cacheEntries; entry < cacheEntries + cacheEntryCount; entry++)
+	if (entry->segment == segment && entry->location == location)
+	{
+	    if (entry->vendorId != record->vendorId || entry->deviceId != record->deviceId || entry->subsysVenID != subsysVenID || entry->subsysDevID != subsysDevID)
+		return false;
+
+	    record->isDisplay = !!(entry->flags & TOPOLOGY_CACHE_FLAG_DISPLAY);
+	    record->prefetchableBarMask = entry->prefetchableBarMask;
+	    CopyMem(&record->reBar, &entry->reBar, sizeof record->reBar);
+	    CopyMem(record->barSizeBitIndex, entry->barSizeBitIndex, sizeof record->barSizeBitIndex);
+	    restoredCount++;
+
+	    return true;
+	}
+
+    return false;
+}
+
+EFI_STATUS TopologyCache_Flush(void)
+{
+    static BYTE buffer[TOPOLOGY_CACHE_VAR_MAX_SIZE];
+    BYTE *bufferEnd = buffer + 2u * BYTE_SIZE;
+    uint_least8_t entryCount = 0u;
+
+    for (uint_least16_t index = 0u; index < DeviceRecord_Count() && entryCount < TOPOLOGY_CACHE_MAX_ENTRIES; index++)
+    {
+	DeviceRecord const *record = DeviceRecord_Get(index);
+	uint_least16_t subsysVenID, subsysDevID;
+
+	if (TopologyCache_ReadSubsystem(record, &subsysVenID, &subsysDevID))
+	    bufferEnd = TopologyCache_PackRecord(bufferEnd, record, subsysVenID, subsysDevID), entryCount++;
+    }
+
+    pack_BYTE(buffer, TOPOLOGY_CACHE_VERSION);
+    pack_BYTE(buffer + BYTE_SIZE, entryCount);
+
+    DEBUG((DEBUG_INFO, "ReBarDXE: %u of %u devices restored from the topology cache\n", restoredCount, entryCount));
+
+    uint_least32_t size = (uint_least32_t)(bufferEnd - buffer);
+
+    if (size == cacheSize && CompareMem(buffer, cacheBuffer, size) == 0)
+	return EFI_SUCCESS;
+
+    EFI_STATUS status = WriteEfiVariable(TopologyCache_Name, buffer, size, EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS);
+
+    if (EFI_ERROR(status))
+	SetEFIError(EFIError_WriteTopologyCache, status);
+
+    return status;
+}
+
+static VOID EFIAPI TopologyCache_ReadyToBoot(EFI_EVENT event, VOID *context)
+{
+    TopologyCache_Flush();
+
+    gBS->CloseEvent(event);
+    readyToBootEvent = NULL;
+}
+
+void TopologyCache_Init(bool enabled)
+{
+    if (!enabled || readyToBootEvent)
+	return;
+
+    TopologyCache_Load();
+
+    EFI_STATUS status = gBS->CreateEventEx(EVT_NOTIFY_SIGNAL, TPL_CALLBACK, &TopologyCache_ReadyToBoot, NULL, &gEfiEventReadyToBootGuid, &readyToBootEvent);
+
+    if (EFI_ERROR(status))
+    {
+	readyToBootEvent = NULL;
+	SetEFIError(EFIError_CreateEvent, status);
+    }
+}
@@ -0,0 +1,34 @@
+#if !defined(NV_STRAPS_REBAR_DEVICE_RECORD_H)
+#define NV_STRAPS_REBAR_DEVICE_RECORD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <Uefi.h>
+#include <IndustryStandard/Pci22.h>
+
+#include "PciConfig.h"
+
+// Decisions taken for a device on the first PreprocessController call, to be re-applied on the second call
+typedef struct DeviceRecord
+{
+    UINTN pciAddress;
+    uint_least16_t vendorId, deviceId, subsysVenID, subsysDevID;
+    bool isSelectedGpu, isDisplay, isBridge;
+    PciReBarCapability reBar;
+    uint_least8_t barSizeBitIndex[PCI_MAX_BAR];	    // 0 if the BAR size is not changed
+    uint_least8_t prefetchableBarMask;		    // 64-bit prefetchable memory BARs
+    uint_least16_t nextRecord;
+}
+    DeviceRecord;
+
+DeviceRecord *DeviceRecord_Find(UINTN pciAddress);
+
+// Pointers to previous records are invalidated when a new record is added
+DeviceRecord *DeviceRecord_Add(UINTN pciAddress);
+
+// Records in the order they were added
+uint_least16_t DeviceRecord_Count(void);
+DeviceRecord *DeviceRecord_Get(uint_least16_t index);
+
+#endif	    // !defined(NV_STRAPS_REBAR_DEVICE_RECORD_H)
@@ -0,0 +1,124 @@
+// Generated by tools/genDeviceRegistry.py from DeviceRegistry.lst, do not edit.
+// Sorted by device ID, for lookupBarSizeInRegistry() in DeviceRegistry.c
+
+#if !defined(NV_STRAPS_REBAR_DEVICE_REGISTRY_TABLE_H)
+#define NV_STRAPS_REBAR_DEVICE_REGISTRY_TABLE_H
+
+#include "DeviceRegistry.h"
+
+typedef struct DeviceRegistryEntry
+{
+    UINT16 deviceID;
+    BarSizeSelector barSize;
+}
+    DeviceRegistryEntry;
+
+#if defined(__cplusplus) && !defined(NVSTRAPS_DXE_DRIVER)
+    constexpr
+#else
+    static
+#endif
+	DeviceRegistryEntry const DeviceRegistryTable[] =
+{
+    { 0x1E02u, BarSizeSelector_32G },           // TU102 [Titan RTX] 24GB
+    { 0x1E03u, BarSizeSelector_16G },           // TU102 [GeForce RTX 2080 Ti 12GB]
+    { 0x1E04u, BarSizeSelector_16G },           // TU102 [GeForce RTX 2080 Ti] 11GB
+    { 0x1E07u, BarSizeSelector_16G },           // TU102 [GeForce RTX 2080 Ti Rev. A] 11GB
+    { 0x1E09u, BarSizeSelector_16G },           // TU102 [CMP 50HX] 10GB
+    { 0x1E2Du, BarSizeSelector_16G },           // TU102 [GeForce RTX 2080 Ti Engineering Sample] 11GB ???
+    { 0x1E2Eu, BarSizeSelector_16G },           // TU102 [GeForce RTX 2080 Ti 12GB Engineering Sample]
+    { 0x1E30u, BarSizeSelector_Excluded },      // TU102GL [Quadro RTX 6000/8000] 24GB / 48GB
+    { 0x1E36u, BarSizeSelector_Excluded },      // TU102GL [Quadro RTX 6000]	24GB
+    { 0x1E37u, BarSizeSelector_Excluded },      // TU102GL [Tesla T10 16GB / GRID RTX T10-2/T10-4/T10-8]
+    { 0x1E38u, BarSizeSelector_Excluded },      // TU102GL [Tesla T40 24GB]
+    { 0x1E3Cu, BarSizeSelector_Excluded },      // TU102GL
+    { 0x1E3Du, BarSizeSelector_Excluded },      // TU102GL
+    { 0x1E3Eu, BarSizeSelector_Excluded },      // TU102GL
+    { 0x1E78u, BarSizeSelector_Excluded },      // TU102GL [Quadro RTX 6000/8000] 24GB / 48GB
+    { 0x1E81u, BarSizeSelector_8G },            // TU104 [GeForce RTX 2080 SUPER] 8GB
+    { 0x1E82u, BarSizeSelector_8G },            // TU104 [GeForce RTX 2080] 8GB
+    { 0x1E84u, BarSizeSelector_8G },            // TU104 [GeForce RTX 2070 SUPER] 8GB
+    { 0x1E87u, BarSizeSelector_8G },            // TU104 [GeForce RTX 2080 Rev. A] 8GB
+    { 0x1E89u, BarSizeSelector_8G },            // TU104 [GeForce RTX 2060] 6GB
+    { 0x1E90u, BarSizeSelector_8G },            // TU104M [GeForce RTX 2080 Mobile] 8GB
+    { 0x1E91u, BarSizeSelector_8G },            // TU104M [GeForce RTX 2070 SUPER Mobile / Max-Q] 8GB
+    { 0x1E93u, BarSizeSelector_8G },            // TU104M [GeForce RTX 2080 SUPER Mobile / Max-Q] 8GB
+    { 0x1EABu, BarSizeSelector_8G },            // TU104M [GeForce RTX 2080 Mobile] 8GB
+    { 0x1EAEu, BarSizeSelector_8G },            // TU104M [GeForce GTX 2080 Engineering Sample] 8GB ???
+    { 0x1EB0u, BarSizeSelector_16G },           // TU104GL [Quadro RTX 5000] 16GB
+    { 0x1EB1u, BarSizeSelector_8G },            // TU104GL [Quadro RTX 4000]  8GB
+    { 0x1EB4u, BarSizeSelector_16G },           // TU104GL [Tesla T4G] 16GB
+    { 0x1EB5u, BarSizeSelector_16G },           // TU104GLM [Quadro RTX 5000 Mobile / Max-Q] 16GB
+    { 0x1EB6u, BarSizeSelector_8G },            // TU104GLM [Quadro RTX 4000 Mobile / Max-Q] 8GB
+    { 0x1EB8u, BarSizeSelector_16G },           // TU104GL [Tesla T4] 16GB
+    { 0x1EB9u, BarSizeSelector_Excluded },      // TU104GL [T4 32GB]
+    { 0x1EBAu, BarSizeSelector_Excluded },      // TU104GL [PG189 SKU600]
+    { 0x1EBEu, BarSizeSelector_Excluded },      // TU104GL
+    { 0x1EC2u, BarSizeSelector_8G },            // TU104 [GeForce RTX 2070 SUPER] 8GB
+    { 0x1EC7u, BarSizeSelector_8G },            // TU104 [GeForce RTX 2070 SUPER] 8GB
+    { 0x1ED0u, BarSizeSelector_8G },            // TU104BM [GeForce RTX 2080 Mobile] 8GB
+    { 0x1ED1u, BarSizeSelector_8G },            // TU104BM [GeForce RTX 2070 SUPER Mobile / Max-Q] 8GB
+    { 0x1ED3u, BarSizeSelector_8G },            // TU104BM [GeForce RTX 2080 SUPER Mobile / Max-Q] 8GB
+    { 0x1EF5u, BarSizeSelector_16G },           // TU104GLM [Quadro RTX 5000 Mobile Refresh] 16GB
+    { 0x1F02u, BarSizeSelector_8G },            // TU106 [GeForce RTX 2070] 8GB
+    { 0x1F03u, BarSizeSelector_16G },           // TU106 [GeForce RTX 2060 12GB] 12GB
+    { 0x1F06u, BarSizeSelector_8G },            // TU106 [GeForce RTX 2060 SUPER] 8GB
+    { 0x1F07u, BarSizeSelector_8G },            // TU106 [GeForce RTX 2070 Rev. A] 8GB
+    { 0x1F08u, BarSizeSelector_8G },            // TU106 [GeForce RTX 2060 Rev. A] 6GB
+    { 0x1F09u, BarSizeSelector_8G },            // TU106 [GeForce GTX 1660 SUPER] 6GB
+    { 0x1F0Au, BarSizeSelector_4G },            // TU106 [GeForce GTX 1650] 4GB
+    { 0x1F0Bu, BarSizeSelector_8G },            // TU106 [CMP 40HX] 8GB
+    { 0x1F10u, BarSizeSelector_8G },            // TU106M [GeForce RTX 2070 Mobile] 8GB
+    { 0x1F11u, BarSizeSelector_8G },            // TU106M [GeForce RTX 2060 Mobile] 6GB
+    { 0x1F12u, BarSizeSelector_8G },            // TU106M [GeForce RTX 2060 Max-Q] 6GB
+    { 0x1F14u, BarSizeSelector_8G },            // TU106M [GeForce RTX 2070 Mobile / Max-Q Refresh] 8GB
+    { 0x1F15u, BarSizeSelector_8G },            // TU106M [GeForce RTX 2060 Mobile] 6GB
+    { 0x1F36u, BarSizeSelector_8G },            // TU106GLM [Quadro RTX 3000 Mobile / Max-Q] 6GB
+    { 0x1F42u, BarSizeSelector_8G },            // TU106 [GeForce RTX 2060 SUPER]  8GB
+    { 0x1F47u, BarSizeSelector_8G },            // TU106 [GeForce RTX 2060 SUPER]  8gb
+    { 0x1F50u, BarSizeSelector_8G },            // TU106BM [GeForce RTX 2070 Mobile / Max-Q] 8GB
+    { 0x1F51u, BarSizeSelector_8G },            // TU106BM [GeForce RTX 2060 Mobile] 6GB
+    { 0x1F54u, BarSizeSelector_8G },            // TU106BM [GeForce RTX 2070 Mobile] 8GB
+    { 0x1F55u, BarSizeSelector_8G },            // TU106BM [GeForce RTX 2060 Mobile] 6GB
+    { 0x1F76u, BarSizeSelector_8G },            // TU106GLM [Quadro RTX 3000 Mobile Refresh] 6GB
+    { 0x1F82u, BarSizeSelector_4G },            // TU117 [GeForce GTX 1650] 4GB
+    { 0x1F83u, BarSizeSelector_4G },            // TU117 [GeForce GTX 1630] 4GB
+    { 0x1F91u, BarSizeSelector_4G },            // TU117M [GeForce GTX 1650 Mobile / Max-Q] 4GB
+    { 0x1F92u, BarSizeSelector_4G },            // TU117M [GeForce GTX 1650 Mobile] 4GB
+    { 0x1F94u, BarSizeSelector_4G },            // TU117M [GeForce GTX 1650 Mobile] 4GB
+    { 0x1F95u, BarSizeSelector_4G },            // TU117M [GeForce GTX 1650 Ti Mobile] 4GB
+    { 0x1F96u, BarSizeSelector_4G },            // TU117M [GeForce GTX 1650 Mobile / Max-Q] 4GB
+    { 0x1F97u, BarSizeSelector_2G },            // TU117M [GeForce MX450] 2GB
+    { 0x1F98u, BarSizeSelector_2G },            // TU117M [GeForce MX450] 2GB
+    { 0x1F99u, BarSizeSelector_4G },            // TU117M [GeForce GTX 1650 Mobile / Max-Q] 4GB
+    { 0x1F9Cu, BarSizeSelector_2G },            // TU117M [GeForce MX450] 2GB
+    { 0x1F9Du, BarSizeSelector_4G },            // TU117M [GeForce GTX 1650 Mobile / Max-Q] 4GB
+    { 0x1F9Fu, BarSizeSelector_2G },            // TU117M [GeForce MX550] 2GB
+    { 0x1FA0u, BarSizeSelector_2G },            // TU117M [GeForce MX550] 2GB
+    { 0x1FB0u, BarSizeSelector_4G },            // TU117GLM [Quadro T1000 Mobile] 4GB
+    { 0x1FB1u, BarSizeSelector_4G },            // TU117GL [T600] 4GB
+    { 0x1FB2u, BarSizeSelector_4G },            // TU117GLM [Quadro T400 Mobile] 4GB ??
+    { 0x1FB6u, BarSizeSelector_4G },            // TU117GLM [T600 Laptop GPU] 4GB
+    { 0x1FB7u, BarSizeSelector_4G },            // TU117GLM [T550 Laptop GPU] 4GB
+    { 0x1FB8u, BarSizeSelector_4G },            // TU117GLM [Quadro T2000 Mobile / Max-Q] 4GB
+    { 0x1FB9u, BarSizeSelector_4G },            // TU117GLM [Quadro T1000 Mobile] 4GB
+    { 0x1FBAu, BarSizeSelector_4G },            // TU117GLM [T600 Mobile] 4GB
+    { 0x1FBBu, BarSizeSelector_4G },            // TU117GLM [Quadro T500 Mobile] 4GB
+    { 0x1FBCu, BarSizeSelector_4G },            // TU117GLM [T1200 Laptop GPU] 4GB
+    { 0x1FD9u, BarSizeSelector_4G },            // TU117BM [GeForce GTX 1650 Mobile Refresh] 4GB
+    { 0x1FDDu, BarSizeSelector_4G },            // TU117BM [GeForce GTX 1650 Mobile Refresh] 4GB
+    { 0x1FF0u, BarSizeSelector_8G },            // TU117GL [T1000 8GB]
+    { 0x1FF2u, BarSizeSelector_4G },            // TU117GL [T400 4GB]
+    { 0x1FF9u, BarSizeSelector_4G },            // TU117GLM [Quadro T1000 Mobile] 4GB
+    { 0x2182u, BarSizeSelector_8G },            // TU116 [GeForce GTX 1660 Ti] 6GB
+    { 0x2183u, BarSizeSelector_8G },            // TU116 [GeForce GTX 1660 Ti 8GB] 8GB
+    { 0x2184u, BarSizeSelector_8G },            // TU116 [GeForce GTX 1660] 6GB
+    { 0x2187u, BarSizeSelector_4G },            // TU116 [GeForce GTX 1650 SUPER] 4GB
+    { 0x2188u, BarSizeSelector_4G },            // TU116 [GeForce GTX 1650] 4GB
+    { 0x2189u, BarSizeSelector_8G },            // TU116 [CMP 30HX] 6GB
+    { 0x2191u, BarSizeSelector_8G },            // TU116M [GeForce GTX 1660 Ti Mobile] 6GB
+    { 0x2192u, BarSizeSelector_4G },            // TU116M [GeForce GTX 1650 Ti Mobile] 4GB
+    { 0x21C4u, BarSizeSelector_8G },            // TU116 [GeForce GTX 1660 SUPER] 6GB
+};
+
+#endif          // !defined(NV_STRAPS_REBAR_DEVICE_REGISTRY_TABLE_H)
@@ -37,8 +37,9 @@ inline BYTE *pack_WORD(BYTE *buffer, uint_least16_t value);
 inline BYTE *pack_DWORD(BYTE *buffer, uint_least32_t value);
 inline BYTE *pack_QWORD(BYTE *buffer, uint_least64_t value);
 
-ERROR_CODE ReadEfiVariable(char const name[MAX_VARIABLE_NAME_LENGTH], BYTE *buffer, uint_least32_t *size);
-ERROR_CODE WriteEfiVariable(char const name[MAX_VARIABLE_NAME_LENGTH], BYTE /* const */ *buffer, uint_least32_t size, uint_least32_t attributes);
+// Variable names are up to MAX_VARIABLE_NAME_LENGTH characters
+ERROR_CODE ReadEfiVariable(char const *name, BYTE *buffer, uint_least32_t *size);
+ERROR_CODE WriteEfiVariable(char const *name, BYTE /* const */ *buffer, uint_least32_t size, uint_least32_t attributes);
 
 inline uint_least8_t unpack_BYTE(BYTE const *buffer)
 {
@@ -45,7 +45,8 @@ typedef enum ConfigPriority
 
 enum
 {
-    NvStraps_GPU_MAX_COUNT = 8u
+    NvStraps_GPU_MAX_COUNT = 16u,
+    NvStraps_BRIDGE_MAX_COUNT = NvStraps_GPU_MAX_COUNT + 2u
 };
 
 enum
@@ -152,6 +153,30 @@ typedef struct NvStraps_BarSizeMaskOverride
 }
     NvStraps_BarSizeMaskOverride;
 
+// All configuration for one GPU, resolved at once
+typedef struct NvStraps_GPUPolicy
+{
+    NvStraps_BarSize barSize;
+    NvStraps_BarSizeMaskOverride sizeMaskOverride;
+    NvStraps_GPUConfig const *gpuConfig;
+    NvStraps_BridgeConfig const *bridgeConfig;
+}
+    NvStraps_GPUPolicy;
+
+// Which UEFI variable holds the firmware setup options, as found by the last full enumeration
+typedef enum NvStraps_SetupVarName
+{
+    SetupVarName_None = 0u,
+    SetupVarName_Custom = 1u,
+    SetupVarName_Setup = 2u
+}
+    NvStraps_SetupVarName;
+
+enum
+{
+    SETUP_VAR_GUID_SIZE = 16u
+};
+
 typedef struct NvStrapsConfig
 {
     bool dirty;
@@ -159,14 +184,19 @@ typedef struct NvStrapsConfig
     uint_least16_t nOptionFlags;
     uint_least64_t nSetupVarCRC;
 
+    uint_least8_t setupVarName;					    // NvStraps_SetupVarName
+    uint_least8_t setupVarGUID[SETUP_VAR_GUID_SIZE];		    // EFI_GUID, little-endian fields
+    uint_least32_t setupVarSize;
+
     uint_least8_t nGPUSelector;
     NvStraps_GPUSelector GPUs[NvStraps_GPU_MAX_COUNT];
+    uint_least8_t gpuSelectorIndex[NvStraps_GPU_MAX_COUNT];	    // GPUs[] sorted by device ID and tier, not saved
 
     uint_least8_t nGPUConfig;
     NvStraps_GPUConfig gpuConfig[NvStraps_GPU_MAX_COUNT];
 
     uint_least8_t nBridgeConfig;
-    NvStraps_BridgeConfig bridge[NvStraps_GPU_MAX_COUNT + 2u];
+    NvStraps_BridgeConfig bridge[NvStraps_BRIDGE_MAX_COUNT];
 
 #if defined(__cplusplus) && !defined(NVSTRAPS_DXE_DRIVER)
     bool isDirty() const;
@@ -181,6 +211,10 @@ typedef struct NvStrapsConfig
     bool hasSetupVarCRC(bool hasCRC);
     bool enableSetupVarCRC() const;
     bool enableSetupVarCRC(bool enableCRC);
+    bool usePciECAM() const;
+    bool usePciECAM(bool useECAM);
+    bool flushStatusImmediately() const;
+    bool flushStatusImmediately(bool flushImmediately);
 
     uint_least8_t targetPciBarSizeSelector() const;
     uint_least8_t targetPciBarSizeSelector(uint_least8_t barSizeSelector);
@@ -212,13 +246,25 @@ typedef struct NvStrapsConfig
 }
     NvStrapsConfig;
 
+// Version 0 is the original fixed layout, starting with the PCI BAR size. Later versions start with a marker byte
+// that is never a valid BAR size, followed by the format version, the header, the record counts, and the records
+// with a leading flags byte, each record only as long as needed. The Setup variable identity, if known, follows
+// the records.
 enum
 {
+    NV_STRAPS_FORMAT_MARKER = 0xFEu,
+    NV_STRAPS_FORMAT_VERSION = 1u,
+
     NV_STRAPS_HEADER_SIZE = BYTE_SIZE /* PCI BAR size */ + WORD_SIZE /* Option flags */ + QWORD_SIZE /* SetupVar CRC64 */,
-    NV_STRAPS_CONFIG_SIZE = NV_STRAPS_HEADER_SIZE
-        + BYTE_SIZE + GPU_SELECTOR_SIZE * NvStraps_GPU_MAX_COUNT
-        + BYTE_SIZE + GPU_CONFIG_SIZE * NvStraps_GPU_MAX_COUNT
-        + BYTE_SIZE + BRIDGE_CONFIG_SIZE * (NvStraps_GPU_MAX_COUNT + 2u)
+    NV_STRAPS_V1_HEADER_SIZE = BYTE_SIZE /* marker */ + BYTE_SIZE /* version */ + NV_STRAPS_HEADER_SIZE + 3u * BYTE_SIZE /* record counts */,
+    NV_STRAPS_SETUP_VAR_ID_SIZE = BYTE_SIZE /* name */ + SETUP_VAR_GUID_SIZE + DWORD_SIZE /* size */,
+
+    // Worst case with every record at full length: 757 bytes for 16 GPUs, below the 1 KiB variable size limit found on most firmware
+    NV_STRAPS_CONFIG_SIZE = NV_STRAPS_V1_HEADER_SIZE
+        + (BYTE_SIZE + GPU_SELECTOR_SIZE) * NvStraps_GPU_MAX_COUNT
+        + (BYTE_SIZE + GPU_CONFIG_SIZE) * NvStraps_GPU_MAX_COUNT
+        + (BYTE_SIZE + BRIDGE_CONFIG_SIZE) * NvStraps_BRIDGE_MAX_COUNT
+        + NV_STRAPS_SETUP_VAR_ID_SIZE
 };
 
 #define NVSTRAPSCONFIG_BUFFERSIZE(config)       NV_STRAPS_CONFIG_SIZE
@@ -230,40 +276,53 @@ extern "C"
 
 extern char const NvStrapsConfig_VarName[];
 
-bool NvStrapsConfig_GPUSelector_DeviceMatch(NvStraps_GPUSelector const *selector, uint_least16_t devID);
-bool NvStrapsConfig_GPUSelector_SubsystemMatch(NvStraps_GPUSelector const *selector, uint_least16_t subsysVenID, uint_least16_t subsysDevID);
-bool NvStrapsConfig_GPUSelector_BusLocationMatch(NvStraps_GPUSelector const *selector, uint_least8_t busNr, uint_least8_t dev, uint_least8_t func);
-bool NvStrapsConfig_GPUConfig_DeviceMatch(NvStraps_GPUConfig const *config, uint_least16_t devID);
-bool NvStrapsConfig_GPUConfig_SubsystemMatch(NvStraps_GPUConfig const *config, uint_least16_t subsysVenID, uint_least16_t subsysDevID);
-bool NvStrapsConfig_BridgeConfig_DeviceMatch(NvStraps_BridgeConfig const *config, uint_least16_t venID, uint_least16_t devID);
-bool NvStrapsConfig_BridgeConfig_BusLocationMatch(NvStraps_BridgeConfig const *config, uint_least8_t bus, uint_least8_t dev, uint_least8_t func);
-uint_least8_t NvStrapsConfig_TargetPciBarSizeSelector(NvStrapsConfig const *config);
-uint_least8_t NvStrapsConfig_SetTargetPciBarSizeSelector(NvStrapsConfig *config, uint_least8_t barSizeSelector);
-uint_least8_t NvStrapsConfig_IsGlobalEnable(NvStrapsConfig const *config);
-uint_least8_t NvStrapsConfig_SetGlobalEnable(NvStrapsConfig *config, uint_least8_t globalEnable);
-uint_least64_t NvStrapsConfig_SetupVarCRC(NvStrapsConfig const *config);
-uint_least64_t NvStrapsConfig_SetSetupVarCRC(NvStrapsConfig *config, uint_least64_t varCRC);
+inline bool NvStrapsConfig_GPUSelector_DeviceMatch(NvStraps_GPUSelector const *selector, uint_least16_t devID);
+inline bool NvStrapsConfig_GPUSelector_SubsystemMatch(NvStraps_GPUSelector const *selector, uint_least16_t subsysVenID, uint_least16_t subsysDevID);
+inline bool NvStrapsConfig_GPUSelector_BusLocationMatch(NvStraps_GPUSelector const *selector, uint_least8_t busNr, uint_least8_t dev, uint_least8_t func);
+inline bool NvStrapsConfig_GPUConfig_DeviceMatch(NvStraps_GPUConfig const *config, uint_least16_t devID);
+inline bool NvStrapsConfig_GPUConfig_SubsystemMatch(NvStraps_GPUConfig const *config, uint_least16_t subsysVenID, uint_least16_t subsysDevID);
+inline bool NvStrapsConfig_BridgeConfig_DeviceMatch(NvStraps_BridgeConfig const *config, uint_least16_t venID, uint_least16_t devID);
+inline bool NvStrapsConfig_BridgeConfig_BusLocationMatch(NvStraps_BridgeConfig const *config, uint_least8_t bus, uint_least8_t dev, uint_least8_t func);
+inline uint_least8_t NvStrapsConfig_TargetPciBarSizeSelector(NvStrapsConfig const *config);
+inline uint_least8_t NvStrapsConfig_SetTargetPciBarSizeSelector(NvStrapsConfig *config, uint_least8_t barSizeSelector);
+inline uint_least8_t NvStrapsConfig_IsGlobalEnable(NvStrapsConfig const *config);
+inline uint_least8_t NvStrapsConfig_SetGlobalEnable(NvStrapsConfig *config, uint_least8_t globalEnable);
+inline uint_least64_t NvStrapsConfig_SetupVarCRC(NvStrapsConfig const *config);
+inline uint_least64_t NvStrapsConfig_SetSetupVarCRC(NvStrapsConfig *config, uint_least64_t varCRC);
 bool NvStrapsConfig_SetGPUConfig(NvStrapsConfig *config, NvStraps_GPUConfig const *gpuConfig);
 bool NvStrapsConfig_SetBridgeConfig(NvStrapsConfig *config, NvStraps_BridgeConfig const *bridgeConfig);
-bool NvStrapsConfig_IsDirty(NvStrapsConfig const *config);
-bool NvStrapsConfig_SetIsDirty(NvStrapsConfig *config, bool dirtyFlag);
-bool NvStrapsConfig_SkipS3Resume(NvStrapsConfig const *config);
-bool NvStrapsConfig_SetSkipS3Resume(NvStrapsConfig *config, bool fSkipS3Resume);
-bool NvStrapsConfig_OverrideBarSizeMask(NvStrapsConfig const *config);
-bool NvStrapsConfig_SetOverrideBarSizeMask(NvStrapsConfig *config, bool fOverrideSizeMask);
-bool NvStrapsConfig_HasSetupVarCRC(NvStrapsConfig const *config);
-bool NvStrapsConfig_SetHasSetupVarCRC(NvStrapsConfig *config, bool hasCrc);
-bool NvStrapsConfig_IsGpuConfigured(NvStrapsConfig const *config);
-bool NvStrapsConfig_IsDriverConfigured(NvStrapsConfig const *config);
+inline bool NvStrapsConfig_IsDirty(NvStrapsConfig const *config);
+inline bool NvStrapsConfig_SetIsDirty(NvStrapsConfig *config, bool dirtyFlag);
+inline bool NvStrapsConfig_SkipS3Resume(NvStrapsConfig const *config);
+inline bool NvStrapsConfig_SetSkipS3Resume(NvStrapsConfig *config, bool fSkipS3Resume);
+inline bool NvStrapsConfig_OverrideBarSizeMask(NvStrapsConfig const *config);
+inline bool NvStrapsConfig_SetOverrideBarSizeMask(NvStrapsConfig *config, bool fOverrideSizeMask);
+inline bool NvStrapsConfig_HasSetupVarCRC(NvStrapsConfig const *config);
+inline bool NvStrapsConfig_SetHasSetupVarCRC(NvStrapsConfig *config, bool hasCrc);
+inline bool NvStrapsConfig_UsePciECAM(NvStrapsConfig const *config);
+inline bool NvStrapsConfig_SetUsePciECAM(NvStrapsConfig *config, bool useECAM);
+inline bool NvStrapsConfig_FlushStatusImmediately(NvStrapsConfig const *config);
+inline bool NvStrapsConfig_SetFlushStatusImmediately(NvStrapsConfig *config, bool flushImmediately);
+uint_least8_t NvStrapsConfig_SetupVarName(NvStrapsConfig const *config, uint_least8_t guid[SETUP_VAR_GUID_SIZE], uint_least32_t *size);
+bool NvStrapsConfig_SetSetupVarName(NvStrapsConfig *config, uint_least8_t name, uint_least8_t const guid[SETUP_VAR_GUID_SIZE], uint_least32_t size);
+inline bool NvStrapsConfig_IsGpuConfigured(NvStrapsConfig const *config);
+inline bool NvStrapsConfig_IsDriverConfigured(NvStrapsConfig const *config);
 bool NvStrapsConfig_ResetConfig(NvStrapsConfig *config);
 void NvStrapsConfig_Clear(NvStrapsConfig *config);
+void NvStrapsConfig_IndexGPUSelectors(NvStrapsConfig *config);
+unsigned NvStrapsConfig_FindGPUSelector(NvStrapsConfig const *config, uint_least16_t deviceID, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t bus, uint_least8_t dev, uint_least8_t fn);
 
 NvStraps_BarSize NvStrapsConfig_LookupBarSize(NvStrapsConfig const *config, uint_least16_t deviceID, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t bus, uint_least8_t dev, uint_least8_t fn);
 NvStraps_BarSizeMaskOverride NvStrapsConfig_LookupBarSizeMaskOverride(NvStrapsConfig const *config, uint_least16_t deviceID, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t bus, uint_least8_t dev, uint_least8_t fn);
 NvStraps_GPUConfig const *NvStrapsConfig_LookupGPUConfig(NvStrapsConfig const *config, uint_least8_t bus, uint_least8_t dev, uint_least8_t fn);
 NvStraps_BridgeConfig const *NvStrapsConfig_LookupBridgeConfig(NvStrapsConfig const *config, uint_least8_t secondaryBus);
+NvStraps_GPUPolicy NvStrapsConfig_ResolveGPUPolicy(NvStrapsConfig const *config, uint_least16_t deviceID, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t bus, uint_least8_t dev, uint_least8_t fn);
 uint_least32_t NvStrapsConfig_HasBridgeDevice(NvStrapsConfig const *config, uint_least8_t bus, uint_least8_t dev, uint_least8_t fn);
 
+// Buffer layout only, a malformed buffer clears the configuration. Save returns the size used, or 0
+void NvStrapsConfig_Load(BYTE const *buffer, unsigned size, NvStrapsConfig *config);
+unsigned NvStrapsConfig_Save(BYTE *buffer, unsigned size, NvStrapsConfig const *config);
+
 NvStrapsConfig *GetNvStrapsConfig(bool reload, ERROR_CODE *errorCode);
 void SaveNvStrapsConfig(ERROR_CODE *errorCode);
 
@@ -405,6 +464,44 @@ inline bool NvStrapsConfig_SetEnableSetupVarCRC(NvStrapsConfig *config, bool ena
     return previousFlag;
 }
 
+inline bool NvStrapsConfig_UsePciECAM(NvStrapsConfig const *config)
+{
+    return !!(config->nOptionFlags & 0x00'40u);
+}
+
+inline bool NvStrapsConfig_SetUsePciECAM(NvStrapsConfig *config, bool useECAM)
+{
+    bool previousFlag = NvStrapsConfig_UsePciECAM(config);
+
+    config->dirty = config->dirty || previousFlag != useECAM;
+
+    if (useECAM)
+	config->nOptionFlags |= 0x00'40u;
+    else
+	config->nOptionFlags &= (uint_least16_t) ~(uint_least16_t)0x00'40u;
+
+    return previousFlag;
+}
+
+inline bool NvStrapsConfig_FlushStatusImmediately(NvStrapsConfig const *config)
+{
+    return !!(config->nOptionFlags & 0x00'80u);
+}
+
+inline bool NvStrapsConfig_SetFlushStatusImmediately(NvStrapsConfig *config, bool flushImmediately)
+{
+    bool previousFlag = NvStrapsConfig_FlushStatusImmediately(config);
+
+    config->dirty = config->dirty || previousFlag != flushImmediately;
+
+    if (flushImmediately)
+	config->nOptionFlags |= 0x00'80u;
+    else
+	config->nOptionFlags &= (uint_least16_t) ~(uint_least16_t)0x00'80u;
+
+    return previousFlag;
+}
+
 inline bool NvStrapsConfig_IsGpuConfigured(NvStrapsConfig const *config)
 {
     return NvStrapsConfig_IsGlobalEnable(config) || config->nGPUSelector;
@@ -600,6 +697,26 @@ inline bool NvStrapsConfig::enableSetupVarCRC(bool enableCRC)
     return NvStrapsConfig_SetEnableSetupVarCRC(this, enableCRC);
 }
 
+inline bool NvStrapsConfig::usePciECAM() const
+{
+    return NvStrapsConfig_UsePciECAM(this);
+}
+
+inline bool NvStrapsConfig::usePciECAM(bool useECAM)
+{
+    return NvStrapsConfig_SetUsePciECAM(this, useECAM);
+}
+
+inline bool NvStrapsConfig::flushStatusImmediately() const
+{
+    return NvStrapsConfig_FlushStatusImmediately(this);
+}
+
+inline bool NvStrapsConfig::flushStatusImmediately(bool flushImmediately)
+{
+    return NvStrapsConfig_SetFlushStatusImmediately(this, flushImmediately);
+}
+
 inline uint_least8_t NvStrapsConfig::targetPciBarSizeSelector() const
 {
     return NvStrapsConfig_TargetPciBarSizeSelector(this);
@@ -7,34 +7,99 @@
 #if defined(UEFI_SOURCE)
 # include <Uefi.h>
 # include <Protocol/PciRootBridgeIo.h>
+# include <IndustryStandard/Pci22.h>
 #endif
 
 #include "LocalAppConfig.h"
 
 #if defined(UEFI_SOURCE)
+typedef struct PciReBarEntry
+{
+    uint_least16_t entryOffset;		// 0 if the BAR is not resizable
+    uint_least32_t barControl;
+    uint_least32_t sizeMask;		// bit n set for a supported size of 2^n MiB
+    uint_least8_t  currentSize;
+}
+    PciReBarEntry;
+
+// Resizable BAR capability, with the entry for each BAR indexed by the BAR number
+typedef struct PciReBarCapability
+{
+    uint_least16_t capabilityOffset;
+    uint_least8_t  barCount;
+    PciReBarEntry  bar[PCI_MAX_BAR];
+}
+    PciReBarCapability;
+
 UINT64 pciAddrOffset(UINTN pciAddress, INTN offset);
+void pciConfigUseEcam(bool useEcam);
+uint_least8_t pciSystemRootBridgeCount();
 UINTN pciLocateDevice(EFI_HANDLE RootBridgeHandle, EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_PCI_ADDRESS addressInfo, uint_least16_t *venID, uint_least16_t *devID, uint_least8_t *headerType);
 uint_least16_t pciFindExtCapability(UINTN pciAddress, uint_least32_t cap);
-uint_least32_t pciRebarGetPossibleSizes(UINTN pciAddress, uint_least16_t capabilityOffset, UINT16 vid, UINT16 did, uint_least8_t barIndex);
-uint_least32_t pciRebarPollPossibleSizes(UINTN pciAddress, uint_least16_t capabilityOffset, uint_least8_t barIndex, uint_least32_t barSizeMask);
+bool pciRebarParseCapability(UINTN pciAddress, uint_least16_t capabilityOffset, PciReBarCapability *reBar);
+uint_least32_t pciRebarGetPossibleSizes(PciReBarCapability const *reBar, uint_least8_t barIndex);
+uint_least32_t pciRebarReadPossibleSizes(UINTN pciAddress, PciReBarCapability *reBar, uint_least8_t barIndex);
 
 EFI_STATUS pciReadDeviceSubsystem(UINTN pciAddress, uint_least16_t *subsysVenID, uint_least16_t *subsysDevID);
 EFI_STATUS pciBridgeSecondaryBus(UINTN pciAddress, uint_least8_t *secondaryBus);
 uint_least32_t pciDeviceClass(UINTN pciAddress);
 uint_least32_t pciDeviceBAR0(UINTN pciAddress, EFI_STATUS *status);
-bool pciRebarSetSize(UINTN pciAddress, uint_least16_t capabilityOffset, uint_least8_t barIndex, uint_least8_t barSizeBitIndex);
+uint_least8_t pciDevicePrefetchableBARs(UINTN pciAddress);
+bool pciRebarSetSize(UINTN pciAddress, PciReBarCapability *reBar, uint_least8_t barIndex, uint_least8_t barSizeBitIndex);
 
-void pciSaveAndRemapBridgeConfig(UINTN bridgePciAddress, UINT32 bridgeSaveArea[3u], EFI_PHYSICAL_ADDRESS baseAddress0, EFI_PHYSICAL_ADDRESS topAddress0, EFI_PHYSICAL_ADDRESS bridgeIoBaseLimit);
-void pciRestoreBridgeConfig(UINTN bridgePciAddress, UINT32 bridgeSaveArea[3u]);
+bool pciIsDeviceBAR0Decoded(UINTN bridgePciAddress, UINTN pciAddress, EFI_PHYSICAL_ADDRESS baseAddress0, EFI_PHYSICAL_ADDRESS topAddress0);
 
-void pciSaveAndRemapDeviceBAR0(UINTN pciAddress, UINT32 deviceSaveArea[2u], EFI_PHYSICAL_ADDRESS baseAddress0);
-void pciRestoreDeviceConfig(UINTN pciAddress, UINT32 deviceSaveArea[2u]);
+// Each remap and restore is also recorded in the S3 resume script. With writeConfig false only the script entries are
+// recorded, for a device that already decodes the range.
+void pciSaveAndRemapBridgeConfig(UINTN bridgePciAddress, UINT32 bridgeSaveArea[3u], EFI_PHYSICAL_ADDRESS baseAddress0, EFI_PHYSICAL_ADDRESS topAddress0, EFI_PHYSICAL_ADDRESS bridgeIoBaseLimit, bool writeConfig);
+void pciRestoreBridgeConfig(UINTN bridgePciAddress, UINT32 bridgeSaveArea[3u], bool writeConfig);
+
+void pciSaveAndRemapDeviceBAR0(UINTN pciAddress, UINT32 deviceSaveArea[2u], EFI_PHYSICAL_ADDRESS baseAddress0, bool writeConfig);
+void pciRestoreDeviceConfig(UINTN pciAddress, UINT32 deviceSaveArea[2u], bool writeConfig);
 
 bool pciIsPciBridge(uint_least8_t headerType);
 bool pciIsVgaController(uint_least32_t pciClassReg);
 
 #endif	    // defined(UEFI_SOURCE)
 
+#if defined(UEFI_SOURCE)
+// Layout of the PCI address used in the driver, the lower 32 bits are as for EFI_PCI_ADDRESS()
+//	bits 48..63	PCI segment
+//	bits 44..47	index of the root bridge for the RootBridgeIo protocol
+//	bits 32..43	extended register offset
+//	bits 24..31	bus
+//	bits 16..23	device
+//	bits  8..15	function
+enum
+{
+    PCI_ADDRESS_ROOT_BRIDGE_SHIFT = 44u,
+    PCI_ADDRESS_SEGMENT_SHIFT = 48u
+};
+
+#define PCI_ADDRESS_REGISTER_MASK UINT64_C(0x0000'0FFF'0000'0000)
+
+inline UINTN pciMakeAddress(uint_least16_t segment, uint_least8_t rootBridgeIndex, uint_least8_t bus, uint_least8_t dev, uint_least8_t fun)
+{
+    return (UINTN)segment << PCI_ADDRESS_SEGMENT_SHIFT | (UINTN)(rootBridgeIndex & 0x0Fu) << PCI_ADDRESS_ROOT_BRIDGE_SHIFT | (UINTN)EFI_PCI_ADDRESS(bus, dev, fun, 0u);
+}
+
+// Address of another device behind the same root bridge
+inline UINTN pciSiblingAddress(UINTN pciAddress, uint_least8_t bus, uint_least8_t dev, uint_least8_t fun)
+{
+    return (pciAddress & ~(UINTN)UINT64_C(0x0000'0FFF'FFFF'FFFF)) | (UINTN)EFI_PCI_ADDRESS(bus, dev, fun, 0u);
+}
+
+inline uint_least16_t pciAddressSegment(UINTN pciAddress)
+{
+    return pciAddress >> PCI_ADDRESS_SEGMENT_SHIFT & WORD_BITMASK;
+}
+
+inline uint_least8_t pciAddressRootBridge(UINTN pciAddress)
+{
+    return pciAddress >> PCI_ADDRESS_ROOT_BRIDGE_SHIFT & 0x0Fu;
+}
+#endif      // defined(UEFI_SOURCE)
+
 inline void pciUnpackAddress(UINTN pciAddress, uint_least8_t *bus, uint_least8_t *dev, uint_least8_t *fun)
 {
     *bus = pciAddress >> 24u & BYTE_BITMASK;
@@ -44,7 +109,7 @@ inline void pciUnpackAddress(UINTN pciAddress, uint_least8_t *bus, uint_least8_t
 
 inline uint_least16_t pciPackLocation(uint_least8_t bus, uint_least8_t dev, uint_least8_t fun)
 {
-    return (uint_least16_t) bus << BYTE_BITSIZE | dev << 3u & 0b1111'1000u | fun & 0b0111u;
+    return (uint_least16_t) bus << BYTE_BITSIZE | (dev << 3u & 0b1111'1000u) | (fun & 0b0111u);
 }
 
 
@@ -0,0 +1,21 @@
+#if !defined(NV_STRAPS_REBAR_PCI_ECAM_H)
+#define NV_STRAPS_REBAR_PCI_ECAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <Uefi.h>
+
+// Memory-mapped configuration space range for a PCI segment, from the ACPI MCFG table
+typedef struct PciEcamRange
+{
+    UINT64 baseAddress;			// address for bus 0, even if the range starts with a later bus
+    uint_least16_t segment;
+    uint_least8_t startBus, endBus;
+}
+    PciEcamRange;
+
+bool PciEcam_Init();
+bool PciEcam_LookupRange(uint_least16_t segment, PciEcamRange *range);
+
+#endif	    // !defined(NV_STRAPS_REBAR_PCI_ECAM_H)
@@ -0,0 +1,72 @@
+#if !defined(NV_STRAPS_REBAR_PCI_TRACE_H)
+#define NV_STRAPS_REBAR_PCI_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <Uefi.h>
+
+#if defined(_ASSERT)
+# undef _ASSERT
+#endif
+
+#include <Library/DebugLib.h>
+
+#include "LocalAppConfig.h"
+
+// Config space access counters and trace, for DEBUG builds only. Release builds (MDEPKG_NDEBUG) leave the macros
+// below empty, unless NVSTRAPS_PCI_TRACE is given in the build options.
+#if !defined(NVSTRAPS_PCI_TRACE)
+# if defined(MDEPKG_NDEBUG)
+#  define NVSTRAPS_PCI_TRACE 0
+# else
+#  define NVSTRAPS_PCI_TRACE 1
+# endif
+#endif
+
+// Accessor that issued the config space access
+typedef enum PciTrace_Site
+{
+    PciTrace_Other,
+    PciTrace_LocateDevice,		// pciLocateDevice
+    PciTrace_DeviceHeader,		// subsystem, class, BAR0 and secondary bus
+    PciTrace_ExtCapability,		// pciFindExtCapability
+    PciTrace_ReBarCapability,		// parse the ReBAR capability and re-read the sizes
+    PciTrace_ReBarSize,			// pciRebarSetSize
+    PciTrace_BridgeRemap,		// pciSaveAndRemapBridgeConfig
+    PciTrace_BridgeRestore,		// pciRestoreBridgeConfig
+    PciTrace_DeviceRemap,		// pciSaveAndRemapDeviceBAR0
+    PciTrace_DeviceRestore,		// pciRestoreDeviceConfig
+
+    PciTrace_SiteCount
+}
+    PciTrace_Site;
+
+// The variable holds the read and write counts for each site, for each device, and for each register (dword) offset
+// accessed, then the first trace entries: site (BYTE), segment (WORD), bus location (WORD), register offset (WORD),
+// access width in bytes with bit 7 set for writes (BYTE) and value (DWORD)
+enum
+{
+    PCI_TRACE_MAX_DEVICES = 64u,
+    PCI_TRACE_MAX_ENTRIES = 256u,
+    PCI_TRACE_WRITE_FLAG = 0x80u
+};
+
+extern char const PciTrace_Name[];
+
+#if NVSTRAPS_PCI_TRACE
+void PciTrace_Init(void);
+void PciTrace_SetSite(PciTrace_Site site);
+void PciTrace_Access(UINTN pciAddress, INTN pos, uint_least8_t width, bool isWrite, UINT32 value);
+EFI_STATUS PciTrace_Flush(void);
+
+# define PCI_TRACE_INIT()					PciTrace_Init()
+# define PCI_TRACE_SITE(site)					PciTrace_SetSite(site)
+# define PCI_TRACE_ACCESS(pciAddress, pos, width, isWrite, value) PciTrace_Access(pciAddress, pos, width, isWrite, value)
+#else
+# define PCI_TRACE_INIT()					((void)0)
+# define PCI_TRACE_SITE(site)					((void)0)
+# define PCI_TRACE_ACCESS(pciAddress, pos, width, isWrite, value) ((void)0)
+#endif
+
+#endif          // !defined(NV_STRAPS_REBAR_PCI_TRACE_H)
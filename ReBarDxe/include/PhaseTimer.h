@@ -0,0 +1,78 @@
+#if !defined(NV_STRAPS_REBAR_PHASE_TIMER_H)
+#define NV_STRAPS_REBAR_PHASE_TIMER_H
+
+#if defined(UEFI_SOURCE)
+# include <Uefi.h>
+#else
+#if defined(__cplusplus) && !defined(NVSTRAPS_DXE_DRIVER)
+import std;
+using std::uint_least8_t;
+using std::uint_least32_t;
+using std::uint_least64_t;
+# else
+#  include <stdint.h>
+# endif
+#endif
+
+#if defined(__cplusplus) && !defined(NVSTRAPS_DXE_DRIVER)
+import LocalAppConfig;
+#else
+# include "LocalAppConfig.h"
+#endif
+
+// Driver phases timed during boot. Phases can nest, so each total includes the time of the inner phases.
+typedef enum PhaseTimer_Phase
+{
+    PhaseTimer_DriverInit,			// rebarInit
+    PhaseTimer_LoadConfig,			// GetNvStrapsConfig
+    PhaseTimer_SetupVarEnum,			// enumerate variables for the Setup variable name and GUID
+    PhaseTimer_SetupVarLoad,			// read the Setup variable
+    PhaseTimer_SetupVarCRC,			// CRC of the Setup variable
+    PhaseTimer_CMOSCheck,			// IsCMOSClear
+    PhaseTimer_HookInstall,			// hook the host bridges PreprocessController method
+    PhaseTimer_PreprocessController,		// driver work in each PreprocessController call, without the original method
+    PhaseTimer_StrapsRemap,			// remap and restore the bridge window and GPU BAR0
+    PhaseTimer_StrapsMMIO,			// read and write the STRAPS registers
+    PhaseTimer_StrapsSettle,			// wait for the GPUs to report the new BAR1 size
+    PhaseTimer_ReBarWrite,			// write the BAR size in the ReBAR capability
+
+    PhaseTimer_Count
+}
+    PhaseTimer_Phase;
+
+typedef struct PhaseTimer_Record
+{
+    uint_least64_t ticks;
+    uint_least32_t calls;
+}
+    PhaseTimer_Record;
+
+// The variable holds the tick frequency (QWORD), the phase count (BYTE), and a record for each phase
+enum
+{
+    PHASE_TIMER_RECORD_SIZE = QWORD_SIZE + DWORD_SIZE,
+    PHASE_TIMER_VAR_MAX_SIZE = QWORD_SIZE + BYTE_SIZE + PhaseTimer_Count * PHASE_TIMER_RECORD_SIZE
+};
+
+extern char const PhaseTimer_Name[];
+
+#if defined(UEFI_SOURCE) || defined(EFIAPI)
+void PhaseTimer_Init(void);
+uint_least64_t PhaseTimer_Start(void);
+void PhaseTimer_Stop(PhaseTimer_Phase phase, uint_least64_t startTime);
+EFI_STATUS PhaseTimer_Flush(void);
+#else
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+// Returns the number of phase records read, 0 if the variable is missing or invalid
+unsigned ReadPhaseTimers(ERROR_CODE *errorCode, PhaseTimer_Record records[PhaseTimer_Count], uint_least64_t *ticksPerSecond);
+
+#if defined(__cplusplus)
+}
+#endif
+#endif
+
+#endif          // !defined(NV_STRAPS_REBAR_PHASE_TIMER_H)
@@ -5,8 +5,11 @@
 #include <Protocol/S3SaveState.h>
 
 #include "NvStrapsConfig.h"
+#include "PciConfig.h"
 
 extern EFI_HANDLE reBarImageHandle;
 extern NvStrapsConfig *config;
 
+uint_least32_t getReBarSizeMask(UINTN pciAddress, PciReBarCapability const *reBar, uint_least16_t vid, uint_least16_t did, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t barIndex);
+
 #endif          // !defined(REBAR_UEFI_REBAR_H)
@@ -0,0 +1,16 @@
+#if !defined(NV_STRAPS_REBAR_PLANNER_H)
+#define NV_STRAPS_REBAR_PLANNER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <Uefi.h>
+#include <Protocol/PciHostBridgeResourceAllocation.h>
+
+// Sizes for the resizable BARs of all devices behind a root bridge, planned together before the second
+// PreprocessController call, so the bridge windows fit in the MMIO aperture of the root bridge
+// Note the 64-bit prefetchable BARs of a function without a device record, that still take space in the bridge window
+void ReBarPlanner_AddOtherBars(UINTN pciAddress);
+void ReBarPlanner_Plan(EFI_PCI_HOST_BRIDGE_RESOURCE_ALLOCATION_PROTOCOL *pciResAlloc, EFI_HANDLE rootBridgeHandle, UINTN pciAddress);
+
+#endif	    // !defined(NV_STRAPS_REBAR_PLANNER_H)
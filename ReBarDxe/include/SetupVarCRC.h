@@ -0,0 +1,28 @@
+#if !defined(NV_STRAPS_REBAR_SETUP_VAR_CRC_H)
+#define NV_STRAPS_REBAR_SETUP_VAR_CRC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "LocalAppConfig.h"
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+// CRC-64 of the Setup variable. The buffer is taken as little-endian QWORDs, each one shifted into the CRC
+// register most significant bit first. The buffer length must be a multiple of QWORD_SIZE.
+uint_least64_t ecma128_crc64(BYTE const *buffer, BYTE const *bufferEnd, uint_least64_t crcValue);
+
+// Same CRC using only the slice-by-8 tables, even when the carry-less multiply instruction is available
+uint_least64_t ecma128_crc64_table(BYTE const *buffer, BYTE const *bufferEnd, uint_least64_t crcValue);
+
+// Same CRC, one bit at a time, as computed by earlier versions. Reference for the tests.
+uint_least64_t ecma128_crc64_bitwise(BYTE const *buffer, BYTE const *bufferEnd, uint_least64_t crcValue);
+
+#if defined(__cplusplus)
+}       // extern "C"
+#endif
+
+#endif          // !defined(NV_STRAPS_REBAR_SETUP_VAR_CRC_H)
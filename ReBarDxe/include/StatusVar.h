@@ -2,10 +2,14 @@
 #define NV_STRAPS_REBAR_STATUS_VAR_H
 
 #if defined(UEFI_SOURCE)
+# include <stdbool.h>
 # include <Uefi.h>
 #else
 #if defined(__cplusplus) && !defined(NVSTRAPS_DXE_DRIVER)
 import std;
+using std::uint_least8_t;
+using std::uint_least16_t;
+using std::uint_least32_t;
 using std::uint_least64_t;
 # else
 #  include <stdint.h>
@@ -18,6 +22,8 @@ import LocalAppConfig;
 # include "LocalAppConfig.h"
 #endif
 
+#include "NvStrapsConfig.h"
+
 typedef enum StatusVar
 {
     StatusVar_NotLoaded = 10u,
@@ -84,18 +90,55 @@ typedef enum EFIErrorLocation
     EFIError_SetupTimer,
     EFIError_WaitTimer,
     EFIError_CreateEvent,
-    EFIError_CloseEvent
+    EFIError_CloseEvent,
+    EFIError_AllocateDeviceRecord,
+    EFIError_LoadRootBridgeIoProtocol,
+    EFIError_AllocateMemorySpace,
+    EFIError_SetMemorySpaceAttributes,
+    EFIError_FreeMemorySpace,
+    EFIError_FreeIoSpace,
+    EFIError_HostBridgeAttributes,
+    EFIError_GetMemorySpaceMap,
+    EFIError_WriteTopologyCache,
+    EFIError_ReBarPlanLimit
 }
     EFIErrorLocation;
 
+// The variable holds the overall status QWORD, followed by a record count and one record per GPU and bridge
+typedef struct StatusVar_DeviceRecord
+{
+    uint_least16_t segment;
+    uint_least16_t busLocation;
+    uint_least8_t flags;
+    uint_least8_t status;			// highest StatusVar value for the device
+    uint_least8_t errorLocation;		// EFIErrorLocation of the first EFI error for the device
+    uint_least8_t errorStatus;			// low byte of the EFI_STATUS
+    uint_least8_t strapsStatus;			// last StatusVar value from the GPU STRAPS setup
+    uint_least8_t barSizeSelector;		// BAR1 size selected for the GPU STRAPS, 0xFF if none
+    uint_least32_t reBarSizeMask;		// BAR1 sizes last read from the ReBAR capability, bit 0 for 1 MiB
+}
+    StatusVar_DeviceRecord;
+
+enum
+{
+    StatusVar_DeviceRecord_Bridge = 0x01u,
+
+    STATUS_VAR_DEVICE_RECORD_SIZE = 2u * WORD_SIZE + 6u * BYTE_SIZE + DWORD_SIZE,
+    STATUS_VAR_DEVICE_MAX_COUNT = NvStraps_GPU_MAX_COUNT + NvStraps_BRIDGE_MAX_COUNT,    // GPUs and bridges in NvStrapsConfig
+    STATUS_VAR_MAX_SIZE = QWORD_SIZE + BYTE_SIZE + STATUS_VAR_DEVICE_MAX_COUNT * STATUS_VAR_DEVICE_RECORD_SIZE
+};
+
 extern char const StatusVar_Name[];
 
 void SetStatusVar(StatusVar val);
 
 #if defined(UEFI_SOURCE) || defined(EFIAPI)
+void StatusVar_Init(bool flushImmediately);
+EFI_STATUS StatusVar_Flush(void);
 void SetEFIError(EFIErrorLocation errLocation, EFI_STATUS status);
 void SetDeviceStatusVar(UINTN pciAddress, StatusVar val);
 void SetDeviceEFIError(UINTN pciAddress, EFIErrorLocation errLocation, EFI_STATUS status);
+void SetDeviceBarSize(UINTN pciAddress, uint_least8_t barSizeSelector, uint_least32_t reBarSizeMask);
 #else
 #if defined(__cplusplus)
 extern "C"
@@ -103,6 +146,7 @@ extern "C"
 #endif
 
 uint_least64_t ReadStatusVar(ERROR_CODE *errorCode);
+uint_least64_t ReadStatusVarRecords(ERROR_CODE *errorCode, StatusVar_DeviceRecord records[STATUS_VAR_DEVICE_MAX_COUNT], unsigned *recordCount);
 
 #if defined(__cplusplus)
 }
@@ -0,0 +1,32 @@
+#if !defined(NV_STRAPS_REBAR_TOPOLOGY_CACHE_H)
+#define NV_STRAPS_REBAR_TOPOLOGY_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <Uefi.h>
+
+#include "DeviceRecord.h"
+
+// Non-volatile record of the devices found on the previous boot, with the ReBAR capability and the BAR sizes applied.
+// A device that matches by location, IDs and subsystem IDs (all in the cached config header) skips the capability
+// search, and gets the BAR sizes applied on the last boot. The variable is only written again when the devices or the
+// sizes change.
+//
+// Each entry: segment, bus location, vendor ID, device ID, subsystem vendor ID, subsystem device ID (WORDs, 0xFFFF
+// for bridges), flags and prefetchable BAR mask (BYTEs), ReBAR capability offset (WORD), resizable BAR count (BYTE),
+// then for each resizable BAR: BAR index (BYTE), entry offset (WORD), control register (DWORD), size mask (DWORD) and
+// size applied (BYTE)
+enum
+{
+    TOPOLOGY_CACHE_VERSION = 1u,
+    TOPOLOGY_CACHE_MAX_ENTRIES = 48u
+};
+
+extern char const TopologyCache_Name[];
+
+void TopologyCache_Init(bool enabled);
+bool TopologyCache_Restore(DeviceRecord *record);
+EFI_STATUS TopologyCache_Flush(void);
+
+#endif	    // !defined(NV_STRAPS_REBAR_TOPOLOGY_CACHE_H)
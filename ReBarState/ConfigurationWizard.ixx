@@ -5,6 +5,7 @@ import std;
 import NvStraps.WinAPI;
 import LocalAppConfig;
 import StatusVar;
+import PhaseTimer;
 import DeviceRegistry;
 import WinApiError;
 import DeviceList;
@@ -67,6 +68,8 @@ static vector<MenuCommand> buildConfigurationMenu(NvStrapsConfig const &nvStraps
 	MenuCommand::OverrideBarSizeMask,
 	MenuCommand::EnableSetupVarCRC,
 	MenuCommand::ClearSetupVarCRC,
+	MenuCommand::UsePciECAM,
+	MenuCommand::FlushStatusImmediately,
 	MenuCommand::UEFIConfiguration,
 	MenuCommand::ShowConfiguration
     };
@@ -325,7 +328,17 @@ void runConfigurationWizard()
 {
     auto menuType = MenuType::Main;
     auto dwStatusVarLastError = ERROR_CODE { ERROR_CODE_SUCCESS };
-    auto driverStatus = ReadStatusVar(&dwStatusVarLastError);
+    auto deviceStatus = vector<StatusVar_DeviceRecord>(STATUS_VAR_DEVICE_MAX_COUNT);
+    auto deviceStatusCount = 0u;
+    auto driverStatus = ReadStatusVarRecords(&dwStatusVarLastError, deviceStatus.data(), &deviceStatusCount);
+
+    deviceStatus.resize(deviceStatusCount);
+
+    auto phaseTimersLastError = ERROR_CODE { ERROR_CODE_SUCCESS };
+    auto phaseTimers = vector<PhaseTimer_Record>(PhaseTimer_Count);
+    auto ticksPerSecond = uint_least64_t { };
+
+    phaseTimers.resize(ReadPhaseTimers(&phaseTimersLastError, phaseTimers.data(), &ticksPerSecond));
 
     if (dwStatusVarLastError)
     {
@@ -339,13 +352,13 @@ void runConfigurationWizard()
     auto deviceSelector = MenuCommand::GPUSelectorByPCIID;
 
     setConfigDirtyOnMismatch(deviceList, nvStrapsConfig);
-    showConfiguration(deviceList, nvStrapsConfig, driverStatus);
+    showConfiguration(deviceList, nvStrapsConfig, driverStatus, deviceStatus, phaseTimers, ticksPerSecond);
 
     auto runMenuLoop = true;
 
     auto showConfig = [&]()
     {
-        showConfiguration(deviceList, nvStrapsConfig, driverStatus);
+        showConfiguration(deviceList, nvStrapsConfig, driverStatus, deviceStatus, phaseTimers, ticksPerSecond);
     };
 
     while (runMenuLoop)
@@ -434,6 +447,18 @@ void runConfigurationWizard()
 	    showConfig();
 	    break;
 
+	case MenuCommand::UsePciECAM:
+	    nvStrapsConfig.usePciECAM(!nvStrapsConfig.usePciECAM());
+
+	    showConfig();
+	    break;
+
+	case MenuCommand::FlushStatusImmediately:
+	    nvStrapsConfig.flushStatusImmediately(!nvStrapsConfig.flushStatusImmediately());
+
+	    showConfig();
+	    break;
+
         case MenuCommand::PerGPUConfigClear:
             nvStrapsConfig.clearGPUSelectors();
             showConfig();
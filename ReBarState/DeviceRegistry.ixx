@@ -1,9 +1,19 @@
 module;
 
 #include "DeviceRegistry.h"
+#include "DeviceRegistryTable.h"
 
 export module DeviceRegistry;
 
+import std;
+
+// The table is generated, but also check here that no duplicate or unsorted entry was edited in by hand
+static_assert
+    (
+	std::ranges::adjacent_find(DeviceRegistryTable, std::ranges::greater_equal { }, &DeviceRegistryEntry::deviceID) == std::ranges::end(DeviceRegistryTable),
+	"DeviceRegistryTable must be sorted by device ID, with no duplicates. Regenerate it with tools/genDeviceRegistry.py"
+    );
+
 export using ::MAX_BAR_SIZE_SELECTOR;
 export using ::BarSizeSelector;
 export using enum ::BarSizeSelector;
@@ -8,12 +8,10 @@ import WinApiError;
 using std::begin;
 using std::end;
 using std::size;
-using std::find_if;
 using std::copy;
 using std::system_error;
 
 namespace views = std::ranges::views;
-namespace execution = std::execution;
 using namespace std::literals::string_literals;
 
 bool NvStrapsConfig::setGPUSelector(uint_least8_t barSizeSelector, uint_least16_t deviceID, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t bus, uint_least8_t dev, uint_least8_t fn)
@@ -31,12 +29,8 @@ bool NvStrapsConfig::setGPUSelector(uint_least8_t barSizeSelector, uint_least16_
     };
 
     auto end_it = begin(GPUs) + nGPUSelector;
-    auto it = find_if(execution::par_unseq, begin(GPUs), end_it, [&gpuSelector](auto const &selector)
-        {
-            return selector.deviceMatch(gpuSelector.deviceID)
-                 && selector.subsystemMatch(gpuSelector.subsysVendorID, gpuSelector.subsysDeviceID)
-                 && selector.busLocationMatch(gpuSelector.bus, gpuSelector.device, gpuSelector.function);
-        });
+    auto index = NvStrapsConfig_FindGPUSelector(this, deviceID, subsysVenID, subsysDevID, bus, dev, fn);
+    auto it = index == WORD_BITMASK ? end_it : begin(GPUs) + index;
 
     if (it == end_it)
         if (nGPUSelector >= size(GPUs))
@@ -45,6 +39,7 @@ bool NvStrapsConfig::setGPUSelector(uint_least8_t barSizeSelector, uint_least16_
         {
             dirty = true;
             GPUs[nGPUSelector++] = gpuSelector;
+            NvStrapsConfig_IndexGPUSelectors(this);
         }
     else
         if (it->barSizeSelector != barSizeSelector)
@@ -71,12 +66,8 @@ bool NvStrapsConfig::setBarSizeMaskOverride(bool sizeMaskOverride, uint_least16_
     };
 
     auto end_it = begin(GPUs) + nGPUSelector;
-    auto it = find_if(execution::par_unseq, begin(GPUs), end_it, [&gpuSelector](auto const &selector)
-        {
-            return selector.deviceMatch(gpuSelector.deviceID)
-                 && selector.subsystemMatch(gpuSelector.subsysVendorID, gpuSelector.subsysDeviceID)
-                 && selector.busLocationMatch(gpuSelector.bus, gpuSelector.device, gpuSelector.function);
-        });
+    auto index = NvStrapsConfig_FindGPUSelector(this, deviceID, subsysVenID, subsysDevID, bus, dev, fn);
+    auto it = index == WORD_BITMASK ? end_it : begin(GPUs) + index;
 
     if (it == end_it)
         if (nGPUSelector >= size(GPUs))
@@ -85,6 +76,7 @@ bool NvStrapsConfig::setBarSizeMaskOverride(bool sizeMaskOverride, uint_least16_
         {
             dirty = true;
             GPUs[nGPUSelector++] = gpuSelector;
+            NvStrapsConfig_IndexGPUSelectors(this);
         }
     else
         if (it->overrideBarSizeMask != gpuSelector.overrideBarSizeMask)
@@ -109,12 +101,8 @@ bool NvStrapsConfig::clearGPUSelector(UINT16 deviceID, UINT16 subsysVenID, UINT1
     };
 
     auto end_it = begin(GPUs) + nGPUSelector;
-    auto it = find_if(execution::par_unseq, begin(GPUs), end_it, [&gpuSelector](auto const &selector)
-        {
-            return selector.deviceMatch(gpuSelector.deviceID)
-                 && selector.subsystemMatch(gpuSelector.subsysVendorID, gpuSelector.subsysDeviceID)
-                 && selector.busLocationMatch(gpuSelector.bus, gpuSelector.device, gpuSelector.function);
-        });
+    auto index = NvStrapsConfig_FindGPUSelector(this, deviceID, subsysVenID, subsysDevID, bus, dev, fn);
+    auto it = index == WORD_BITMASK ? end_it : begin(GPUs) + index;
 
     if (it == end_it)
         return false;
@@ -122,6 +110,7 @@ bool NvStrapsConfig::clearGPUSelector(UINT16 deviceID, UINT16 subsysVenID, UINT1
     dirty = true;
     copy(it + 1u, end_it, it);
     nGPUSelector--;
+    NvStrapsConfig_IndexGPUSelectors(this);
 
     return true;
 }
@@ -107,7 +107,14 @@ void ShowNvStrapsConfig(function<void (wstring const &)> show)
     show(L"\t                       - overrideBarSize:    "s + to_wstring(config.overrideBarSizeMask()) + L'\n');
     show(L"\t                       - hasSetupVarCRC:     "s + to_wstring(config.hasSetupVarCRC()) + L'\n');
     show(L"\t                       - disableSetupVarCRC: "s + to_wstring(!config.enableSetupVarCRC()) + L'\n');
+    show(L"\t                       - usePciECAM:         "s + to_wstring(config.usePciECAM()) + L'\n');
+    show(L"\t                       - flushStatusNow:     "s + to_wstring(config.flushStatusImmediately()) + L'\n');
     show(L"\tSetupVarCRC:       "s + L"0x"s + formatAddress64(config.nSetupVarCRC, false) + L'\n');
+    show(L"\tSetupVarName:      "s + (config.setupVarName == SetupVarName_Setup ? L"Setup"s : config.setupVarName == SetupVarName_Custom ? L"Custom"s : L"(none)"s) + L'\n');
+
+    if (config.setupVarName != SetupVarName_None)
+	show(L"\tSetupVarSize:      "s + to_wstring(config.setupVarSize) + L'\n');
+
     show(L"\tnPciBarSize:       "s + to_wstring(config.nPciBarSize) + L'\n');
     show(L"\tnGPUSelectorCount: "s + to_wstring(config.nGPUSelector) + L'\n');
 
@@ -0,0 +1,11 @@
+module;
+
+#include "PhaseTimer.h"
+
+export module PhaseTimer;
+
+export using ::PhaseTimer_Phase;
+export using enum ::PhaseTimer_Phase;
+export using ::PhaseTimer_Record;
+export using ::PhaseTimer_Name;
+export using ::ReadPhaseTimers;
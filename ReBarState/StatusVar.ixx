@@ -8,6 +8,10 @@ export using ::StatusVar;
 export using enum ::StatusVar;
 export using ::EFIErrorLocation;
 export using enum ::EFIErrorLocation;
+export using ::StatusVar_DeviceRecord;
+export using ::StatusVar_DeviceRecord_Bridge;
+export using ::STATUS_VAR_DEVICE_MAX_COUNT;
 export using ::StatusVar_Name;
 export using ::SetStatusVar;
 export using ::ReadStatusVar;
+export using ::ReadStatusVarRecords;
@@ -25,6 +25,8 @@ export enum class MenuCommand
     OverrideBarSizeMask,
     EnableSetupVarCRC,
     ClearSetupVarCRC,
+    UsePciECAM,
+    FlushStatusImmediately,
     UEFIConfiguration,
     UEFIBARSizePrompt,
     PerGPUConfigClear,
@@ -104,6 +106,8 @@ static auto const mainMenuShortcuts = map<wchar_t, MenuCommand>
     { L'O', MenuCommand::OverrideBarSizeMask },
     { L'R', MenuCommand::EnableSetupVarCRC },
     { L'L', MenuCommand::ClearSetupVarCRC },
+    { L'M', MenuCommand::UsePciECAM },
+    { L'F', MenuCommand::FlushStatusImmediately },
     { L'P', MenuCommand::UEFIConfiguration },
     { L'S', MenuCommand::SaveConfiguration },
     { L'W', MenuCommand::ShowConfiguration },
@@ -184,6 +188,26 @@ static wstring showMainMenuEntry(MenuCommand menuCommand, bool isGlobalEnable, v
 
 	return wstring(1u, chShortcut);
 
+    case MenuCommand::UsePciECAM:
+	if (config.usePciECAM())
+	    wcout << L"\t(" << chShortcut << L") Disable"sv;
+	else
+	    wcout << L"\t(" << chShortcut << L") Enable"sv;
+
+	wcout << L" direct memory-mapped (ECAM) PCI configuration access\n"sv;
+
+	return wstring(1u, chShortcut);
+
+    case MenuCommand::FlushStatusImmediately:
+	if (config.flushStatusImmediately())
+	    wcout << L"\t(" << chShortcut << L") Disable"sv;
+	else
+	    wcout << L"\t(" << chShortcut << L") Enable"sv;
+
+	wcout << L" immediate status updates from the UEFI DXE driver (for debugging hangs)\n"sv;
+
+	return wstring(1u, chShortcut);
+
     case MenuCommand::PerGPUConfig:
         if (devices | all)
         {
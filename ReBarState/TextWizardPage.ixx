@@ -4,6 +4,7 @@ import std;
 import LocalAppConfig;
 import NvStrapsConfig;
 import StatusVar;
+import PhaseTimer;
 import DeviceRegistry;
 import DeviceList;
 
@@ -21,7 +22,8 @@ export void showError(wstring const &message);
 export void showError(string const &message);
 export void showStartupLogo();
 
-export void showConfiguration(vector<DeviceInfo> const &devices, NvStrapsConfig const &nvStrapsConfig, uint_least64_t driverStatus);
+export void showConfiguration(vector<DeviceInfo> const &devices, NvStrapsConfig const &nvStrapsConfig, uint_least64_t driverStatus, vector<StatusVar_DeviceRecord> const &deviceStatus,
+	vector<PhaseTimer_Record> const &phaseTimers, uint_least64_t ticksPerSecond);
 
 inline void showInfo(wstring const &message)
 {
@@ -46,6 +48,7 @@ inline void showStartupLogo()
 module: private;
 
 using std::uint_least8_t;
+using std::uint_least32_t;
 using std::uint_least64_t;
 using std::string;
 using std::wstring_view;
@@ -60,6 +63,8 @@ using std::right;
 using std::uppercase;
 using std::setw;
 using std::setfill;
+using std::setprecision;
+using std::fixed;
 using std::max;
 
 namespace views = std::ranges::views;
@@ -424,6 +429,36 @@ wstring_view driverErrorString(EFIErrorLocation errLocation)
     case EFIError_CloseEvent:
 	return L" (at Close Event BeforeExitBootServices)"sv;
 
+    case EFIError_AllocateDeviceRecord:
+	return L" (at Allocate device record)"sv;
+
+    case EFIError_LoadRootBridgeIoProtocol:
+	return L" (at Load root bridge I/O protocol)"sv;
+
+    case EFIError_AllocateMemorySpace:
+	return L" (at Allocate temporary BAR0 MMIO window)"sv;
+
+    case EFIError_SetMemorySpaceAttributes:
+	return L" (at Set uncacheable MMIO window attribute)"sv;
+
+    case EFIError_FreeMemorySpace:
+	return L" (at Free temporary BAR0 MMIO window)"sv;
+
+    case EFIError_FreeIoSpace:
+	return L" (at Free temporary bridge I/O window)"sv;
+
+    case EFIError_HostBridgeAttributes:
+	return L" (at Get host bridge allocation attributes)"sv;
+
+    case EFIError_GetMemorySpaceMap:
+	return L" (at Get MMIO aperture from the memory space map)"sv;
+
+    case EFIError_WriteTopologyCache:
+	return L" (at Write PCI topology cache)"sv;
+
+    case EFIError_ReBarPlanLimit:
+	return L" (at Plan BAR sizes, too many resizable BARs or buses)"sv;
+
     default:
         return L""sv;
     }
@@ -450,6 +485,73 @@ static wstring formatPciBarSize(unsigned sizeSelector)
     return to_wstring(1u << sizeSelector % 10) + suffix;
 }
 
+static wstring formatReBarSizeMask(uint_least32_t sizeMask)
+{
+    wstring sizeList;
+
+    for (auto sizeSelector = 0u; sizeSelector < DWORD_BITSIZE; sizeSelector++)
+	if (sizeMask & uint_least32_t { 1u } << sizeSelector)
+	    sizeList += (sizeList.empty() ? L""s : L", "s) + formatPciBarSize(sizeSelector);
+
+    return sizeList.empty() ? L"none"s : sizeList;
+}
+
+// One line per GPU and bridge recorded by the UEFI DXE driver, to check each GPU got the configured BAR size
+static void showDeviceStatus(vector<StatusVar_DeviceRecord> const &deviceStatus)
+{
+    for (auto const &record: deviceStatus)
+    {
+	wcout << L"\t"sv << hex << right << setfill(L'0')
+	    << setw(4u) << record.segment << L':'
+	    << setw(2u) << (record.busLocation >> BYTE_BITSIZE & BYTE_BITMASK) << L':'
+	    << setw(2u) << (record.busLocation >> 3u & 0b0001'1111u) << L'.'
+	    << (record.busLocation & 0b0111u) << dec << setfill(L' ')
+	    << (record.flags & StatusVar_DeviceRecord_Bridge ? L" bridge: "sv : L" GPU:    "sv)
+	    << driverStatusString(record.status)
+	    << (record.status == StatusVar_Internal_EFIError ? driverErrorString(static_cast<EFIErrorLocation>(record.errorLocation)) : L""sv);
+
+	if (record.strapsStatus)
+	    wcout << L", STRAPS: "sv << driverStatusString(record.strapsStatus);
+
+	if (record.barSizeSelector < BarSizeSelector_Excluded)
+	    wcout << L", BAR1: "sv << formatBarSizeSelector(record.barSizeSelector) << L", ReBAR sizes: "sv << formatReBarSizeMask(record.reBarSizeMask);
+
+	wcout << L'\n';
+    }
+}
+
+static wstring_view const phaseTimerNames[PhaseTimer_Count] =
+{
+    L"Driver entry point"sv,
+    L"  Load configuration"sv,
+    L"  Find Setup variable"sv,
+    L"  Read Setup variable"sv,
+    L"  Setup variable CRC"sv,
+    L"  CMOS clear check"sv,
+    L"  Install bridge hook"sv,
+    L"PreprocessController hook"sv,
+    L"  STRAPS remap BAR0"sv,
+    L"  STRAPS registers"sv,
+    L"  STRAPS settle wait"sv,
+    L"  ReBAR size writes"sv
+};
+
+// Time spent by the UEFI DXE driver during the last boot, with the inner phases indented
+static void showPhaseTimers(vector<PhaseTimer_Record> const &phaseTimers, uint_least64_t ticksPerSecond)
+{
+    if (phaseTimers.empty() || !ticksPerSecond)
+	return;
+
+    wcout << L"\nUEFI DXE driver boot time:\n"sv << left << setw(32u) << L"\tPhase"sv << right << setw(8u) << L"Calls"sv << setw(14u) << L"Time (ms)"sv << L'\n';
+
+    for (auto phase = 0u; phase < phaseTimers.size(); phase++)
+	if (phaseTimers[phase].calls)
+	    wcout << L'\t' << left << setw(31u) << phaseTimerNames[phase] << right << setw(8u) << phaseTimers[phase].calls
+		<< setw(14u) << fixed << setprecision(3) << static_cast<double>(phaseTimers[phase].ticks) * 1'000.0 / static_cast<double>(ticksPerSecond) << L'\n';
+
+    wcout << L'\n';
+}
+
 static void showPciReBarState(uint_least8_t reBarState)
 {
     switch (reBarState)
@@ -479,10 +581,13 @@ static void showPciReBarState(uint_least8_t reBarState)
     }
 }
 
-void showConfiguration(vector<DeviceInfo> const &devices, NvStrapsConfig const &nvStrapsConfig, uint_least64_t driverStatus)
+void showConfiguration(vector<DeviceInfo> const &devices, NvStrapsConfig const &nvStrapsConfig, uint_least64_t driverStatus, vector<StatusVar_DeviceRecord> const &deviceStatus,
+	vector<PhaseTimer_Record> const &phaseTimers, uint_least64_t ticksPerSecond)
 {
     showLocalGPUs(devices, nvStrapsConfig);
     showDriverStatus(driverStatus);
+    showDeviceStatus(deviceStatus);
+    showPhaseTimers(phaseTimers, ticksPerSecond);
     showPciReBarState(nvStrapsConfig.targetPciBarSizeSelector());
 }
 
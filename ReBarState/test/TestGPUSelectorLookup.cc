@@ -0,0 +1,147 @@
+#include <cstdlib>
+
+#include "LocalAppConfig.h"
+#include "DeviceRegistry.h"
+#include "NvStrapsConfig.h"
+
+using std::uint_least8_t;
+using std::uint_least16_t;
+using std::array;
+using std::cerr;
+using std::endl;
+
+namespace
+{
+    bool hasSubsystem(NvStraps_GPUSelector const &selector)
+    {
+	return selector.subsysVendorID != WORD_BITMASK && selector.subsysDeviceID != WORD_BITMASK;
+    }
+
+    bool hasBusLocation(NvStraps_GPUSelector const &selector)
+    {
+	return selector.bus != BYTE_BITMASK || selector.device != BYTE_BITMASK || selector.function != BYTE_BITMASK;
+    }
+
+    // The linear lookup used before the selectors were indexed: the first match by bus location wins, otherwise the
+    // last match by subsystem, otherwise the last match by PCI ID
+    template <typename IsConfigured>
+	NvStraps_GPUSelector const *linearLookup(NvStrapsConfig const &config, uint_least16_t deviceID, uint_least16_t subsysVenID, uint_least16_t subsysDevID,
+		uint_least8_t bus, uint_least8_t dev, uint_least8_t fn, IsConfigured isConfigured, ConfigPriority &priority)
+    {
+	NvStraps_GPUSelector const *found = nullptr;
+
+	priority = UNCONFIGURED;
+
+	for (auto const &selector: std::span { config.GPUs, config.nGPUSelector })
+	    if (selector.deviceID == deviceID && isConfigured(selector))
+		if (hasSubsystem(selector))
+		{
+		    if (selector.subsysVendorID == subsysVenID && selector.subsysDeviceID == subsysDevID)
+			if (hasBusLocation(selector))
+			{
+			    if (selector.bus == bus && selector.device == dev && selector.function == fn)
+				return priority = EXPLICIT_PCI_LOCATION, &selector;
+			}
+			else
+			    priority = EXPLICIT_SUBSYSTEM_ID, found = &selector;
+		}
+		else
+		    if (priority < EXPLICIT_SUBSYSTEM_ID)
+			priority = EXPLICIT_PCI_ID, found = &selector;
+
+	return found;
+    }
+
+    NvStraps_BarSize linearLookupBarSize(NvStrapsConfig const &config, uint_least16_t deviceID, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t bus, uint_least8_t dev, uint_least8_t fn)
+    {
+	ConfigPriority priority;
+	auto selector = linearLookup(config, deviceID, subsysVenID, subsysDevID, bus, dev, fn, [](auto const &selector) { return selector.barSizeSelector != BarSizeSelector_None; }, priority);
+	auto barSizeSelector = selector ? static_cast<BarSizeSelector>(selector->barSizeSelector) : BarSizeSelector_None;
+
+	if (priority == UNCONFIGURED && NvStrapsConfig_IsGlobalEnable(&config))
+	{
+	    barSizeSelector = lookupBarSizeInRegistry(deviceID);
+
+	    if (barSizeSelector == BarSizeSelector_None)
+	    {
+		if (NvStrapsConfig_IsGlobalEnable(&config) > 1u && isTuringGPU(deviceID))
+		    return { .priority = IMPLIED_GLOBAL, .barSizeSelector = BarSizeSelector_2G };
+	    }
+	    else
+		priority = FOUND_GLOBAL;
+	}
+
+	return { .priority = priority, .barSizeSelector = barSizeSelector };
+    }
+
+    NvStraps_BarSizeMaskOverride linearLookupMaskOverride(NvStrapsConfig const &config, uint_least16_t deviceID, uint_least16_t subsysVenID, uint_least16_t subsysDevID, uint_least8_t bus, uint_least8_t dev, uint_least8_t fn)
+    {
+	ConfigPriority priority;
+	auto selector = linearLookup(config, deviceID, subsysVenID, subsysDevID, bus, dev, fn, [](auto const &selector) { return !!selector.overrideBarSizeMask; }, priority);
+
+	if (priority == UNCONFIGURED)
+	    return { .priority = FOUND_GLOBAL, .sizeMaskOverride = NvStrapsConfig_OverrideBarSizeMask(&config) };
+
+	return { .priority = priority, .sizeMaskOverride = selector->overrideBarSizeMask != 0xFFu };
+    }
+}
+
+// Compare the indexed lookup with the linear lookup, over random selector sets with few distinct IDs and locations
+int TestGPUSelectorLookup(int argc, char *argv[])
+{
+    std::mt19937 random { 0x6'9E'10'0Cu };
+
+    array<uint_least16_t, 4u> const deviceIDs { 0x1E87u, 0x2204u, 0x2684u, 0x1F08u };
+    array<uint_least16_t, 3u> const subsystems { 0x1043u, 0x1462u, WORD_BITMASK };
+    array<uint_least8_t, 3u> const buses { 0x01u, 0x41u, BYTE_BITMASK };
+    array<uint_least8_t, 4u> const barSizes { BarSizeSelector_256M, BarSizeSelector_8G, BarSizeSelector_Excluded, BarSizeSelector_None };
+    array<uint_least8_t, 3u> const maskOverrides { 0x00u, 0x01u, 0xFFu };
+
+    auto pick = [&random](auto const &values) { return values[random() % values.size()]; };
+    NvStrapsConfig config { };
+
+    for (auto iteration = 0u; iteration < 20'000u; iteration++)
+    {
+	config.nOptionFlags = static_cast<uint_least16_t>(random());
+	config.nGPUSelector = static_cast<uint_least8_t>(random() % (NvStraps_GPU_MAX_COUNT + 1u));
+
+	for (auto &selector: std::span { config.GPUs, config.nGPUSelector })
+	{
+	    auto bus = pick(buses);
+
+	    selector =
+	    {
+		.deviceID = pick(deviceIDs),
+		.subsysVendorID = pick(subsystems),
+		.subsysDeviceID = pick(subsystems),
+		.bus = bus,
+		.device = static_cast<uint_least8_t>(bus == BYTE_BITMASK ? BYTE_BITMASK : random() % 2u),
+		.function = static_cast<uint_least8_t>(bus == BYTE_BITMASK ? BYTE_BITMASK : 0u),
+		.barSizeSelector = pick(barSizes),
+		.overrideBarSizeMask = pick(maskOverrides)
+	    };
+	}
+
+	NvStrapsConfig_IndexGPUSelectors(&config);
+
+	for (auto query = 0u; query < 8u; query++)
+	{
+	    auto deviceID = pick(deviceIDs), subsysVenID = pick(subsystems), subsysDevID = pick(subsystems);
+	    auto bus = pick(buses), dev = static_cast<uint_least8_t>(random() % 2u), fn = uint_least8_t { 0u };
+
+	    auto barSize = NvStrapsConfig_LookupBarSize(&config, deviceID, subsysVenID, subsysDevID, bus, dev, fn);
+	    auto expectedBarSize = linearLookupBarSize(config, deviceID, subsysVenID, subsysDevID, bus, dev, fn);
+	    auto maskOverride = NvStrapsConfig_LookupBarSizeMaskOverride(&config, deviceID, subsysVenID, subsysDevID, bus, dev, fn);
+	    auto expectedMaskOverride = linearLookupMaskOverride(config, deviceID, subsysVenID, subsysDevID, bus, dev, fn);
+
+	    if (barSize.priority != expectedBarSize.priority || barSize.barSizeSelector != expectedBarSize.barSizeSelector
+		    || maskOverride.priority != expectedMaskOverride.priority || maskOverride.sizeMaskOverride != expectedMaskOverride.sizeMaskOverride)
+	    {
+		cerr << "TestGPUSelectorLookup: indexed lookup differs from the linear lookup at iteration " << iteration << endl;
+		return EXIT_FAILURE;
+	    }
+	}
+    }
+
+    return EXIT_SUCCESS;
+}
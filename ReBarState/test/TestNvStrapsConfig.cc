@@ -1,6 +1,234 @@
 #include <cstdlib>
 
+#include "LocalAppConfig.h"
+#include "EfiVariable.h"
+#include "NvStrapsConfig.h"
+
+using std::uint_least8_t;
+using std::uint_least16_t;
+using std::uint_least32_t;
+using std::array;
+using std::vector;
+using std::cerr;
+using std::endl;
+
+namespace
+{
+    bool sameConfig(NvStrapsConfig const &left, NvStrapsConfig const &right)
+    {
+	if (left.nPciBarSize != right.nPciBarSize || left.nOptionFlags != right.nOptionFlags || left.nSetupVarCRC != right.nSetupVarCRC
+		|| left.nGPUSelector != right.nGPUSelector || left.nGPUConfig != right.nGPUConfig || left.nBridgeConfig != right.nBridgeConfig)
+	{
+	    return false;
+	}
+
+	for (auto i = 0u; i < left.nGPUSelector; i++)
+	    if (left.GPUs[i] != right.GPUs[i])
+		return false;
+
+	for (auto i = 0u; i < left.nGPUConfig; i++)
+	    if (left.gpuConfig[i] != right.gpuConfig[i])
+		return false;
+
+	for (auto i = 0u; i < left.nBridgeConfig; i++)
+	    if (left.bridge[i] != right.bridge[i])
+		return false;
+
+	return true;
+    }
+
+    bool isCleared(NvStrapsConfig const &config)
+    {
+	return !config.nPciBarSize && !config.nOptionFlags && !config.nGPUSelector && !config.nGPUConfig && !config.nBridgeConfig;
+    }
+
+    // Original fixed layout (version 0), with every field at full length
+    vector<BYTE> packV0(NvStrapsConfig const &config)
+    {
+	vector<BYTE> buffer(NV_STRAPS_HEADER_SIZE + BYTE_SIZE + config.nGPUSelector * GPU_SELECTOR_SIZE + BYTE_SIZE + config.nGPUConfig * GPU_CONFIG_SIZE
+		+ BYTE_SIZE + config.nBridgeConfig * BRIDGE_CONFIG_SIZE);
+	BYTE *pos = buffer.data();
+
+	pos = pack_BYTE(pos, config.nPciBarSize);
+	pos = pack_WORD(pos, config.nOptionFlags);
+	pos = pack_QWORD(pos, config.nSetupVarCRC);
+	pos = pack_BYTE(pos, config.nGPUSelector);
+
+	for (auto const &selector: std::span { config.GPUs, config.nGPUSelector })
+	{
+	    pos = pack_WORD(pos, selector.deviceID);
+	    pos = pack_WORD(pos, selector.subsysVendorID);
+	    pos = pack_WORD(pos, selector.subsysDeviceID);
+	    pos = pack_BYTE(pos, selector.bus);
+	    pos = pack_BYTE(pos, selector.bus == 0xFFu && selector.device == 0xFFu && selector.function == 0xFFu ? 0xFFu : selector.device << 3u | selector.function);
+	    pos = pack_BYTE(pos, selector.barSizeSelector);
+	    pos = pack_BYTE(pos, selector.overrideBarSizeMask);
+	}
+
+	pos = pack_BYTE(pos, config.nGPUConfig);
+
+	for (auto const &gpuConfig: std::span { config.gpuConfig, config.nGPUConfig })
+	{
+	    pos = pack_WORD(pos, gpuConfig.deviceID);
+	    pos = pack_WORD(pos, gpuConfig.subsysVendorID);
+	    pos = pack_WORD(pos, gpuConfig.subsysDeviceID);
+	    pos = pack_BYTE(pos, gpuConfig.bus);
+	    pos = pack_BYTE(pos, gpuConfig.device << 3u | gpuConfig.function);
+	    pos = pack_QWORD(pos, gpuConfig.bar0.base);
+	    pos = pack_QWORD(pos, gpuConfig.bar0.top);
+	}
+
+	pos = pack_BYTE(pos, config.nBridgeConfig);
+
+	for (auto const &bridge: std::span { config.bridge, config.nBridgeConfig })
+	{
+	    pos = pack_WORD(pos, bridge.vendorID);
+	    pos = pack_WORD(pos, bridge.deviceID);
+	    pos = pack_BYTE(pos, bridge.bridgeBus);
+	    pos = pack_BYTE(pos, bridge.bridgeDevice << 3u | bridge.bridgeFunction);
+	    pos = pack_BYTE(pos, bridge.bridgeSecondaryBus);
+	}
+
+	return buffer;
+    }
+
+    // Wildcard and explicit selectors, 32-bit and 64-bit BAR0 ranges, and switch ports with the same bridge IDs
+    void fillConfig(NvStrapsConfig &config)
+    {
+	config = NvStrapsConfig { };
+	config.nPciBarSize = 32u;
+	config.nOptionFlags = 0x0005u;
+	config.nSetupVarCRC = UINT64_C(0x0123'4567'89AB'CDEF);
+
+	config.GPUs[config.nGPUSelector++] = { .deviceID = 0x2204u, .subsysVendorID = 0xFFFFu, .subsysDeviceID = 0xFFFFu, .bus = 0xFFu, .device = 0xFFu, .function = 0xFFu, .barSizeSelector = 4u, .overrideBarSizeMask = 0u };
+	config.GPUs[config.nGPUSelector++] = { .deviceID = 0x2204u, .subsysVendorID = 0x1043u, .subsysDeviceID = 0x87B3u, .bus = 0xFFu, .device = 0xFFu, .function = 0xFFu, .barSizeSelector = 6u, .overrideBarSizeMask = 1u };
+	config.GPUs[config.nGPUSelector++] = { .deviceID = 0x1E87u, .subsysVendorID = 0x1462u, .subsysDeviceID = 0x3715u, .bus = 0x41u, .device = 0x00u, .function = 0x00u, .barSizeSelector = 2u, .overrideBarSizeMask = 0xFFu };
+
+	config.gpuConfig[config.nGPUConfig++] = { .deviceID = 0x2204u, .subsysVendorID = 0xFFFFu, .subsysDeviceID = 0xFFFFu, .bus = 0x01u, .device = 0x00u, .function = 0x00u, .bar0 = { .base = 0x8000'0000u, .top = 0x80FF'FFFFu } };
+	config.gpuConfig[config.nGPUConfig++] = { .deviceID = 0x1E87u, .subsysVendorID = 0x1462u, .subsysDeviceID = 0x3715u, .bus = 0x41u, .device = 0x00u, .function = 0x00u, .bar0 = { .base = UINT64_C(0x40'0000'0000), .top = UINT64_C(0x40'00FF'FFFF) } };
+
+	config.bridge[config.nBridgeConfig++] = { .vendorID = 0x8086u, .deviceID = 0x1901u, .bridgeBus = 0x00u, .bridgeDevice = 0x01u, .bridgeFunction = 0x00u, .bridgeSecondaryBus = 0x01u };
+	config.bridge[config.nBridgeConfig++] = { .vendorID = 0x1022u, .deviceID = 0x1483u, .bridgeBus = 0x40u, .bridgeDevice = 0x03u, .bridgeFunction = 0x01u, .bridgeSecondaryBus = 0x41u };
+	config.bridge[config.nBridgeConfig++] = { .vendorID = 0x1022u, .deviceID = 0x1483u, .bridgeBus = 0x40u, .bridgeDevice = 0x03u, .bridgeFunction = 0x02u, .bridgeSecondaryBus = 0x42u };
+    }
+
+    bool check(bool condition, char const *message)
+    {
+	if (!condition)
+	    cerr << "TestNvStrapsConfig: " << message << endl;
+
+	return condition;
+    }
+}
+
 int TestNvStrapsConfig(int argc, char *argv[])
 {
+    NvStrapsConfig original, loaded, reloaded;
+    array<BYTE, NV_STRAPS_CONFIG_SIZE> buffer;
+
+    fillConfig(original);
+
+    // Version 0 loads as is, saves as version 1, and loads back the same
+    auto bufferV0 = packV0(original);
+
+    NvStrapsConfig_Load(bufferV0.data(), static_cast<unsigned>(bufferV0.size()), &loaded);
+
+    if (!check(sameConfig(original, loaded), "version 0 configuration not loaded"))
+	return EXIT_FAILURE;
+
+    unsigned size = NvStrapsConfig_Save(buffer.data(), static_cast<unsigned>(buffer.size()), &loaded);
+
+    if (!check(size && buffer[0u] == NV_STRAPS_FORMAT_MARKER && buffer[1u] == NV_STRAPS_FORMAT_VERSION, "configuration not saved as version 1"))
+	return EXIT_FAILURE;
+
+    NvStrapsConfig_Load(buffer.data(), size, &reloaded);
+
+    if (!check(sameConfig(original, reloaded), "version 1 configuration not loaded back"))
+	return EXIT_FAILURE;
+
+    // Wildcard selectors and configs omit the subsystem and location, 32-bit BAR0 ranges use DWORDs, and the last
+    // bridge has the same IDs as the previous one
+    unsigned expectedSize = NV_STRAPS_V1_HEADER_SIZE
+	+ (BYTE_SIZE + WORD_SIZE + 2u * BYTE_SIZE)
+	+ (BYTE_SIZE + 3u * WORD_SIZE + 2u * BYTE_SIZE)
+	+ (BYTE_SIZE + 3u * WORD_SIZE + 4u * BYTE_SIZE)
+	+ (BYTE_SIZE + WORD_SIZE + 2u * BYTE_SIZE + 2u * DWORD_SIZE)
+	+ (BYTE_SIZE + 3u * WORD_SIZE + 2u * BYTE_SIZE + 2u * QWORD_SIZE)
+	+ 2u * (BYTE_SIZE + 2u * WORD_SIZE + 3u * BYTE_SIZE)
+	+ (BYTE_SIZE + 3u * BYTE_SIZE);
+
+    if (!check(size == expectedSize, "unexpected record encoding size"))
+	return cerr << "    saved " << size << " bytes, expected " << expectedSize << endl, EXIT_FAILURE;
+
+    // Every truncated version 1 blob clears the configuration
+    for (unsigned length = 0u; length < size; length++)
+    {
+	fillConfig(loaded);
+	NvStrapsConfig_Load(buffer.data(), length, &loaded);
+
+	if (!check(isCleared(loaded), "truncated configuration not cleared"))
+	    return cerr << "    at length " << length << endl, EXIT_FAILURE;
+    }
+
+    // Malformed blobs: unknown version, record counts over the limits, and a first bridge that refers to a previous one
+    auto malformed = vector<vector<BYTE>> { };
+    auto saved = vector<BYTE>(buffer.begin(), buffer.begin() + size);
+
+    malformed.push_back(saved), malformed.back()[1u] = NV_STRAPS_FORMAT_VERSION + 1u;
+    malformed.push_back(saved), malformed.back()[NV_STRAPS_V1_HEADER_SIZE - 3u] = NvStraps_GPU_MAX_COUNT + 1u;
+    malformed.push_back(saved), malformed.back()[NV_STRAPS_V1_HEADER_SIZE - 2u] = NvStraps_GPU_MAX_COUNT + 1u;
+    malformed.push_back(saved), malformed.back()[NV_STRAPS_V1_HEADER_SIZE - 1u] = NvStraps_BRIDGE_MAX_COUNT + 1u;
+
+    unsigned firstBridge = expectedSize - 2u * (BYTE_SIZE + 2u * WORD_SIZE + 3u * BYTE_SIZE) - (BYTE_SIZE + 3u * BYTE_SIZE);
+
+    malformed.push_back(saved), malformed.back()[firstBridge] |= 0x08u;
+
+    for (auto &blob: malformed)
+    {
+	fillConfig(loaded);
+	NvStrapsConfig_Load(blob.data(), static_cast<unsigned>(blob.size()), &loaded);
+
+	if (!check(isCleared(loaded), "malformed configuration not cleared"))
+	    return cerr << "    blob " << &blob - malformed.data() << endl, EXIT_FAILURE;
+    }
+
+    // Loading a version 0 blob drops the Setup variable identity from an earlier load
+    array<uint_least8_t, SETUP_VAR_GUID_SIZE> setupVarGUID { 0x11u, 0x22u, 0x33u };
+    uint_least32_t setupVarSize = 0u;
+
+    NvStrapsConfig_SetSetupVarName(&loaded, SetupVarName_Setup, setupVarGUID.data(), 0x4000u);
+    NvStrapsConfig_Load(bufferV0.data(), static_cast<unsigned>(bufferV0.size()), &loaded);
+
+    if (!check(NvStrapsConfig_SetupVarName(&loaded, setupVarGUID.data(), &setupVarSize) == SetupVarName_None, "Setup variable identity kept from an earlier load"))
+	return EXIT_FAILURE;
+
+    // A truncated version 0 blob clears the configuration too
+    fillConfig(loaded);
+    NvStrapsConfig_Load(bufferV0.data(), static_cast<unsigned>(bufferV0.size() - 1u), &loaded);
+
+    if (!check(isCleared(loaded), "truncated version 0 configuration not cleared"))
+	return EXIT_FAILURE;
+
+    // The worst case fits the buffer size
+    fillConfig(original);
+
+    for (auto i = original.nGPUSelector; i < NvStraps_GPU_MAX_COUNT; i++)
+	original.GPUs[i] = original.GPUs[2u], original.GPUs[i].deviceID = static_cast<uint_least16_t>(0x2000u + i);
+
+    for (auto i = original.nGPUConfig; i < NvStraps_GPU_MAX_COUNT; i++)
+	original.gpuConfig[i] = original.gpuConfig[1u], original.gpuConfig[i].bus = static_cast<uint_least8_t>(0x50u + i);
+
+    for (auto i = original.nBridgeConfig; i < NvStraps_BRIDGE_MAX_COUNT; i++)
+	original.bridge[i] = original.bridge[0u], original.bridge[i].vendorID = static_cast<uint_least16_t>(0x1000u + i);
+
+    original.nGPUSelector = original.nGPUConfig = NvStraps_GPU_MAX_COUNT;
+    original.nBridgeConfig = NvStraps_BRIDGE_MAX_COUNT;
+
+    size = NvStrapsConfig_Save(buffer.data(), static_cast<unsigned>(buffer.size()), &original);
+    NvStrapsConfig_Load(buffer.data(), size, &reloaded);
+
+    if (!check(size && size <= NV_STRAPS_CONFIG_SIZE && sameConfig(original, reloaded), "full configuration not saved and loaded back"))
+	return EXIT_FAILURE;
+
     return EXIT_SUCCESS;
 }
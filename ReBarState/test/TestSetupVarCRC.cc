@@ -0,0 +1,55 @@
+#include <cstdlib>
+
+#include "LocalAppConfig.h"
+#include "SetupVarCRC.h"
+
+using std::uint_least64_t;
+using std::size_t;
+using std::array;
+using std::vector;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace chrono = std::chrono;
+
+int TestSetupVarCRC(int argc, char *argv[])
+{
+    std::mt19937_64 random { 0x5E7'0F'C0C0u };
+    vector<BYTE> buffer(64u * 1024u);
+
+    for (auto &value: buffer)
+	value = static_cast<BYTE>(random());
+
+    // Every length up to a few times the folding block, then some longer ones, with random seeds
+    for (size_t length = 0u; length <= buffer.size(); length += length < 1024u ? QWORD_SIZE : 1024u + QWORD_SIZE)
+    {
+	auto seed = static_cast<uint_least64_t>(random());
+	auto expected = ecma128_crc64_bitwise(buffer.data(), buffer.data() + length, seed);
+
+	if (ecma128_crc64_table(buffer.data(), buffer.data() + length, seed) != expected || ecma128_crc64(buffer.data(), buffer.data() + length, seed) != expected)
+	{
+	    cerr << "CRC64 mismatch for buffer length " << length << endl;
+	    return EXIT_FAILURE;
+	}
+    }
+
+    auto constexpr ITERATIONS = 256u;
+    array<uint_least64_t (*)(BYTE const *, BYTE const *, uint_least64_t), 3u> const crcFunctions { &ecma128_crc64_bitwise, &ecma128_crc64_table, &ecma128_crc64 };
+    array<char const *, 3u> const crcNames { "bitwise", "table", "default" };
+    uint_least64_t crcValue = 0u;
+
+    for (auto i = 0u; i < crcFunctions.size(); i++)
+    {
+	auto start = chrono::steady_clock::now();
+
+	for (auto iteration = 0u; iteration < ITERATIONS; iteration++)
+	    crcValue = crcFunctions[i](buffer.data(), buffer.data() + buffer.size(), crcValue);
+
+	auto duration = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start) / ITERATIONS;
+
+	cout << "CRC64 " << crcNames[i] << ": " << duration.count() / 1000.0 << " us for " << buffer.size() / 1024u << " KiB" << endl;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+# generate the sorted device registry table for DeviceRegistry.c from the DeviceRegistry.lst list
+# usage
+# ./genDeviceRegistry.py ../ReBarDxe/DeviceRegistry.lst ../ReBarDxe/include/DeviceRegistryTable.h
+#
+# fails on duplicate device IDs, on the same ID listed with different BAR sizes, and on IDs outside the Turing ranges
+
+import re
+import sys
+
+BAR_SIZES = [ "Excluded", "2G", "4G", "8G", "16G", "32G" ]
+
+# Same ranges as PCI_ID_RANGE_TU1xx in DeviceRegistry.c
+TURING_RANGES = [ (0x1E00, 0x1E7F), (0x1E80, 0x1EFF), (0x1F00, 0x1F7F), (0x2180, 0x21FF), (0x1F80, 0x1FFF) ]
+
+def parse(listFile):
+    entries = { }
+    barSize = None
+    errors = [ ]
+
+    with open(listFile, encoding = "utf-8") as file:
+        for lineNr, line in enumerate(file, 1):
+            line = line.strip()
+
+            if not line or line.startswith("#"):
+                continue
+
+            section = re.fullmatch(r"\[(\w+)\]", line)
+
+            if section:
+                barSize = section.group(1)
+
+                if barSize not in BAR_SIZES:
+                    errors.append(f"{listFile}:{lineNr}: unknown BAR size [{barSize}]")
+
+                continue
+
+            entry = re.fullmatch(r"0[xX]([0-9A-Fa-f]{4})\s*(.*)", line)
+
+            if not entry or barSize is None:
+                errors.append(f"{listFile}:{lineNr}: expected a device ID in a [BAR size] section")
+                continue
+
+            deviceID, description = int(entry.group(1), 16), entry.group(2).strip()
+
+            if not any(first <= deviceID <= last for first, last in TURING_RANGES):
+                errors.append(f"{listFile}:{lineNr}: device ID 0x{deviceID:04X} is not a Turing GPU")
+            elif deviceID in entries:
+                previousSize, _, previousLine = entries[deviceID]
+                kind = "duplicate" if previousSize == barSize else "conflicting"
+                errors.append(f"{listFile}:{lineNr}: {kind} device ID 0x{deviceID:04X}, first listed on line {previousLine}")
+            else:
+                entries[deviceID] = (barSize, description, lineNr)
+
+    if errors:
+        sys.exit("\n".join(errors))
+
+    return entries
+
+def generate(entries, listFile):
+    lines = [ f"// Generated by tools/genDeviceRegistry.py from {listFile.replace(chr(92), '/').split('/')[-1]}, do not edit.",
+              "// Sorted by device ID, for lookupBarSizeInRegistry() in DeviceRegistry.c",
+              "",
+              "#if !defined(NV_STRAPS_REBAR_DEVICE_REGISTRY_TABLE_H)",
+              "#define NV_STRAPS_REBAR_DEVICE_REGISTRY_TABLE_H",
+              "",
+              "#include \"DeviceRegistry.h\"",
+              "",
+              "typedef struct DeviceRegistryEntry",
+              "{",
+              "    UINT16 deviceID;",
+              "    BarSizeSelector barSize;",
+              "}",
+              "    DeviceRegistryEntry;",
+              "",
+              "#if defined(__cplusplus) && !defined(NVSTRAPS_DXE_DRIVER)",
+              "    constexpr",
+              "#else",
+              "    static",
+              "#endif",
+              "\tDeviceRegistryEntry const DeviceRegistryTable[] =",
+              "{" ]
+
+    for deviceID in sorted(entries):
+        barSize, description, _ = entries[deviceID]
+        entry = f"    {{ 0x{deviceID:04X}u, BarSizeSelector_{barSize} }},"
+        lines.append(f"{entry:<48}// {description}" if description else entry)
+
+    lines += [ "};", "", "#endif          // !defined(NV_STRAPS_REBAR_DEVICE_REGISTRY_TABLE_H)", "" ]
+
+    return "\n".join(lines)
+
+listFile, headerFile = sys.argv[1], sys.argv[2]
+
+with open(headerFile, "w", encoding = "utf-8", newline = "\n") as file:
+    file.write(generate(parse(listFile), listFile))